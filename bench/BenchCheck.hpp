@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+// BORDERLESS_BENCH_NAME is set per target by CMakeLists.txt
+#ifndef BORDERLESS_BENCH_NAME
+#define BORDERLESS_BENCH_NAME "bench"
+#endif
+
+namespace bench {
+
+    // the checks a benchmark makes before timing anything; a failure names the check and exits with 1,
+    // so the bench target fails as well
+    inline auto check(bool condition, const char *what) -> void {
+        if (!condition) {
+            std::fprintf(stderr, "%s: check failed: %s\n", BORDERLESS_BENCH_NAME, what);
+            std::exit(1);
+        }
+    }
+}
@@ -0,0 +1,247 @@
+// The property animation timeline under a fake clock: easing curves, keyframes, delay, repeat and
+// alternate, the cubic curves handed to the compositor against CPU sampling, one batch per tick
+// with replacement, cancellation and completion, bit-identical batches across runs, and the cost
+// of a tick with thousands of concurrent animations sampled on the CPU or offloaded.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "BenchCheck.hpp"
+#include "core/Animation.hpp"
+
+using namespace borderless;
+using bench::check;
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+using Duration = FrameClockType::duration;
+
+namespace {
+
+    auto near(float a, float b, float tolerance = 1e-4f) -> bool { return std::fabs(a - b) <= tolerance; }
+
+    auto elapsed_ns(Clock::time_point start) -> double {
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    auto check_easing() -> void {
+        for (const auto easing: {Easing::linear(), Easing::ease_in(), Easing::ease_out(), Easing::ease_in_out(),
+                                 Easing::cubic_bezier(0.25f, 0.1f, 0.25f, 1.0f)}) {
+            check(near(easing(0.0f), 0.0f) && near(easing(1.0f), 1.0f), "easings run from 0 to 1");
+            float previous = 0.0f;
+            for (int i = 1; i <= 100; ++i) {
+                const auto value = easing(float(i) / 100);
+                check(value >= previous - 1e-6f, "these easings do not go back");
+                previous = value;
+            }
+        }
+        for (int i = 0; i <= 20; ++i) {
+            const auto t = float(i) / 20;
+            check(near(Easing::ease_in()(t), t * t) && near(Easing::ease_out()(t), 1 - (1 - t) * (1 - t)) &&
+                  near(Easing::ease_in_out()(t), t * t * (3 - 2 * t)) && near(Easing::linear()(t), t),
+                  "named easings are their polynomials");
+            // the general Bezier solver agrees with the polynomial shortcut
+            check(near(Easing::cubic_bezier(0.3333f, 0.0f, 0.6667f, 1.0f)(t), Easing::ease_in_out()(t), 1e-3f),
+                  "bezier solver");
+        }
+        check(Easing::ease_out().polynomial() && !Easing::cubic_bezier(0.25f, 0.1f, 0.25f, 1.0f).polynomial(),
+              "only x-linear curves are polynomial");
+        // CSS ease at its midpoint
+        check(near(Easing::cubic_bezier(0.25f, 0.1f, 0.25f, 1.0f)(0.5f), 0.8024f, 1e-3f), "css ease");
+    }
+
+    auto check_sampling() -> void {
+        auto fade = tween(1, AnimatedProperty::opacity, 0.0f, 1.0f, 100ms, Easing::linear());
+        fade.delay = 50ms;
+        check(sample(fade, 0ms) == 0.0f && sample(fade, 50ms) == 0.0f, "holds the first value during the delay");
+        check(near(sample(fade, 75ms), 0.25f) && near(sample(fade, 150ms), 1.0f) && sample(fade, 1s) == 1.0f,
+              "linear progress, then holds the end");
+        check(end_time(fade) == 150ms, "end time");
+
+        Animation bounce;
+        bounce.property = AnimatedProperty::offset_y;
+        bounce.keyframes = {{0.0f, 0.0f, Easing::linear()}, {0.25f, 10.0f, Easing::linear()}, {1.0f, 0.0f, {}}};
+        bounce.duration = 200ms;
+        bounce.iterations = 3;
+        check(near(sample(bounce, 25ms), 5.0f) && near(sample(bounce, 50ms), 10.0f) &&
+              near(sample(bounce, 125ms), 5.0f), "keyframes");
+        check(near(sample(bounce, 225ms), 5.0f) && near(sample(bounce, 450ms), 10.0f), "iterations repeat");
+
+        auto swing = tween(0, AnimatedProperty::scale_x, 1.0f, 2.0f, 100ms, Easing::linear());
+        swing.alternate = true;
+        swing.iterations = 2;
+        check(near(sample(swing, 25ms), 1.25f) && near(sample(swing, 125ms), 1.75f) && sample(swing, 300ms) == 1.0f,
+              "alternate runs back and ends where it started");
+
+        bool threw = false;
+        try {
+            Animation broken;
+            broken.keyframes = {{0.0f, 0.0f, {}}, {0.6f, 1.0f, {}}, {0.5f, 0.0f, {}}, {1.0f, 0.0f, {}}};
+            validate(broken);
+        } catch (const std::invalid_argument &) {
+            threw = true;
+        }
+        check(threw, "keyframes out of order are rejected");
+    }
+
+    auto check_compositor_curves() -> void {
+        Animation pulse;
+        pulse.property = AnimatedProperty::scale_x;
+        pulse.keyframes = {{0.0f, 1.0f, Easing::ease_out()}, {0.3f, 1.2f, Easing::ease_in_out()}, {1.0f, 1.0f, {}}};
+        pulse.duration = 400ms;
+        pulse.delay = 100ms;
+        for (const uint32_t iterations: {1u, 3u, 0u}) {
+            pulse.iterations = iterations;
+            const auto curve = compositor_curve(pulse);
+            check(curve.has_value(), "polynomial keyframes go to the compositor");
+            for (int ms = 0; ms < 2000; ms += 7) {
+                const auto expected = sample(pulse, std::chrono::milliseconds(ms));
+                check(near(curve->evaluate(ms / 1000.0), expected, 2e-4f), "compositor curve matches CPU sampling");
+            }
+        }
+        pulse.keyframes[0].easing = Easing::cubic_bezier(0.25f, 0.1f, 0.25f, 1.0f);
+        check(!compositor_curve(pulse), "bezier easings stay on the CPU");
+        pulse.keyframes[0].easing = Easing::ease_out();
+        pulse.alternate = true;
+        check(!compositor_curve(pulse), "alternate stays on the CPU");
+    }
+
+    auto same(const PropertyBatch &a, const PropertyBatch &b) -> bool {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (a[i].target != b[i].target || a[i].property != b[i].property ||
+                std::memcmp(&a[i].value, &b[i].value, sizeof(float)) != 0 || (a[i].curve == nullptr) != (b[i].curve == nullptr)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // a scripted session against a fake clock; returns every batch
+    auto script(bool compositor) -> std::vector<PropertyBatch> {
+        const FrameClockType::time_point t0{};
+        Timeline timeline(compositor);
+        timeline.set_interval(16ms);
+        std::vector<PropertyBatch> batches;
+        auto tick = [&](Duration at) {
+            batches.emplace_back();
+            timeline.tick(t0 + at, batches.back());
+        };
+        timeline.add(tween(1, AnimatedProperty::opacity, 1.0f, 0.5f, 200ms));
+        auto slide = tween(1, AnimatedProperty::offset_x, 0.0f, 100.0f, 160ms, Easing::cubic_bezier(0.25f, 0.1f, 0.25f, 1.0f));
+        timeline.add(slide);
+        for (int frame = 0; frame < 8; ++frame) {
+            tick(frame * 16ms);
+        }
+        // replace the fade halfway, starting from where it is
+        const auto now = t0 + 7 * 16ms;
+        timeline.add(tween(1, AnimatedProperty::opacity, *timeline.value(1, AnimatedProperty::opacity, now), 1.0f, 100ms));
+        timeline.cancel(1, AnimatedProperty::offset_x);
+        for (int frame = 8; frame < 20; ++frame) {
+            tick(frame * 16ms);
+        }
+        return batches;
+    }
+
+    auto check_timeline() -> void {
+        const FrameClockType::time_point t0{};
+        Timeline cpu(false);
+        cpu.set_interval(16ms);
+        PropertyBatch batch;
+        check(cpu.next_wake(t0) == Duration::max(), "an empty timeline sleeps");
+        check(!cpu.add(tween(7, AnimatedProperty::opacity, 0.0f, 1.0f, 32ms, Easing::linear())), "no compositor");
+        check(cpu.due(t0), "an added animation is due");
+        cpu.tick(t0, batch);
+        check(batch.size() == 1 && batch[0].value == 0.0f && !batch[0].curve, "starts at the first tick");
+        check(cpu.next_wake(t0 + 4ms) == 12ms, "then wakes once per interval");
+        batch.clear();
+        cpu.tick(t0 + 16ms, batch);
+        check(batch.size() == 1 && near(batch[0].value, 0.5f), "sampled every tick");
+        batch.clear();
+        cpu.tick(t0 + 40ms, batch);
+        check(batch.size() == 1 && batch[0].value == 1.0f && cpu.size() == 0 && cpu.stats().completed == 1,
+              "ends on its final value");
+        check(cpu.next_wake(t0 + 40ms) == Duration::max(), "and goes idle");
+
+        Timeline offload(true);
+        check(offload.add(tween(3, AnimatedProperty::scale_x, 1.0f, 2.0f, 100ms)), "handed to the compositor");
+        batch.clear();
+        offload.tick(t0, batch);
+        check(batch.size() == 1 && batch[0].curve && near(batch[0].curve->evaluate(0.05), 1.75f),
+              "the curve goes out once");
+        check(offload.next_wake(t0 + 30ms) == 70ms, "no CPU ticks until it ends");
+        batch.clear();
+        offload.tick(t0 + 50ms, batch);
+        check(batch.empty(), "nothing to do while the compositor runs it");
+        offload.tick(t0 + 100ms, batch);
+        check(batch.size() == 1 && !batch[0].curve && batch[0].value == 2.0f, "the end value replaces the curve");
+
+        const auto first = script(true), second = script(true);
+        check(first.size() == second.size(), "same tick count");
+        for (size_t i = 0; i < first.size(); ++i) {
+            check(same(first[i], second[i]), "same batches under a fake clock");
+        }
+        size_t curves = 0, statics = 0;
+        for (const auto &b: first) {
+            for (const auto &change: b) {
+                (change.curve ? curves : statics) += 1;
+            }
+        }
+        check(curves == 2, "both fades were offloaded");
+        check(statics > 8, "the bezier slide was sampled");
+        const auto cpu_only = script(false);
+        for (const auto &b: cpu_only) {
+            for (const auto &change: b) {
+                check(!change.curve, "no curves without a compositor");
+            }
+        }
+    }
+}
+
+auto main() -> int {
+    check_easing();
+    check_sampling();
+    check_compositor_curves();
+    check_timeline();
+
+    // thousands of concurrent animations over two seconds of 60 Hz ticks
+    const FrameClockType::time_point t0{};
+    std::mt19937 rng(3);
+    std::printf("%-38s %10s %12s %12s\n", "animations", "ticks", "us/tick", "ns/anim");
+    for (const bool compositor: {false, true}) {
+        for (const uint32_t count: {1000u, 10000u}) {
+            Timeline timeline(compositor);
+            for (uint32_t i = 0; i < count; ++i) {
+                Animation animation;
+                animation.target = i;
+                animation.property = static_cast<AnimatedProperty>(rng() % 5);
+                const auto easing = i % 3 == 0 ? Easing::cubic_bezier(0.25f, 0.1f, 0.25f, 1.0f) : Easing::ease_in_out();
+                animation.keyframes = {{0.0f, 0.0f, easing}, {0.5f, float(rng() % 100), easing}, {1.0f, 1.0f, {}}};
+                animation.duration = std::chrono::milliseconds(200 + rng() % 800);
+                animation.iterations = 0;
+                timeline.add(std::move(animation));
+            }
+            PropertyBatch batch;
+            batch.reserve(count);
+            const int ticks = 120;
+            const auto start = Clock::now();
+            for (int i = 0; i < ticks; ++i) {
+                batch.clear();
+                timeline.tick(t0 + i * 16'667us, batch);
+            }
+            const auto per_tick = elapsed_ns(start) / ticks;
+            check(timeline.size() == count, "repeating animations keep running");
+            char name[64];
+            std::snprintf(name, sizeof(name), "%u, %s", count, compositor ? "compositor where possible" : "CPU sampled");
+            std::printf("%-38s %10d %12.1f %12.1f\n", name, ticks, per_tick / 1e3, per_tick / count);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,300 @@
+// The asset pack that replaces LoadImage(L"../assets/penguin.ico", LR_LOADFROMFILE): LZ4 round
+// trips and malformed-input rejection, pack build/open/lookup, icon directory parsing and
+// per-DPI image selection, and the cost of opening a pack cold (pages evicted) and warm.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BenchCheck.hpp"
+#include "core/AssetPack.hpp"
+#include "core/IconFile.hpp"
+#include "core/Lz4.hpp"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace borderless;
+using bench::check;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    auto elapsed_ns(Clock::time_point start) -> double {
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    auto random_bytes(std::mt19937 &rng, size_t size) -> std::vector<uint8_t> {
+        std::vector<uint8_t> bytes(size);
+        for (auto &b: bytes) {
+            b = static_cast<uint8_t>(rng());
+        }
+        return bytes;
+    }
+
+    // BGRA pixels with flat runs and a repeating gradient, like an icon's DIB
+    auto icon_like_bytes(std::mt19937 &rng, size_t size) -> std::vector<uint8_t> {
+        std::vector<uint8_t> bytes(size);
+        for (size_t i = 0; i < size; ++i) {
+            const auto pixel = i / 4;
+            bytes[i] = (pixel / 64) % 3 == 0 ? 0 : static_cast<uint8_t>(pixel % 64 * 4 + (i % 4) * 16);
+        }
+        for (size_t i = 0; i < size / 100; ++i) {
+            bytes[rng() % size] = static_cast<uint8_t>(rng());
+        }
+        return bytes;
+    }
+
+    auto round_trips(const std::vector<uint8_t> &input) -> bool {
+        std::vector<uint8_t> compressed;
+        lz4::compress(view(input), compressed);
+        if (compressed.size() > lz4::compress_bound(input.size())) {
+            return false;
+        }
+        std::vector<uint8_t> output(input.size() + 1);
+        return lz4::decompress(view(compressed), output.data(), output.size()) == input.size() &&
+               std::equal(input.begin(), input.end(), output.begin());
+    }
+
+    auto put16(std::vector<uint8_t> &out, uint16_t value) -> void {
+        out.push_back(static_cast<uint8_t>(value));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+    }
+
+    auto put32(std::vector<uint8_t> &out, uint32_t value) -> void {
+        put16(out, static_cast<uint16_t>(value));
+        put16(out, static_cast<uint16_t>(value >> 16));
+    }
+
+    struct SyntheticImage {
+        int32_t size;
+        uint16_t bit_count;
+        bool png;
+    };
+
+    // an .ico with one DIB (or PNG) per entry; the pixels are not valid, only the layout is
+    auto build_icon(std::mt19937 &rng, const std::vector<SyntheticImage> &images) -> std::vector<uint8_t> {
+        std::vector<uint8_t> out;
+        put16(out, 0);
+        put16(out, 1);
+        put16(out, static_cast<uint16_t>(images.size()));
+        std::vector<std::vector<uint8_t>> payloads;
+        for (const auto &image: images) {
+            std::vector<uint8_t> payload;
+            if (image.png) {
+                payload = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+                const auto body = random_bytes(rng, 256);
+                payload.insert(payload.end(), body.begin(), body.end());
+            } else {
+                put32(payload, 40);
+                put32(payload, static_cast<uint32_t>(image.size));
+                put32(payload, static_cast<uint32_t>(image.size * 2)); // XOR + AND mask
+                put16(payload, 1);
+                put16(payload, image.bit_count);
+                const auto pixels = icon_like_bytes(rng, static_cast<size_t>(image.size) * image.size * image.bit_count / 8);
+                payload.resize(40);
+                payload.insert(payload.end(), pixels.begin(), pixels.end());
+            }
+            payloads.push_back(std::move(payload));
+        }
+        uint32_t offset = static_cast<uint32_t>(6 + 16 * images.size());
+        for (size_t i = 0; i < images.size(); ++i) {
+            out.push_back(static_cast<uint8_t>(images[i].size >= 256 ? 0 : images[i].size));
+            out.push_back(static_cast<uint8_t>(images[i].size >= 256 ? 0 : images[i].size));
+            out.push_back(0);
+            out.push_back(0);
+            put16(out, 1);
+            put16(out, images[i].bit_count);
+            put32(out, static_cast<uint32_t>(payloads[i].size()));
+            put32(out, offset);
+            offset += static_cast<uint32_t>(payloads[i].size());
+        }
+        for (const auto &payload: payloads) {
+            out.insert(out.end(), payload.begin(), payload.end());
+        }
+        return out;
+    }
+
+    auto evict(const std::string &path) -> bool {
+#if defined(_WIN32)
+        (void) path;
+        return false;
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        ::fdatasync(fd);
+        const bool evicted = ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+        ::close(fd);
+        return evicted;
+#endif
+    }
+}
+
+int main() {
+    std::mt19937 rng(11);
+
+    // LZ4 block codec
+    for (const size_t size: {size_t{0}, size_t{1}, size_t{12}, size_t{13}, size_t{100}, size_t{4096},
+                             size_t{70'000}, size_t{1 << 20}}) {
+        check(round_trips(random_bytes(rng, size)), "random data round trips");
+        check(round_trips(icon_like_bytes(rng, size)), "compressible data round trips");
+        check(round_trips(std::vector<uint8_t>(size, 0xAB)), "a single repeated byte round trips");
+    }
+    {
+        const auto input = icon_like_bytes(rng, 1 << 16);
+        std::vector<uint8_t> compressed;
+        lz4::compress(view(input), compressed);
+        std::vector<uint8_t> output(input.size());
+        check(lz4::decompress(view(compressed), output.data(), output.size() - 1) == SIZE_MAX,
+              "output that does not fit is rejected");
+        for (size_t cut = 1; cut < 64; ++cut) {
+            check(lz4::decompress({compressed.data(), compressed.size() - cut}, output.data(), output.size()) !=
+                  input.size(), "truncated input does not decode to the full size");
+        }
+        const uint8_t bad_offset[] = {0x14, 'a', 0x05, 0x00, 0x50, 'b', 'c', 'd', 'e', 'f'};
+        check(lz4::decompress({bad_offset, sizeof(bad_offset)}, output.data(), output.size()) == SIZE_MAX,
+              "a match before the start of the output is rejected");
+        check(lz4::decompress({}, output.data(), output.size()) == SIZE_MAX, "empty input is rejected");
+        for (int i = 0; i < 2000; ++i) {
+            auto corrupt = compressed;
+            corrupt[rng() % corrupt.size()] = static_cast<uint8_t>(rng());
+            lz4::decompress(view(corrupt), output.data(), output.size()); // must stay in bounds
+        }
+    }
+
+    // icon directories
+    const auto icon_bytes = build_icon(rng, {{16, 32, false}, {32, 32, false}, {32, 8, false}, {48, 32, false},
+                                             {64, 32, false}, {256, 32, true}});
+    const auto icon = parse_icon(view(icon_bytes));
+    check(icon && icon->images.size() == 6, "icon directory parses");
+    check(icon->images[5].png && icon->images[5].width == 256 && !icon->images[0].png, "png and 256px entries");
+    check(best_icon_image(*icon, 32)->width == 32 && best_icon_image(*icon, 32)->bit_count == 32,
+          "exact size, higher bit depth");
+    check(best_icon_image(*icon, 40)->width == 48, "next larger size");
+    check(best_icon_image(*icon, 512)->width == 256, "largest when none is large enough");
+    check(best_icon_image(IconFile{}, 32) == nullptr, "empty icon");
+    check(icon_size_for_dpi(32, 96) == 32 && icon_size_for_dpi(32, 120) == 40 && icon_size_for_dpi(32, 144) == 48 &&
+          icon_size_for_dpi(16, 168) == 28, "dpi scaling");
+    auto truncated = icon_bytes;
+    truncated.resize(truncated.size() - 1);
+    check(!parse_icon(view(truncated)), "truncated image is rejected");
+    check(!parse_icon({icon_bytes.data(), 20}), "truncated directory is rejected");
+
+    // pack build, open and lookups
+    AssetPackWriter writer;
+    writer.add("penguin.ico", icon_bytes);
+    writer.add("noise.bin", random_bytes(rng, 100'000));
+    writer.add("stored.bin", icon_like_bytes(rng, 10'000), false);
+    writer.add("empty.txt", {});
+    for (int i = 0; i < 200; ++i) {
+        writer.add("filler/" + std::to_string(i) + ".bin", icon_like_bytes(rng, 1000 + i * 37));
+    }
+    writer.add("stored.bin", icon_like_bytes(rng, 10'000), false); // replaces
+    const std::string path = "asset_pack_bench.pack";
+    check(writer.write(path), "write pack");
+
+    {
+        AssetPack pack;
+        check(pack.open(path), "open pack");
+        check(pack.size() == 204, "entry count");
+        const auto ico = pack.get("penguin.ico");
+        check(ico && ico->size == icon_bytes.size() &&
+              std::equal(icon_bytes.begin(), icon_bytes.end(), ico->data), "compressed entry round trips");
+        check(pack.decoded_bytes() == icon_bytes.size(), "decoded on first access");
+        check(pack.get("penguin.ico")->data == ico->data && pack.decoded_bytes() == icon_bytes.size(),
+              "decoded once");
+        check(pack.get("noise.bin")->size == 100'000 && pack.decoded_bytes() == icon_bytes.size(),
+              "incompressible data is stored raw");
+        check(pack.get("empty.txt") && pack.get("empty.txt")->empty(), "empty entry");
+        check(!pack.get("missing.ico") && !pack.contains("penguin"), "missing entries");
+        check(parse_icon(*ico).has_value(), "icon parses from the pack");
+    }
+
+    {
+        auto bytes = writer.build();
+        AssetPack pack;
+        check(pack.open(view(bytes)) && pack.contains("filler/7.bin"), "open from memory");
+        bytes[0] = 'X';
+        check(!pack.open(view(bytes)) && !pack.error().empty(), "bad magic is rejected");
+        bytes[0] = 'B';
+        bytes.resize(100);
+        check(!pack.open(view(bytes)), "truncated index is rejected");
+        check(!pack.open("does/not/exist.pack"), "missing file");
+    }
+
+    // timings
+    const int opens = 200;
+    double cold = 0;
+    bool evicted = true;
+    for (int i = 0; i < opens / 10; ++i) {
+        evicted &= evict(path);
+        const auto start = Clock::now();
+        AssetPack pack;
+        pack.open(path);
+        const auto ico = pack.get("penguin.ico");
+        cold += elapsed_ns(start);
+        check(ico.has_value(), "cold open");
+    }
+    cold /= opens / 10;
+
+    double warm = 0;
+    for (int i = 0; i < opens; ++i) {
+        const auto start = Clock::now();
+        AssetPack pack;
+        pack.open(path);
+        const auto ico = pack.get("penguin.ico");
+        warm += elapsed_ns(start);
+        check(ico.has_value(), "warm open");
+    }
+    warm /= opens;
+
+    AssetPack pack;
+    pack.open(path);
+    const auto names = pack.names();
+    std::vector<std::string> keys(names.begin(), names.end());
+    const int lookups = 1'000'000;
+    size_t found = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < lookups; ++i) {
+        found += pack.contains(keys[static_cast<size_t>(i) % keys.size()]);
+    }
+    const auto lookup = elapsed_ns(start) / lookups;
+    check(found == static_cast<size_t>(lookups), "every name is found");
+
+    const auto pixels = icon_like_bytes(rng, 128 * 128 * 4);
+    std::vector<uint8_t> compressed;
+    lz4::compress(view(pixels), compressed);
+    std::vector<uint8_t> output(pixels.size());
+    const int decodes = 2000;
+    start = Clock::now();
+    for (int i = 0; i < decodes; ++i) {
+        check(lz4::decompress(view(compressed), output.data(), output.size()) == pixels.size(), "decode");
+    }
+    const auto decode_mb_s = pixels.size() * double{decodes} / (elapsed_ns(start) / 1e9) / 1e6;
+    compressed.clear();
+    start = Clock::now();
+    for (int i = 0; i < decodes / 10; ++i) {
+        compressed.clear();
+        lz4::compress(view(pixels), compressed);
+    }
+    const auto encode_mb_s = pixels.size() * double{decodes / 10} / (elapsed_ns(start) / 1e9) / 1e6;
+    std::remove(path.c_str());
+
+    std::printf("%-34s %10s\n", "operation", "value");
+    std::printf("%-34s %10.1f us%s\n", "open + get icon, cold", cold / 1e3, evicted ? "" : " (not evicted)");
+    std::printf("%-34s %10.1f us\n", "open + get icon, warm", warm / 1e3);
+    std::printf("%-34s %10.1f ns\n", "lookup by name", lookup);
+    std::printf("%-34s %10.0f MB/s\n", "lz4 decode, 128x128 BGRA", decode_mb_s);
+    std::printf("%-34s %10.0f MB/s\n", "lz4 encode, 128x128 BGRA", encode_mb_s);
+    std::printf("%-34s %10.2f\n", "ratio, 128x128 BGRA", double(pixels.size()) / compressed.size());
+    return 0;
+}
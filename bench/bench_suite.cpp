@@ -0,0 +1,465 @@
+// The hot paths of src/core in one statistically sound run: hit-testing, message dispatch, the
+// brush and LRU caches, frame scheduling, resize coalescing, animation, damage tracking, the CPU
+// rendering kernels, LZ4 and a message replay. Every benchmark is warmed up and timed over
+// repeated runs; the table shows the median and spread. --json keeps the samples, and --baseline
+// compares against an earlier --json with a rank-sum test, exiting with 1 on a significant
+// regression or, unless --filter is given, a baseline benchmark that did not run.
+//
+//   bench_suite [--filter text] [--runs n] [--warmup n] [--min-time ms] [--list]
+//               [--json results.json] [--baseline baseline.json] [--threshold percent] [--alpha p]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BenchCheck.hpp"
+#include "core/Animation.hpp"
+#include "core/Benchmark.hpp"
+#include "core/BrushCache.hpp"
+#include "core/CpuRenderer.hpp"
+#include "core/Damage.hpp"
+#include "core/FrameScheduler.hpp"
+#include "core/HitTester.hpp"
+#include "core/LruCache.hpp"
+#include "core/Lz4.hpp"
+#include "core/MessageDispatcher.hpp"
+#include "core/MessageReplay.hpp"
+#include "core/MonitorTopology.hpp"
+#include "core/ResizeCoalescer.hpp"
+
+using namespace borderless;
+using bench::check;
+using namespace std::chrono_literals;
+
+namespace {
+
+    // the statistics the gate relies on
+    auto check_statistics() -> void {
+        std::vector<double> a, b, c;
+        std::mt19937 rng(5);
+        std::normal_distribution<double> noise(100.0, 2.0);
+        for (int i = 0; i < 15; ++i) {
+            a.push_back(noise(rng));
+            b.push_back(noise(rng));
+            c.push_back(noise(rng) * 1.2);
+        }
+        check(rank_sum_p_value(a, b) > 0.01, "same distribution is not significant");
+        check(rank_sum_p_value(a, c) < 1e-4, "a 20% shift is significant");
+        check(rank_sum_p_value({1, 1, 1}, {1, 1, 1}) == 1.0, "all ties");
+
+        BenchmarkResult base{"x", 10, a}, same{"x", 10, b}, slow{"x", 10, c};
+        summarize(base);
+        summarize(same);
+        summarize(slow);
+        check(base.p10 <= base.median && base.median <= base.p90, "percentiles in order");
+        check(compare({base}, {same})[0].verdict == BenchmarkVerdict::unchanged, "noise is unchanged");
+        check(compare({base}, {slow})[0].verdict == BenchmarkVerdict::slower, "regression flagged");
+        check(compare({slow}, {base})[0].verdict == BenchmarkVerdict::faster, "improvement flagged");
+        check(compare({}, {base})[0].verdict == BenchmarkVerdict::added, "new benchmark");
+        const auto dropped = compare({base}, {});
+        check(dropped.size() == 1 && dropped[0].verdict == BenchmarkVerdict::missing, "dropped benchmark");
+        check(regressions(dropped) == 1 && regressions(dropped, true) == 0, "missing fails unless filtered");
+
+        base.name = "quote\" and \\";
+        std::vector<BenchmarkResult> parsed;
+        check(parse_json(to_json({base, slow}), parsed) && parsed.size() == 2, "json round trip");
+        check(parsed[0].name == base.name && parsed[0].samples.size() == a.size() &&
+              std::abs(parsed[0].median - base.median) < 1e-3, "json keeps name and samples");
+        check(!parse_json("{\"version\":2,\"benchmarks\":[]}", parsed), "other versions rejected");
+        check(!parse_json("{\"benchmarks\":[{\"name\":\"x\",", parsed), "truncated json rejected");
+    }
+
+    auto add_hit_testing(BenchmarkSuite &suite) -> void {
+        auto tester = std::make_shared<HitTester>();
+        const Rect window{100, 100, 1380, 820};
+        tester->update({8, 8}, window);
+        tester->add_region({{0, 0, 0, 32}, HitResult::caption, anchor_left | anchor_right | anchor_top});
+        tester->add_region({{-138, 0, -92, 32}, HitResult::minimize_button, anchor_right | anchor_top});
+        tester->add_region({{-92, 0, -46, 32}, HitResult::maximize_button, anchor_right | anchor_top});
+        tester->add_region({{-46, 0, 0, 32}, HitResult::close_button, anchor_right | anchor_top});
+        auto points = std::make_shared<std::vector<Point>>();
+        std::mt19937 rng(1);
+        for (int i = 0; i < 1024; ++i) {
+            points->push_back({90 + static_cast<int32_t>(rng() % 1300), 90 + static_cast<int32_t>(rng() % 740)});
+        }
+        suite.add("hit_test/lookup", [tester, points](uint64_t n) {
+            uint64_t sum = 0;
+            for (uint64_t i = 0; i < n; ++i) {
+                sum += static_cast<uint64_t>(tester->hit_test((*points)[i & 1023]));
+            }
+            return sum;
+        });
+        suite.add("hit_test/update", [tester, window](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                tester->update({8, 8}, window.offset(static_cast<int32_t>(i & 7), 0));
+            }
+            tester->update({8, 8}, window);
+            return static_cast<uint64_t>(tester->window_rect().left);
+        });
+    }
+
+    struct DispatchTarget {
+        uint64_t hits = 0;
+        uint64_t sizes = 0;
+    };
+
+    auto add_dispatch(BenchmarkSuite &suite) -> void {
+        using Dispatcher = MessageDispatcher<DispatchTarget, true>;
+        auto dispatcher = std::make_shared<Dispatcher>();
+        dispatcher->on(wm::nchittest, "WM_NCHITTEST", [](DispatchTarget &t, const Message &) -> std::optional<intptr_t> {
+            return static_cast<intptr_t>(++t.hits & 1);
+        });
+        dispatcher->on(wm::size, "WM_SIZE", [](DispatchTarget &t, const Message &) -> std::optional<intptr_t> {
+            ++t.sizes;
+            return std::nullopt;
+        });
+        dispatcher->on(wm::tray_icon, "WM_TRAY_ICON", [](DispatchTarget &, const Message &) -> std::optional<intptr_t> {
+            return 0;
+        });
+        // a drag: hit-tests and mouse moves, now and then a resize or a tray message
+        auto stream = std::make_shared<std::vector<Message>>();
+        for (uint32_t i = 0; i < 1024; ++i) {
+            const auto id = i % 64 == 0 ? wm::size : i % 97 == 0 ? wm::tray_icon : i % 2 ? wm::nchittest : wm::mousemove;
+            stream->push_back({id, 0, static_cast<intptr_t>(i)});
+        }
+        auto target = std::make_shared<DispatchTarget>();
+        for (const bool instrumented: {false, true}) {
+            suite.add(instrumented ? "dispatch/instrumented" : "dispatch/plain", [=](uint64_t n) {
+                dispatcher->set_instrumentation(instrumented);
+                intptr_t sum = 0;
+                for (uint64_t i = 0; i < n; ++i) {
+                    sum += dispatcher->dispatch(*target, (*stream)[i & 1023], [] { return intptr_t{1}; });
+                }
+                return static_cast<uint64_t>(sum);
+            });
+        }
+    }
+
+    struct KeyBackend {
+        using Brush = std::shared_ptr<BrushKey>;
+
+        auto create_brush(const BrushKey &key) -> Brush { return std::make_shared<BrushKey>(key); }
+    };
+
+    auto add_caches(BenchmarkSuite &suite) -> void {
+        auto brushes = std::make_shared<BrushCache<KeyBackend>>(KeyBackend{}, 128);
+        auto colors = std::make_shared<std::vector<Color>>();
+        std::mt19937 rng(2);
+        for (int i = 0; i < 1024; ++i) {
+            const auto shade = float(rng() % 32) / 31.0f;
+            colors->push_back({shade, 1.0f - shade, 0.5f, 1.0f});
+        }
+        suite.add("brush_cache/solid", [brushes, colors](uint64_t n) {
+            uintptr_t sum = 0;
+            for (uint64_t i = 0; i < n; ++i) {
+                if ((i & 1023) == 0) {
+                    brushes->begin_frame();
+                }
+                sum += reinterpret_cast<uintptr_t>(brushes->solid((*colors)[i & 1023]).get());
+            }
+            return static_cast<uint64_t>(sum);
+        });
+
+        auto lru = std::make_shared<LruCache<uint32_t, uint64_t>>(256);
+        suite.add("lru_cache/get_or_create", [lru](uint64_t n) {
+            uint64_t sum = 0;
+            uint32_t key = 1;
+            for (uint64_t i = 0; i < n; ++i) {
+                key = key * 1664525u + 1013904223u;
+                // mostly hits, with a tail of misses that evict
+                const auto id = (key >> 8) % ((key & 15) ? 200u : 4000u);
+                sum += lru->get_or_create(id, [&] { return uint64_t{id} * 3; });
+            }
+            return sum;
+        });
+    }
+
+    struct FakeClock : FrameClock {
+        auto now() const -> FrameClockType::time_point override { return time; }
+
+        FrameClockType::time_point time = FrameClockType::time_point{} + 1h;
+    };
+
+    struct FakePresenter : FramePresenter {
+        auto ready(FrameClockType::duration) -> bool override { return true; }
+
+        auto present() -> void override { ++presents; }
+
+        uint64_t presents = 0;
+    };
+
+    auto add_scheduling(BenchmarkSuite &suite) -> void {
+        struct Fixture {
+            FakeClock clock;
+            FakePresenter presenter;
+            FrameScheduler scheduler{clock, presenter};
+            ResizeCoalescer resizer;
+            Timeline timeline;
+            PropertyBatch batch;
+        };
+        auto f = std::make_shared<Fixture>();
+        suite.add("frame_scheduler/tick", [f](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                f->clock.time += 1ms;
+                if (i % 4 == 0) {
+                    f->scheduler.request_frame();
+                }
+                f->scheduler.tick([] { return true; });
+            }
+            return f->presenter.presents;
+        });
+        suite.add("resize_coalescer/storm", [f](uint64_t n) {
+            uint64_t applied = 0;
+            for (uint64_t i = 0; i < n; ++i) {
+                f->clock.time += 2ms;
+                f->resizer.request({800 + static_cast<int32_t>(i & 255), 600});
+                f->resizer.apply(f->clock.time, [&](Size) { ++applied; });
+            }
+            return applied;
+        });
+        suite.add("timeline/64_tweens", [f](uint64_t n) {
+            uint64_t changes = 0;
+            for (uint64_t i = 0; i < n; ++i) {
+                if (f->timeline.size() == 0) {
+                    for (uint32_t target = 0; target < 64; ++target) {
+                        f->timeline.add(tween(target, AnimatedProperty::opacity, 0.0f, 1.0f, 500ms));
+                    }
+                }
+                f->clock.time += 16ms;
+                f->batch.clear();
+                f->timeline.tick(f->clock.time, f->batch);
+                changes += f->batch.size();
+            }
+            return changes;
+        });
+
+        auto monitors = std::make_shared<MonitorTopology>();
+        monitors->update({{1, {0, 0, 2560, 1440}, {0, 0, 2560, 1400}, 144, true},
+                          {2, {2560, 0, 4480, 1080}, {2560, 0, 4480, 1040}, 96, false},
+                          {3, {-1920, 200, 0, 1280}, {-1920, 200, 0, 1240}, 96, false}});
+        suite.add("monitor_topology/from_point", [monitors](uint64_t n) {
+            uintptr_t sum = 0;
+            for (uint64_t i = 0; i < n; ++i) {
+                const Point p{static_cast<int32_t>(i * 37 % 6400) - 1920, static_cast<int32_t>(i * 11 % 1440)};
+                if (const auto monitor = monitors->from_point(p)) {
+                    sum += monitor->handle;
+                }
+            }
+            return static_cast<uint64_t>(sum);
+        });
+
+        auto damage = std::make_shared<DamageRegion>();
+        damage->set_surface({0, 0, 1920, 1080});
+        suite.add("damage/add_32", [damage](uint64_t n) {
+            int64_t area = 0;
+            for (uint64_t i = 0; i < n; ++i) {
+                damage->clear();
+                for (int32_t r = 0; r < 32; ++r) {
+                    const auto x = (r * 181 + static_cast<int32_t>(i)) % 1800, y = (r * 97) % 1000;
+                    damage->add({x, y, x + 40 + r, y + 30});
+                }
+                area += damage->area();
+            }
+            return static_cast<uint64_t>(area);
+        });
+    }
+
+    auto add_rendering(BenchmarkSuite &suite) -> void {
+        const auto level = kernels::detect_simd();
+        const auto *k = &kernels::kernels(level);
+        constexpr size_t pixels = 64 * 1024;
+        auto dst = std::make_shared<std::vector<uint32_t>>(pixels, 0xff204060u);
+        auto src = std::make_shared<std::vector<uint32_t>>(pixels, 0xc0604020u);
+        auto mask = std::make_shared<std::vector<uint8_t>>(pixels);
+        for (size_t i = 0; i < pixels; ++i) {
+            (*mask)[i] = static_cast<uint8_t>(i * 7);
+        }
+        // per call over 64K pixels
+        suite.add("kernels/fill_64k", [dst, k](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                k->fill(dst->data(), pixels, 0xff000000u | static_cast<uint32_t>(i));
+            }
+            return uint64_t{(*dst)[pixels / 2]};
+        });
+        suite.add("kernels/blend_solid_64k", [dst, k](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                k->blend_solid(dst->data(), pixels, 0x80402010u);
+            }
+            return uint64_t{(*dst)[pixels / 2]};
+        });
+        suite.add("kernels/blend_mask_64k", [dst, mask, k](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                k->blend_mask(dst->data(), mask->data(), pixels, 0xff000000u);
+            }
+            return uint64_t{(*dst)[pixels / 2]};
+        });
+        suite.add("kernels/blend_bitmap_64k", [dst, src, k](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                k->blend_bitmap(dst->data(), src->data(), pixels, 200);
+            }
+            return uint64_t{(*dst)[pixels / 2]};
+        });
+
+        struct Frame {
+            Surface surface;
+            std::unique_ptr<CpuRenderer> renderer;
+        };
+        auto frame = std::make_shared<Frame>();
+        frame->surface.resize(480, 400);
+        frame->renderer = std::make_unique<CpuRenderer>(frame->surface, level);
+        // the sample's scene: background, a panel, the ellipse
+        suite.add("cpu_renderer/frame_480x400", [frame](uint64_t n) {
+            auto &r = *frame->renderer;
+            for (uint64_t i = 0; i < n; ++i) {
+                r.begin_frame();
+                r.clear({1.0f, 1.0f, 1.0f, 1.0f});
+                r.fill_rect({0.0f, 0.0f, 480.0f, 32.0f}, {0.2f, 0.2f, 0.2f, 1.0f});
+                r.fill_ellipse({240.0f, 216.0f}, 150.0f, 150.0f, {0.18f, 0.55f, 0.34f, 0.75f});
+                r.end_frame();
+            }
+            return uint64_t{frame->surface.row(216)[240]};
+        });
+
+        std::vector<uint8_t> raw(256 * 1024);
+        std::mt19937 rng(3);
+        for (size_t i = 0; i < raw.size(); ++i) {
+            // compressible, like icon and bitmap data
+            raw[i] = static_cast<uint8_t>((i / 64) % 16 == 0 ? rng() : i / 512);
+        }
+        auto compressed = std::make_shared<std::vector<uint8_t>>();
+        lz4::compress(view(raw), *compressed);
+        auto out = std::make_shared<std::vector<uint8_t>>(raw.size());
+        suite.add("lz4/decompress_256k", [compressed, out](uint64_t n) {
+            uint64_t sum = 0;
+            for (uint64_t i = 0; i < n; ++i) {
+                sum += lz4::decompress(view(*compressed), out->data(), out->size());
+            }
+            return sum;
+        });
+    }
+
+    auto add_replay(BenchmarkSuite &suite) -> void {
+        // a second of dragging and resizing by the corner
+        auto messages = std::make_shared<std::vector<RecordedMessage>>();
+        for (uint32_t i = 0; i < 1000; ++i) {
+            RecordedMessage m;
+            m.time_ns = i * 1'000'000ull;
+            const auto x = static_cast<intptr_t>(200 + i / 2), y = static_cast<intptr_t>(300 + i / 4);
+            m.message = {wm::nchittest, 0, y << 16 | x};
+            messages->push_back(m);
+            if (i % 3 == 0) {
+                m.message = {wm::size, 0, y << 16 | x};
+                messages->push_back(m);
+            }
+        }
+        suite.add("replay/drag_1000_messages", [messages](uint64_t n) {
+            uint64_t sum = 0;
+            for (uint64_t i = 0; i < n; ++i) {
+                sum += replay(*messages).checksum;
+            }
+            return sum;
+        });
+    }
+
+    auto usage() -> int {
+        std::fprintf(stderr, "usage: bench_suite [--filter text] [--runs n] [--warmup n] [--min-time ms] [--list]\n"
+                             "                   [--json results.json] [--baseline baseline.json]\n"
+                             "                   [--threshold percent] [--alpha p]\n");
+        return 2;
+    }
+}
+
+int main(int argc, char **argv) {
+    BenchmarkOptions options;
+    CompareOptions compare_options;
+    std::string json, baseline_path;
+    bool list = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg == "--list") {
+            list = true;
+            continue;
+        }
+        if (!value) {
+            return usage();
+        }
+        ++i;
+        if (arg == "--filter") {
+            options.filter = value;
+        } else if (arg == "--runs") {
+            options.runs = static_cast<uint32_t>(std::max(2, std::atoi(value)));
+        } else if (arg == "--warmup") {
+            options.warmup_runs = static_cast<uint32_t>(std::max(0, std::atoi(value)));
+        } else if (arg == "--min-time") {
+            options.min_run_time = std::chrono::milliseconds(std::max(1, std::atoi(value)));
+        } else if (arg == "--json") {
+            json = value;
+        } else if (arg == "--baseline") {
+            baseline_path = value;
+        } else if (arg == "--threshold") {
+            compare_options.threshold = std::atof(value) / 100.0;
+        } else if (arg == "--alpha") {
+            compare_options.alpha = std::atof(value);
+        } else {
+            return usage();
+        }
+    }
+
+    check_statistics();
+
+    BenchmarkSuite suite;
+    add_hit_testing(suite);
+    add_dispatch(suite);
+    add_caches(suite);
+    add_scheduling(suite);
+    add_rendering(suite);
+    add_replay(suite);
+    if (list) {
+        for (const auto &name: suite.names()) {
+            std::printf("%s\n", name.c_str());
+        }
+        return 0;
+    }
+
+    // load first, so a bad path does not cost a whole run
+    std::vector<BenchmarkResult> baseline;
+    if (!baseline_path.empty() && !load_results(baseline_path, baseline)) {
+        std::fprintf(stderr, "bench_suite: cannot read %s\n", baseline_path.c_str());
+        return 2;
+    }
+
+    std::printf("%u runs after %u warm-up, at least %lld ms each, kernels: %s\n", options.runs,
+                options.warmup_runs,
+                static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                        options.min_run_time).count()),
+                kernels::simd_level_name(kernels::detect_simd()));
+    const auto results = suite.run(options);
+    check(!results.empty(), "the filter matches a benchmark");
+    check(suite.sink() != 0, "the workloads ran");
+    std::printf("%s", format_benchmark_results(results).c_str());
+
+    if (!json.empty()) {
+        check(save_results(results, json), "results written");
+        std::printf("wrote %s\n", json.c_str());
+    }
+    if (!baseline_path.empty()) {
+        const auto comparisons = compare(baseline, results, compare_options);
+        std::printf("\nagainst %s (threshold %.1f%%, alpha %g):\n%s", baseline_path.c_str(),
+                    100.0 * compare_options.threshold, compare_options.alpha,
+                    format_comparison(comparisons).c_str());
+        // a filtered run leaves out baseline benchmarks on purpose
+        if (const auto failed = regressions(comparisons, !options.filter.empty())) {
+            std::printf("%zu regression(s) or missing benchmark(s)\n", failed);
+            return 1;
+        }
+    }
+    return 0;
+}
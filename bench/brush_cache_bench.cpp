@@ -0,0 +1,166 @@
+// The brush cache against a fake backend: one brush per key, trimming of cold brushes, and brushes
+// of the current frame surviving a full cache. Then a scene's worth of draws is run once through a
+// single brush whose color is set before every draw, as D2DRenderer used to, and once through the
+// cache: brush state changes (SetColor calls) against brushes created, and the cost per draw with
+// an assumed backend cost for each.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "BenchCheck.hpp"
+#include "core/BrushCache.hpp"
+
+using namespace borderless;
+using bench::check;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    // assumed backend costs: SetColor on a brush that batched draws still refer to makes D2D flush
+    // the batch, and creating a brush is a device call
+    constexpr auto set_color_cost = std::chrono::nanoseconds(150);
+    constexpr auto create_cost = std::chrono::microseconds(2);
+
+    auto spin(Clock::duration cost) -> void {
+        const auto until = Clock::now() + cost;
+        while (Clock::now() < until) {
+        }
+    }
+
+    struct FakeBrush {
+        BrushKey key;
+        uint64_t changes = 0; // state changes applied to this brush
+
+        auto set_color(const Color &color) -> void {
+            spin(set_color_cost);
+            key.color = color;
+            ++changes;
+        }
+    };
+
+    struct FakeBackend {
+        using Brush = std::shared_ptr<FakeBrush>;
+
+        uint64_t created = 0;
+
+        auto create_brush(const BrushKey &key) -> Brush {
+            spin(create_cost);
+            ++created;
+            return std::make_shared<FakeBrush>(FakeBrush{key, 0});
+        }
+    };
+
+    using FakeCache = BrushCache<FakeBackend>;
+
+    const Color green{0.18f, 0.55f, 0.34f, 0.75f};
+    const Color black{0.0f, 0.0f, 0.0f, 1.0f};
+
+    auto check_cache() -> void {
+        FakeCache cache(FakeBackend{}, 4, 2);
+        const auto a = cache.solid(green);
+        check(cache.solid(green) == a && cache.backend().created == 1, "one brush per color");
+        check(cache.solid(green, 0.5f) != a && cache.solid(black) != a, "opacity and color are part of the key");
+
+        const auto gradient = BrushKey::linear({0.0f, 0.0f}, {0.0f, 100.0f}, {{0.0f, green}, {1.0f, black}});
+        const auto g = cache.get(gradient);
+        check(cache.get(BrushKey::linear({0.0f, 0.0f}, {0.0f, 100.0f}, {{0.0f, green}, {1.0f, black}})) == g,
+              "gradients by definition");
+        check(cache.get(BrushKey::linear({0.0f, 0.0f}, {0.0f, 50.0f}, {{0.0f, green}, {1.0f, black}})) != g,
+              "a different gradient");
+        check(cache.size() == 5 && cache.stats().hits == 2 && cache.stats().misses == 5, "lookups counted");
+
+        bool threw = false;
+        try {
+            BrushKey::linear({}, {}, {{0.0f, green}});
+        } catch (const std::invalid_argument &) {
+            threw = true;
+        }
+        check(threw, "a gradient needs two stops");
+
+        // over capacity, but every brush was used in the frame that just ended
+        cache.begin_frame();
+        check(cache.size() == 5 && cache.stats().used == 5, "brushes of the last frame are kept");
+        // only green is used from now on; the rest goes over capacity first, then idle
+        cache.solid(green);
+        cache.begin_frame();
+        check(cache.size() == 4, "trimmed to capacity, coldest first");
+        check(cache.solid(green) == a, "the used brush survived");
+        cache.begin_frame();
+        cache.solid(green);
+        cache.begin_frame();
+        cache.solid(green);
+        cache.begin_frame();
+        check(cache.size() == 1 && cache.stats().used == 1, "idle brushes trimmed");
+        check(cache.solid(green) == a && cache.backend().created == 5, "and nothing recreated");
+    }
+
+    // the colors of a frame's draws: a few distinct colors repeated in paint order
+    auto draw_stream(size_t count, size_t colors) -> std::vector<Color> {
+        std::mt19937 rng(11);
+        std::vector<Color> palette;
+        for (size_t i = 0; i < colors; ++i) {
+            palette.push_back({float(rng() % 256) / 255.0f, float(rng() % 256) / 255.0f, float(rng() % 256) / 255.0f,
+                               1.0f});
+        }
+        std::vector<Color> stream(count);
+        for (auto &color: stream) {
+            color = palette[rng() % colors];
+        }
+        return stream;
+    }
+}
+
+auto main() -> int {
+    check_cache();
+
+    const int frames = 200;
+    std::printf("%8s %8s %16s %16s %14s %14s\n", "draws", "colors", "SetColor calls", "brushes created",
+                "mutate ns", "cached ns");
+    for (const auto [draws, colors]: {std::pair<size_t, size_t>{2, 2}, {100, 8}, {1000, 32}, {10000, 64}}) {
+        const auto stream = draw_stream(draws, colors);
+
+        // one brush, its color set whenever it differs from the last draw's
+        FakeBrush shared;
+        uintptr_t sink = 0;
+        auto start = Clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            for (const auto &color: stream) {
+                if (shared.key.color != color) {
+                    shared.set_color(color);
+                }
+                sink += reinterpret_cast<uintptr_t>(&shared);
+            }
+        }
+        const auto mutate_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() /
+                               double(frames * stream.size());
+
+        // immutable brushes, created once per color
+        FakeCache cache(FakeBackend{}, 128);
+        start = Clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            cache.begin_frame();
+            for (const auto &color: stream) {
+                sink += reinterpret_cast<uintptr_t>(cache.solid(color).get());
+            }
+        }
+        const auto cached_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() /
+                               double(frames * stream.size());
+        check(sink != 0, "draws happened");
+        check(cache.size() == colors && cache.stats().used == colors, "one brush per color, all in use");
+        check(cache.backend().created == colors && shared.changes > frames * stream.size() / 2,
+              "brushes created once, the shared one recolored on most draws");
+        check(cached_ns < mutate_ns, "cached brushes beat recoloring one");
+
+        std::printf("%8zu %8zu %16llu %16llu %14.2f %14.2f\n", draws, colors,
+                    static_cast<unsigned long long>(shared.changes),
+                    static_cast<unsigned long long>(cache.backend().created), mutate_ns, cached_ns);
+    }
+    return 0;
+}
@@ -0,0 +1,185 @@
+// The system capability snapshot against a fake provider: only the parts a broadcast names are
+// re-queried and listeners only hear about real changes. Then a message stream (hit tests,
+// activations and animation starts, with a settings broadcast now and then) is run once asking the
+// provider on every read, as composition_enabled() used to, and once reading the snapshot.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "BenchCheck.hpp"
+#include "core/SystemCapabilities.hpp"
+
+using namespace borderless;
+using bench::check;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    // assumed cost of asking the system for one part: DwmIsCompositionEnabled, GetSystemMetrics,
+    // GetDeviceCaps and SystemParametersInfo each cross into the window manager or win32k
+    constexpr auto query_cost = std::chrono::nanoseconds(500);
+
+    auto spin(Clock::duration cost) -> void {
+        const auto until = Clock::now() + cost;
+        while (Clock::now() < until) {
+        }
+    }
+
+    // what the system reports; the benchmark flips settings here
+    class FakeProvider : public CapabilityProvider {
+    public:
+        auto query(uint8_t which, Capabilities &into) -> void override {
+            ++calls;
+            asked |= which;
+            for (uint8_t part = 1; part != 0 && part <= capability_all; part <<= 1) {
+                if (which & part) {
+                    spin(query_cost);
+                }
+            }
+            if (which & capability_composition) {
+                into.composition = system.composition;
+            }
+            if (which & capability_frame) {
+                into.frame = system.frame;
+            }
+            if (which & capability_color_depth) {
+                into.color_depth = system.color_depth;
+            }
+            if (which & capability_high_contrast) {
+                into.high_contrast = system.high_contrast;
+            }
+            if (which & capability_reduced_motion) {
+                into.reduced_motion = system.reduced_motion;
+            }
+        }
+
+        Capabilities system{true, {8, 8}, 32, false, false};
+        uint64_t calls = 0;
+        uint8_t asked = 0;
+    };
+
+    auto check_snapshot() -> void {
+        FakeProvider provider;
+        SystemCapabilities capabilities(provider);
+        check(provider.calls == 1 && provider.asked == capability_all, "everything queried once up front");
+        check(capabilities.snapshot().frame == Point{8, 8}, "snapshot holds the frame");
+
+        std::vector<uint8_t> heard;
+        bool contrast_after = false;
+        const auto listener = capabilities.subscribe([&](const CapabilityChange &change) {
+            heard.push_back(change.changed);
+            contrast_after = change.after.high_contrast;
+            check(change.before.high_contrast != change.after.high_contrast ||
+                  !(change.changed & capability_high_contrast), "before and after differ where changed");
+        });
+
+        provider.asked = 0;
+        check(capabilities.refresh(capability_composition) == 0 && heard.empty(), "no change, no notification");
+        check(provider.asked == capability_composition, "only the named part is queried");
+
+        // a change the broadcast did not name stays unseen until a broadcast names it
+        provider.system.high_contrast = true;
+        check(capabilities.refresh(capability_frame) == 0 && !capabilities.snapshot().high_contrast, "not asked");
+        check(capabilities.refresh(capability_high_contrast | capability_reduced_motion) == capability_high_contrast,
+              "only what changed is reported");
+        check(heard.size() == 1 && heard[0] == capability_high_contrast && contrast_after, "listener heard it");
+
+        provider.system.composition = false;
+        provider.system.frame = {4, 4};
+        check(capabilities.refresh() == (capability_composition | capability_frame), "two parts at once");
+        check(heard.size() == 2 && !capabilities.snapshot().composition, "one notification for both");
+
+        capabilities.unsubscribe(listener);
+        provider.system.color_depth = 16;
+        check(capabilities.refresh(capability_color_depth) == capability_color_depth && heard.size() == 2,
+              "unsubscribed");
+        check(capabilities.stats().changes == 3 && capabilities.stats().notifications == 2, "stats");
+    }
+
+    enum class Kind : uint8_t {
+        hit_test,      // frame metrics for the resize border
+        activate,      // composition for WM_NCACTIVATE
+        animate,       // reduced motion before starting an animation
+        setting,       // WM_SETTINGCHANGE
+        composition,   // WM_DWMCOMPOSITIONCHANGED
+    };
+
+    auto message_stream(size_t count) -> std::vector<Kind> {
+        std::mt19937 rng(5);
+        std::vector<Kind> stream(count);
+        for (auto &kind: stream) {
+            const auto r = rng() % 100000;
+            kind = r < 2 ? Kind::setting : r < 3 ? Kind::composition : r < 80000 ? Kind::hit_test
+                    : r < 95000 ? Kind::activate : Kind::animate;
+        }
+        return stream;
+    }
+}
+
+auto main() -> int {
+    check_snapshot();
+
+    const auto stream = message_stream(1'000'000);
+    FakeProvider per_call;
+    Capabilities scratch;
+    int64_t sink = 0;
+    auto start = Clock::now();
+    for (const auto kind: stream) {
+        switch (kind) {
+            case Kind::hit_test:
+                per_call.query(capability_frame, scratch);
+                sink += scratch.frame.x;
+                break;
+            case Kind::activate:
+                per_call.query(capability_composition, scratch);
+                sink += scratch.composition;
+                break;
+            case Kind::animate:
+                per_call.query(capability_reduced_motion, scratch);
+                sink += scratch.reduced_motion;
+                break;
+            default:
+                break;
+        }
+    }
+    const auto per_call_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / double(stream.size());
+
+    FakeProvider provider;
+    SystemCapabilities capabilities(provider);
+    start = Clock::now();
+    for (const auto kind: stream) {
+        const auto &snapshot = capabilities.snapshot();
+        switch (kind) {
+            case Kind::hit_test:
+                sink += snapshot.frame.x;
+                break;
+            case Kind::activate:
+                sink += snapshot.composition;
+                break;
+            case Kind::animate:
+                sink += snapshot.reduced_motion;
+                break;
+            case Kind::setting:
+                capabilities.refresh(capability_frame | capability_high_contrast | capability_reduced_motion);
+                break;
+            case Kind::composition:
+                capabilities.refresh(capability_composition);
+                break;
+        }
+    }
+    const auto snapshot_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / double(stream.size());
+    check(sink != 0, "reads happened");
+    check(provider.calls * 100 < per_call.calls, "the snapshot asks the provider on broadcasts only");
+    check(snapshot_ns < per_call_ns, "reading the snapshot beats asking the system");
+
+    // the fake charges query_cost per part, the real provider is a DWM, GDI or SystemParametersInfo call
+    std::printf("%-10s %16s %16s\n", "reads", "provider calls", "ns/message");
+    std::printf("%-10s %16llu %16.2f\n", "per call", static_cast<unsigned long long>(per_call.calls), per_call_ns);
+    std::printf("%-10s %16llu %16.2f\n", "snapshot", static_cast<unsigned long long>(provider.calls), snapshot_ns);
+    std::printf("%s", format_capability_stats(capabilities.stats()).c_str());
+    return 0;
+}
@@ -0,0 +1,282 @@
+// Headless benchmark for the CPU renderer.
+// Before timing it checks the scalar reference frame against checked-in golden hashes, that every
+// SIMD level renders it bit-identical to the scalar kernels and that a few golden pixels have their
+// exact expected values, then reports megapixels/s per primitive and SIMD level.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#include "BenchCheck.hpp"
+#include "core/CpuRenderer.hpp"
+#include "core/Scene.hpp"
+
+using namespace borderless;
+using bench::check;
+using kernels::SimdLevel;
+
+namespace {
+
+    const SimdLevel all_levels[] = {SimdLevel::scalar, SimdLevel::sse2, SimdLevel::avx2};
+
+    // 16x16 checker bitmap with translucent cells, premultiplied
+    auto make_bitmap() -> std::vector<uint32_t> {
+        std::vector<uint32_t> pixels(16 * 16);
+        for (int y = 0; y < 16; ++y) {
+            for (int x = 0; x < 16; ++x) {
+                pixels[y * 16 + x] = ((x ^ y) & 4) ? 0xff2050f0u : 0x80400000u;
+            }
+        }
+        return pixels;
+    }
+
+    // 40x12 fake glyph run coverage with soft edges
+    auto make_glyphs() -> std::vector<uint8_t> {
+        std::vector<uint8_t> coverage(40 * 12);
+        for (int y = 0; y < 12; ++y) {
+            for (int x = 0; x < 40; ++x) {
+                coverage[y * 40 + x] = static_cast<uint8_t>((x % 8 < 5) ? (y * 21 + x * 3) & 0xff : 0);
+            }
+        }
+        return coverage;
+    }
+
+    auto render_reference(SimdLevel level, const std::vector<uint32_t> &bitmap,
+                          const std::vector<uint8_t> &glyphs) -> Surface {
+        Surface surface;
+        surface.resize(173, 131); // odd sizes exercise the scalar tails
+        CpuRenderer r(surface, level);
+        const auto image = r.add_image({bitmap.data(), 16, 16, 16});
+        const AlphaMask glyph_mask{glyphs.data(), 40, 12, 40};
+        r.set_text_rasterizer([&](const TextLayoutKey &) { return &glyph_mask; });
+
+        r.begin_frame();
+        r.clear({1.0f, 1.0f, 1.0f, 1.0f});
+        r.fill_rect({10.25f, 5.5f, 90.75f, 40.4f}, {0.2f, 0.4f, 0.9f, 0.6f});
+        r.fill_rect({0, 0, 30, 30}, {1, 0, 0, 1});
+        r.fill_ellipse({80.3f, 70.7f}, 50.2f, 33.1f, {0.18f, 0.55f, 0.34f, 0.75f});
+        r.push_clip({20, 20, 150, 100});
+        r.set_transform(Transform::translation(7.0f, 3.0f));
+        r.fill_ellipse({100.0f, 50.0f}, 40.0f, 60.0f, {0.9f, 0.1f, 0.1f, 0.5f});
+        r.draw_text({{}, L"", 30.0f, 12.0f}, {10.0f, 80.0f}, {0, 0, 0, 1}); // the run overhangs the box
+        r.pop_clip();
+        r.set_transform({});
+        r.draw_image(image, {120, 90, 136, 106}, 1.0f);
+        r.draw_image(image, {130, 10, 171, 53}, 0.7f);
+        r.end_frame();
+        return surface;
+    }
+
+    constexpr int32_t golden_tile = 32;
+
+    // FNV-1a of each 32x32 tile of the scalar reference frame, rows top to bottom; after an intended
+    // change to the output, paste the table printed on mismatch
+    constexpr uint32_t golden_tiles[] = {
+            0x903dbbedu, 0xdcbea685u, 0x164a3d57u, 0x5240fcc5u, 0xa605f660u, 0xb2f2ea91u,
+            0xd90168f2u, 0x217a427cu, 0x29034586u, 0x2e15d7f6u, 0xdcfe61b9u, 0x9dfdda06u,
+            0xf287be50u, 0xf256e643u, 0x1f6773f6u, 0x0f044f6du, 0x0b9e44e9u, 0xece8c145u,
+            0x34e76dc5u, 0x69e754a3u, 0x62cda581u, 0x950a2fecu, 0x10ef240bu, 0xece8c145u,
+            0xe3496045u, 0xe3496045u, 0xe3496045u, 0xe3496045u, 0xe3496045u, 0x1b8b4a79u,
+    };
+
+    auto tile_hash(const Surface &surface, const Rect &tile) -> uint32_t {
+        uint32_t hash = 2166136261u;
+        for (int32_t y = tile.top; y < tile.bottom; ++y) {
+            const auto row = reinterpret_cast<const uint8_t *>(surface.row(y) + tile.left);
+            for (size_t i = 0; i < static_cast<size_t>(tile.width()) * 4; ++i) {
+                hash = (hash ^ row[i]) * 16777619u;
+            }
+        }
+        return hash;
+    }
+
+    auto check_golden(const Surface &reference) -> void {
+        const auto columns = (reference.width + golden_tile - 1) / golden_tile;
+        const auto rows = (reference.height + golden_tile - 1) / golden_tile;
+        check(static_cast<size_t>(columns * rows) == std::size(golden_tiles), "golden table matches the frame size");
+        std::vector<uint32_t> hashes;
+        Rect wrong{};
+        for (int32_t row = 0; row < rows; ++row) {
+            for (int32_t column = 0; column < columns; ++column) {
+                const Rect tile = intersect({column * golden_tile, row * golden_tile, (column + 1) * golden_tile,
+                                             (row + 1) * golden_tile}, {0, 0, reference.width, reference.height});
+                hashes.push_back(tile_hash(reference, tile));
+                if (hashes.back() != golden_tiles[hashes.size() - 1]) {
+                    wrong = wrong.empty() ? tile : unite(wrong, tile);
+                }
+            }
+        }
+        if (!wrong.empty()) {
+            std::fprintf(stderr, "cpu_renderer_bench: reference frame differs from golden in {%d, %d, %d, %d}\n",
+                         wrong.left, wrong.top, wrong.right, wrong.bottom);
+            for (size_t i = 0; i < hashes.size(); ++i) {
+                std::fprintf(stderr, "0x%08xu,%s", hashes[i], (i + 1) % columns ? " " : "\n");
+            }
+        }
+        check(wrong.empty(), "scalar reference frame matches golden");
+    }
+
+    auto check_kernels(SimdLevel level) -> void {
+        const auto &ref = kernels::kernels(SimdLevel::scalar);
+        const auto &k = kernels::kernels(level);
+        std::mt19937 rng(7);
+        for (size_t count = 0; count < 70; ++count) {
+            std::vector<uint32_t> dst(count), src(count);
+            std::vector<uint8_t> mask(count);
+            for (size_t i = 0; i < count; ++i) {
+                dst[i] = rng();
+                const uint32_t a = rng() & 0xff;
+                // premultiplied source: every channel <= alpha
+                src[i] = a << 24 | (rng() % (a + 1)) << 16 | (rng() % (a + 1)) << 8 | (rng() % (a + 1));
+                mask[i] = (i % 5 == 0) ? 0 : static_cast<uint8_t>(rng());
+            }
+            for (uint32_t color: {0xff102030u, 0x80402010u, 0x00000000u, 0x40404040u}) {
+                auto a = dst, b = dst;
+                ref.blend_solid(a.data(), count, color);
+                k.blend_solid(b.data(), count, color);
+                check(a == b, "blend_solid matches scalar");
+
+                a = b = dst;
+                ref.blend_mask(a.data(), mask.data(), count, color);
+                k.blend_mask(b.data(), mask.data(), count, color);
+                check(a == b, "blend_mask matches scalar");
+
+                a = b = dst;
+                ref.fill(a.data(), count, color);
+                k.fill(b.data(), count, color);
+                check(a == b, "fill matches scalar");
+            }
+            for (uint8_t opacity: {255, 200, 1, 0}) {
+                auto a = dst, b = dst;
+                ref.blend_bitmap(a.data(), src.data(), count, opacity);
+                k.blend_bitmap(b.data(), src.data(), count, opacity);
+                check(a == b, "blend_bitmap matches scalar");
+            }
+        }
+    }
+
+    auto golden_pixels() -> void {
+        Surface s;
+        s.resize(64, 64);
+        CpuRenderer r(s, SimdLevel::scalar);
+        r.begin_frame();
+        r.clear({0, 0, 0, 1});
+        r.fill_rect({0, 0, 8, 8}, {1, 0, 0, 1});
+        r.fill_rect({8, 0, 16, 8}, {1, 1, 1, 0.5f});
+        r.fill_ellipse({40, 40}, 10, 10, {0, 0, 1, 1});
+        r.end_frame();
+
+        check(s.row(4)[4] == 0xffff0000u, "opaque red fill");
+        check(s.row(4)[12] == 0xff808080u, "half white over black");
+        check(s.row(40)[40] == 0xff0000ffu, "ellipse interior");
+        check(s.row(40)[20] == 0xff000000u, "outside the ellipse untouched");
+        const auto edge = s.row(40)[30];
+        check((edge & 0xff) > 0 && (edge & 0xff) < 0xff, "anti-aliased ellipse edge");
+    }
+
+    // a glyph run larger than its layout box must not paint outside the bounds the scene damages
+    auto text_stays_in_bounds(const std::vector<uint8_t> &glyphs) -> void {
+        Scene scene;
+        const auto label = scene.add(scene.root(), TextNode{{{}, L"", 20.0f, 8.0f}, {3.0f, 2.0f}, {0, 0, 0, 1}},
+                                     Transform::translation(10.5f, 20.25f));
+        DamageRegion damage;
+        damage.set_surface({0, 0, 64, 64});
+        scene.update(damage);
+        damage.add_all();
+
+        Surface s;
+        s.resize(64, 64);
+        CpuRenderer r(s, SimdLevel::scalar);
+        const AlphaMask glyph_mask{glyphs.data(), 40, 12, 40};
+        r.set_text_rasterizer([&](const TextLayoutKey &) { return &glyph_mask; });
+        r.begin_frame();
+        paint(scene, damage, r);
+        r.end_frame();
+
+        const auto &bounds = scene.bounds(label);
+        bool inside = true, painted = false;
+        for (int32_t y = 0; y < 64; ++y) {
+            for (int32_t x = 0; x < 64; ++x) {
+                if (s.row(y)[x] != 0) {
+                    painted = true;
+                    inside = inside && x >= bounds.left && x < bounds.right && y >= bounds.top && y < bounds.bottom;
+                }
+            }
+        }
+        check(painted, "the label is drawn");
+        check(inside, "text is clipped to its layout box");
+    }
+
+    struct Primitive {
+        const char *name;
+        int64_t pixels_per_call;
+        std::function<void(CpuRenderer &)> draw;
+    };
+}
+
+int main() {
+    const auto bitmap = make_bitmap();
+    const auto glyphs = make_glyphs();
+
+    golden_pixels();
+    text_stays_in_bounds(glyphs);
+    const auto reference = render_reference(SimdLevel::scalar, bitmap, glyphs);
+    check_golden(reference);
+    for (auto level: all_levels) {
+        if (!kernels::simd_supported(level)) {
+            std::printf("%s: not supported on this machine, skipped\n", kernels::simd_level_name(level));
+            continue;
+        }
+        check_kernels(level);
+        check(render_reference(level, bitmap, glyphs).pixels == reference.pixels, "reference frame is pixel exact");
+    }
+
+    std::vector<uint32_t> big_bitmap(512 * 512, 0xc0604020u);
+    std::vector<uint8_t> big_mask(512 * 64);
+    for (size_t i = 0; i < big_mask.size(); ++i) big_mask[i] = static_cast<uint8_t>(i * 7);
+    const AlphaMask glyph_run{big_mask.data(), 512, 64, 512};
+
+    const std::vector<Primitive> primitives = {
+            {"fill opaque",   512 * 512, [](CpuRenderer &r) { r.fill_rect({0, 0, 512, 512}, {0.2f, 0.3f, 0.4f, 1.0f}); }},
+            {"fill alpha",    512 * 512, [](CpuRenderer &r) { r.fill_rect({0, 0, 512, 512}, {0.2f, 0.3f, 0.4f, 0.5f}); }},
+            {"ellipse alpha", 205887,    [](CpuRenderer &r) { r.fill_ellipse({256, 256}, 256, 256, {0.2f, 0.6f, 0.3f, 0.75f}); }},
+            {"glyph mask",    512 * 64,  [&](CpuRenderer &r) { r.draw_mask(glyph_run, {0, 100}, {0, 0, 0, 1}); }},
+            {"bitmap blend",  512 * 512, [](CpuRenderer &r) { r.draw_image(0, {0, 0, 512, 512}, 0.8f); }},
+    };
+
+    using clock = std::chrono::steady_clock;
+    std::printf("%-16s", "primitive");
+    for (auto level: all_levels) std::printf("%12s", kernels::simd_level_name(level));
+    std::printf("   (MP/s)\n");
+
+    for (const auto &primitive: primitives) {
+        std::printf("%-16s", primitive.name);
+        for (auto level: all_levels) {
+            if (!kernels::simd_supported(level)) {
+                std::printf("%12s", "-");
+                continue;
+            }
+            Surface surface;
+            surface.resize(512, 512);
+            CpuRenderer r(surface, level);
+            r.add_image({big_bitmap.data(), 512, 512, 512});
+            r.begin_frame();
+
+            constexpr int calls = 300;
+            primitive.draw(r); // warm up
+            const auto start = clock::now();
+            for (int i = 0; i < calls; ++i) {
+                primitive.draw(r);
+            }
+            const auto seconds = std::chrono::duration<double>(clock::now() - start).count();
+            std::printf("%12.1f", static_cast<double>(primitive.pixels_per_call) * calls / seconds / 1e6);
+        }
+        std::printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,184 @@
+// SharedPool, the process-wide device set BorderlessWindows borrow: lifetime and reference counts
+// with fake devices (creation, sharing, release with the last holder, retain, invalidation after a
+// lost device, concurrent first use, failures), and the cost of opening a dozen panels when each
+// creates its own devices against borrowing one set.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "BenchCheck.hpp"
+#include "core/SharedPool.hpp"
+
+using namespace borderless;
+using bench::check;
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    std::atomic<int> live_devices{0};
+
+    // stands in for GraphicsDevices: D3D device, DXGI factory, D2D factory and device, DComp device
+    struct FakeDevices {
+        explicit FakeDevices(std::chrono::microseconds cost) {
+            std::this_thread::sleep_for(cost);
+            ++live_devices;
+        }
+
+        ~FakeDevices() { --live_devices; }
+
+        FakeDevices(const FakeDevices &) = delete;
+
+        auto operator=(const FakeDevices &) -> FakeDevices & = delete;
+    };
+
+    auto fake_pool(std::chrono::microseconds cost = 0us) -> SharedPool<FakeDevices> {
+        return SharedPool<FakeDevices>([cost] { return std::make_unique<FakeDevices>(cost); });
+    }
+
+    // assumed costs: the device set, and a window's own swap chain, device context and visual
+    constexpr auto devices_cost = 25ms;
+    constexpr auto per_window_cost = 2ms;
+
+    auto ms(Clock::duration d) -> double { return std::chrono::duration<double, std::milli>(d).count(); }
+}
+
+int main() {
+    // lifetime
+    {
+        SharedPool<FakeDevices> pool([] { return std::make_unique<FakeDevices>(0us); });
+        check(pool.users() == 0 && live_devices == 0, "nothing until the first acquire");
+        auto first = pool.acquire();
+        auto second = pool.acquire();
+        check(first == second && live_devices == 1, "windows share one set");
+        check(pool.users() == 2 && pool.stats().created == 1 && pool.stats().reused == 1, "counted");
+        first.reset();
+        check(pool.users() == 1 && live_devices == 1, "alive while a window holds it");
+        second.reset();
+        check(pool.users() == 0 && live_devices == 0 && pool.stats().destroyed == 1, "released with the last window");
+        auto third = pool.acquire();
+        check(live_devices == 1 && pool.stats().created == 2, "recreated for the next window");
+        third.reset();
+
+        pool.set_retain(true);
+        auto retained = pool.acquire();
+        retained.reset();
+        check(live_devices == 1 && pool.users() == 0, "retained between windows");
+        check(pool.acquire() != nullptr && pool.stats().created == 3, "and reused");
+        pool.set_retain(false);
+        check(live_devices == 0, "released when no longer retained");
+        check(pool.stats().peak_users == 2, "peak users");
+    }
+    {
+        auto pool = fake_pool();
+        auto stale = pool.acquire();
+        const auto generation = pool.generation();
+        pool.invalidate();
+        check(pool.generation() == generation + 1, "invalidate bumps the generation");
+        auto fresh = pool.acquire();
+        check(fresh != stale && live_devices == 2, "a lost device is replaced, holders keep theirs");
+        check(pool.users() == 1, "users count the current set only");
+        stale.reset();
+        check(live_devices == 1, "the stale set goes with its last holder");
+    }
+    check(live_devices == 0, "nothing leaks");
+    {
+        std::shared_ptr<FakeDevices> survivor;
+        {
+            auto pool = fake_pool();
+            survivor = pool.acquire();
+        }
+        check(live_devices == 1, "holders may outlive the pool");
+        survivor.reset();
+        check(live_devices == 0, "and release after it");
+    }
+    {
+        int attempts = 0;
+        SharedPool<FakeDevices> pool([&] {
+            if (++attempts == 1) {
+                throw std::runtime_error("DXGI_ERROR_UNSUPPORTED");
+            }
+            return std::make_unique<FakeDevices>(0us);
+        });
+        bool thrown = false;
+        try {
+            pool.acquire();
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        check(thrown && pool.stats().created == 0, "a failed creation propagates");
+        check(pool.acquire() != nullptr && attempts == 2, "and is retried by the next acquire");
+    }
+    {
+        // startup workers of several windows asking at once create one set
+        auto pool = fake_pool(5ms);
+        std::vector<std::shared_ptr<FakeDevices>> held(8);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < held.size(); ++i) {
+            threads.emplace_back([&, i] { held[i] = pool.acquire(); });
+        }
+        for (auto &thread: threads) {
+            thread.join();
+        }
+        bool shared = true;
+        for (const auto &h: held) {
+            shared &= h == held.front();
+        }
+        check(shared && pool.stats().created == 1 && live_devices == 1, "concurrent first use creates one set");
+    }
+
+    // a dozen panels
+    const int windows = 12;
+    std::vector<std::unique_ptr<FakeDevices>> own;
+    std::vector<double> own_costs;
+    for (int i = 0; i < windows; ++i) {
+        const auto start = Clock::now();
+        own.push_back(std::make_unique<FakeDevices>(devices_cost));
+        std::this_thread::sleep_for(per_window_cost);
+        own_costs.push_back(ms(Clock::now() - start));
+    }
+    check(live_devices == windows, "a set per window");
+    own.clear();
+
+    auto pool = fake_pool(devices_cost);
+    std::vector<std::shared_ptr<FakeDevices>> borrowed;
+    std::vector<double> pooled_costs;
+    for (int i = 0; i < windows; ++i) {
+        const auto start = Clock::now();
+        borrowed.push_back(pool.acquire());
+        std::this_thread::sleep_for(per_window_cost);
+        pooled_costs.push_back(ms(Clock::now() - start));
+    }
+    check(live_devices == 1 && pool.users() == windows, "one set for every window");
+
+    auto sum = [](const std::vector<double> &costs, size_t from) {
+        double total = 0;
+        for (size_t i = from; i < costs.size(); ++i) {
+            total += costs[i];
+        }
+        return total;
+    };
+    check(sum(pooled_costs, 1) * 4 < sum(own_costs, 1), "later windows skip device creation");
+
+    std::printf("%-22s %14s %16s %12s %8s\n", "12 windows", "first ms", "each other ms", "total ms", "sets");
+    std::printf("%-22s %14.2f %16.2f %12.2f %8d\n", "devices per window", own_costs[0],
+                sum(own_costs, 1) / (windows - 1), sum(own_costs, 0), windows);
+    std::printf("%-22s %14.2f %16.2f %12.2f %8d\n", "shared pool", pooled_costs[0],
+                sum(pooled_costs, 1) / (windows - 1), sum(pooled_costs, 0), 1);
+
+    const int acquires = 1'000'000;
+    const auto start = Clock::now();
+    for (int i = 0; i < acquires; ++i) {
+        auto lease = pool.acquire();
+    }
+    std::printf("acquire + release of a live set: %.1f ns\n",
+                std::chrono::duration<double, std::nano>(Clock::now() - start).count() / acquires);
+    return 0;
+}
@@ -0,0 +1,261 @@
+// Display lists on the CPU renderer: a frame drawn directly and the same frame recorded, written,
+// memory-mapped and replayed must be pixel identical; diffs of unchanged, recolored and extended
+// frames must damage exactly what changed; corrupt lists are rejected. Then reports the cost of
+// recording, building, opening (in memory and mapped) and replaying against drawing directly,
+// and of diffing two frames, for lists of increasing size.
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "BenchCheck.hpp"
+#include "core/CpuRenderer.hpp"
+#include "core/DisplayList.hpp"
+
+using namespace borderless;
+using bench::check;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    constexpr int32_t surface_width = 640;
+    constexpr int32_t surface_height = 480;
+    const Rect surface_rect{0, 0, surface_width, surface_height};
+
+    auto elapsed_ns(Clock::time_point start) -> double {
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    struct Assets {
+        std::vector<uint32_t> bitmap = std::vector<uint32_t>(32 * 32);
+        std::vector<uint8_t> glyphs = std::vector<uint8_t>(48 * 14);
+        AlphaMask glyph_mask{};
+
+        Assets() {
+            for (int y = 0; y < 32; ++y) {
+                for (int x = 0; x < 32; ++x) {
+                    bitmap[y * 32 + x] = ((x ^ y) & 8) ? 0xff2050f0u : 0x80400000u;
+                }
+            }
+            for (size_t i = 0; i < glyphs.size(); ++i) {
+                glyphs[i] = static_cast<uint8_t>((i % 48) % 6 < 4 ? i * 13 : 0);
+            }
+            glyph_mask = {glyphs.data(), 48, 14, 48};
+        }
+    };
+
+    // cards of a dashboard, each a clipped group with a background, an indicator, a label and an
+    // icon; every fifth card gets a hand-drawn sparkline as a mask
+    auto draw_frame(Renderer &r, const Assets &assets, size_t cards, Color highlight = {0.9f, 0.2f, 0.2f, 1.0f})
+            -> void {
+        r.set_transform({});
+        r.clear({1.0f, 1.0f, 1.0f, 1.0f});
+        for (size_t i = 0; i < cards; ++i) {
+            const auto x = static_cast<float>((i % 8) * 80), y = static_cast<float>((i / 8) % 12 * 40);
+            r.push_clip({static_cast<int32_t>(x), static_cast<int32_t>(y), static_cast<int32_t>(x) + 78,
+                         static_cast<int32_t>(y) + 38});
+            r.set_transform(Transform::translation(x, y));
+            r.fill_rect({0.0f, 0.0f, 78.0f, 38.0f}, {0.93f, 0.94f, 0.96f, 1.0f});
+            r.fill_ellipse({12.0f, 19.0f}, 7.5f, 7.5f, i == 0 ? highlight : Color{0.18f, 0.55f, 0.34f, 0.75f});
+            r.draw_text({{L"Segoe UI", 400, 12.0f, L"en-us"}, i % 2 ? L"42 %" : L"Ready", 48.0f, 14.0f},
+                        {24.0f, 12.0f}, {0.1f, 0.1f, 0.1f, 1.0f});
+            r.draw_image(0, {60.0f, 4.0f, 76.0f, 20.0f}, 0.9f);
+            if (i % 5 == 0) {
+                r.draw_mask(assets.glyph_mask, {static_cast<int32_t>(x) + 24, static_cast<int32_t>(y) + 24},
+                            {0.2f, 0.4f, 0.9f, 0.8f});
+            }
+            r.set_transform({});
+            r.pop_clip();
+        }
+    }
+
+    auto make_surface() -> Surface {
+        Surface surface;
+        surface.resize(surface_width, surface_height);
+        return surface;
+    }
+
+    struct Target {
+        Surface surface = make_surface();
+        CpuRenderer renderer;
+
+        explicit Target(const Assets &assets) : renderer(surface) {
+            renderer.add_image({assets.bitmap.data(), 32, 32, 32});
+            renderer.set_text_rasterizer([&assets](const TextLayoutKey &) { return &assets.glyph_mask; });
+        }
+    };
+
+    auto record(const Assets &assets, size_t cards, Color highlight = {0.9f, 0.2f, 0.2f, 1.0f})
+            -> std::vector<uint8_t> {
+        DisplayListRecorder recorder;
+        recorder.begin_frame();
+        draw_frame(recorder, assets, cards, highlight);
+        recorder.end_frame();
+        return recorder.build();
+    }
+
+    auto check_lists(const Assets &assets) -> void {
+        Target direct(assets), replayed(assets), mapped(assets);
+        direct.renderer.begin_frame();
+        draw_frame(direct.renderer, assets, 96);
+        direct.renderer.end_frame();
+
+        const auto bytes = record(assets, 96);
+        DisplayList list;
+        check(list.open(view(bytes)), "open a recorded list");
+        check(list.size() == 2 + 96 * 8 + 20, "a command per call");
+        replayed.renderer.begin_frame();
+        replay(list, replayed.renderer);
+        replayed.renderer.end_frame();
+        check(replayed.surface.pixels == direct.surface.pixels, "replay is pixel exact");
+
+        const std::string path = "display_list_bench.list";
+        {
+            std::FILE *file = std::fopen(path.c_str(), "wb");
+            check(file && std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size(), "write");
+            std::fclose(file);
+        }
+        DisplayList from_disk;
+        check(from_disk.open(path), "open a mapped list");
+        mapped.renderer.begin_frame();
+        replay(from_disk, mapped.renderer);
+        mapped.renderer.end_frame();
+        check(mapped.surface.pixels == direct.surface.pixels, "mapped replay is pixel exact");
+        check(from_disk.text(1).text == L"42 %" && from_disk.text(0).format.family == L"Segoe UI",
+              "text layouts survive the file");
+        from_disk.close();
+        std::remove(path.c_str());
+
+        // diffs: nothing, one indicator recolored, one more card
+        DisplayList same, recolored, extended;
+        const auto same_bytes = record(assets, 96);
+        const auto recolored_bytes = record(assets, 96, {0.2f, 0.2f, 0.9f, 1.0f});
+        const auto extended_bytes = record(assets, 97);
+        check(same.open(view(same_bytes)) && recolored.open(view(recolored_bytes)) &&
+              extended.open(view(extended_bytes)), "open the variants");
+        const auto unchanged = diff(list, same, surface_rect);
+        check(unchanged.changed == 0 && unchanged.damage.empty(), "identical frames, no damage");
+        const auto recolor = diff(list, recolored, surface_rect);
+        check(recolor.changed == 2, "one command on each side");
+        check(recolor.damage.rects().size() == 1 && recolor.damage.bounds() == Rect{4, 11, 20, 27},
+              "damage is the indicator");
+        const auto added = diff(list, extended, surface_rect);
+        check(added.changed == 8 && added.damage.bounds() == Rect{0, 0, 78, 38},
+              "an appended card damages its own cell");
+
+        // corrupt lists
+        auto corrupt = bytes;
+        corrupt[32] = static_cast<uint8_t>(display_list::Op::count); // the first command's op
+        DisplayList bad;
+        check(!bad.open(view(corrupt)), "unknown op rejected");
+        corrupt = bytes;
+        corrupt[32] = static_cast<uint8_t>(display_list::Op::pop_clip);
+        check(!bad.open(view(corrupt)), "unbalanced clip rejected");
+        corrupt = bytes;
+        corrupt[32 + (list.size() - 1) * sizeof(display_list::Command)] =
+                static_cast<uint8_t>(display_list::Op::push_clip); // the last command's op
+        check(!bad.open(view(corrupt)), "unpopped clip rejected");
+        // coordinates that would reach round_out as NaN, infinite or beyond int32_t
+        corrupt = bytes;
+        corrupt[32] = static_cast<uint8_t>(display_list::Op::fill_rect);
+        check(bad.open(view(corrupt)), "the first command as a fill");
+        for (const auto value: {std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::infinity(),
+                                 -std::numeric_limits<float>::infinity(), 3e9f}) {
+            auto payload = corrupt;
+            std::memcpy(&payload[32 + offsetof(display_list::Command, values) + sizeof(float)], &value,
+                        sizeof(value)); // the fill's top
+            check(!bad.open(view(payload)), "non-finite or out of range coordinates rejected");
+        }
+        corrupt = bytes;
+        corrupt.resize(corrupt.size() - 1);
+        check(!bad.open(view(corrupt)), "truncated list rejected");
+        corrupt = bytes;
+        corrupt[4] = 9;
+        check(!bad.open(view(corrupt)) && bad.error().find("version") != std::string::npos, "version checked");
+    }
+}
+
+auto main() -> int {
+    Assets assets;
+    check_lists(assets);
+
+    std::printf("%8s %10s %8s %10s %10s %10s %10s %10s %12s %12s %10s\n", "cards", "commands", "B/cmd", "record us",
+                "build us", "open us", "mmap us", "diff us", "direct us", "replay us", "replay ns/c");
+    for (const size_t cards: {16, 96, 1000, 10000}) {
+        const int repeats = cards > 1000 ? 5 : 50;
+        DisplayListRecorder recorder;
+        auto start = Clock::now();
+        for (int i = 0; i < repeats; ++i) {
+            recorder.begin_frame();
+            draw_frame(recorder, assets, cards);
+            recorder.end_frame();
+        }
+        const auto record_ns = elapsed_ns(start) / repeats;
+
+        start = Clock::now();
+        std::vector<uint8_t> bytes;
+        for (int i = 0; i < repeats; ++i) {
+            bytes = recorder.build();
+        }
+        const auto build_ns = elapsed_ns(start) / repeats;
+
+        DisplayList list;
+        start = Clock::now();
+        for (int i = 0; i < repeats; ++i) {
+            check(list.open(view(bytes)), "open");
+        }
+        const auto open_ns = elapsed_ns(start) / repeats;
+
+        const std::string path = "display_list_bench.list";
+        check(recorder.write(path), "write");
+        DisplayList mapped;
+        start = Clock::now();
+        for (int i = 0; i < repeats; ++i) {
+            check(mapped.open(path), "mapped open");
+        }
+        const auto mmap_ns = elapsed_ns(start) / repeats;
+
+        const auto other_bytes = record(assets, cards, {0.2f, 0.2f, 0.9f, 1.0f});
+        DisplayList other;
+        check(other.open(view(other_bytes)), "open the other frame");
+        start = Clock::now();
+        size_t changed = 0;
+        for (int i = 0; i < repeats; ++i) {
+            changed += diff(list, other, surface_rect).changed;
+        }
+        const auto diff_ns = elapsed_ns(start) / repeats;
+        check(changed == size_t(repeats) * 2, "one recolored indicator");
+
+        Target target(assets);
+        start = Clock::now();
+        for (int i = 0; i < repeats; ++i) {
+            target.renderer.begin_frame();
+            draw_frame(target.renderer, assets, cards);
+            target.renderer.end_frame();
+        }
+        const auto direct_ns = elapsed_ns(start) / repeats;
+        const auto direct_pixels = target.surface.pixels;
+
+        start = Clock::now();
+        for (int i = 0; i < repeats; ++i) {
+            target.renderer.begin_frame();
+            replay(mapped, target.renderer);
+            target.renderer.end_frame();
+        }
+        const auto replay_ns = elapsed_ns(start) / repeats;
+        check(target.surface.pixels == direct_pixels, "mapped replay matches");
+        mapped.close();
+        std::remove(path.c_str());
+
+        std::printf("%8zu %10zu %8.1f %10.1f %10.1f %10.1f %10.1f %10.1f %12.1f %12.1f %10.1f\n", cards, list.size(),
+                    double(bytes.size()) / double(list.size()), record_ns / 1e3, build_ns / 1e3, open_ns / 1e3,
+                    mmap_ns / 1e3, diff_ns / 1e3, direct_ns / 1e3, replay_ns / 1e3, replay_ns / double(list.size()));
+    }
+    return 0;
+}
@@ -0,0 +1,148 @@
+// Per-monitor DPI handling without a window: the DIP to pixel rounding against MulDiv, the
+// listener fan-out of a DPI change, and what moving a scene to another monitor costs, i.e. the
+// rescale of every node's pixel bounds that WM_DPICHANGED triggers, for scenes of growing size.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "BenchCheck.hpp"
+#include "core/Dpi.hpp"
+#include "core/Scene.hpp"
+
+using namespace borderless;
+using bench::check;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    auto elapsed_us(Clock::time_point start) -> double {
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+
+    // MulDiv(value, numerator, denominator): exact product, rounded half away from zero
+    auto mul_div(int32_t value, int32_t numerator, int32_t denominator) -> int32_t {
+        const double exact = double(value) * numerator / denominator;
+        return int32_t(exact < 0 ? exact - 0.5 : exact + 0.5);
+    }
+
+    auto check_scaling() -> void {
+        static_assert(scale_for_dpi(480, 144) == 720, "150 %");
+        static_assert(scale_for_dpi(Size{480, 400}, 120).height == 500, "125 %");
+        static_assert(rescale_for_dpi(720, 144, 96) == 480, "back to 96 DPI");
+        for (const uint32_t dpi: {96u, 120u, 144u, 168u, 192u, 216u, 240u, 288u, 384u, 480u}) {
+            for (int32_t value = -2000; value <= 2000; ++value) {
+                check(scale_for_dpi(value, dpi) == mul_div(value, int32_t(dpi), 96), "scale_for_dpi is MulDiv");
+                check(rescale_for_dpi(value, dpi, 96) == mul_div(value, 96, int32_t(dpi)), "rescale_for_dpi is MulDiv");
+            }
+            // a DIP length survives the round trip through pixels
+            const DpiContext context(dpi);
+            for (int32_t dips = 0; dips <= 2000; ++dips) {
+                check(context.to_dips(context.to_pixels(dips)) == dips, "DIPs round trip");
+            }
+        }
+        // a window dragged from 100 % to 175 % and back ends up with the size it started with
+        check(rescale_for_dpi(rescale_for_dpi(480, 96, 168), 168, 96) == 480, "dragged back");
+    }
+
+    auto check_fan_out() -> void {
+        DpiContext context;
+        check(context.dpi() == default_dpi && context.scale() == 1.0f, "starts at 96 DPI");
+        std::string calls;
+        std::vector<DpiChange> changes;
+        context.subscribe([&](const DpiChange &change) {
+            calls += 'h';
+            changes.push_back(change);
+        });
+        const auto scene = context.subscribe([&](const DpiChange &) { calls += 's'; });
+        context.subscribe([&](const DpiChange &) { calls += 't'; });
+
+        check(!context.set_dpi(96) && calls.empty(), "same DPI notifies nobody");
+        check(context.set_dpi(144) && calls == "hst", "every listener once, in subscription order");
+        check(changes.back().from == 96 && changes.back().to == 144, "change carries both DPIs");
+        check(context.to_pixels(Size{480, 400}).width == 720 && context.transform().m11 == 1.5f, "new scale");
+
+        context.unsubscribe(scene);
+        calls.clear();
+        context.set_dpi(192);
+        check(calls == "ht" && changes.back().from == 144, "unsubscribed listener is skipped");
+        check(context.changes() == 2, "two changes");
+
+        bool threw = false;
+        try {
+            context.set_dpi(0);
+        } catch (const std::invalid_argument &) {
+            threw = true;
+        }
+        check(threw && context.dpi() == 192, "zero DPI rejected");
+    }
+
+    // a grid of labelled indicators laid out in DIPs under a root that scales to pixels
+    struct Panel {
+        Scene scene;
+        LayerDamage damage;
+
+        explicit Panel(int count) {
+            damage.assign(1, DamageRegion());
+            damage[0].set_surface({0, 0, 4096, 4096});
+            for (int i = 0; i < count; ++i) {
+                const auto x = float(i % 40) * 48.0f, y = float(i / 40) * 24.0f;
+                const auto card = scene.add(scene.root(), GroupNode{}, Transform::translation(x, y));
+                scene.add(card, EllipseNode{{8.0f, 8.0f}, 6.0f, 6.0f, {0, 1, 0, 1}});
+                scene.add(card, TextNode{{{L"Segoe UI", 400, 9.0f, L"en-us"}, L"42", 28.0f, 14.0f},
+                                         {16.0f, 2.0f}, {}});
+            }
+            scene.update(damage);
+        }
+    };
+
+    auto check_scene() -> void {
+        Panel panel(4);
+        DpiContext context;
+        context.subscribe([&](const DpiChange &) { panel.scene.set_transform(panel.scene.root(), context.transform()); });
+        const auto ellipse = NodeId(2);
+        check(panel.scene.bounds(ellipse) == Rect{1, 1, 15, 15}, "96 DPI bounds");
+
+        panel.damage[0].clear();
+        context.set_dpi(192);
+        panel.scene.update(panel.damage);
+        check(panel.scene.bounds(ellipse) == Rect{3, 3, 29, 29}, "bounds in 200 % pixels");
+        check(panel.damage[0].intersects({3, 3, 29, 29}) && panel.damage[0].intersects({1, 1, 15, 15}),
+              "old and new pixels are damaged");
+    }
+}
+
+auto main() -> int {
+    check_scaling();
+    check_fan_out();
+    check_scene();
+
+    // the scene part of WM_DPICHANGED: a new root transform and the update that rescales every node
+    std::printf("%10s %16s %16s\n", "nodes", "rescale us", "steady us");
+    for (const int cards: {100, 1000, 10000}) {
+        Panel panel(cards);
+        DpiContext context;
+        context.subscribe([&](const DpiChange &) { panel.scene.set_transform(panel.scene.root(), context.transform()); });
+        const uint32_t dpis[] = {144, 96, 192, 120};
+        const int rounds = 40;
+        auto start = Clock::now();
+        for (int round = 0; round < rounds; ++round) {
+            context.set_dpi(dpis[round % 4]);
+            panel.damage[0].clear();
+            panel.scene.update(panel.damage);
+        }
+        const auto rescale = elapsed_us(start) / rounds;
+        start = Clock::now();
+        for (int round = 0; round < rounds; ++round) {
+            panel.damage[0].clear();
+            panel.scene.update(panel.damage);
+        }
+        const auto steady = elapsed_us(start) / rounds;
+        check(panel.damage[0].empty(), "nothing to repaint without a change");
+        std::printf("%10zu %16.1f %16.2f\n", panel.scene.node_count(), rescale, steady);
+    }
+    return 0;
+}
@@ -0,0 +1,144 @@
+// Drives borderless::FrameScheduler with a simulated clock and a simulated flip-model swap chain
+// (60 Hz vblank, maximum frame latency 1) and reports frame counts and latency percentiles for
+// each mode. Render cost is randomized with occasional spikes.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "BenchCheck.hpp"
+#include "core/FrameScheduler.hpp"
+
+using namespace borderless;
+using bench::check;
+using Clock = FrameClockType;
+using std::chrono::microseconds;
+
+namespace {
+
+    struct SimClock : FrameClock {
+        Clock::time_point t{};
+
+        auto now() const -> Clock::time_point override { return t; }
+    };
+
+    // one queued frame at most; the queue drains at every vblank
+    struct SimSwapChain : FramePresenter {
+        explicit SimSwapChain(SimClock &clock) : clock(clock) {}
+
+        auto next_vblank() const -> Clock::time_point {
+            const auto since = clock.t.time_since_epoch();
+            return Clock::time_point((since / vblank + 1) * vblank);
+        }
+
+        auto retire() -> void {
+            if (queued && clock.t >= queued_until) {
+                queued = false;
+            }
+        }
+
+        auto ready(Clock::duration timeout) -> bool override {
+            retire();
+            if (queued && clock.t + timeout >= queued_until) {
+                clock.t = queued_until;
+                retire();
+            }
+            return !queued;
+        }
+
+        auto present() -> void override {
+            ++presents;
+            queued = true;
+            queued_until = next_vblank();
+        }
+
+        SimClock &clock;
+        Clock::duration vblank = microseconds(16'667);
+        Clock::time_point queued_until{};
+        bool queued = false;
+        uint64_t presents = 0;
+    };
+
+    struct Run {
+        uint64_t frames;
+        FrameSummary summary;
+        uint64_t late;
+    };
+
+    // simulates RunApp's loop: sleep for the scheduler timeout (or until the swap chain is ready), then tick
+    auto simulate(FrameMode mode, Clock::duration interval, Clock::duration duration,
+                  Clock::duration request_every) -> Run {
+        SimClock clock;
+        SimSwapChain chain(clock);
+        FrameScheduler scheduler(clock, chain);
+        scheduler.set_mode(mode);
+        scheduler.set_interval(interval);
+
+        std::mt19937 rng(1);
+        std::uniform_int_distribution<int> cost_us(1'000, 6'000);
+        std::uniform_int_distribution<int> spike(0, 99);
+
+        Clock::time_point next_request{};
+        const auto end = clock.t + duration;
+        while (clock.t < end) {
+            if (request_every.count() && clock.t >= next_request) {
+                scheduler.request_frame(); // input or data arriving
+                next_request += request_every;
+            }
+
+            // like MsgWaitForMultipleObjectsEx: on the waitable object without timeout, or on the timeout alone
+            auto wake = end;
+            if (scheduler.waits_on_swap_chain(clock.t)) {
+                chain.retire();
+                wake = std::min(wake, chain.queued ? chain.queued_until : clock.t);
+            } else if (scheduler.wait_timeout(clock.t) != Clock::duration::max()) {
+                wake = std::min(wake, clock.t + scheduler.wait_timeout(clock.t));
+            }
+            if (request_every.count()) {
+                wake = std::min(wake, next_request);
+            }
+            clock.t = std::max(clock.t, wake);
+
+            scheduler.tick([&] {
+                clock.t += microseconds(cost_us(rng) + (spike(rng) == 0 ? 25'000 : 0));
+                return true;
+            });
+        }
+        return {chain.presents, scheduler.stats().summary(), scheduler.stats().late_frames()};
+    }
+
+    auto ms(Clock::duration d) -> double {
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+}
+
+int main() {
+    const auto duration = std::chrono::seconds(10);
+    const auto vsync = microseconds(16'667);
+
+    const auto continuous = simulate(FrameMode::continuous, vsync, duration, {});
+    const auto fixed = simulate(FrameMode::fixed_rate, microseconds(33'333), duration, {});
+    const auto on_demand = simulate(FrameMode::on_demand, vsync, duration, microseconds(250'000));
+    const auto idle = simulate(FrameMode::on_demand, vsync, duration, {});
+
+    check(continuous.frames > 500 && continuous.frames <= 601, "continuous is paced by vblank");
+    check(fixed.frames > 270 && fixed.frames <= 301, "fixed rate keeps ~30 fps");
+    check(on_demand.frames >= 39 && on_demand.frames <= 41, "on demand renders once per request");
+    check(idle.frames == 1, "idle on demand renders only the first frame");
+
+    std::printf("%-12s %7s %9s %9s %9s %11s %11s %6s\n",
+                "mode", "frames", "cpu p50", "cpu p99", "cpu max", "interval p50", "interval p99", "late");
+    const struct {
+        const char *name;
+        const Run &run;
+    } rows[] = {{"continuous", continuous}, {"fixed 30Hz", fixed}, {"on demand", on_demand}, {"idle", idle}};
+    for (const auto &row: rows) {
+        const auto &s = row.run.summary;
+        std::printf("%-12s %7llu %7.2fms %7.2fms %7.2fms %10.2fms %10.2fms %6llu\n", row.name,
+                    static_cast<unsigned long long>(row.run.frames),
+                    ms(s.cpu_p50), ms(s.cpu_p99), ms(s.cpu_max), ms(s.interval_p50), ms(s.interval_p99),
+                    static_cast<unsigned long long>(row.run.late));
+    }
+    return 0;
+}
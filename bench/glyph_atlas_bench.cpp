@@ -0,0 +1,305 @@
+// The glyph atlas behind the non-D2D text path: shelf packing without overlaps, hits and
+// subpixel phases, eviction under a budget with the current frame pinned, re-rasterization after
+// eviction, and glyphs/sec for a page of text drawn from the atlas against rasterizing every glyph
+// every frame. The rasterizer is synthetic (a supersampled ring per glyph) but costs about what a
+// hinted outline does at these sizes.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "BenchCheck.hpp"
+#include "core/CpuRenderer.hpp"
+#include "core/GlyphAtlas.hpp"
+
+using namespace borderless;
+using bench::check;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    constexpr uint32_t space = 32;
+    constexpr uint32_t missing = 1000; // ids from here on are not in the font
+
+    auto elapsed_ns(Clock::time_point start) -> double {
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    auto rasterize(const GlyphKey &key, float offset_x, GlyphBitmap &bitmap) -> bool {
+        if (key.glyph >= missing) {
+            return false;
+        }
+        bitmap.advance = key.size * 0.55f + float(key.glyph % 3) * 0.25f;
+        if (key.glyph == space) {
+            bitmap.advance = key.size * 0.3f;
+            return true;
+        }
+        const auto w = static_cast<int32_t>(key.size * 0.5f) + static_cast<int32_t>(key.glyph % 4);
+        const auto h = static_cast<int32_t>(key.size * 0.7f) + static_cast<int32_t>(key.glyph % 3);
+        bitmap.width = w + (offset_x > 0.0f ? 1 : 0);
+        bitmap.height = h;
+        bitmap.left = static_cast<int32_t>(key.glyph % 2);
+        bitmap.top = h - static_cast<int32_t>(key.glyph % 5 == 0 ? key.size * 0.2f : 0.0f);
+        bitmap.pixels.resize(static_cast<size_t>(bitmap.width) * static_cast<size_t>(bitmap.height));
+
+        // a ring through the glyph box, 4x4 samples per pixel
+        const float cx = float(w) / 2 + offset_x, cy = float(h) / 2;
+        const float outer = float(std::min(w, h)) / 2, inner = outer * (0.4f + float(key.glyph % 7) * 0.05f);
+        for (int32_t y = 0; y < bitmap.height; ++y) {
+            for (int32_t x = 0; x < bitmap.width; ++x) {
+                int covered = 0;
+                for (int sy = 0; sy < 4; ++sy) {
+                    for (int sx = 0; sx < 4; ++sx) {
+                        const float dx = float(x) + (float(sx) + 0.5f) / 4 - cx;
+                        const float dy = (float(y) + (float(sy) + 0.5f) / 4 - cy) * float(w) / float(h);
+                        const float d = std::sqrt(dx * dx + dy * dy);
+                        covered += d <= outer && d >= inner;
+                    }
+                }
+                bitmap.pixels[static_cast<size_t>(y) * bitmap.width + x] = static_cast<uint8_t>(covered * 255 / 16);
+            }
+        }
+        return true;
+    }
+
+    auto page_matches(const GlyphAtlas &atlas, const AtlasGlyph &glyph, const GlyphKey &key) -> bool {
+        GlyphBitmap expected;
+        rasterize(key, float(key.subpixel) / float(atlas.options().subpixel_steps), expected);
+        const auto page = atlas.page(glyph.page);
+        if (!page.pixels || glyph.source.width() != expected.width || glyph.source.height() != expected.height) {
+            return false;
+        }
+        for (int32_t y = 0; y < expected.height; ++y) {
+            for (int32_t x = 0; x < expected.width; ++x) {
+                const auto stored = page.pixels[static_cast<size_t>(glyph.source.top + y) * page.stride +
+                                                glyph.source.left + x];
+                if (stored != expected.pixels[static_cast<size_t>(y) * expected.width + x]) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    auto check_packer() -> void {
+        std::mt19937 rng(7);
+        ShelfPacker packer(256, 256);
+        std::vector<uint8_t> taken(256 * 256, 0);
+        int64_t area = 0;
+        int placed = 0;
+        for (;;) {
+            const auto w = static_cast<int32_t>(4 + rng() % 17), h = static_cast<int32_t>(8 + rng() % 9);
+            const auto rect = packer.allocate(w, h);
+            if (!rect) {
+                break;
+            }
+            check(rect->width() == w && rect->height() == h, "packer returns the asked size");
+            check(rect->left >= 0 && rect->top >= 0 && rect->right <= 256 && rect->bottom <= 256, "packer stays in page");
+            for (int32_t y = rect->top; y < rect->bottom; ++y) {
+                for (int32_t x = rect->left; x < rect->right; ++x) {
+                    check(!taken[static_cast<size_t>(y) * 256 + x], "packed rects do not overlap");
+                    taken[static_cast<size_t>(y) * 256 + x] = 1;
+                }
+            }
+            area += int64_t{w} * h;
+            ++placed;
+        }
+        check(packer.used_area() == area, "used area adds up");
+        check(double(area) / (256.0 * 256.0) > 0.75, "shelves fill most of the page");
+        check(!packer.allocate(0, 4) && !packer.allocate(257, 4), "degenerate and oversized rects are refused");
+        packer.reset();
+        check(packer.used_area() == 0 && packer.allocate(256, 256).has_value(), "reset frees the page");
+        std::printf("packer: %d rects, %.0f%% of a 256x256 page\n", placed, 100.0 * double(area) / (256.0 * 256.0));
+    }
+
+    auto check_atlas() -> void {
+        GlyphAtlas atlas(rasterize);
+        const GlyphKey a{1, 65, 16.0f, 0};
+        const auto first = atlas.find(a);
+        check(first && atlas.stats().misses == 1, "a miss rasterizes");
+        check(atlas.find(a) == first && atlas.stats().hits == 1 && atlas.stats().misses == 1, "a hit does not");
+        check(page_matches(atlas, *first, a), "page holds the rasterized coverage");
+        check(atlas.take_dirty(first->page) == first->source && atlas.take_dirty(first->page).empty(),
+              "new glyphs are reported dirty once");
+
+        const GlyphKey shifted{1, 65, 16.0f, 2};
+        const auto second = atlas.find(shifted);
+        check(second && second != first && page_matches(atlas, *second, shifted), "subpixel phases are separate glyphs");
+        check(!atlas.find({1, missing, 16.0f, 0}) && atlas.stats().failed == 1, "missing glyphs are not cached");
+        check(!atlas.find({1, 65, 4000.0f, 0}) && atlas.stats().oversized == 1, "glyphs larger than a page are refused");
+        const auto blank = atlas.find({1, space, 16.0f, 0});
+        check(blank && blank->page == GlyphAtlas::no_page && blank->source.empty(), "spaces take no page space");
+
+        check(atlas.snap(10.0f) == std::make_pair(10, uint8_t{0}) && atlas.snap(10.3f) == std::make_pair(10, uint8_t{1}) &&
+              atlas.snap(10.9f) == std::make_pair(11, uint8_t{0}) && atlas.snap(-0.5f) == std::make_pair(-1, uint8_t{2}),
+              "pen positions snap to quarter pixels");
+
+        const std::vector<uint32_t> text{72, 101, 108, 108, 111, space, 119, 111, 114, 108, 100};
+        std::vector<GlyphQuad> quads;
+        const PointF origin{10.25f, 30.0f};
+        const auto pen = atlas.layout({1, 16.0f, origin, text.data(), nullptr, text.size()}, quads);
+        check(quads.size() == text.size() - 1, "one quad per visible glyph");
+        float advance = 0;
+        for (const auto glyph: text) {
+            advance += atlas.find({1, glyph, 16.0f, 0})->advance;
+        }
+        check(std::fabs(pen.x - origin.x - advance) < 1e-3f && pen.y == origin.y, "the pen moves by the advances");
+
+        // quads drawn from the atlas look exactly like the glyphs rasterized and blended one by one
+        Surface from_atlas, direct;
+        from_atlas.resize(200, 50);
+        direct.resize(200, 50);
+        CpuRenderer(from_atlas).draw_glyphs(atlas, quads, {0, 0, 0, 1});
+        CpuRenderer renderer(direct);
+        GlyphBitmap bitmap;
+        auto x = origin.x;
+        for (const auto glyph: text) {
+            const auto [px, phase] = atlas.snap(x);
+            bitmap = {};
+            rasterize({1, glyph, 16.0f, phase}, float(phase) / 4, bitmap);
+            if (bitmap.width) {
+                renderer.draw_mask({bitmap.pixels.data(), bitmap.width, bitmap.height, bitmap.width},
+                                   {px + bitmap.left, 30 - bitmap.top}, {0, 0, 0, 1});
+            }
+            x += bitmap.advance;
+        }
+        check(from_atlas.pixels == direct.pixels, "atlas text matches direct rasterization");
+    }
+
+    auto check_eviction() -> void {
+        GlyphAtlasOptions options;
+        options.page_size = 64;
+        options.budget_bytes = 2 * 64 * 64;
+        GlyphAtlas atlas(rasterize, options);
+
+        // 40 new glyphs a frame, more than a page; old pages go, the budget holds between frames
+        for (uint32_t frame = 0; frame < 20; ++frame) {
+            atlas.begin_frame();
+            check(atlas.bytes() <= options.budget_bytes, "trimmed to budget at frame start");
+            for (uint32_t i = 0; i < 40; ++i) {
+                const GlyphKey key{frame, 33 + i, 14.0f, 0};
+                const auto glyph = atlas.find(key);
+                check(glyph && page_matches(atlas, *glyph, key), "glyph intact after evictions");
+            }
+        }
+        check(atlas.stats().evicted_pages > 0 && atlas.stats().evicted_glyphs > 0, "pages are evicted");
+
+        const auto misses = atlas.stats().misses;
+        atlas.begin_frame();
+        const GlyphKey old{0, 33, 14.0f, 0};
+        const auto again = atlas.find(old);
+        check(again && atlas.stats().misses == misses + 1 && page_matches(atlas, *again, old),
+              "an evicted glyph is rasterized again");
+
+        // one frame needing far more than the budget: nothing used in it may be evicted
+        atlas.begin_frame();
+        std::vector<std::pair<GlyphKey, const AtlasGlyph *>> used;
+        for (uint32_t i = 0; i < 200; ++i) {
+            const GlyphKey key{100 + i % 7, 33 + i, 14.0f, static_cast<uint8_t>(i % 4)};
+            used.emplace_back(key, atlas.find(key));
+        }
+        check(atlas.stats().overruns > 0 && atlas.bytes() > options.budget_bytes, "the atlas grows for one frame");
+        const auto hits = atlas.stats().hits;
+        for (const auto &[key, glyph]: used) {
+            check(atlas.find(key) == glyph && page_matches(atlas, *glyph, key), "glyphs of the frame stay put");
+        }
+        check(atlas.stats().hits == hits + used.size(), "and stay cached");
+        atlas.begin_frame();
+        check(atlas.bytes() <= options.budget_bytes, "and shrinks back the next frame");
+        std::printf("%s", format_glyph_atlas_stats(atlas.stats()).c_str());
+    }
+}
+
+auto main() -> int {
+    check_packer();
+    check_atlas();
+    check_eviction();
+
+    // a page of text: 60 lines of 80 glyphs at two sizes, pen positions at arbitrary fractions
+    std::mt19937 rng(42);
+    constexpr int lines = 60, per_line = 80;
+    std::vector<std::vector<uint32_t>> text(lines);
+    for (auto &line: text) {
+        for (int i = 0; i < per_line; ++i) {
+            line.push_back(rng() % 6 == 0 ? space : 33 + rng() % 94);
+        }
+    }
+    const auto run = [&](int line) -> GlyphRun {
+        const float size = line % 4 == 0 ? 16.0f : 13.0f;
+        return {1, size, {4.0f + float(line % 5) * 0.37f, 18.0f + float(line) * 17.0f}, text[line].data(), nullptr,
+                text[line].size()};
+    };
+    Surface cached_surface, uncached_surface;
+    cached_surface.resize(1024, 1060);
+    uncached_surface.resize(1024, 1060);
+
+    GlyphAtlas atlas(rasterize);
+    std::vector<GlyphQuad> quads;
+    CpuRenderer cached(cached_surface);
+    const auto draw_cached = [&] {
+        atlas.begin_frame();
+        quads.clear();
+        for (int line = 0; line < lines; ++line) {
+            atlas.layout(run(line), quads);
+        }
+        cached.draw_glyphs(atlas, quads, {0.1f, 0.1f, 0.1f, 1});
+    };
+    CpuRenderer uncached(uncached_surface);
+    GlyphBitmap bitmap;
+    const auto draw_uncached = [&] {
+        for (int line = 0; line < lines; ++line) {
+            const auto r = run(line);
+            auto x = r.origin.x;
+            for (size_t i = 0; i < r.count; ++i) {
+                const auto [px, phase] = atlas.snap(x);
+                bitmap.width = bitmap.height = 0;
+                rasterize({r.font, r.glyphs[i], r.size, phase}, float(phase) / 4, bitmap);
+                if (bitmap.width) {
+                    uncached.draw_mask({bitmap.pixels.data(), bitmap.width, bitmap.height, bitmap.width},
+                                       {px + bitmap.left, static_cast<int32_t>(std::lround(r.origin.y)) - bitmap.top},
+                                       {0.1f, 0.1f, 0.1f, 1});
+                }
+                x += bitmap.advance;
+            }
+        }
+    };
+
+    draw_cached();
+    draw_uncached();
+    check(cached_surface.pixels == uncached_surface.pixels, "cached and uncached text are identical");
+    atlas.reset_stats();
+
+    const int frames = 40;
+    auto start = Clock::now();
+    for (int i = 0; i < frames; ++i) {
+        draw_uncached();
+    }
+    const auto uncached_ns = elapsed_ns(start) / frames;
+    start = Clock::now();
+    for (int i = 0; i < frames; ++i) {
+        draw_cached();
+    }
+    const auto cached_ns = elapsed_ns(start) / frames;
+    start = Clock::now();
+    for (int i = 0; i < frames * 10; ++i) {
+        atlas.begin_frame();
+        quads.clear();
+        for (int line = 0; line < lines; ++line) {
+            atlas.layout(run(line), quads);
+        }
+    }
+    const auto layout_ns = elapsed_ns(start) / (frames * 10);
+    check(atlas.stats().misses == 0, "a warm page of text rasterizes nothing");
+
+    const double glyphs = lines * per_line;
+    std::printf("%-34s %12s %12s\n", "page of text (4800 glyphs)", "us/frame", "glyphs/s");
+    std::printf("%-34s %12.1f %12.3g\n", "rasterize + blend every glyph", uncached_ns / 1e3, glyphs / (uncached_ns / 1e9));
+    std::printf("%-34s %12.1f %12.3g\n", "atlas lookup + blend", cached_ns / 1e3, glyphs / (cached_ns / 1e9));
+    std::printf("%-34s %12.1f %12.3g\n", "atlas lookup only", layout_ns / 1e3, glyphs / (layout_ns / 1e9));
+    std::printf("speedup %.1fx, %zu glyphs on %zu page(s), %zu KB\n", uncached_ns / cached_ns, atlas.glyph_count(),
+                atlas.page_count(), atlas.bytes() / 1024);
+    return 0;
+}
@@ -0,0 +1,88 @@
+// Headless microbenchmark for borderless::HitTester.
+// Reports ns per WM_NCHITTEST lookup with a warm cache and, for comparison, with the
+// cache refreshed before every lookup (what the old per-message GetWindowRect path cost us
+// before even counting the system calls).
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "BenchCheck.hpp"
+#include "core/HitTester.hpp"
+
+using namespace borderless;
+using bench::check;
+
+namespace {
+
+    auto make_tester(const Rect &window) -> HitTester {
+        HitTester tester;
+        tester.update({8, 8}, window);
+        // caption strip across the top, three caption buttons and a no-drag search box
+        tester.add_region({{0, 0, 0, 32}, HitResult::caption, anchor_left | anchor_right | anchor_top});
+        tester.add_region({{-138, 0, -92, 32}, HitResult::minimize_button, anchor_right | anchor_top});
+        tester.add_region({{-92, 0, -46, 32}, HitResult::maximize_button, anchor_right | anchor_top});
+        tester.add_region({{-46, 0, 0, 32}, HitResult::close_button, anchor_right | anchor_top});
+        tester.add_region({{120, 4, 320, 28}, HitResult::client, anchor_left | anchor_top});
+        return tester;
+    }
+
+    auto sanity(HitTester &tester, const Rect &w) -> void {
+        check(tester.hit_test({w.left + 2, w.top + 2}) == HitResult::top_left, "top left corner");
+        check(tester.hit_test({w.right - 1, w.bottom - 1}) == HitResult::bottom_right, "bottom right corner");
+        check(tester.hit_test({w.right - 20, w.top + 16}) == HitResult::close_button, "close button");
+        check(tester.hit_test({w.left + 200, w.top + 16}) == HitResult::client, "no-drag zone");
+        check(tester.hit_test({w.left + 60, w.top + 16}) == HitResult::caption, "caption strip");
+        check(tester.hit_test({w.left + 200, w.top + 200}) == HitResult::caption, "draggable client");
+        check(tester.hit_test({w.left - 5, w.top + 200}) == HitResult::nowhere, "outside");
+
+        tester.set_draggable(false);
+        check(tester.hit_test({w.left + 200, w.top + 200}) == HitResult::client, "non-draggable client");
+        tester.set_draggable(true);
+
+        tester.set_resizable(false);
+        check(tester.hit_test({w.right - 1, w.top + 1}) == HitResult::close_button, "button under corner");
+        tester.set_resizable(true);
+    }
+}
+
+int main() {
+    const Rect window{100, 100, 580, 500};
+    auto tester = make_tester(window);
+    sanity(tester, window);
+
+    // cursor positions clustered around the window, like a mouse-move storm
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int32_t> xs(window.left - 16, window.right + 16);
+    std::uniform_int_distribution<int32_t> ys(window.top - 16, window.bottom + 16);
+    std::vector<Point> cursors(4096);
+    for (auto &p: cursors) {
+        p = {xs(rng), ys(rng)};
+    }
+
+    constexpr size_t iterations = 20'000'000;
+    using clock = std::chrono::steady_clock;
+
+    int64_t sink = 0;
+    auto start = clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        sink += static_cast<int64_t>(tester.hit_test(cursors[i & 4095]));
+    }
+    auto cached = std::chrono::duration<double, std::nano>(clock::now() - start).count() / iterations;
+
+    constexpr size_t refresh_iterations = iterations / 10;
+    start = clock::now();
+    for (size_t i = 0; i < refresh_iterations; ++i) {
+        tester.invalidate();
+        tester.update({8, 8}, window);
+        sink += static_cast<int64_t>(tester.hit_test(cursors[i & 4095]));
+    }
+    auto refreshed = std::chrono::duration<double, std::nano>(clock::now() - start).count() / refresh_iterations;
+
+    std::printf("hit_test cached:    %6.2f ns/lookup\n", cached);
+    std::printf("hit_test refreshed: %6.2f ns/lookup\n", refreshed);
+    std::printf("(checksum %lld)\n", static_cast<long long>(sink));
+    return 0;
+}
@@ -0,0 +1,454 @@
+// Layer caching under a fake 60 Hz clock: per-layer damage and filtered painting in the scene,
+// promotion and demotion by update rate with hysteresis, the layer budget, placements that keep
+// the paint order for random overlapping layers, surfaces that cover everything their layer
+// paints, the replay of a recorded update trace through a binary save and load, and the cost of a
+// policy frame.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BenchCheck.hpp"
+#include "core/CpuRenderer.hpp"
+#include "core/LayerPolicy.hpp"
+#include "core/Scene.hpp"
+#include "core/Trace.hpp"
+
+using namespace borderless;
+using bench::check;
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+using Duration = FrameClockType::duration;
+
+namespace {
+
+    constexpr Duration frame_interval = 16'667us;
+
+    auto elapsed_ns(Clock::time_point start) -> double {
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    auto check_scene_layers() -> void {
+        Scene scene;
+        auto chrome = scene.add(scene.root(), GroupNode{});
+        scene.set_layer(chrome, 1);
+        auto title = scene.add(chrome, EllipseNode{{40.0f, 20.0f}, 30.0f, 10.0f, {1, 1, 1, 1}});
+        auto badge = scene.add(chrome, EllipseNode{{200.0f, 20.0f}, 10.0f, 10.0f, {1, 0, 0, 1}});
+        auto spinner = scene.add(scene.root(), EllipseNode{{100.0f, 100.0f}, 20.0f, 20.0f, {0, 0, 1, 1}});
+
+        LayerDamage damage(1);
+        damage[0].set_surface({0, 0, 400, 300});
+        scene.update(damage);
+        check(damage.size() == 2 && !damage[0].empty() && !damage[1].empty(), "first frame damages both layers");
+        check(damage[1].surface() == damage[0].surface(), "new layers take the surface");
+        check(scene.layer(title) == 1 && scene.layer(badge) == 1 && scene.layer(spinner) == 0, "layers inherit");
+
+        for (auto &region: damage) {
+            region.clear();
+        }
+        scene.set_transform(spinner, Transform::translation(5.0f, 0.0f));
+        scene.update(damage);
+        check(!damage[0].empty() && damage[1].empty(), "a change stays in its layer");
+
+        std::vector<LayerSample> samples;
+        layer_samples(scene, damage, samples);
+        check(samples.size() == 2 && samples[0].layer == 1 && samples[1].layer == 0, "runs in paint order");
+        check(!samples[0].updated && samples[1].updated, "runs know their damage");
+        check(samples[0].bounds == unite(scene.bounds(title), scene.bounds(badge)), "run bounds");
+        check(scene.subtree_bounds(chrome) == samples[0].bounds, "subtree bounds");
+
+        std::vector<NodeId> painted;
+        scene.paint({0, 0, 400, 300}, [](uint32_t layer) { return layer == 1; },
+                    [&](NodeId id, const NodeContent &, const Transform &) { painted.push_back(id); });
+        check(painted == std::vector<NodeId>{title, badge}, "painting is limited to the included layers");
+
+        // moving the badge out of the layer damages both
+        for (auto &region: damage) {
+            region.clear();
+        }
+        scene.set_layer(badge, 0);
+        scene.update(damage);
+        check(damage[0].intersects(scene.bounds(badge)) && damage[1].intersects(scene.bounds(badge)),
+              "a node changing layers damages the old and the new one");
+        for (auto &region: damage) {
+            region.clear();
+        }
+        const auto removed = scene.bounds(title);
+        scene.remove(title);
+        scene.update(damage);
+        check(damage[0].empty() && damage[1].intersects(removed), "removal damages the node's layer");
+
+        // the single-region update still sees everything
+        DamageRegion all;
+        all.set_surface({0, 0, 400, 300});
+        scene.set_transform(spinner, {});
+        scene.set_content(badge, EllipseNode{{200.0f, 20.0f}, 12.0f, 12.0f, {1, 0, 0, 1}});
+        scene.update(all);
+        check(all.intersects(scene.bounds(spinner)) && all.intersects(scene.bounds(badge)), "one region for all");
+    }
+
+    // a fixed layout whose layers update on a schedule, run against the policy at 60 Hz
+    struct Session {
+        LayerPolicy policy;
+        std::vector<LayerSample> layout;
+        std::function<bool(uint32_t layer, int frame)> updates;
+        std::map<uint32_t, std::vector<std::pair<Duration, LayerDecision>>> history;
+
+        auto run(int first, int count) -> void {
+            const FrameClockType::time_point t0{};
+            auto samples = layout;
+            for (int frame = first; frame < first + count; ++frame) {
+                for (auto &sample: samples) {
+                    sample.updated = frame == 0 || updates(sample.layer, frame);
+                }
+                const auto at = frame * frame_interval;
+                for (const auto &decision: policy.frame(t0 + at, samples)) {
+                    history[decision.layer].emplace_back(at, decision);
+                }
+            }
+        }
+
+        auto changes(uint32_t layer) -> size_t { return history[layer].size(); }
+    };
+
+    // no layer changes twice within min_dwell, unless it disappeared or lost its place
+    auto check_dwell(const Session &session, Duration dwell) -> void {
+        for (const auto &[layer, decisions]: session.history) {
+            for (size_t i = 1; i < decisions.size(); ++i) {
+                check(decisions[i].first - decisions[i - 1].first >= dwell, "changes respect the dwell time");
+            }
+        }
+    }
+
+    auto check_hysteresis() -> void {
+        Session session;
+        // background, then chrome, a 1 Hz clock, a spinner, a 3 Hz meter and a 6 Hz graph
+        session.layout = {{0, {0, 0, 800, 600}, false},
+                          {1, {0, 0, 800, 40}, false},
+                          {2, {600, 60, 760, 100}, false},
+                          {3, {300, 300, 364, 364}, false},
+                          {4, {20, 400, 220, 440}, false},
+                          {5, {20, 460, 420, 580}, false}};
+        session.updates = [](uint32_t layer, int frame) {
+            switch (layer) {
+                case 0:
+                    return frame % 30 == 0;
+                case 2:
+                    return frame % 60 == 0;
+                case 3:
+                    return true;
+                case 4:
+                    return frame % 20 == 0;
+                case 5:
+                    return frame % 10 == 0;
+                default:
+                    return false;
+            }
+        };
+        session.run(0, 600);
+        const auto &policy = session.policy;
+        check(policy.placement(1) == LayerPlacement::above && policy.placement(2) == LayerPlacement::above,
+              "static chrome and the clock get surfaces over the background");
+        check(policy.placement(3) == LayerPlacement::swap_chain, "the spinner stays in the swap chain");
+        check(policy.placement(4) == LayerPlacement::swap_chain && policy.placement(5) == LayerPlacement::swap_chain,
+              "rates between the thresholds never promote a new layer");
+        check(session.changes(1) == 1 && session.changes(2) == 1 && session.changes(3) == 0, "promoted once");
+        check(policy.rate(2) < 2.0 && policy.rate(3) > 50.0, "rates track updates per second");
+        const auto chrome = session.history[1][0].first;
+        check(chrome >= 1s && chrome < 2s, "new layers settle before they are cached");
+
+        // the chrome animates for half a second, then rests again
+        session.updates = [previous = session.updates](uint32_t layer, int frame) {
+            return layer == 1 ? frame < 630 : previous(layer, frame);
+        };
+        session.run(600, 600);
+        const auto &chrome_changes = session.history[1];
+        check(chrome_changes.size() == 3 && chrome_changes[1].second.to == LayerPlacement::swap_chain &&
+              chrome_changes[2].second.to == LayerPlacement::above, "a burst demotes once and the layer comes back");
+        check(chrome_changes[1].first < 600 * frame_interval + 300ms, "demoted early in the burst");
+        check(session.changes(2) == 1 && session.changes(4) == 0 && session.changes(5) == 0,
+              "other layers are left alone");
+        check_dwell(session, LayerPolicyOptions{}.min_dwell);
+
+        // a layer that goes away leaves its surface behind
+        session.layout.erase(session.layout.begin() + 2);
+        session.run(1200, 1);
+        check(session.history[2].back().second.to == LayerPlacement::swap_chain && session.policy.cached() == 1,
+              "a vanished layer is demoted");
+    }
+
+    auto check_budget() -> void {
+        LayerPolicyOptions options;
+        options.max_layers = 4;
+        options.max_area = 200 * 200;
+        Session session{LayerPolicy(options), {}, [](uint32_t, int) { return false; }, {}};
+        for (uint32_t i = 1; i <= 8; ++i) {
+            const int32_t size = 40 + int32_t(i) * 10;
+            session.layout.push_back({i, Rect{0, 0, size, size}.offset(int32_t(i) * 200, 0), false});
+        }
+        session.layout.push_back({9, {0, 300, 40, 340}, false}); // below min_area
+        session.run(0, 300);
+        const auto &policy = session.policy;
+        check(policy.cached() <= 4 && policy.stats().over_budget > 0, "budget caps the layers");
+        int64_t area = 0;
+        for (uint32_t i = 1; i <= 8; ++i) {
+            if (policy.placement(i) != LayerPlacement::swap_chain) {
+                area += policy.bounds(i).area();
+            }
+        }
+        check(area <= options.max_area, "budget caps the area");
+        check(policy.placement(8) != LayerPlacement::swap_chain, "the largest static layer comes first");
+        check(policy.placement(9) == LayerPlacement::swap_chain, "small layers are not worth a surface");
+    }
+
+    auto check_paint_order() -> void {
+        Session session;
+        // chrome between the background and an overlay of untagged content on top of it
+        session.layout = {{0, {0, 0, 800, 600}, false},
+                          {1, {0, 0, 800, 40}, false},
+                          {0, {700, 10, 790, 30}, false},
+                          {2, {0, 560, 800, 600}, false},
+                          {3, {100, 100, 300, 300}, false},
+                          {4, {200, 200, 400, 400}, false}};
+        session.updates = [](uint32_t layer, int) { return layer == 0; };
+        session.run(0, 180);
+        const auto &policy = session.policy;
+        check(policy.placement(1) == LayerPlacement::swap_chain && policy.stats().blocked > 0,
+              "content on both sides keeps a layer in the swap chain");
+        check(policy.placement(2) == LayerPlacement::above, "the footer goes over the background");
+        check(policy.placement(3) == LayerPlacement::above && policy.placement(4) == LayerPlacement::above,
+              "overlapping cached layers stack in paint order");
+        check(policy.stacking() == (std::vector<uint32_t>{2, 3, 4}), "stacking bottom to top");
+
+        // nothing under a layer lets it sit below the swap chain
+        Session under;
+        under.layout = {{1, {0, 0, 400, 400}, false}, {0, {100, 100, 200, 200}, false}};
+        under.updates = [](uint32_t layer, int) { return layer == 0; };
+        under.run(0, 180);
+        check(under.policy.placement(1) == LayerPlacement::below, "a backdrop goes under the swap chain");
+        check(under.policy.stacking() == std::vector<uint32_t>{1}, "one cached layer");
+    }
+
+    // random overlapping runs; every frame the composed order must match the paint order
+    auto check_random_order() -> void {
+        std::mt19937 rng(17);
+        for (int round = 0; round < 50; ++round) {
+            LayerPolicyOptions options;
+            options.min_area = 0;
+            LayerPolicy policy(options);
+            const FrameClockType::time_point t0{};
+            std::vector<LayerSample> samples;
+            const auto runs = 4 + rng() % 12;
+            for (uint32_t i = 0; i < runs; ++i) {
+                const int32_t x = rng() % 600, y = rng() % 400;
+                samples.push_back({uint32_t(rng() % 6), {x, y, x + 40 + int32_t(rng() % 200),
+                                                          y + 40 + int32_t(rng() % 200)}, false});
+            }
+            std::vector<bool> dynamic(6);
+            for (auto &&d: dynamic) {
+                d = rng() % 3 == 0;
+            }
+            for (int frame = 0; frame < 240; ++frame) {
+                for (auto &sample: samples) {
+                    sample.updated = frame == 0 || (dynamic[sample.layer] && frame % 2 == 0);
+                }
+                policy.frame(t0 + frame * frame_interval, samples);
+                for (size_t i = 0; i < samples.size(); ++i) {
+                    for (size_t j = i + 1; j < samples.size(); ++j) {
+                        const auto a = samples[i].layer, b = samples[j].layer;
+                        if (a == b || !intersects(samples[i].bounds, samples[j].bounds)) {
+                            continue;
+                        }
+                        // visual position: group, then first run within a group, then the run itself
+                        auto position = [&](uint32_t layer, size_t run) {
+                            const auto at = layer == 0 ? LayerPlacement::swap_chain : policy.placement(layer);
+                            size_t first = run;
+                            if (at != LayerPlacement::swap_chain) {
+                                first = 0;
+                                while (samples[first].layer != layer) {
+                                    ++first;
+                                }
+                            }
+                            const int group = at == LayerPlacement::below ? 0 : at == LayerPlacement::above ? 2 : 1;
+                            return std::make_pair(group, first);
+                        };
+                        check(position(a, i) < position(b, j), "cached layers keep the paint order");
+                    }
+                }
+            }
+        }
+    }
+
+    // the shell's scene: a pulsing ellipse and a static label whose glyph run overhangs its layout
+    // box. Once a layer is promoted, its surface is sized to policy.bounds(); painting the layer
+    // alone must not put a pixel outside that rect, or the surface would crop it
+    auto check_surface_coverage() -> void {
+        Scene scene;
+        const auto ellipse = scene.add(scene.root(), EllipseNode{{100.0f, 100.0f}, 100.0f, 100.0f, {0, 1, 0, 1}});
+        const auto label = scene.add(scene.root(), TextNode{{{L"Arial", 400, 48.0f, L"en-us"}, L"Hello, World!",
+                                                             300.0f, 60.0f}, {50.0f, 150.0f}, {0, 0, 0, 1}});
+        scene.set_layer(ellipse, 1);
+        scene.set_layer(label, 2);
+
+        Surface surface;
+        surface.resize(640, 480);
+        std::vector<uint8_t> coverage(420 * 80, 0xff);
+        const AlphaMask run{coverage.data(), 420, 80, 420};
+        CpuRenderer renderer(surface);
+        renderer.set_text_rasterizer([&](const TextLayoutKey &) { return &run; });
+
+        LayerPolicy policy;
+        LayerDamage damage(1);
+        damage[0].set_surface({0, 0, 640, 480});
+        std::vector<LayerSample> samples;
+        for (int frame = 0; frame < 180; ++frame) {
+            for (auto &region: damage) {
+                region.clear();
+            }
+            auto pulse = std::get<EllipseNode>(scene.content(ellipse));
+            pulse.color.a = frame % 2 ? 0.5f : 1.0f;
+            scene.set_content(ellipse, pulse);
+            scene.update(damage);
+            layer_samples(scene, damage, samples);
+            policy.frame(FrameClockType::time_point{} + frame * frame_interval, samples);
+        }
+        check(policy.placement(2) != LayerPlacement::swap_chain && policy.placement(1) == LayerPlacement::swap_chain,
+              "the static label is promoted, the pulsing ellipse is not");
+
+        for (const uint32_t layer: {1u, 2u}) {
+            if (policy.placement(layer) == LayerPlacement::swap_chain) {
+                continue;
+            }
+            DamageRegion all;
+            all.set_surface({0, 0, 640, 480});
+            all.add_all();
+            renderer.begin_frame();
+            paint(scene, all, renderer, [layer](uint32_t l) { return l == layer; });
+            renderer.end_frame();
+            const auto bounds = policy.bounds(layer);
+            bool covered = true;
+            for (int32_t y = 0; y < surface.height; ++y) {
+                for (int32_t x = 0; x < surface.width; ++x) {
+                    covered = covered && (surface.row(y)[x] == 0 || (x >= bounds.left && x < bounds.right &&
+                                                                     y >= bounds.top && y < bounds.bottom));
+                }
+            }
+            check(covered, "a promoted layer's surface covers everything its nodes paint");
+        }
+    }
+
+    // a recorded session: render_scene frames with layer_update events, as the shell writes them
+    auto recorded_trace(Duration length) -> trace::Snapshot {
+        trace::Snapshot snapshot;
+        snapshot.ticks_per_second = 3e9;
+        trace::ThreadTrace thread;
+        thread.name = "ui";
+        const auto frames = int(length / frame_interval);
+        const auto interval_ticks = uint64_t(snapshot.ticks_per_second * 16'667e-6);
+        uint64_t ticks = 123456789;
+        for (int frame = 0; frame < frames; ++frame) {
+            thread.records.push_back({ticks, uint16_t(trace::Event::render_scene), trace::Phase::begin, 0, 0});
+            for (uint32_t layer = 1; layer <= 3; ++layer) {
+                const bool updated = frame == 0 || (layer == 2 && frame % 60 == 0) || layer == 3;
+                if (updated) {
+                    thread.records.push_back({ticks + 10, uint16_t(trace::Event::layer_update),
+                                              trace::Phase::instant, 0, layer});
+                }
+            }
+            thread.records.push_back({ticks + 500, uint16_t(trace::Event::render_scene), trace::Phase::end, 0, 0});
+            thread.records.push_back({ticks + 600, uint16_t(trace::Event::present), trace::Phase::instant, 0, 1});
+            ticks += interval_ticks;
+        }
+        snapshot.threads.push_back(std::move(thread));
+        return snapshot;
+    }
+
+    auto check_trace_replay() -> void {
+        const std::string path = "layer_policy_bench.trace";
+        trace::Snapshot loaded;
+        check(trace::save(recorded_trace(5s), path) && trace::load(path, loaded), "save and load");
+        std::remove(path.c_str());
+        const auto frames = layer_update_frames(loaded);
+        check(frames.size() == 299, "one frame per render_scene");
+        check(frames[0].updated.size() == 3 && frames[1].updated == std::vector<uint32_t>{3} &&
+              frames[60].updated == (std::vector<uint32_t>{2, 3}), "updates land in their frames");
+        check(frames[60].at > 990ms && frames[60].at < 1010ms, "timestamps from the tick rate");
+
+        // replay the trace twice against the same layout; the decisions must not depend on the run
+        auto replay = [&] {
+            LayerPolicy policy;
+            std::vector<LayerSample> samples = {{0, {0, 0, 800, 600}, false},
+                                                {1, {0, 0, 800, 40}, false},
+                                                {2, {600, 60, 760, 100}, false},
+                                                {3, {300, 300, 364, 364}, false}};
+            std::vector<std::pair<Duration, LayerDecision>> decisions;
+            for (const auto &frame: frames) {
+                for (auto &sample: samples) {
+                    sample.updated = false;
+                    for (auto layer: frame.updated) {
+                        sample.updated = sample.updated || layer == sample.layer;
+                    }
+                }
+                for (const auto &decision: policy.frame(FrameClockType::time_point{} + frame.at, samples)) {
+                    decisions.emplace_back(frame.at, decision);
+                }
+            }
+            check(policy.placement(1) == LayerPlacement::above && policy.placement(2) == LayerPlacement::above &&
+                  policy.placement(3) == LayerPlacement::swap_chain, "the recorded session caches chrome and clock");
+            return decisions;
+        };
+        const auto first = replay(), second = replay();
+        check(first.size() == 2 && second.size() == first.size(), "two promotions");
+        for (size_t i = 0; i < first.size(); ++i) {
+            check(first[i].first == second[i].first && first[i].second.layer == second[i].second.layer,
+                  "replays decide the same");
+        }
+    }
+}
+
+auto main() -> int {
+    check_scene_layers();
+    check_hysteresis();
+    check_budget();
+    check_paint_order();
+    check_random_order();
+    check_surface_coverage();
+    check_trace_replay();
+
+    // the policy's share of a frame for scenes with many tagged runs
+    std::mt19937 rng(5);
+    std::printf("%-30s %10s %12s %10s\n", "runs", "frames", "us/frame", "cached");
+    LayerPolicyStats stats;
+    for (const uint32_t runs: {8u, 64u, 256u}) {
+        LayerPolicyOptions options;
+        options.max_layers = 32;
+        LayerPolicy policy(options);
+        std::vector<LayerSample> samples;
+        for (uint32_t i = 0; i < runs; ++i) {
+            const int32_t x = rng() % 1800, y = rng() % 1000;
+            samples.push_back({i % 4 == 0 ? 0 : i, {x, y, x + 64 + int32_t(rng() % 128), y + 64 + int32_t(rng() % 64)},
+                               false});
+        }
+        const FrameClockType::time_point t0{};
+        const int frames = 600;
+        const auto start = Clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            for (size_t i = 0; i < samples.size(); ++i) {
+                samples[i].updated = frame == 0 || (i % 3 == 0 && frame % 4 == 0);
+            }
+            policy.frame(t0 + frame * frame_interval, samples);
+        }
+        const auto per_frame = elapsed_ns(start) / frames;
+        char name[64];
+        std::snprintf(name, sizeof(name), "%u", runs);
+        std::printf("%-30s %10d %12.2f %10zu\n", name, frames, per_frame / 1e3, policy.cached());
+        stats = policy.stats();
+    }
+    std::printf("%s", format_layer_policy_stats(stats).c_str());
+    return 0;
+}
@@ -0,0 +1,238 @@
+// Feeds a synthetic window message stream (mouse-move and hit-test heavy, like a drag over the
+// window) through borderless::MessageDispatcher and through the equivalent switch statement, and
+// reports dispatch cost per message with instrumentation compiled out, switched off and on.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "BenchCheck.hpp"
+#include "core/MessageDispatcher.hpp"
+
+using namespace borderless;
+using bench::check;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    // Win32 message IDs, so the stats read like the real thing
+    enum : uint32_t {
+        wm_move = 0x0003,
+        wm_size = 0x0005,
+        wm_paint = 0x000F,
+        wm_setcursor = 0x0020,
+        wm_getminmaxinfo = 0x0024,
+        wm_nchittest = 0x0084,
+        wm_ncmousemove = 0x00A0,
+        wm_keydown = 0x0100,
+        wm_timer = 0x0113,
+        wm_mousemove = 0x0200,
+        wm_tray_icon = 0x0401,
+    };
+
+    struct FakeWindow {
+        int32_t left = 100, top = 100, right = 580, bottom = 500;
+        int32_t border = 8;
+        uint64_t resizes = 0;
+        uint64_t keys = 0;
+        uint64_t tray = 0;
+    };
+
+    // what DefWindowProc costs us here: nothing, but not inlined either
+#if defined(_MSC_VER)
+    __declspec(noinline)
+#else
+    __attribute__((noinline))
+#endif
+    auto default_proc(const Message &message) -> intptr_t {
+        return static_cast<intptr_t>(message.id & 1);
+    }
+
+    auto x_of(intptr_t lparam) -> int32_t { return static_cast<int16_t>(lparam & 0xFFFF); }
+
+    auto y_of(intptr_t lparam) -> int32_t { return static_cast<int16_t>((lparam >> 16) & 0xFFFF); }
+
+    auto on_nchittest(FakeWindow &w, const Message &m) -> std::optional<intptr_t> {
+        const auto x = x_of(m.lparam), y = y_of(m.lparam);
+        const bool l = x < w.left + w.border, r = x >= w.right - w.border;
+        const bool t = y < w.top + w.border, b = y >= w.bottom - w.border;
+        if (t) return l ? 13 : r ? 14 : 12;
+        if (b) return l ? 16 : r ? 17 : 15;
+        if (l) return 10;
+        if (r) return 11;
+        return 1;
+    }
+
+    auto on_size(FakeWindow &w, const Message &m) -> std::optional<intptr_t> {
+        w.right = w.left + x_of(m.lparam);
+        w.bottom = w.top + y_of(m.lparam);
+        ++w.resizes;
+        return std::nullopt; // like the shell, let the default processing run too
+    }
+
+    auto on_move(FakeWindow &w, const Message &m) -> std::optional<intptr_t> {
+        const auto width = w.right - w.left, height = w.bottom - w.top;
+        w.left = x_of(m.lparam);
+        w.top = y_of(m.lparam);
+        w.right = w.left + width;
+        w.bottom = w.top + height;
+        return std::nullopt;
+    }
+
+    auto on_keydown(FakeWindow &w, const Message &m) -> std::optional<intptr_t> {
+        if (m.wparam >= 0x76 && m.wparam <= 0x7A) { // F7..F11
+            ++w.keys;
+            return 0;
+        }
+        return std::nullopt;
+    }
+
+    auto on_timer(FakeWindow &, const Message &m) -> std::optional<intptr_t> {
+        if (m.wparam == 1) {
+            return 0;
+        }
+        return std::nullopt;
+    }
+
+    auto on_tray_icon(FakeWindow &w, const Message &) -> std::optional<intptr_t> {
+        ++w.tray;
+        return 0;
+    }
+
+    auto switch_proc(FakeWindow &w, const Message &m) -> intptr_t {
+        std::optional<intptr_t> result;
+        switch (m.id) {
+            case wm_nchittest:
+                result = on_nchittest(w, m);
+                break;
+            case wm_size:
+                result = on_size(w, m);
+                break;
+            case wm_move:
+                result = on_move(w, m);
+                break;
+            case wm_keydown:
+                result = on_keydown(w, m);
+                break;
+            case wm_timer:
+                result = on_timer(w, m);
+                break;
+            case wm_tray_icon:
+                result = on_tray_icon(w, m);
+                break;
+            default:
+                break;
+        }
+        return result ? *result : default_proc(m);
+    }
+
+    template<bool Instrumented>
+    auto make_dispatcher() -> MessageDispatcher<FakeWindow, Instrumented> {
+        MessageDispatcher<FakeWindow, Instrumented> d;
+        d.on(wm_nchittest, "WM_NCHITTEST", &on_nchittest)
+                .on(wm_size, "WM_SIZE", &on_size)
+                .on(wm_move, "WM_MOVE", &on_move)
+                .on(wm_keydown, "WM_KEYDOWN", &on_keydown)
+                .on(wm_timer, "WM_TIMER", &on_timer)
+                .on(wm_tray_icon, "WM_TRAY_ICON", &on_tray_icon);
+        return d;
+    }
+
+    auto make_stream(size_t count) -> std::vector<Message> {
+        struct Weighted {
+            uint32_t id;
+            int weight;
+        };
+        const Weighted mix[] = {
+                {wm_nchittest, 30}, {wm_mousemove, 25}, {wm_setcursor, 20}, {wm_ncmousemove, 8},
+                {wm_size, 4}, {wm_move, 4}, {wm_getminmaxinfo, 3}, {wm_paint, 2}, {wm_timer, 2},
+                {wm_keydown, 1}, {wm_tray_icon, 1},
+        };
+        std::vector<int> weights;
+        for (const auto &m: mix) {
+            weights.push_back(m.weight);
+        }
+        std::mt19937 rng(7);
+        std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+        std::uniform_int_distribution<int> coord(0, 700);
+        std::uniform_int_distribution<int> key(0x70, 0x7B);
+
+        std::vector<Message> stream;
+        stream.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            const auto id = mix[pick(rng)].id;
+            const auto lparam = static_cast<intptr_t>((coord(rng) << 16) | coord(rng));
+            stream.push_back({id, static_cast<uintptr_t>(id == wm_keydown ? key(rng) : i & 3), lparam});
+        }
+        return stream;
+    }
+
+    struct Run {
+        double ns_per_message;
+        intptr_t checksum;
+    };
+
+    template<typename Proc>
+    auto run(const std::vector<Message> &stream, int rounds, Proc &&proc) -> Run {
+        intptr_t checksum = 0;
+        const auto start = Clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (const auto &message: stream) {
+                checksum += proc(message);
+            }
+        }
+        const auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        return {elapsed / static_cast<double>(stream.size() * static_cast<size_t>(rounds)), checksum};
+    }
+}
+
+int main() {
+    const auto stream = make_stream(1'000'000);
+    const int rounds = 10;
+
+    FakeWindow baseline_window;
+    const auto baseline = run(stream, rounds, [&](const Message &m) { return switch_proc(baseline_window, m); });
+
+    FakeWindow stripped_window;
+    auto stripped = make_dispatcher<false>();
+    const auto table = run(stream, rounds, [&](const Message &m) {
+        return stripped.dispatch(stripped_window, m, [&] { return default_proc(m); });
+    });
+
+    FakeWindow off_window;
+    auto switched_off = make_dispatcher<true>();
+    switched_off.set_instrumentation(false);
+    const auto off = run(stream, rounds, [&](const Message &m) {
+        return switched_off.dispatch(off_window, m, [&] { return default_proc(m); });
+    });
+
+    FakeWindow on_window;
+    auto instrumented = make_dispatcher<true>();
+    const auto on = run(stream, rounds, [&](const Message &m) {
+        return instrumented.dispatch(on_window, m, [&] { return default_proc(m); });
+    });
+
+    check(table.checksum == baseline.checksum && off.checksum == baseline.checksum &&
+          on.checksum == baseline.checksum, "all dispatch paths return the same results");
+    check(on_window.resizes == baseline_window.resizes && on_window.keys == baseline_window.keys &&
+          on_window.tray == baseline_window.tray, "all dispatch paths run the same handlers");
+    check(stripped.stats().empty() && switched_off.stats().empty(), "no stats without instrumentation");
+
+    uint64_t counted = 0;
+    for (const auto &s: instrumented.stats()) {
+        counted += s.count;
+        check(s.latency.count() == s.count, "every dispatch lands in the histogram");
+    }
+    check(counted == stream.size() * rounds, "every message is counted once");
+
+    std::printf("%-34s %8s\n", "dispatch", "ns/msg");
+    std::printf("%-34s %8.2f\n", "switch statement", baseline.ns_per_message);
+    std::printf("%-34s %8.2f\n", "table, instrumentation compiled out", table.ns_per_message);
+    std::printf("%-34s %8.2f\n", "table, instrumentation off", off.ns_per_message);
+    std::printf("%-34s %8.2f\n", "table, counters + histograms", on.ns_per_message);
+    std::printf("\n%s", format_message_stats(instrumented.stats()).c_str());
+    return 0;
+}
@@ -0,0 +1,208 @@
+// Records a synthetic session the way the shell's --record does (a drag with its hit-test storm,
+// live resizing, a snap to maximized, tray hovering and clicks, the F7-F11 toggles and a DPI
+// change), saves and loads it, and checks the round trip is exact and that two replays end in the
+// same state. Reports bytes per message, replay cost per message and the per-type stats.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "BenchCheck.hpp"
+#include "core/MessageRecording.hpp"
+#include "core/MessageReplay.hpp"
+
+using namespace borderless;
+using bench::check;
+
+namespace {
+
+    auto point(int32_t x, int32_t y) -> intptr_t {
+        return static_cast<intptr_t>((static_cast<uint32_t>(y & 0xFFFF) << 16) | static_cast<uint32_t>(x & 0xFFFF));
+    }
+
+    struct Session {
+        MessageRecorder recorder;
+        uint64_t now_ns = 0;
+
+        auto send(uint32_t id, uintptr_t wparam, intptr_t lparam, uint16_t window = 0) -> void {
+            RecordedMessage m;
+            m.time_ns = now_ns;
+            m.window = window;
+            m.message = {id, wparam, lparam};
+            recorder.record(m);
+        }
+
+        auto send_rect(uint32_t id, uintptr_t wparam, Rect rect) -> void {
+            RecordedMessage m;
+            m.time_ns = now_ns;
+            m.message = {id, wparam, 0};
+            m.has_rect = true;
+            m.rect = rect;
+            recorder.record(m);
+        }
+
+        auto wait_ms(uint64_t ms) -> void { now_ns += ms * 1'000'000; }
+    };
+
+    auto record_session() -> MessageRecorder {
+        Session s;
+        s.send(wm::size, 0, point(800, 600));
+        s.send(wm::move, 0, point(100, 100));
+
+        // moving the mouse over the window, then dragging it by the caption
+        for (int i = 0; i < 3000; ++i) {
+            const auto x = 120 + (i % 600), y = 110 + (i / 600) * 4;
+            s.send(wm::nchittest, 0, point(x, y));
+            s.send(wm::mousemove, 0, point(x - 100, y - 100));
+            if (i >= 1000 && i % 2 == 0) {
+                s.send(wm::move, 0, point(100 + (i - 1000) / 10, 100));
+            }
+            s.wait_ms(1);
+        }
+        // live resizing from the bottom-right corner, the coalescing timer running
+        for (int i = 0; i < 1000; ++i) {
+            s.send(wm::nchittest, 0, point(899 + i / 4, 699));
+            s.send(wm::size, 0, point(800 + i / 4, 600 + i / 8));
+            if (i % 16 == 0) {
+                s.send(wm::timer, 1, 0);
+            }
+            s.wait_ms(1);
+        }
+        s.send(wm::exitsizemove, 0, 0);
+
+        // snapped to maximized and back
+        s.send_rect(wm::nccalcsize, 1, {-8, -8, 1928, 1048});
+        s.send(wm::size, 2, point(1920, 1040));
+        s.wait_ms(200);
+        s.send_rect(wm::nccalcsize, 1, {300, 200, 1100, 800});
+        s.send(wm::size, 0, point(800, 600));
+        s.send(wm::move, 0, point(300, 200));
+
+        // hovering the tray icon, then a right click opening the popup and a double click
+        for (int i = 0; i < 50; ++i) {
+            s.send(wm::tray_icon, 0, wm::mousemove);
+            s.wait_ms(5);
+        }
+        s.send(wm::tray_icon, 0, wm::rbuttondown);
+        s.send(wm::nchittest, 0, point(20, 20), 1); // the popup's own window
+        s.wait_ms(400);
+        s.send(wm::tray_icon, 0, wm::lbuttondblclk);
+
+        // the F7-F11 toggles, each pressed twice
+        for (const uintptr_t key: {0x76u, 0x77u, 0x78u, 0x79u, 0x7Au}) {
+            for (int i = 0; i < 2; ++i) {
+                s.send(key == 0x79u ? wm::syskeydown : wm::keydown, key, 1);
+                s.wait_ms(120);
+                s.send(wm::nchittest, 0, point(305, 205));
+            }
+        }
+
+        // moved to a 150% monitor
+        s.send(wm::dpichanged, 144 | (144 << 16), 0);
+        s.send_rect(wm::dpichanged, 144 | (144 << 16), {300, 200, 1500, 1100});
+        s.send(wm::setting_change, 0, 0);
+        s.send(wm::themechanged, 0, 0);
+        s.send(wm::nchittest, 0, point(1495, 1095));
+        s.wait_ms(50);
+
+        s.send(wm::close, 0, 0);
+        s.send(wm::destroy, 0, 0);
+        return std::move(s.recorder);
+    }
+
+    auto same(const RecordedMessage &a, const RecordedMessage &b) -> bool {
+        return a.time_ns == b.time_ns && a.window == b.window && a.message.id == b.message.id &&
+               a.message.wparam == b.message.wparam && a.message.lparam == b.message.lparam &&
+               a.has_rect == b.has_rect && (!a.has_rect || a.rect == b.rect);
+    }
+
+    auto check_recorder() -> void {
+        // the same message through the clock-based overload: the rect replaces lparam
+        MessageRecorder recorder;
+        const auto start = MessageRecorder::Clock::now();
+        const Rect rect{-8, -8, 1928, 1048};
+        recorder.record(start, 0, {wm::nccalcsize, 1, 0x7ff0'1234}, &rect);
+        recorder.record(start + std::chrono::milliseconds(3), 2, {wm::nchittest, 0, point(-5, 40)});
+        std::vector<RecordedMessage> messages;
+        check(decode_messages(view(recorder.bytes()), recorder.count(), messages) && messages.size() == 2,
+              "decoded");
+        check(messages[0].has_rect && messages[0].rect == rect && messages[0].message.lparam == 0,
+              "rect recorded instead of the pointer");
+        check(messages[1].time_ns == 3'000'000 && messages[1].window == 2 && messages[1].message.lparam == point(-5, 40),
+              "time, window and lparam");
+
+        // truncated and oversized input
+        auto bytes = recorder.bytes();
+        bytes.pop_back();
+        check(!decode_messages(view(bytes), recorder.count(), messages), "truncated input rejected");
+        check(!decode_messages(view(recorder.bytes()), recorder.count() + 1, messages), "short input rejected");
+        check(!decode_messages(view(recorder.bytes()), recorder.count() - 1, messages), "trailing bytes rejected");
+    }
+}
+
+auto main() -> int {
+    check_recorder();
+
+    const auto recorder = record_session();
+    const std::string path = "message_replay_bench.messages";
+    check(recorder.save(path), "save");
+    std::vector<RecordedMessage> loaded;
+    check(load_messages(path, loaded), "load");
+    std::remove(path.c_str());
+    check(loaded.size() == recorder.count(), "every message loaded");
+
+    // what the recording is, re-encoded: identical bytes
+    MessageRecorder again;
+    for (const auto &message: loaded) {
+        again.record(message);
+    }
+    check(again.bytes() == recorder.bytes(), "round trip is exact");
+    std::vector<RecordedMessage> decoded;
+    check(decode_messages(view(again.bytes()), again.count(), decoded) && decoded.size() == loaded.size(),
+          "decoded again");
+    for (size_t i = 0; i < loaded.size(); ++i) {
+        check(same(decoded[i], loaded[i]), "same messages");
+    }
+
+    const auto first = replay(loaded);
+    const auto first_stats = ReplayWindow::dispatcher().stats();
+    const auto second = replay(loaded);
+    check(first.checksum == second.checksum, "replays are deterministic");
+    check(first.frames == second.frames && first.resizes == second.resizes, "same frames and resizes");
+    check(first.windows == 2 && first.messages == loaded.size(), "both windows replayed");
+    check(first.resizes > 0 && first.resizes < 1000, "live resizing coalesced");
+    check(first.frames >= first.resizes, "a frame per resize");
+
+    // one message less ends elsewhere
+    std::vector<RecordedMessage> shorter(loaded.begin(), loaded.end() - 3);
+    check(replay(shorter).checksum != first.checksum, "the checksum follows the state");
+
+    // the first 100 ms as recorded: the replay cannot be faster than the recording
+    std::vector<RecordedMessage> head;
+    for (const auto &message: loaded) {
+        if (message.time_ns > 100'000'000) {
+            break;
+        }
+        head.push_back(message);
+    }
+    ReplayOptions paced;
+    paced.recorded_pace = true;
+    const auto at_pace = replay(head, paced);
+    check(at_pace.wall_ns >= at_pace.recorded_ns, "recorded pace");
+
+    std::printf("%llu messages, %zu bytes, %.2f bytes per message\n",
+                static_cast<unsigned long long>(recorder.count()), recorder.bytes().size(),
+                double(recorder.bytes().size()) / double(recorder.count()));
+    std::printf("%s", format_replay_report(first).c_str());
+    std::printf("max speed: %.1f ns per message, %.0fx the recorded pace\n",
+                double(second.wall_ns) / double(second.messages),
+                double(second.recorded_ns) / double(second.wall_ns));
+    std::printf("recorded pace, first 100 ms: %.1f ms replayed\n", double(at_pace.wall_ns) / 1e6);
+    if (ReplayWindow::Dispatcher::instrumented()) {
+        std::printf("%s", format_message_stats(first_stats).c_str());
+    }
+    return 0;
+}
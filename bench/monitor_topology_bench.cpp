@@ -0,0 +1,191 @@
+// The cached monitor topology over synthetic multi-monitor layouts: point and rect lookups against
+// a brute-force MonitorFromPoint/MonitorFromRect model, the fallbacks, work areas for maximizing,
+// and the cost of a grid lookup against a scan of every monitor.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "BenchCheck.hpp"
+#include "core/MonitorTopology.hpp"
+
+using namespace borderless;
+using bench::check;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    auto elapsed_ns(Clock::time_point start) -> double {
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    // a monitor with a 48 px task bar along its bottom edge
+    auto monitor(uintptr_t handle, Rect bounds, uint32_t dpi, bool primary = false) -> Monitor {
+        auto work = bounds;
+        work.bottom -= dpi / 2;
+        return {handle, bounds, work, dpi, primary};
+    }
+
+    struct Layout {
+        const char *name;
+        std::vector<Monitor> monitors;
+    };
+
+    auto layouts() -> std::vector<Layout> {
+        std::vector<Layout> all;
+        all.push_back({"single 1080p", {monitor(1, {0, 0, 1920, 1080}, 96, true)}});
+        all.push_back({"laptop + 4k on the left", {monitor(1, {0, 0, 2560, 1600}, 192, true),
+                                                   monitor(2, {-3840, -560, 0, 1600}, 144)}});
+        all.push_back({"three, middle raised", {monitor(1, {0, 0, 2560, 1440}, 96, true),
+                                                monitor(2, {-1920, 360, 0, 1440}, 96),
+                                                monitor(3, {2560, 240, 4480, 1320}, 120)}});
+        std::vector<Monitor> wall;
+        for (int row = 0; row < 3; ++row) {
+            for (int col = 0; col < 3; ++col) {
+                wall.push_back(monitor(uintptr_t(10 + row * 3 + col),
+                                       Rect{0, 0, 1920, 1080}.offset(col * 1920, row * 1080), 96, row == 1 && col == 1));
+            }
+        }
+        all.push_back({"3x3 wall", wall});
+        // sixteen monitors of mixed sizes in a staggered, gappy arrangement
+        std::vector<Monitor> mixed;
+        std::mt19937 rng(11);
+        int32_t x = -8000;
+        for (uintptr_t i = 0; i < 16; ++i) {
+            const int32_t width = 1280 + int32_t(rng() % 3) * 640;
+            const int32_t height = 720 + int32_t(rng() % 3) * 360;
+            const int32_t y = int32_t(rng() % 5) * 400 - 800;
+            mixed.push_back(monitor(100 + i, {x, y, x + width, y + height}, 96 + uint32_t(rng() % 4) * 24, i == 5));
+            x += width + (i % 4 == 3 ? 300 : 0);
+        }
+        all.push_back({"16 mixed with gaps", mixed});
+        // mirrored: two monitors showing the same pixels
+        all.push_back({"mirrored", {monitor(1, {0, 0, 1920, 1080}, 96, true), monitor(2, {0, 0, 1920, 1080}, 96)}});
+        return all;
+    }
+
+    auto scan_point(const std::vector<Monitor> &monitors, Point p) -> const Monitor * {
+        for (const auto &m: monitors) {
+            if (m.bounds.contains(p)) {
+                return &m;
+            }
+        }
+        return nullptr;
+    }
+
+    auto scan_rect(const std::vector<Monitor> &monitors, const Rect &r) -> const Monitor * {
+        const Monitor *best = nullptr;
+        int64_t area = 0;
+        for (const auto &m: monitors) {
+            if (intersect(m.bounds, r).area() > area) {
+                best = &m;
+                area = intersect(m.bounds, r).area();
+            }
+        }
+        return best;
+    }
+
+    auto check_layout(const Layout &layout) -> void {
+        MonitorTopology topology;
+        check(!topology.valid() && topology.from_point({0, 0}) == nullptr, "nothing before the first update");
+        topology.update(layout.monitors);
+        check(topology.valid() && topology.generation() == 1, "valid after update");
+        const auto &monitors = topology.monitors();
+        const auto bounds = topology.bounds();
+
+        std::mt19937 rng(7);
+        auto coordinate = [&](int32_t low, int32_t high) { return low + int32_t(rng() % uint32_t(high - low)); };
+        for (int i = 0; i < 20000; ++i) {
+            const Point p{coordinate(bounds.left - 500, bounds.right + 500), coordinate(bounds.top - 500, bounds.bottom + 500)};
+            check(topology.from_point(p, MonitorFallback::none) == scan_point(monitors, p), "point lookup");
+            const auto nearest = topology.from_point(p);
+            check(nearest != nullptr, "nearest always finds one");
+            if (!scan_point(monitors, p)) {
+                for (const auto &m: monitors) {
+                    const auto dx = std::max({m.bounds.left - p.x, 0, p.x - (m.bounds.right - 1)});
+                    const auto dy = std::max({m.bounds.top - p.y, 0, p.y - (m.bounds.bottom - 1)});
+                    const auto nx = std::max({nearest->bounds.left - p.x, 0, p.x - (nearest->bounds.right - 1)});
+                    const auto ny = std::max({nearest->bounds.top - p.y, 0, p.y - (nearest->bounds.bottom - 1)});
+                    check(int64_t(nx) * nx + int64_t(ny) * ny <= int64_t(dx) * dx + int64_t(dy) * dy, "nearest is nearest");
+                }
+                check(topology.from_point(p, MonitorFallback::primary)->primary, "primary fallback");
+            }
+
+            // windows of every size, including ones straddling edges and maximized ones
+            const Rect r{p.x, p.y, p.x + coordinate(1, 2500), p.y + coordinate(1, 1500)};
+            const auto expected = scan_rect(monitors, r);
+            check(topology.from_rect(r, MonitorFallback::none) == expected, "rect lookup");
+        }
+        // a maximized window's rect sticks out by the frame; it still maps to its monitor's work area
+        for (const auto &m: monitors) {
+            const Rect maximized{m.bounds.left - 8, m.bounds.top - 8, m.bounds.right + 8, m.work.bottom + 8};
+            const auto found = topology.from_rect(maximized);
+            check(found->bounds == m.bounds && found->work == m.work, "maximized window finds its work area");
+        }
+    }
+}
+
+auto main() -> int {
+    for (const auto &layout: layouts()) {
+        check_layout(layout);
+    }
+
+    MonitorTopology topology;
+    topology.update(layouts()[1].monitors);
+    topology.invalidate();
+    check(!topology.valid(), "invalidated by a display change");
+    topology.update({monitor(1, {0, 0, 1920, 1080}, 96, true)});
+    check(topology.valid() && topology.generation() == 2 && topology.monitors().size() == 1, "refreshed");
+    check(topology.from_point({-100, 100}, MonitorFallback::none) == nullptr, "the unplugged monitor is gone");
+    check(topology.from_point({-100, 100})->dpi == 96, "dpi comes with the monitor");
+    MonitorTopology empty;
+    empty.update({});
+    check(empty.from_point({0, 0}) == nullptr && empty.from_rect({0, 0, 10, 10}) == nullptr, "no monitors at all");
+
+    // random points defeat the last-hit check; a window dragged across the layout is the usual case
+    std::printf("%-28s %10s %14s %14s %14s %14s\n", "layout", "monitors", "grid ns/point", "scan ns/point",
+                "drag ns/rect", "scan ns/rect");
+    MonitorTopologyStats stats;
+    for (const auto &layout: layouts()) {
+        MonitorTopology timed;
+        timed.update(layout.monitors);
+        const auto bounds = timed.bounds();
+        std::mt19937 rng(3);
+        std::vector<Point> points(4096);
+        for (auto &p: points) {
+            p = {bounds.left + int32_t(rng() % uint32_t(bounds.width())), bounds.top + int32_t(rng() % uint32_t(bounds.height()))};
+        }
+        // a 960x540 window dragged left to right at the height of the first monitor's middle, in
+        // 8 px steps, a WM_NCCALCSIZE per step
+        std::vector<Rect> drag;
+        const auto &first = layout.monitors.front().bounds;
+        const auto y = first.top + first.height() / 2 - 270;
+        for (int32_t x = bounds.left; x + 960 < bounds.right; x += 8) {
+            drag.push_back({x, y, x + 960, y + 540});
+        }
+        const int rounds = 200;
+        uintptr_t sink = 0;
+        auto time = [&](size_t count, auto &&lookup) {
+            const auto start = Clock::now();
+            for (int round = 0; round < rounds; ++round) {
+                for (size_t i = 0; i < count; ++i) {
+                    const auto m = lookup(i);
+                    sink += m ? m->handle : 0;
+                }
+            }
+            return elapsed_ns(start) / (double(rounds) * double(count));
+        };
+        const auto grid = time(points.size(), [&](size_t i) { return timed.from_point(points[i], MonitorFallback::none); });
+        const auto scan = time(points.size(), [&](size_t i) { return scan_point(timed.monitors(), points[i]); });
+        const auto dragged = time(drag.size(), [&](size_t i) { return timed.from_rect(drag[i]); });
+        const auto scanned = time(drag.size(), [&](size_t i) { return scan_rect(timed.monitors(), drag[i]); });
+        check(sink != 0, "lookups found monitors");
+        std::printf("%-28s %10zu %14.2f %14.2f %14.2f %14.2f\n", layout.name, layout.monitors.size(), grid, scan,
+                    dragged, scanned);
+        stats = timed.stats();
+    }
+    std::printf("%s", format_monitor_topology_stats(stats).c_str());
+    return 0;
+}
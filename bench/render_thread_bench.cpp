@@ -0,0 +1,185 @@
+// Throughput of borderless::SpscQueue against a mutex-protected deque, and enqueue cost plus
+// post-to-execute latency of borderless::RenderThread, both with a steady stream of commands and
+// with sparse commands that find the render thread asleep.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BenchCheck.hpp"
+#include "core/RenderThread.hpp"
+
+using namespace borderless;
+using bench::check;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    auto seconds(Clock::duration d) -> double {
+        return std::chrono::duration<double>(d).count();
+    }
+
+    auto nanoseconds(Clock::duration d) -> double {
+        return std::chrono::duration<double, std::nano>(d).count();
+    }
+
+    class MutexQueue {
+    public:
+        auto try_push(uint64_t value) -> bool {
+            std::lock_guard<std::mutex> lock(mutex_);
+            items_.push_back(value);
+            return true;
+        }
+
+        auto try_pop(uint64_t &out) -> bool {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (items_.empty()) {
+                return false;
+            }
+            out = items_.front();
+            items_.pop_front();
+            return true;
+        }
+
+    private:
+        std::mutex mutex_;
+        std::deque<uint64_t> items_;
+    };
+
+    // one producer and one consumer thread; the consumer checks that values arrive in order
+    template<typename Queue>
+    auto throughput(Queue &queue, uint64_t count) -> double {
+        bool ordered = true;
+        const auto start = Clock::now();
+        std::thread consumer([&] {
+            uint64_t expected = 0;
+            uint64_t value = 0;
+            while (expected < count) {
+                if (queue.try_pop(value)) {
+                    ordered &= value == expected;
+                    ++expected;
+                } else {
+                    std::this_thread::yield(); // keeps single-core machines moving
+                }
+            }
+        });
+        for (uint64_t i = 0; i < count;) {
+            if (queue.try_push(i)) {
+                ++i;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        consumer.join();
+        const auto elapsed = Clock::now() - start;
+        check(ordered, "queue delivers values in order");
+        return static_cast<double>(count) / seconds(elapsed) / 1e6;
+    }
+
+    struct Command {
+        Clock::time_point posted{};
+        uint64_t sequence = 0;
+    };
+
+    struct Latency {
+        double post_p50, post_p99;       // ns spent in post()
+        double deliver_p50, deliver_p99; // ns from post() until the render thread executed it
+        double deliver_max;
+        RenderThreadStats stats;
+    };
+
+    auto percentile(std::vector<Clock::duration> &values, double p) -> double {
+        const auto rank = static_cast<size_t>(p * static_cast<double>(values.size() - 1) + 0.5);
+        std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(rank), values.end());
+        return nanoseconds(values[rank]);
+    }
+
+    // gap == 0 posts back to back; otherwise the producer pauses so the render thread falls asleep
+    auto latency(uint64_t count, Clock::duration gap) -> Latency {
+        std::vector<Clock::duration> post(count);
+        std::vector<Clock::duration> deliver(count);
+        uint64_t next = 0;
+        bool ordered = true;
+
+        RenderThread<Command>::Hooks hooks;
+        hooks.execute = [&](Command &command) {
+            deliver[command.sequence] = Clock::now() - command.posted;
+            ordered &= command.sequence == next++;
+        };
+        hooks.frame = [] { return Clock::duration::max(); };
+
+        Latency result{};
+        {
+            RenderThread<Command> thread(std::move(hooks));
+            for (uint64_t i = 0; i < count; ++i) {
+                if (gap != Clock::duration::zero()) {
+                    const auto until = Clock::now() + gap;
+                    while (Clock::now() < until) {
+                        std::this_thread::yield();
+                    }
+                }
+                const auto before = Clock::now();
+                thread.post(Command{before, i});
+                post[i] = Clock::now() - before;
+            }
+            thread.stop();
+            result.stats = thread.stats();
+        }
+        check(ordered, "commands execute in post order");
+        check(result.stats.executed == count && result.stats.posted == count, "every command executes once");
+
+        result.post_p50 = percentile(post, 0.50);
+        result.post_p99 = percentile(post, 0.99);
+        result.deliver_p50 = percentile(deliver, 0.50);
+        result.deliver_p99 = percentile(deliver, 0.99);
+        result.deliver_max = nanoseconds(*std::max_element(deliver.begin(), deliver.end()));
+        return result;
+    }
+}
+
+int main() {
+    const uint64_t items = 10'000'000;
+    SpscQueue<uint64_t> spsc(1024);
+    MutexQueue locked;
+    const auto spsc_rate = throughput(spsc, items);
+    const auto mutex_rate = throughput(locked, items);
+    std::printf("%-24s %10.1f Mops/s\n", "SpscQueue (1024)", spsc_rate);
+    std::printf("%-24s %10.1f Mops/s\n", "mutex + deque", mutex_rate);
+
+    {
+        SpscQueue<int> small(3);
+        check(small.capacity() == 4, "capacity rounds up to a power of two");
+        int out = 0;
+        for (int i = 0; i < 4; ++i) {
+            check(small.try_push(i), "push until full");
+        }
+        check(!small.try_push(4), "full queue rejects");
+        check(small.try_pop(out) && out == 0, "pop oldest");
+        check(small.try_push(4) && small.size() == 4, "slot reused after pop");
+    }
+
+    std::printf("\n%-24s %10s %10s %12s %12s %12s %9s %9s\n", "RenderThread", "post p50", "post p99",
+                "deliver p50", "deliver p99", "deliver max", "wakeups", "full");
+    const struct {
+        const char *name;
+        uint64_t count;
+        Clock::duration gap;
+    } runs[] = {
+            {"stream", 1'000'000, Clock::duration::zero()},
+            {"sparse (every 200us)", 5'000, std::chrono::microseconds(200)},
+    };
+    for (const auto &run: runs) {
+        const auto r = latency(run.count, run.gap);
+        std::printf("%-24s %8.0fns %8.0fns %10.0fns %10.0fns %10.0fns %9llu %9llu\n", run.name,
+                    r.post_p50, r.post_p99, r.deliver_p50, r.deliver_p99, r.deliver_max,
+                    static_cast<unsigned long long>(r.stats.wakeups),
+                    static_cast<unsigned long long>(r.stats.full_waits));
+    }
+    return 0;
+}
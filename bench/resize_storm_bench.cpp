@@ -0,0 +1,124 @@
+// Resize-storm stress harness for borderless::ResizeCoalescer with a fake swap chain.
+// Simulates interactive drags that emit WM_SIZE faster than the display refreshes and compares
+// the coalesced policy with resizing on every message. All time is simulated.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "BenchCheck.hpp"
+#include "core/ResizeCoalescer.hpp"
+
+using namespace borderless;
+using bench::check;
+using Clock = ResizeCoalescer::Clock;
+using std::chrono::microseconds;
+
+namespace {
+
+    // counts ResizeBuffers calls and charges a fixed cost per call to the simulated clock
+    struct FakeSwapChain {
+        Size size;
+        microseconds cost;
+        Clock::time_point *now;
+        uint64_t resizes = 0;
+        std::vector<Clock::time_point> resize_times;
+
+        auto resize(Size s) -> void {
+            size = s;
+            ++resizes;
+            resize_times.push_back(*now);
+            *now += cost;
+        }
+    };
+
+    struct Storm {
+        const char *name;
+        microseconds message_interval; // time between WM_SIZE messages
+        microseconds duration;
+        microseconds resize_cost;
+    };
+
+    struct Result {
+        uint64_t messages;
+        uint64_t resizes;
+        size_t max_per_vblank;
+        microseconds busy;
+        microseconds final_latency; // last WM_SIZE until the swap chain has that size
+    };
+
+    auto run(const Storm &storm, bool coalesce) -> Result {
+        const microseconds vblank(16'667);
+        Clock::time_point now{};
+        FakeSwapChain chain{{800, 600}, storm.resize_cost, &now, 0, {}};
+        ResizeCoalescer resizer(vblank);
+        resizer.reset(chain.size);
+        auto resize = [&](Size s) { chain.resize(s); };
+
+        uint64_t messages = 0;
+        Size last{};
+        Clock::time_point last_message{};
+        const Clock::time_point end = now + storm.duration;
+        Clock::time_point next_message = now;
+        for (int32_t step = 0; now < end; ++step) {
+            now = std::max(now, next_message);
+            last = {800 + step % 300, 600 + step % 200};
+            last_message = now;
+            ++messages;
+            if (coalesce) {
+                resizer.request(last);
+                resizer.apply(now, resize);
+            } else {
+                resize(last);
+            }
+            next_message += storm.message_interval;
+
+            // the shell's WM_TIMER fires when the pending resize becomes due
+            if (coalesce && resizer.pending() && now + resizer.wait_time(now) < next_message) {
+                now += resizer.wait_time(now);
+                resizer.apply(now, resize);
+            }
+        }
+        // WM_EXITSIZEMOVE
+        if (coalesce) {
+            resizer.flush(now, resize);
+        }
+        check(chain.size.width == last.width && chain.size.height == last.height, "final size applied");
+
+        size_t max_per_vblank = 0;
+        for (size_t i = 0, j = 0; i < chain.resize_times.size(); ++i) {
+            while (chain.resize_times[i] - chain.resize_times[j] >= vblank) ++j;
+            max_per_vblank = std::max(max_per_vblank, i - j + 1);
+        }
+        const auto final_latency = std::chrono::duration_cast<microseconds>(chain.resize_times.back() - last_message);
+        return {messages, chain.resizes, max_per_vblank, storm.resize_cost * chain.resizes,
+                std::max(final_latency, microseconds::zero())};
+    }
+}
+
+int main() {
+    const Storm storms[] = {
+            {"mouse drag 125 Hz", microseconds(8'000), microseconds(2'000'000), microseconds(3'000)},
+            {"mouse drag 1 kHz", microseconds(1'000), microseconds(2'000'000), microseconds(3'000)},
+            {"gaming mouse 8 kHz", microseconds(125), microseconds(2'000'000), microseconds(3'000)},
+            {"slow ResizeBuffers", microseconds(1'000), microseconds(2'000'000), microseconds(12'000)},
+    };
+
+    std::printf("%-22s %-10s %9s %9s %12s %10s %12s\n",
+                "storm", "policy", "WM_SIZE", "resizes", "max/vblank", "busy ms", "final lag us");
+    for (const auto &storm: storms) {
+        for (bool coalesce: {false, true}) {
+            const auto r = run(storm, coalesce);
+            if (coalesce) {
+                check(r.max_per_vblank <= 1, "at most one resize per vblank");
+            }
+            std::printf("%-22s %-10s %9llu %9llu %12zu %10.1f %12lld\n", storm.name,
+                        coalesce ? "coalesced" : "naive",
+                        static_cast<unsigned long long>(r.messages), static_cast<unsigned long long>(r.resizes),
+                        r.max_per_vblank, static_cast<double>(r.busy.count()) / 1000.0,
+                        static_cast<long long>(r.final_latency.count()));
+        }
+    }
+    return 0;
+}
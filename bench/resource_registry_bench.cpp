@@ -0,0 +1,196 @@
+// The resource registry against a fake device that can be lost and can fail creations on demand:
+// handles across slot reuse, rebuild order after a loss, a loss in the middle of the rebuild, and
+// partial releases. Then the registry's own cost of rebuilding a window's worth of brushes, bitmaps
+// and text layouts, which has to fit into a frame or two next to the actual creation calls.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "BenchCheck.hpp"
+#include "core/ResourceRegistry.hpp"
+
+using namespace borderless;
+using bench::check;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    struct DeviceLost : std::runtime_error {
+        DeviceLost() : std::runtime_error("device removed") {}
+    };
+
+    // the driver: every device it hands out belongs to an epoch that ends when the device is lost
+    struct FakeDriver {
+        uint32_t epoch = 0;
+        uint64_t creations = 0;
+        int64_t fail_after = -1; // creations until the device is lost again, -1 never
+        std::string log;
+
+        auto create(char kind) -> uint32_t {
+            if (fail_after == 0) {
+                fail_after = -1;
+                ++epoch;
+                throw DeviceLost();
+            }
+            if (fail_after > 0) {
+                --fail_after;
+            }
+            ++creations;
+            log += kind;
+            return epoch;
+        }
+    };
+
+    // every object remembers the epoch it was created in and the one of what it was created from
+    struct FakeObject {
+        uint32_t epoch = 0;
+        uint32_t parent_epoch = 0;
+    };
+
+    struct Window {
+        ResourceRegistry registry;
+        Resource<FakeObject> device;
+        Resource<FakeObject> context;
+        Resource<FakeObject> swap_chain;
+        Resource<FakeObject> back_buffer;
+        std::vector<Resource<FakeObject>> brushes;
+        std::vector<Resource<FakeObject>> bitmaps;
+        std::vector<Resource<FakeObject>> layouts;
+
+        Window(FakeDriver &driver, size_t brush_count, size_t bitmap_count, size_t layout_count) {
+            auto &r = registry;
+            device = r.add<FakeObject>([&driver] { return FakeObject{driver.create('D'), 0}; });
+            context = r.add<FakeObject>([&] { return FakeObject{driver.create('C'), r.get(device).epoch}; }, {device});
+            swap_chain = r.add<FakeObject>([&] { return FakeObject{driver.create('S'), r.get(device).epoch}; },
+                                           {device});
+            back_buffer = r.add<FakeObject>([&] {
+                return FakeObject{driver.create('B'), r.get(swap_chain).epoch};
+            }, {swap_chain, context});
+            for (size_t i = 0; i < brush_count; ++i) {
+                brushes.push_back(r.add<FakeObject>([&] {
+                    return FakeObject{driver.create('b'), r.get(context).epoch};
+                }, {context}));
+            }
+            for (size_t i = 0; i < bitmap_count; ++i) {
+                bitmaps.push_back(r.add<FakeObject>([&] {
+                    return FakeObject{driver.create('m'), r.get(context).epoch};
+                }, {context}));
+            }
+            // text layouts are created from a device-independent factory: the device does not matter
+            for (size_t i = 0; i < layout_count; ++i) {
+                layouts.push_back(r.add<FakeObject>([&driver] { return FakeObject{driver.create('l'), 0}; }));
+            }
+        }
+
+        // nothing left from an older device
+        auto consistent(uint32_t epoch) const -> bool {
+            for (const auto resource: {device, context, swap_chain, back_buffer}) {
+                const auto object = registry.find(resource);
+                if (!object || object->epoch != epoch || (resource != device && object->parent_epoch != epoch)) {
+                    return false;
+                }
+            }
+            for (const auto *group: {&brushes, &bitmaps}) {
+                for (const auto resource: *group) {
+                    const auto object = registry.find(resource);
+                    if (!object || object->epoch != epoch || object->parent_epoch != epoch) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+    };
+
+    auto check_handles() -> void {
+        ResourceRegistry registry;
+        const auto a = registry.add<int>([] { return 1; });
+        const auto b = registry.add<int>([] { return 2; }, {a});
+        check(registry.get(a) == 1 && registry.get(b) == 2, "objects by handle");
+        registry.remove(a);
+        check(!registry.contains(a) && !registry.contains(b) && registry.size() == 0, "remove takes dependents along");
+        const auto c = registry.add<std::string>([] { return std::string("reused"); });
+        check(c.id.index == a.id.index || c.id.index == b.id.index, "slot reused");
+        check(registry.find(a) == nullptr && registry.find(b) == nullptr, "stale handles find nothing");
+        bool threw = false;
+        try {
+            registry.declare<int>([] { return 3; }, {a});
+        } catch (const std::invalid_argument &) {
+            threw = true;
+        }
+        check(threw, "a stale dependency is rejected");
+
+        const auto late = registry.declare<int>([] { return 4; });
+        check(!registry.materialized(late), "declared, not created");
+        registry.materialize(late);
+        check(registry.get(late) == 4, "materialized on demand");
+    }
+
+    auto check_device_loss() -> void {
+        FakeDriver driver;
+        Window window(driver, 3, 2, 2);
+        check(window.consistent(0) && driver.log == "DCSBbbbmmll", "created in declaration order");
+
+        // the device is lost: everything goes, dependencies come back first
+        ++driver.epoch;
+        driver.log.clear();
+        window.registry.rebuild();
+        check(window.consistent(1) && driver.log == "DCSBbbbmmll", "rebuilt in declaration order");
+
+        // and lost again halfway through the rebuild
+        ++driver.epoch;
+        driver.fail_after = 5;
+        bool lost = false;
+        try {
+            window.registry.rebuild();
+        } catch (const DeviceLost &) {
+            lost = true;
+        }
+        check(lost, "the loss surfaces");
+        check(window.registry.stats().materialized == 0, "a failed rebuild keeps nothing from the dead device");
+        window.registry.rebuild();
+        check(window.consistent(3) && window.registry.stats().failed_rebuilds == 1, "the retry succeeds");
+
+        // a resize only recreates the back buffer
+        driver.log.clear();
+        window.registry.release(window.back_buffer);
+        check(!window.registry.materialized(window.back_buffer) && window.registry.materialized(window.context),
+              "only the back buffer is released");
+        window.registry.materialize_all();
+        check(driver.log == "B", "and only it is recreated");
+
+        // a context released takes its brushes and bitmaps, not the swap chain or the layouts
+        driver.log.clear();
+        window.registry.release(window.context);
+        window.registry.materialize_all();
+        check(driver.log == "CBbbbmm" && window.consistent(3), "context and its dependents");
+    }
+}
+
+auto main() -> int {
+    check_handles();
+    check_device_loss();
+
+    std::printf("%10s %10s %10s %14s %14s\n", "brushes", "bitmaps", "layouts", "rebuild us", "ns/resource");
+    for (const size_t scale: {1u, 10u, 100u}) {
+        FakeDriver driver;
+        Window window(driver, 20 * scale, 4 * scale, 30 * scale);
+        const int rounds = 50;
+        const auto start = Clock::now();
+        for (int round = 0; round < rounds; ++round) {
+            ++driver.epoch;
+            window.registry.rebuild();
+        }
+        const auto us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / rounds;
+        check(window.consistent(driver.epoch), "consistent after every rebuild");
+        std::printf("%10zu %10zu %10zu %14.1f %14.1f\n", window.brushes.size(), window.bitmaps.size(),
+                    window.layouts.size(), us, us * 1000.0 / double(window.registry.size()));
+    }
+    return 0;
+}
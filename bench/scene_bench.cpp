@@ -0,0 +1,150 @@
+// Headless benchmark for the retained scene graph and damage tracking.
+// For a few typical UI updates it reports how many pixels get repainted compared to a full
+// Clear+redraw, and the CPU time spent in Scene::update plus rect coalescing.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+#include "BenchCheck.hpp"
+#include "core/Scene.hpp"
+
+using namespace borderless;
+using bench::check;
+
+namespace {
+
+    constexpr int32_t surface_width = 1280;
+    constexpr int32_t surface_height = 800;
+
+    // a dashboard: a grid of cards, each a group with an indicator ellipse and a label
+    struct Dashboard {
+        Scene scene;
+        std::vector<NodeId> cards;
+        std::vector<NodeId> indicators;
+        std::vector<NodeId> labels;
+
+        Dashboard() {
+            for (int row = 0; row < 10; ++row) {
+                for (int col = 0; col < 10; ++col) {
+                    auto card = scene.add(scene.root(), GroupNode{},
+                                          Transform::translation(col * 128.0f, row * 80.0f));
+                    cards.push_back(card);
+                    indicators.push_back(scene.add(card, EllipseNode{{16.0f, 16.0f}, 10.0f, 10.0f, {0, 1, 0, 1}}));
+                    labels.push_back(scene.add(card, TextNode{{{L"Arial", 400, 12.0f, L"en-us"}, L"42 %",
+                                                               80.0f, 20.0f}, {32.0f, 6.0f}, {}}));
+                }
+            }
+        }
+    };
+
+    auto sanity() -> void {
+        Dashboard d;
+        DamageRegion damage;
+        damage.set_surface({0, 0, surface_width, surface_height});
+        d.scene.update(damage);
+        check(!damage.empty(), "initial frame is damaged");
+
+        damage.clear();
+        d.scene.update(damage);
+        check(damage.empty(), "no change, no damage");
+
+        d.scene.set_content(d.indicators[0], EllipseNode{{16.0f, 16.0f}, 10.0f, 10.0f, {1, 0, 0, 1}});
+        d.scene.update(damage);
+        check(damage.rects().size() == 1, "one indicator, one rect");
+        check(damage.rects()[0] == Rect{5, 5, 27, 27}, "indicator bounds plus aa margin");
+
+        damage.clear();
+        d.scene.set_transform(d.cards[11], Transform::translation(130.0f, 80.0f));
+        d.scene.update(damage);
+        check(damage.bounds() == Rect{133, 85, 243, 107}, "moved card damages old and new position");
+
+        damage.clear();
+        d.scene.remove(d.cards[99]);
+        d.scene.update(damage);
+        check(!damage.empty(), "removal damages");
+
+        size_t painted = 0;
+        d.scene.paint({0, 0, 40, 40}, [&](NodeId, const NodeContent &, const Transform &) { ++painted; });
+        check(painted == 2, "paint visits only leaves in the clip");
+
+        SwapChainDamage swap(2);
+        swap.reset({0, 0, surface_width, surface_height});
+        DamageRegion small;
+        small.add({0, 0, 10, 10});
+        check(swap.begin_frame(small).area() == int64_t{surface_width} * surface_height, "first buffer full");
+        check(swap.present_all(), "first frame presents everything");
+        check(swap.begin_frame(small).area() == int64_t{surface_width} * surface_height, "second buffer full");
+        check(!swap.present_all(), "second frame is a delta");
+        DamageRegion other;
+        other.add({100, 100, 110, 110});
+        check(swap.begin_frame(other).area() == 200, "repaint includes the previous frame's damage");
+    }
+
+    struct Scenario {
+        const char *name;
+        std::function<void(Dashboard &, size_t frame)> step;
+    };
+}
+
+int main() {
+    sanity();
+
+    const std::vector<Scenario> scenarios = {
+            {"spinner (1 indicator/frame)", [](Dashboard &d, size_t frame) {
+                d.scene.set_content(d.indicators[0], EllipseNode{{16.0f, 16.0f}, 10.0f, 10.0f,
+                                                                 {0, 1, 0, (frame % 10) / 10.0f}});
+            }},
+            {"hover (2 cards/frame)", [](Dashboard &d, size_t frame) {
+                const auto a = frame % d.indicators.size(), b = (frame + 1) % d.indicators.size();
+                d.scene.set_content(d.indicators[a], EllipseNode{{16.0f, 16.0f}, 10.0f, 10.0f, {1, 1, 0, 1}});
+                d.scene.set_content(d.indicators[b], EllipseNode{{16.0f, 16.0f}, 10.0f, 10.0f, {0, 1, 0, 1}});
+            }},
+            {"ticker (10 labels/frame)", [](Dashboard &d, size_t frame) {
+                for (size_t i = 0; i < 10; ++i) {
+                    d.scene.set_content(d.labels[(frame * 7 + i * 13) % d.labels.size()],
+                                        TextNode{{{L"Arial", 400, 12.0f, L"en-us"}, L"43 %", 80.0f, 20.0f},
+                                                 {32.0f, 6.0f}, {}});
+                }
+            }},
+            {"drag (1 card/frame)", [](Dashboard &d, size_t frame) {
+                d.scene.set_transform(d.cards[55], Transform::translation(640.0f + frame % 50, 400.0f));
+            }},
+    };
+
+    constexpr size_t frames = 20'000;
+    const int64_t full_area = int64_t{surface_width} * surface_height;
+    using clock = std::chrono::steady_clock;
+
+    std::printf("%-30s %12s %12s %10s\n", "scenario", "repaint %", "rects/frame", "us/frame");
+    for (const auto &scenario: scenarios) {
+        Dashboard d;
+        DamageRegion damage;
+        damage.set_surface({0, 0, surface_width, surface_height});
+        SwapChainDamage swap(2);
+        swap.reset(damage.surface());
+        d.scene.update(damage);
+        swap.begin_frame(damage);
+        damage.clear();
+        swap.begin_frame(damage);
+
+        int64_t repainted = 0;
+        size_t rects = 0;
+        auto start = clock::now();
+        for (size_t f = 0; f < frames; ++f) {
+            scenario.step(d, f);
+            d.scene.update(damage);
+            const auto &repaint = swap.begin_frame(damage);
+            repainted += repaint.area();
+            rects += repaint.rects().size();
+            damage.clear();
+        }
+        const auto us = std::chrono::duration<double, std::micro>(clock::now() - start).count() / frames;
+        std::printf("%-30s %11.3f%% %12.2f %10.3f\n", scenario.name,
+                    100.0 * static_cast<double>(repainted) / (static_cast<double>(full_area) * frames),
+                    static_cast<double>(rects) / frames, us);
+    }
+    return 0;
+}
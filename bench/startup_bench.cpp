@@ -0,0 +1,171 @@
+// Time to shown window and time to first frame for the BorderlessWindow startup, with each
+// stage's cost simulated by a sleep (device and factory creation mostly wait on the driver and
+// loader). Compares the old serial order, where ShowWindow came last, with the stage graph the
+// window now uses, and checks the executor: dependency order, thread affinity, failures and the
+// critical path.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BenchCheck.hpp"
+#include "core/StageGraph.hpp"
+
+using namespace borderless;
+using bench::check;
+using namespace std::chrono_literals;
+
+namespace {
+
+    auto cost(std::chrono::microseconds duration) -> std::function<void()> {
+        return [duration] { std::this_thread::sleep_for(duration); };
+    }
+
+    // assumed costs for a cold start; creating the devices (driver load) dominates, the first
+    // window pays for them and later ones borrow them from GraphicsDevices::pool()
+    constexpr auto assets_cost = 2ms;
+    constexpr auto window_cost = 4ms;
+    constexpr auto device_cost = 36ms;
+    constexpr auto dwrite_cost = 8ms;
+    constexpr auto d2d_cost = 1ms;
+    constexpr auto swap_chain_cost = 3ms;
+    constexpr auto composition_cost = 2ms;
+    constexpr auto icon_cost = 200us;
+    constexpr auto tray_cost = 1ms;
+    constexpr auto scene_cost = 2ms;
+    constexpr auto first_frame_cost = 3ms;
+
+    // BorderlessWindow::startup()
+    auto staged() -> StageGraph {
+        StageGraph graph;
+        const auto assets = graph.add("assets", cost(assets_cost));
+        const auto window = graph.add("window", cost(window_cost), {}, StageAffinity::caller);
+        const auto device = graph.add("devices", cost(device_cost));
+        const auto text = graph.add("dwrite", cost(dwrite_cost));
+        const auto d2d = graph.add("d2d_context", cost(d2d_cost), {device});
+        const auto swap_chain = graph.add("swap_chain", cost(swap_chain_cost), {device, window});
+        const auto composition = graph.add("composition", cost(composition_cost), {swap_chain}, StageAffinity::caller);
+        graph.add("icon", cost(icon_cost), {assets, window}, StageAffinity::caller);
+        graph.add("tray", cost(tray_cost), {assets, window}, StageAffinity::caller);
+        const auto scene = graph.add("scene", cost(scene_cost), {d2d, text, swap_chain}, StageAffinity::caller);
+        graph.add("first_frame", cost(first_frame_cost), {scene, composition}, StageAffinity::caller);
+        return graph;
+    }
+
+    // the constructor before: load_statics, create_window, tray, init_direct2d, ShowWindow
+    auto serial() -> StageGraph {
+        StageGraph graph;
+        auto previous = graph.add("assets", cost(assets_cost), {}, StageAffinity::caller);
+        for (const auto &[name, duration]: std::vector<std::pair<const char *, std::chrono::microseconds>>{
+                {"window", window_cost}, {"tray", tray_cost}, {"devices", device_cost},
+                {"swap_chain", swap_chain_cost}, {"d2d_context", d2d_cost}, {"composition", composition_cost},
+                {"dwrite", dwrite_cost}, {"scene", scene_cost}, {"show", 0us}, {"first_frame", first_frame_cost}}) {
+            previous = graph.add(name, cost(duration), {previous}, StageAffinity::caller);
+        }
+        return graph;
+    }
+
+    auto ms(std::chrono::nanoseconds t) -> double { return std::chrono::duration<double, std::milli>(t).count(); }
+
+    struct Summary {
+        double shown = 0;
+        double first_frame = 0;
+        double total = 0;
+    };
+
+    auto measure(StageGraph &graph, uint32_t workers, const char *shown_after, int runs) -> Summary {
+        Summary summary;
+        for (int i = 0; i < runs; ++i) {
+            const auto report = graph.run(workers);
+            summary.shown += ms(report.finished(shown_after)) / runs;
+            summary.first_frame += ms(report.finished("first_frame")) / runs;
+            summary.total += ms(report.total) / runs;
+        }
+        return summary;
+    }
+}
+
+int main() {
+    // executor behaviour
+    {
+        auto graph = staged();
+        const auto report = graph.run(3);
+        check(report.stages.size() == graph.size(), "a timing per stage");
+        for (const auto &stage: report.stages) {
+            check(stage.ran && stage.start >= stage.ready && stage.end >= stage.start, "stage timings are ordered");
+            check(stage.affinity == StageAffinity::any || stage.thread == 0, "caller stages stay on the caller");
+        }
+        check(report.stages[1].thread == 0 && report.stages[1].start < 1ms, "the window is shown first");
+        auto after = [&](const char *stage, const char *dependency) {
+            for (const auto &s: report.stages) {
+                if (s.name == stage) {
+                    return s.start >= report.finished(dependency);
+                }
+            }
+            return false;
+        };
+        check(after("d2d_context", "devices") && after("swap_chain", "window") && after("scene", "dwrite") &&
+              after("first_frame", "composition"), "dependencies finish first");
+        check(report.total < report.serial, "stages overlap");
+        // through d2d_context or composition, they are within a millisecond of each other
+        check(report.critical_stages.size() == 4 && report.critical_stages.front() == 2 &&
+              report.critical_stages.back() == 10, "critical path from devices to first_frame");
+        check(report.critical_path <= report.total, "critical path bounds the total");
+
+        const auto serial_report = graph.run(0);
+        for (const auto &stage: serial_report.stages) {
+            check(stage.thread == 0, "zero workers run everything on the caller");
+        }
+        check(serial_report.total >= serial_report.serial, "zero workers run one stage at a time");
+    }
+    {
+        StageGraph graph;
+        int ran = 0;
+        const auto ok = graph.add("ok", [&] { ++ran; });
+        const auto broken = graph.add("broken", [] { throw std::runtime_error("device removed"); }, {ok});
+        const auto dependent = graph.add("dependent", [&] { ++ran; }, {broken});
+        graph.add("transitive", [&] { ++ran; }, {dependent}, StageAffinity::caller);
+        graph.add("independent", [&] { ++ran; }, {ok}, StageAffinity::caller);
+        bool thrown = false;
+        try {
+            graph.run(2);
+        } catch (const std::runtime_error &e) {
+            thrown = std::string(e.what()) == "device removed";
+        }
+        check(thrown, "the first failure is rethrown");
+        check(ran == 2, "dependents of a failed stage are skipped, the rest still run");
+
+        bool rejected = false;
+        try {
+            graph.add("cycle", [] {}, {42});
+        } catch (const std::invalid_argument &) {
+            rejected = true;
+        }
+        check(rejected, "dependencies must be added first");
+    }
+
+    // time to shown window and first frame
+    const int runs = 20;
+    auto before = serial();
+    auto after = staged();
+    const auto old_order = measure(before, 0, "show", runs);
+    const auto graph_serial = measure(after, 0, "window", runs);
+    const auto graph_parallel = measure(after, 3, "window", runs);
+    check(graph_parallel.shown < old_order.shown / 4, "show first");
+    check(graph_parallel.first_frame < old_order.first_frame, "parallel startup reaches the first frame sooner");
+
+    std::printf("%-34s %10s %14s %10s\n", "startup", "shown ms", "first frame ms", "total ms");
+    auto row = [](const char *name, const Summary &s) {
+        std::printf("%-34s %10.2f %14.2f %10.2f\n", name, s.shown, s.first_frame, s.total);
+    };
+    row("serial, ShowWindow last (before)", old_order);
+    row("stage graph, 0 workers", graph_serial);
+    row("stage graph, 3 workers", graph_parallel);
+    std::printf("\n%s", format_stage_report(after.run(3)).c_str());
+    return 0;
+}
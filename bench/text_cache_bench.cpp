@@ -0,0 +1,141 @@
+// Headless benchmark for borderless::TextCache with a fake factory.
+// Compares a steady-state frame served from the cache against recreating the format and
+// layout every frame (the old draw() behaviour) and counts heap allocations per frame.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "BenchCheck.hpp"
+#include "core/TextCache.hpp"
+
+using namespace borderless;
+using bench::check;
+
+namespace {
+    size_t allocations = 0;
+}
+
+auto operator new(size_t size) -> void * {
+    ++allocations;
+    if (auto p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+auto operator delete(void *p) noexcept -> void { std::free(p); }
+
+auto operator delete(void *p, size_t) noexcept -> void { std::free(p); }
+
+namespace {
+
+    // stands in for IDWriteFactory: every object is a heap allocation holding a copy of its input
+    struct FakeBackend {
+        struct FakeFormat {
+            TextFormatKey key;
+        };
+        struct FakeLayout {
+            std::shared_ptr<FakeFormat> format;
+            std::wstring text;
+        };
+        using Format = std::shared_ptr<FakeFormat>;
+        using Layout = std::shared_ptr<FakeLayout>;
+
+        size_t formats_created = 0;
+        size_t layouts_created = 0;
+
+        auto create_format(const TextFormatKey &key) -> Format {
+            ++formats_created;
+            return std::make_shared<FakeFormat>(FakeFormat{key});
+        }
+
+        auto create_layout(const Format &format, const TextLayoutKey &key) -> Layout {
+            ++layouts_created;
+            return std::make_shared<FakeLayout>(FakeLayout{format, key.text});
+        }
+    };
+
+    auto make_keys(size_t count) -> std::vector<TextLayoutKey> {
+        std::vector<TextLayoutKey> keys;
+        for (size_t i = 0; i < count; ++i) {
+            keys.push_back({{L"Arial", 400, 12.0f + static_cast<float>(i % 4), L"en-us"},
+                            L"Label number " + std::to_wstring(i), 200.0f, 40.0f});
+        }
+        return keys;
+    }
+
+    auto sanity() -> void {
+        TextCache<FakeBackend> cache(FakeBackend{}, 4, 8);
+        auto keys = make_keys(16);
+
+        for (size_t i = 0; i < 8; ++i) cache.layout(keys[i]);
+        check(cache.layout_stats().misses == 8 && cache.layout_count() == 8, "fill");
+        check(cache.backend().formats_created == 4, "formats shared between layouts");
+
+        cache.layout(keys[0]); // keys[0] becomes most recent, keys[1] is now the coldest
+        cache.layout(keys[8]);
+        check(cache.layout_stats().evictions == 1, "one eviction");
+        const auto created = cache.backend().layouts_created;
+        cache.layout(keys[0]);
+        check(cache.backend().layouts_created == created, "recently used entry survived");
+        cache.layout(keys[1]);
+        check(cache.backend().layouts_created == created + 1, "coldest entry was evicted");
+    }
+}
+
+int main() {
+    sanity();
+
+    constexpr size_t labels_per_frame = 24;
+    constexpr size_t frames = 200'000;
+    const auto keys = make_keys(labels_per_frame);
+    using clock = std::chrono::steady_clock;
+
+    // cached: warm up once, then every frame looks up the same labels
+    TextCache<FakeBackend> cache(FakeBackend{}, 16, 64);
+    for (const auto &key: keys) cache.layout(key);
+
+    size_t sink = 0;
+    const auto allocations_before = allocations;
+    auto start = clock::now();
+    for (size_t f = 0; f < frames; ++f) {
+        for (const auto &key: keys) {
+            sink += cache.layout(key)->text.size();
+        }
+    }
+    const auto cached_ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    const auto cached_allocations = allocations - allocations_before;
+
+    // uncached: build the key string and create format + layout for every label every frame
+    FakeBackend backend;
+    constexpr size_t uncached_frames = frames / 10;
+    const auto uncached_allocations_before = allocations;
+    start = clock::now();
+    for (size_t f = 0; f < uncached_frames; ++f) {
+        for (const auto &key: keys) {
+            std::wstring text = key.text;
+            auto format = backend.create_format(key.format);
+            auto layout = backend.create_layout(format, {key.format, text, key.max_width, key.max_height});
+            sink += layout->text.size();
+        }
+    }
+    const auto uncached_ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    const auto uncached_allocations = allocations - uncached_allocations_before;
+
+    check(cached_allocations == 0, "steady-state frames must not allocate");
+
+    std::printf("cached:   %8.1f ns/frame, %6.2f allocations/frame\n",
+                cached_ns / frames, static_cast<double>(cached_allocations) / frames);
+    std::printf("uncached: %8.1f ns/frame, %6.2f allocations/frame\n",
+                uncached_ns / uncached_frames, static_cast<double>(uncached_allocations) / uncached_frames);
+    std::printf("layout hits %llu, misses %llu\n",
+                static_cast<unsigned long long>(cache.layout_stats().hits),
+                static_cast<unsigned long long>(cache.layout_stats().misses));
+    std::printf("(checksum %zu)\n", sink);
+    return 0;
+}
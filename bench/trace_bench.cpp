@@ -0,0 +1,138 @@
+// Cost of borderless::trace events: disabled (the runtime check only), enabled instants and
+// scopes, against the std::cout << ... << std::endl style logging they replace. Also checks the
+// per-thread rings, wrap-around and the binary save/load + Chrome JSON path. Events go through
+// what the BORDERLESS_TRACE_* macros expand to, so it runs with -DBORDERLESS_TRACE=OFF too.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include "BenchCheck.hpp"
+#include "core/Trace.hpp"
+
+using namespace borderless;
+using bench::check;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    template<typename Body>
+    auto ns_per_iteration(uint32_t iterations, Body &&body) -> double {
+        const auto start = Clock::now();
+        for (uint32_t i = 0; i < iterations; ++i) {
+            body(i);
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+    }
+
+    // BORDERLESS_TRACE_INSTANT and BORDERLESS_TRACE_COUNTER, without the compile-time switch
+    auto emit_instant(trace::Event event, uint32_t arg) -> void {
+        if (trace::enabled()) {
+            trace::emit(event, trace::Phase::instant, arg);
+        }
+    }
+
+    auto emit_counter(trace::Event event, uint32_t value) -> void {
+        if (trace::enabled()) {
+            trace::emit(event, trace::Phase::counter, value);
+        }
+    }
+
+    auto count_phase(const trace::Snapshot &snapshot, trace::Phase phase) -> uint64_t {
+        uint64_t n = 0;
+        for (const auto &thread: snapshot.threads) {
+            for (const auto &record: thread.records) {
+                n += record.phase == phase;
+            }
+        }
+        return n;
+    }
+}
+
+int main() {
+    const uint32_t iterations = 10'000'000;
+    trace::set_buffer_capacity(1 << 16);
+    trace::set_thread_name("bench");
+
+    // the floor for an enabled event; rdtsc is cheap on bare metal but may trap under a hypervisor
+    uint64_t sink = 0;
+    const auto timestamp = ns_per_iteration(iterations, [&](uint32_t) { sink += trace::ticks(); });
+    check(sink != 0, "clock ticks");
+
+    trace::set_enabled(false);
+    const auto disabled = ns_per_iteration(iterations, [](uint32_t i) {
+        emit_instant(trace::Event::window_message, i);
+    });
+    check(trace::snapshot().threads.front().records.empty(), "disabled events record nothing");
+
+    trace::set_enabled(true);
+    const auto instant = ns_per_iteration(iterations, [](uint32_t i) {
+        emit_instant(trace::Event::window_message, i);
+    });
+    const auto scope = ns_per_iteration(iterations, [](uint32_t i) {
+        trace::Scope traced(trace::Event::render_scene, i);
+    });
+
+    auto snapshot = trace::snapshot();
+    const auto &ring = snapshot.threads.front();
+    check(ring.records.size() == (1u << 16), "ring keeps the newest capacity records");
+    check(ring.dropped == uint64_t{iterations} * 3 - (1u << 16), "older records are counted as dropped");
+    bool ordered = true;
+    for (size_t i = 1; i < ring.records.size(); ++i) {
+        ordered &= ring.records[i].ticks >= ring.records[i - 1].ticks;
+    }
+    check(ordered, "timestamps are monotonic within a thread");
+    check(ring.records.back().phase == trace::Phase::end, "scope ends last");
+
+    // a second thread gets its own ring
+    trace::clear();
+    std::thread worker([] {
+        trace::set_thread_name("worker");
+        for (uint32_t i = 0; i < 100; ++i) {
+            trace::Scope traced(trace::Event::frame, i);
+            emit_counter(trace::Event::present, i);
+        }
+    });
+    worker.join();
+    emit_instant(trace::Event::tray_popup, 1);
+    snapshot = trace::snapshot();
+    check(snapshot.threads.size() == 2 && snapshot.threads[1].name == "worker", "one ring per thread");
+    check(count_phase(snapshot, trace::Phase::begin) == 100 && count_phase(snapshot, trace::Phase::end) == 100 &&
+          count_phase(snapshot, trace::Phase::counter) == 100 && count_phase(snapshot, trace::Phase::instant) == 1,
+          "worker events recorded");
+
+    const std::string path = "trace_bench.trace";
+    trace::Snapshot loaded;
+    check(trace::save(snapshot, path) && trace::load(path, loaded), "save and load");
+    std::remove(path.c_str());
+    check(loaded.threads.size() == 2 && loaded.threads[1].records.size() == 300 &&
+          loaded.ticks_per_second == snapshot.ticks_per_second, "binary round trip");
+    const auto json = trace::to_chrome_json(loaded);
+    check(json.find(R"("name":"thread_name")") != std::string::npos &&
+          json.find(R"("name":"frame","ph":"B")") != std::string::npos &&
+          json.find(R"("name":"tray_popup","ph":"i")") != std::string::npos, "chrome json events");
+    trace::set_enabled(false);
+
+    // what the tray path used to do: format and flush a line per event
+    std::FILE *null = std::fopen("/dev/null", "w");
+    const uint32_t log_iterations = 200'000;
+    const auto flushed = null ? ns_per_iteration(log_iterations, [&](uint32_t i) {
+        std::fprintf(null, "WM_RBUTTONDOWN %u\n", i);
+        std::fflush(null);
+    }) : 0.0;
+    if (null) {
+        std::fclose(null);
+    }
+
+    std::printf("%-30s %8s\n", "event", "ns");
+    std::printf("%-30s %8.2f\n", "timestamp only", timestamp);
+    std::printf("%-30s %8.2f\n", "disabled", disabled);
+    std::printf("%-30s %8.2f\n", "instant", instant);
+    std::printf("%-30s %8.2f\n", "scope (begin + end)", scope);
+    std::printf("%-30s %8.2f\n", "printf + flush to /dev/null", flushed);
+    std::printf("tick rate %.1f MHz\n", loaded.ticks_per_second / 1e6);
+    return 0;
+}
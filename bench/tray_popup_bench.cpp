@@ -0,0 +1,148 @@
+// The tray popup's pooling: the TrayPopupState lifecycle (created once, on hover or the first
+// click, then shown and hidden), popup placement in the work area, and click-to-visible latency
+// for a window created per click (the old showTrayWindowAt) against the pooled one, with and
+// without prewarming on hover, with window creation and showing simulated by sleeps. The first
+// click and the slowest one show what prewarming saves; the percentiles do not.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <utility>
+
+#include "BenchCheck.hpp"
+#include "core/TrayPopup.hpp"
+
+using namespace borderless;
+using bench::check;
+using namespace std::chrono_literals;
+using Clock = TrayPopupState::Clock;
+
+namespace {
+
+    // assumed costs: class lookup + CreateWindowEx + swap chain, and a SetWindowPos that shows it
+    constexpr auto create_cost = 4ms;
+    constexpr auto show_cost = 300us;
+
+    struct Run {
+        uint64_t windows = 0;
+        uint64_t cold_clicks = 0; // clicks that waited for the window to be created
+        double first_us = 0;      // the first click, the one that pays for creation unless prewarmed
+        double p50_us = 0;
+        double p99_us = 0;
+        double max_us = 0;
+    };
+
+    auto us(Clock::duration d) -> double { return std::chrono::duration<double, std::micro>(d).count(); }
+
+    // clicks on the tray icon, each dismissed before the next
+    auto simulate(int clicks, bool pooled, bool hover) -> Run {
+        TrayPopupState state;
+        LatencyHistogram per_click;
+        Run run;
+        for (int i = 0; i < clicks; ++i) {
+            if (hover && pooled && state.prewarm()) {
+                std::this_thread::sleep_for(create_cost);
+                ++run.windows;
+                state.created();
+            }
+            const auto clicked = Clock::now();
+            if (!pooled) {
+                // a new window every time, the old one is never destroyed
+                std::this_thread::sleep_for(create_cost + show_cost);
+                ++run.windows;
+                ++run.cold_clicks;
+                per_click.record(static_cast<uint64_t>((Clock::now() - clicked).count()));
+            } else {
+                if (state.show(clicked)) {
+                    std::this_thread::sleep_for(create_cost);
+                    ++run.windows;
+                    ++run.cold_clicks;
+                    state.created();
+                }
+                std::this_thread::sleep_for(show_cost);
+                state.visible(Clock::now());
+                state.hide();
+            }
+            // the histogram's p99 of 40 clicks is the 39th, which hides a single cold click
+            const auto latency = us(Clock::now() - clicked);
+            if (i == 0) {
+                run.first_us = latency;
+            }
+            run.max_us = std::max(run.max_us, latency);
+        }
+        const auto &latency = pooled ? state.stats().click_to_visible : per_click;
+        run.p50_us = latency.percentile(0.50) / 1e3;
+        run.p99_us = latency.percentile(0.99) / 1e3;
+        return run;
+    }
+}
+
+int main() {
+    // lifecycle
+    {
+        TrayPopupState state;
+        const auto t0 = Clock::now();
+        check(state.state() == PopupState::absent && !state.hide(), "starts without a window");
+        check(state.show(t0), "the first click creates the window");
+        check(state.state() == PopupState::absent, "still absent until created");
+        state.created();
+        check(state.state() == PopupState::showing, "created for a click: showing");
+        state.visible(t0 + 5ms);
+        check(state.state() == PopupState::visible, "visible");
+        check(state.stats().click_to_visible.count() == 1 &&
+              state.stats().click_to_visible.percentile(0.5) >= 5'000'000, "click to visible recorded");
+        check(state.hide() && state.state() == PopupState::hidden && !state.hide(), "hidden once");
+        check(!state.prewarm(), "nothing to prewarm once created");
+        check(!state.show(t0 + 1s), "later clicks reuse the window");
+        state.visible(t0 + 1s + 1ms);
+        check(!state.show(t0 + 2s) && state.state() == PopupState::showing, "a click while visible moves it");
+        state.visible(t0 + 2s + 1ms);
+        state.visible(t0 + 3s); // a second visible report for the same click is ignored
+        check(state.stats().click_to_visible.count() == 3, "one latency per click");
+        check(state.stats().created == 1 && state.stats().shown == 3 && state.stats().reused == 2, "counters");
+
+        state.destroyed();
+        check(state.state() == PopupState::absent && state.stats().destroyed == 1, "destroyed from outside");
+        check(state.prewarm(), "recreated on the next hover");
+        state.created();
+        check(state.state() == PopupState::hidden && state.stats().prewarmed == 1, "prewarmed hidden");
+        check(!state.show(t0 + 4s), "the click after a hover only shows");
+        state.visible(t0 + 4s);
+        check(state.stats().created == 2 && state.stats().reused == 3, "prewarm counts as reuse");
+        check(!format_tray_popup_stats(state.stats()).empty(), "format");
+    }
+
+    // placement, a 1920x1040 work area above a bottom task bar
+    {
+        const Rect work{0, 0, 1920, 1040};
+        const Size popup{200, 400};
+        check(popup_origin({1800, 1060}, popup, work) == Point{1700, 640}, "above the click");
+        check(popup_origin({1900, 1060}, popup, work) == Point{1720, 640}, "kept inside on the right");
+        check(popup_origin({10, 1060}, popup, work) == Point{0, 640}, "kept inside on the left");
+        check(popup_origin({1800, 20}, popup, {0, 40, 1920, 1080}) == Point{1700, 40}, "below a top task bar");
+        check(popup_origin({500, 300}, {200, 2000}, work) == Point{400, 0}, "taller than the work area");
+        check(popup_origin({-1000, 1060}, popup, {-1920, 0, 0, 1040}) == Point{-1100, 640}, "left monitor");
+    }
+
+    // latency and window count for 40 clicks
+    const int clicks = 40;
+    const auto per_click = simulate(clicks, false, false);
+    const auto pooled = simulate(clicks, true, false);
+    const auto prewarmed = simulate(clicks, true, true);
+    check(per_click.windows == clicks && pooled.windows == 1 && prewarmed.windows == 1, "one window when pooled");
+    check(per_click.cold_clicks == clicks, "a window per click pays for creation every time");
+    check(pooled.cold_clicks == 1 && pooled.first_us >= us(create_cost), "pooled pays for creation once, first");
+    check(prewarmed.cold_clicks == 0, "prewarmed clicks never wait for creation");
+
+    std::printf("%-28s %8s %12s %12s %12s %12s\n", "tray popup", "windows", "first us", "p50 us", "p99 us", "max us");
+    for (const auto &[name, run]: {std::pair{"window per click (before)", per_click}, std::pair{"pooled", pooled},
+                                   std::pair{"pooled, prewarmed on hover", prewarmed}}) {
+        std::printf("%-28s %8llu %12.0f %12.0f %12.0f %12.0f\n", name, static_cast<unsigned long long>(run.windows),
+                    run.first_us, run.p50_us, run.p99_us, run.max_us);
+    }
+    std::printf("(histogram buckets are powers of two)\n");
+    return 0;
+}
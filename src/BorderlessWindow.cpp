@@ -1,24 +1,15 @@
-﻿#include <iostream>
-#include "pch.h"
+﻿#include "pch.h"
 #include "BorderLessWindow.hpp"
+#include "ComError.hpp"
+#include "core/AssetPack.hpp"
+#include "core/IconFile.hpp"
+#include "core/MonitorTopology.hpp"
+#include "core/SystemCapabilities.hpp"
+#include "WindowManager.hpp"
 
 
 namespace {
 
-    struct ComException {
-        HRESULT result;
-
-        ComException(HRESULT const value) :
-                result(value) {}
-    };
-
-    void HR(HRESULT const result) {
-        if (S_OK != result) {
-            throw ComException(result);
-        }
-    }
-
-
     // we cannot just use WS_POPUP style
     // WS_THICKFRAME: without this the window cannot be resized and so aero snap, de-maximizing and minimizing won't work
     // WS_SYSMENU: enables the context menu with the move, close, maximize, minize... commands (shift + right-click on the task bar item)
@@ -31,38 +22,57 @@ namespace {
         basic_borderless = WS_POPUP | WS_THICKFRAME | WS_SYSMENU | WS_MAXIMIZEBOX | WS_MINIMIZEBOX
     };
 
-    auto maximized(HWND hwnd) -> bool {
-        WINDOWPLACEMENT placement;
-        if (!::GetWindowPlacement(hwnd, &placement)) {
-            return false;
-        }
+    auto to_rect(const RECT &rect) -> borderless::Rect {
+        return {rect.left, rect.top, rect.right, rect.bottom};
+    }
 
-        return placement.showCmd == SW_MAXIMIZE;
+    // the process's monitors; invalidated on WM_DISPLAYCHANGE/WM_SETTINGCHANGE/WM_DPICHANGED
+    auto monitor_cache() -> borderless::MonitorTopology & {
+        static borderless::MonitorTopology topology;
+        return topology;
+    }
+
+    auto current_monitors() -> const borderless::MonitorTopology & {
+        auto &topology = monitor_cache();
+        if (!topology.valid()) {
+            std::vector<borderless::Monitor> monitors;
+            ::EnumDisplayMonitors(nullptr, nullptr, [](HMONITOR handle, HDC, LPRECT, LPARAM data) -> BOOL {
+                MONITORINFO info{};
+                info.cbSize = sizeof(info);
+                if (::GetMonitorInfoW(handle, &info)) {
+                    UINT dpi_x = 96, dpi_y = 96;
+                    ::GetDpiForMonitor(handle, MDT_EFFECTIVE_DPI, &dpi_x, &dpi_y);
+                    reinterpret_cast<std::vector<borderless::Monitor> *>(data)->push_back({
+                            reinterpret_cast<uintptr_t>(handle), to_rect(info.rcMonitor), to_rect(info.rcWork),
+                            dpi_x, (info.dwFlags & MONITORINFOF_PRIMARY) != 0});
+                }
+                return TRUE;
+            }, reinterpret_cast<LPARAM>(&monitors));
+            topology.update(std::move(monitors));
+        }
+        return topology;
     }
 
     /* Adjust client rect to not spill over monitor edges when maximized.
      * rect(in/out): in: proposed window rect, out: calculated client rect
-     * Does nothing if the window is not maximized.
+     * Does nothing if the window is not maximized. Runs on every WM_NCCALCSIZE, so the monitor
+     * comes from the cached topology instead of MonitorFromWindow and GetMonitorInfoW.
      */
     auto adjust_maximized_client_rect(HWND window, RECT &rect) -> void {
-        if (!maximized(window)) {
+        // only reads the WS_MAXIMIZE style bit
+        if (!::IsZoomed(window)) {
             return;
         }
 
-        auto monitor = ::MonitorFromWindow(window, MONITOR_DEFAULTTONULL);
+        const auto monitor = current_monitors().from_rect(to_rect(rect), borderless::MonitorFallback::none);
         if (!monitor) {
             return;
         }
 
-        MONITORINFO monitor_info{};
-        monitor_info.cbSize = sizeof(monitor_info);
-        if (!::GetMonitorInfoW(monitor, &monitor_info)) {
-            return;
-        }
-
         // when maximized, make the client area fill just the monitor (without task bar) rect,
         // not the whole window rect which extends beyond the monitor.
-        rect = monitor_info.rcWork;
+        const auto &work = monitor->work;
+        rect = RECT{work.left, work.top, work.right, work.bottom};
     }
 
     auto last_error(const std::string &message) -> std::system_error {
@@ -72,10 +82,42 @@ namespace {
         );
     }
 
-    auto window_class(WNDPROC wndproc, void *userdata) -> const wchar_t * {
+    auto executable_directory() -> std::filesystem::path {
+        std::wstring path(MAX_PATH, L'\0');
+        for (;;) {
+            const auto length = ::GetModuleFileNameW(nullptr, path.data(), static_cast<DWORD>(path.size()));
+            if (length == 0) {
+                return {};
+            }
+            if (length < path.size()) {
+                path.resize(length);
+                return std::filesystem::path(path).parent_path();
+            }
+            path.resize(path.size() * 2);
+        }
+    }
 
-        auto window = static_cast<BorderlessWindow *>(userdata);
+    /* The icon from assets.pack next to the executable: the pack is mapped, not read, and only the
+     * image closest to size is handed to CreateIconFromResourceEx, which scales it when needed.
+     * Returns nullptr when the pack or the icon is missing.
+     */
+    auto load_packed_icon(const std::filesystem::path &pack_path, std::string_view name, int size) -> HICON {
+        borderless::AssetPack pack;
+        if (!pack.open(pack_path)) {
+            return nullptr;
+        }
+        const auto bytes = pack.get(name);
+        const auto icon = bytes ? borderless::parse_icon(*bytes) : std::nullopt;
+        const auto image = icon ? borderless::best_icon_image(*icon, size) : nullptr;
+        if (!image) {
+            return nullptr;
+        }
+        return ::CreateIconFromResourceEx(const_cast<PBYTE>(image->data.data), static_cast<DWORD>(image->data.size),
+                                          TRUE, 0x00030000 /* icon format version */, size, size,
+                                          LR_DEFAULTCOLOR);
+    }
 
+    auto window_class(WNDPROC wndproc) -> const wchar_t * {
         static const wchar_t *window_class_name = [&] {
             WNDCLASSEXW wcx{};
             wcx.cbSize = sizeof(wcx);
@@ -85,8 +127,7 @@ namespace {
             wcx.lpszClassName = L"BorderlessWindowClass";
             wcx.hbrBackground = reinterpret_cast<HBRUSH>(COLOR_WINDOW + 1);
             wcx.hCursor = ::LoadCursorW(nullptr, IDC_ARROW);
-
-            wcx.hIcon = window->hIcon;
+            // the icon is decoded while the window is already up and set with WM_SETICON
             const ATOM result = ::RegisterClassExW(&wcx);
             if (!result) {
                 throw last_error("failed to register window class");
@@ -96,10 +137,49 @@ namespace {
         return window_class_name;
     }
 
+    // the system calls behind borderless::SystemCapabilities, only for the parts asked for
+    class SystemCapabilityProvider : public borderless::CapabilityProvider {
+    public:
+        auto query(uint8_t which, borderless::Capabilities &into) -> void override {
+            if (which & borderless::capability_composition) {
+                BOOL enabled = FALSE;
+                into.composition = ::DwmIsCompositionEnabled(&enabled) == S_OK && enabled;
+            }
+            if (which & borderless::capability_frame) {
+                // at 96 DPI, each window scales it to its own
+                const auto padded = ::GetSystemMetricsForDpi(SM_CXPADDEDBORDER, USER_DEFAULT_SCREEN_DPI);
+                into.frame = {::GetSystemMetricsForDpi(SM_CXFRAME, USER_DEFAULT_SCREEN_DPI) + padded,
+                              ::GetSystemMetricsForDpi(SM_CYFRAME, USER_DEFAULT_SCREEN_DPI) + padded};
+            }
+            if (which & borderless::capability_color_depth) {
+                const auto screen = ::GetDC(nullptr);
+                into.color_depth = static_cast<uint32_t>(::GetDeviceCaps(screen, BITSPIXEL) *
+                                                         ::GetDeviceCaps(screen, PLANES));
+                ::ReleaseDC(nullptr, screen);
+            }
+            if (which & borderless::capability_high_contrast) {
+                HIGHCONTRASTW contrast{};
+                contrast.cbSize = sizeof(contrast);
+                into.high_contrast = ::SystemParametersInfoW(SPI_GETHIGHCONTRAST, sizeof(contrast), &contrast, 0) &&
+                                     (contrast.dwFlags & HCF_HIGHCONTRASTON) != 0;
+            }
+            if (which & borderless::capability_reduced_motion) {
+                BOOL animations = TRUE;
+                into.reduced_motion = ::SystemParametersInfoW(SPI_GETCLIENTAREAANIMATION, 0, &animations, 0) &&
+                                      !animations;
+            }
+        }
+    };
+
+    // one snapshot for all windows, refreshed from the broadcasts every window receives
+    auto capabilities() -> borderless::SystemCapabilities & {
+        static SystemCapabilityProvider provider;
+        static borderless::SystemCapabilities snapshot(provider);
+        return snapshot;
+    }
+
     auto composition_enabled() -> bool {
-        BOOL composition_enabled = FALSE;
-        bool success = ::DwmIsCompositionEnabled(&composition_enabled) == S_OK;
-        return composition_enabled && success;
+        return capabilities().snapshot().composition;
     }
 
     auto select_borderless_style() -> Style {
@@ -114,19 +194,19 @@ namespace {
         }
     }
 
-    auto create_window(WNDPROC wndproc, void *userdata) -> HWND {
+    auto create_window(WNDPROC wndproc, void *userdata, POINT origin, borderless::Size size) -> HWND {
 
         // create a transparent window at initial otherwise set transparency will not work
         auto handle = CreateWindowExW(
                 static_cast<DWORD>(Style::transparent),
 //                0,
-                window_class(wndproc, userdata),
+                window_class(wndproc),
                 L"Borderless Window",
                 static_cast<DWORD>(Style::basic_borderless),
 //                WS_EX_NOREDIRECTIONBITMAP,
-                100,
-                100,
-                480, 400,
+                origin.x,
+                origin.y,
+                size.width, size.height,
                 nullptr, nullptr, nullptr,
                 userdata
         );
@@ -137,15 +217,90 @@ namespace {
     }
 }
 
-BorderlessWindow::BorderlessWindow() {
-    load_statics();
-    handle = create_window(&BorderlessWindow::WndProc, this);
-    trayWindow = new TrayWindow(handle, this);
+BorderlessWindow::BorderlessWindow(const Options &options) : threaded_rendering(options.threaded) {
 //    trayWindow = TrayWindow(handle);
 //    set_borderless(borderless);
 //    set_borderless_shadow(borderless_shadow);
-    init_direct2d();
-    ::ShowWindow(handle, SW_SHOW);
+    startup(options);
+    if (threaded_rendering) {
+        start_render_thread();
+    }
+
+    // everything that depends on the DPI, updated by WM_DPICHANGED before the window takes its new size
+    dpi.subscribe([this](const borderless::DpiChange &) { hit_tester.invalidate(); });
+    dpi.subscribe([this](const borderless::DpiChange &) {
+        if (render_thread) {
+            if (!dpi_changing) {
+                render_thread->post(ScaleCommand{dpi.scale()});
+            }
+        } else {
+            set_scene_scale(dpi.scale());
+        }
+    });
+    capability_listener = capabilities().subscribe([this](const borderless::CapabilityChange &change) {
+        if (change.changed & borderless::capability_frame) {
+            hit_tester.invalidate();
+        }
+        // aero and basic borderless differ in style and shadow; set_borderless switches over
+        if ((change.changed & borderless::capability_composition) && borderless) {
+            set_borderless(true);
+        }
+    });
+}
+
+void BorderlessWindow::startup(const Options &options) {
+    using borderless::StageAffinity;
+
+    // the window is shown by the first stage; devices, factories and the icon are created on
+    // workers meanwhile, and only the stages that need the window's thread run on this one.
+    // Devices come from the process-wide pool, so only the first window pays for them
+    declare_resources();
+    borderless::StageGraph graph;
+    borderless::Size client{};
+    const auto assets = graph.add("assets", [this] { load_statics(); });
+    const auto window = graph.add("window", [this, &options] {
+        // sized for the monitor it opens on, so it does not start with a WM_DPICHANGED
+        const auto monitor = current_monitors().from_point({options.origin.x, options.origin.y});
+        dpi.set_dpi(monitor ? monitor->dpi : borderless::default_dpi);
+        handle = create_window(&BorderlessWindow::WndProc, this, options.origin,
+                               dpi.to_pixels(borderless::Size{480, 400}));
+        dpi.set_dpi(::GetDpiForWindow(handle));
+        ::ShowWindow(handle, SW_SHOW);
+    }, {}, StageAffinity::caller);
+    // the stages materialize different resources, each after the ones it is created from
+    const auto device = graph.add("devices", [this] { resources.materialize(devices); });
+    const auto text = graph.add("dwrite", [this] { create_text(); });
+    const auto d2d = graph.add("d2d_context", [this] { resources.materialize(dc); }, {device});
+    const auto swap_chain = graph.add("swap_chain", [this, &client] {
+        client = client_size();
+        resources.materialize(swapChain);
+    }, {device, window});
+    const auto composition = graph.add("composition", [this] { create_composition(); },
+                                       {swap_chain}, StageAffinity::caller);
+    graph.add("icon", [this] {
+        ::SendMessageW(handle, WM_SETICON, ICON_BIG, reinterpret_cast<LPARAM>(hIcon));
+        ::SendMessageW(handle, WM_SETICON, ICON_SMALL, reinterpret_cast<LPARAM>(hIcon));
+    }, {assets, window}, StageAffinity::caller);
+    if (options.tray) {
+        graph.add("tray", [this] { trayWindow = new TrayWindow(handle, this); }, {assets, window},
+                  StageAffinity::caller);
+    }
+    const auto scene_ready = graph.add("scene", [this, &client] { init_scene(client); },
+                                       {d2d, text, swap_chain}, StageAffinity::caller);
+    if (!threaded_rendering) {
+        // with a render thread the first frame is its first iteration
+        graph.add("first_frame", [this] { render_frame(); }, {scene_ready, composition}, StageAffinity::caller);
+    }
+
+    startup_report = graph.run(3);
+    started = true;
+    ::OutputDebugStringA(borderless::format_stage_report(startup_report).c_str());
+
+    // WM_SIZE during startup only reached the coalescer; catch up with the size the window has now
+    RECT rect = {};
+    ::GetClientRect(handle, &rect);
+    resizer.request({rect.right - rect.left, rect.bottom - rect.top});
+    apply_pending_resize(true);
 }
 
 void BorderlessWindow::set_borderless(bool enabled) {
@@ -174,216 +329,323 @@ void BorderlessWindow::set_borderless_shadow(bool enabled) {
 }
 
 auto CALLBACK BorderlessWindow::WndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) noexcept -> LRESULT {
+    // the window pointer only changes on WM_NCCREATE and WM_NCDESTROY, so skip GetWindowLongPtrW
+    // for every other message
+    static thread_local HWND cached_hwnd = nullptr;
+    static thread_local BorderlessWindow *cached_window = nullptr;
+
     if (msg == WM_NCCREATE) {
         auto userdata = reinterpret_cast<CREATESTRUCTW *>(lparam)->lpCreateParams;
         // store window instance pointer in window user data
         ::SetWindowLongPtrW(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(userdata));
+        // messages sent during CreateWindowExW arrive before create_window() returns the handle
+        static_cast<BorderlessWindow *>(userdata)->handle = hwnd;
+        cached_hwnd = nullptr;
+    }
+    if (hwnd != cached_hwnd) {
+        cached_hwnd = hwnd;
+        cached_window = reinterpret_cast<BorderlessWindow *>(::GetWindowLongPtrW(hwnd, GWLP_USERDATA));
+    }
+    auto window = cached_window;
+    if (msg == WM_NCDESTROY) {
+        cached_hwnd = nullptr;
+        cached_window = nullptr;
+    }
+    if (!window) {
+        return ::DefWindowProcW(hwnd, msg, wparam, lparam);
     }
-    if (auto window_ptr = reinterpret_cast<BorderlessWindow *>(::GetWindowLongPtrW(hwnd, GWLP_USERDATA))) {
-        auto &window = *window_ptr;
-
-        switch (msg) {
-            case WM_TRAY_ICON: {
-                switch (LOWORD(lparam)) {
-                    case WM_RBUTTONDOWN: {
-                        POINT cursor;
-                        ::GetCursorPos(&cursor);
-                        std::cout<< "WM_RBUTTONDOWN" << std::endl;
-                        window.trayWindow->showTrayWindowAt(&cursor);
-//                        ::SetForegroundWindow(hwnd);
-//                        ::TrackPopupMenu(reinterpret_cast<HMENU>(wparam), 0, cursor.x, cursor.y, 0, hwnd, nullptr);
-//                        ::PostMessageW(hwnd, WM_NULL, 0, 0);
-                        return 0;
-                    }
-                    case WM_LBUTTONDBLCLK: {
-                        ::ShowWindow(hwnd, SW_RESTORE);
-                        return 0;
-                    }
-                }
-                break;
-            }
 
-            case WM_NCCALCSIZE: {
-                if (wparam == TRUE && window.borderless) {
-                    auto &params = *reinterpret_cast<NCCALCSIZE_PARAMS *>(lparam);
-                    adjust_maximized_client_rect(hwnd, params.rgrc[0]);
-                    return 0;
-                }
-                break;
-            }
-            case WM_NCHITTEST: {
-                // When we have no border or title bar, we need to perform our
-                // own hit testing to allow resizing and moving.
-                if (window.borderless) {
-                    return window.hit_test(POINT{
-                            GET_X_LPARAM(lparam),
-                            GET_Y_LPARAM(lparam)
-                    });
-                }
-                break;
-            }
-            case WM_NCACTIVATE: {
-                if (!composition_enabled()) {
-                    // Prevents window frame reappearing on window activation
-                    // in "basic" theme, where no aero shadow is present.
-                    return 1;
-                }
-                break;
-            }
+    if (recorder) {
+        // these point at a RECT a replay needs; recorded before the handler adjusts it
+        const RECT *rect = nullptr;
+        if (msg == WM_NCCALCSIZE) {
+            rect = wparam ? &reinterpret_cast<NCCALCSIZE_PARAMS *>(lparam)->rgrc[0] : reinterpret_cast<RECT *>(lparam);
+        } else if (msg == WM_DPICHANGED) {
+            rect = reinterpret_cast<RECT *>(lparam);
+        }
+        const auto recorded = rect ? to_rect(*rect) : borderless::Rect{};
+        recorder->record(borderless::MessageRecorder::Clock::now(), window->recording_id,
+                         {msg, static_cast<uintptr_t>(wparam), static_cast<intptr_t>(lparam)},
+                         rect ? &recorded : nullptr);
+    }
 
-            case WM_CLOSE: {
-                ::DestroyWindow(hwnd);
-                return 0;
-            }
+    BORDERLESS_TRACE_SCOPE(borderless::trace::Event::window_message, msg);
+    return static_cast<LRESULT>(dispatcher().dispatch(
+            *window,
+            {msg, static_cast<uintptr_t>(wparam), static_cast<intptr_t>(lparam)},
+            [&] { return static_cast<intptr_t>(::DefWindowProcW(hwnd, msg, wparam, lparam)); }));
+}
 
-            case WM_DESTROY: {
-                PostQuitMessage(0);
-                return 0;
-            }
+auto BorderlessWindow::dispatcher() -> MessageDispatcher & {
+    // WindowMessages is written against the ids and codes of windows.h
+    namespace wm = borderless::wm;
+    static_assert(wm::move == WM_MOVE && wm::size == WM_SIZE && wm::close == WM_CLOSE && wm::destroy == WM_DESTROY &&
+                  wm::setting_change == WM_SETTINGCHANGE && wm::display_change == WM_DISPLAYCHANGE &&
+                  wm::nccalcsize == WM_NCCALCSIZE && wm::nchittest == WM_NCHITTEST && wm::ncactivate == WM_NCACTIVATE &&
+                  wm::keydown == WM_KEYDOWN && wm::syskeydown == WM_SYSKEYDOWN && wm::timer == WM_TIMER &&
+                  wm::mousemove == WM_MOUSEMOVE && wm::lbuttondblclk == WM_LBUTTONDBLCLK &&
+                  wm::rbuttondown == WM_RBUTTONDOWN && wm::exitsizemove == WM_EXITSIZEMOVE &&
+                  wm::dpichanged == WM_DPICHANGED && wm::themechanged == WM_THEMECHANGED &&
+                  wm::dwmcompositionchanged == WM_DWMCOMPOSITIONCHANGED && wm::tray_icon == WM_TRAY_ICON);
+    static_assert(wm::size_minimized == SIZE_MINIMIZED && wm::size_maximized == SIZE_MAXIMIZED &&
+                  wm::resize_timer == resize_timer);
+    static_assert(wm::vk_f7 == VK_F7 && wm::vk_f8 == VK_F8 && wm::vk_f9 == VK_F9 && wm::vk_f10 == VK_F10 &&
+                  wm::vk_f11 == VK_F11);
+    static_assert(wm::spi_set_nonclient_metrics == SPI_SETNONCLIENTMETRICS &&
+                  wm::spi_set_high_contrast == SPI_SETHIGHCONTRAST &&
+                  wm::spi_set_client_area_animation == SPI_SETCLIENTAREAANIMATION);
+
+    static MessageDispatcher table = [] {
+        MessageDispatcher d;
+        borderless::WindowMessages<BorderlessWindow>::register_handlers(d);
+        return d;
+    }();
+    return table;
+}
 
-            case WM_KEYDOWN:
-            case WM_SYSKEYDOWN: {
-                switch (wparam) {
-                    case VK_F8 : {
-                        window.borderless_drag = !window.borderless_drag;
-                        return 0;
-                    }
-                    case VK_F9 : {
-                        window.borderless_resize = !window.borderless_resize;
-                        return 0;
-                    }
-                    case VK_F10: {
-                        window.set_borderless(!window.borderless);
-                        return 0;
-                    }
-                    case VK_F11: {
-                        window.set_borderless_shadow(!window.borderless_shadow);
-                        return 0;
-                    }
-                    case VK_F7: {
-                        window.set_opacity(0.5f);
-                        return 0;
-                    }
-                    default:
-                        break;
-                }
-                break;
-            }
+auto BorderlessWindow::has_composition() const -> bool {
+    return composition_enabled();
+}
+
+void BorderlessWindow::fit_client_area(const borderless::Message &message) {
+    auto &params = *reinterpret_cast<NCCALCSIZE_PARAMS *>(message.lparam);
+    adjust_maximized_client_rect(handle, params.rgrc[0]);
+}
+
+void BorderlessWindow::resize_client(borderless::Size size, bool) {
+    if (render_thread) {
+        if (!dpi_changing) {
+            render_thread->post(ResizeCommand{size});
         }
+    } else {
+        resizer.request(size);
+        apply_pending_resize(false);
     }
-
-    return ::DefWindowProcW(hwnd, msg, wparam, lparam);
 }
 
-auto BorderlessWindow::hit_test(POINT cursor) const -> LRESULT {
-    // identify borders and corners to allow resizing the window.
-    // Note: On Windows 10, windows behave differently and
-    // allow resizing outside the visible window frame.
-    // This implementation does not replicate that behavior.
-    const POINT border{
-            ::GetSystemMetrics(SM_CXFRAME) + ::GetSystemMetrics(SM_CXPADDEDBORDER),
-            ::GetSystemMetrics(SM_CYFRAME) + ::GetSystemMetrics(SM_CXPADDEDBORDER)
-    };
-    RECT window;
-    if (!::GetWindowRect(handle, &window)) {
-        return HTNOWHERE;
+void BorderlessWindow::change_dpi(uint32_t new_dpi, const borderless::Message &message) {
+    // hit-test borders and the scene's scale first, then the size the system suggests; its
+    // WM_SIZE resizes the swap chain. The new scale and size have to land in one frame: flushed
+    // here, or with a render thread sent to it as one command instead of a scale and a resize
+    dpi_changing = true;
+    dpi.set_dpi(new_dpi);
+    const auto &suggested = *reinterpret_cast<const RECT *>(message.lparam);
+    ::SetWindowPos(handle, nullptr, suggested.left, suggested.top,
+                   suggested.right - suggested.left, suggested.bottom - suggested.top,
+                   SWP_NOZORDER | SWP_NOACTIVATE);
+    dpi_changing = false;
+    if (render_thread) {
+        render_thread->post(ScaleCommand{dpi.scale(), client_size()});
+    } else {
+        apply_pending_resize(true);
     }
+}
 
-    const auto drag = borderless_drag ? HTCAPTION : HTCLIENT;
+void BorderlessWindow::invalidate_monitors() {
+    monitor_cache().invalidate();
+}
 
-    enum region_mask {
-        client = 0b0000,
-        left = 0b0001,
-        right = 0b0010,
-        top = 0b0100,
-        bottom = 0b1000,
-    };
+void BorderlessWindow::refresh_capabilities(uint8_t changed) {
+    capabilities().refresh(changed);
+}
+
+void BorderlessWindow::show_tray_popup() {
+    POINT cursor;
+    ::GetCursorPos(&cursor);
+    BORDERLESS_TRACE_INSTANT(borderless::trace::Event::tray_popup, 0);
+    trayWindow->showTrayWindowAt(&cursor);
+}
+
+void BorderlessWindow::destroyed() {
+    // stop presenting before the DirectComposition target loses its window
+    if (render_thread) {
+        render_thread->stop();
+    }
+    // nothing waits on the swap chain any more
+    if (frame_latency_waitable) {
+        ::CloseHandle(frame_latency_waitable);
+        frame_latency_waitable = nullptr;
+    }
+    capabilities().unsubscribe(capability_listener);
+    if constexpr (MessageDispatcher::instrumented()) {
+        ::OutputDebugStringA(borderless::format_message_stats(dispatcher().stats()).c_str());
+    }
+    if (trayWindow) {
+        ::OutputDebugStringA(borderless::format_tray_popup_stats(trayWindow->stats()).c_str());
+        // removes the notification icon and the popup with it
+        delete trayWindow;
+        trayWindow = nullptr;
+    }
+    // the WindowManager ends the message loop with the last window
+    closed = true;
+}
+
+auto BorderlessWindow::hit_test(borderless::Point cursor) -> LRESULT {
+    if (!hit_tester.valid() && !refresh_hit_tester()) {
+        return HTNOWHERE;
+    }
+    return static_cast<LRESULT>(hit_tester.hit_test(cursor));
+}
 
-    const auto result =
-            left * (cursor.x < (window.left + border.x)) |
-            right * (cursor.x >= (window.right - border.x)) |
-            top * (cursor.y < (window.top + border.y)) |
-            bottom * (cursor.y >= (window.bottom - border.y));
-
-    switch (result) {
-        case left          :
-            return borderless_resize ? HTLEFT : drag;
-        case right         :
-            return borderless_resize ? HTRIGHT : drag;
-        case top           :
-            return borderless_resize ? HTTOP : drag;
-        case bottom        :
-            return borderless_resize ? HTBOTTOM : drag;
-        case top | left    :
-            return borderless_resize ? HTTOPLEFT : drag;
-        case top | right   :
-            return borderless_resize ? HTTOPRIGHT : drag;
-        case bottom | left :
-            return borderless_resize ? HTBOTTOMLEFT : drag;
-        case bottom | right:
-            return borderless_resize ? HTBOTTOMRIGHT : drag;
-        case client        :
-            return drag;
-        default            :
-            return HTNOWHERE;
+auto BorderlessWindow::refresh_hit_tester() -> bool {
+    // the frame of a window at its own DPI
+    const auto frame = capabilities().snapshot().frame;
+    const borderless::Point border{dpi.to_pixels(frame.x), dpi.to_pixels(frame.y)};
+    RECT window;
+    if (!::GetWindowRect(handle, &window)) {
+        return false;
     }
+    hit_tester.update(border, {window.left, window.top, window.right, window.bottom});
+    return true;
 }
 
 void BorderlessWindow::set_opacity(float d) {
-    set_transparent_window(d);
+    // a fade that is still running continues from where it is
+    const auto now = frame_clock.now();
+    const auto from = animations.value(panel_target, borderless::AnimatedProperty::opacity, now).value_or(opacity);
+    // with animations turned off in the system settings the fade jumps to its end
+    const auto duration = capabilities().snapshot().reduced_motion ? std::chrono::milliseconds(0)
+                                                                   : std::chrono::milliseconds(250);
+    animations.add(borderless::tween(panel_target, borderless::AnimatedProperty::opacity, from, d, duration));
+    opacity = d;
     draw();
 }
 
-void BorderlessWindow::init_direct2d() {
-    HR(D3D11CreateDevice(nullptr,    // Adapter
-                         D3D_DRIVER_TYPE_HARDWARE,
-                         nullptr,    // Module
-                         D3D11_CREATE_DEVICE_BGRA_SUPPORT,
-                         nullptr, 0, // Highest available feature level
-                         D3D11_SDK_VERSION,
-                         &direct3dDevice,
-                         nullptr,    // Actual feature level
-                         nullptr));  // Device context
+auto BorderlessWindow::animate(borderless::FrameClockType::time_point now) -> bool {
+    // nothing to animate while a lost device is being recovered
+    if (!started || !resources.materialized(animator) || !animations.due(now)) {
+        return false;
+    }
+    property_changes.clear();
+    animations.tick(now, property_changes);
+    return resources.get(animator).apply(property_changes);
+}
 
-    HR(direct3dDevice.As(&dxgiDevice));
+auto BorderlessWindow::shared_devices() const -> std::shared_ptr<GraphicsDevices> {
+    return started && resources.materialized(devices) ? resources.get(devices) : nullptr;
+}
 
-    HR(CreateDXGIFactory2(
-            DXGI_CREATE_FACTORY_DEBUG,
-            __uuidof(dxFactory),
-            reinterpret_cast<void **>(dxFactory.GetAddressOf())));
+void BorderlessWindow::declare_resources() {
+    // in creation order, which rebuild() follows; everything is released in reverse, devices last
+    auto &r = resources;
+    devices = r.declare<std::shared_ptr<GraphicsDevices>>([this] {
+        auto &pool = GraphicsDevices::pool(threaded_rendering);
+        devices_generation = pool.generation();
+        return pool.acquire();
+    });
+    dc = r.declare<ComPtr<ID2D1DeviceContext>>([this] { return create_device_context(); }, {devices});
+    swapChain = r.declare<ComPtr<IDXGISwapChain1>>([this] { return create_swap_chain(client_size()); }, {devices});
+    bitmap = r.declare<ComPtr<ID2D1Bitmap1>>([this] { return bind_back_buffer(); }, {swapChain, dc});
+    target = r.declare<ComPtr<IDCompositionTarget>>([this] {
+        ComPtr<IDCompositionTarget> created;
+        HR(resources.get(devices)->composition->CreateTargetForHwnd(handle,
+                                                                    true, // Top most
+                                                                    created.GetAddressOf()));
+        return created;
+    }, {devices});
+    root_visual = r.declare<ComPtr<IDCompositionVisual>>([this] {
+        ComPtr<IDCompositionVisual> created;
+        HR(resources.get(devices)->composition->CreateVisual(created.GetAddressOf()));
+        return created;
+    }, {devices});
+    visual = r.declare<ComPtr<IDCompositionVisual>>([this] {
+        ComPtr<IDCompositionVisual> created;
+        HR(resources.get(devices)->composition->CreateVisual(created.GetAddressOf()));
+        HR(created->SetContent(resources.get(swapChain).Get()));
+        HR(resources.get(root_visual)->AddVisual(created.Get(), TRUE, nullptr));
+        HR(resources.get(target)->SetRoot(resources.get(root_visual).Get()));
+        return created;
+    }, {swapChain, target, root_visual});
+    animator = r.declare<VisualAnimator>([this] {
+        VisualAnimator created(resources.get(devices)->composition);
+        // the first target again after a rebuild, so the timeline's animations carry over
+        panel_target = created.add_target(resources.get(root_visual));
+        return created;
+    }, {root_visual});
+    layers = r.declare<LayerCompositor>([this] {
+        return LayerCompositor(resources.get(devices)->composition, resources.get(root_visual), resources.get(visual));
+    }, {root_visual, visual});
+    renderer = r.declare<D2DRenderer>([this] { return D2DRenderer(resources.get(dc), *text_cache); }, {dc});
+}
+
+auto BorderlessWindow::client_size() const -> borderless::Size {
+    RECT rect = {};
+    ::GetClientRect(handle, &rect);
+    return {rect.right - rect.left, rect.bottom - rect.top};
+}
 
+auto BorderlessWindow::create_swap_chain(borderless::Size size) -> ComPtr<IDXGISwapChain1> {
     DXGI_SWAP_CHAIN_DESC1 description = {};
     description.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
     description.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
     description.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL;
-    description.BufferCount = 2;
+    description.BufferCount = swap_chain_buffers;
     description.SampleDesc.Count = 1;
     description.AlphaMode = DXGI_ALPHA_MODE_PREMULTIPLIED;
+    // lets the message loop sleep until the swap chain can take another frame
+    description.Flags = swap_chain_flags;
+    description.Width = static_cast<UINT>(size.width);
+    description.Height = static_cast<UINT>(size.height);
+
+    const auto &device = resources.get(devices);
+    ComPtr<IDXGISwapChain1> created;
+    HR(device->factory->CreateSwapChainForComposition(device->dxgi.Get(),
+                                                       &description,
+                                                       nullptr, // Don’t restrict
+                                                       created.GetAddressOf()));
+
+    ComPtr<IDXGISwapChain2> swapChain2;
+    HR(created.As(&swapChain2));
+    HR(swapChain2->SetMaximumFrameLatency(1));
+    frame_latency_waitable = swapChain2->GetFrameLatencyWaitableObject();
+    return created;
+}
 
-    RECT rect = {};
-    GetClientRect(handle, &rect);
-    description.Width = rect.right - rect.left;
-    description.Height = rect.bottom - rect.top;
-
-    HR(dxFactory->CreateSwapChainForComposition(dxgiDevice.Get(),
-                                                &description,
-                                                nullptr, // Don’t restrict
-                                                swapChain.GetAddressOf()));
-
-    // Create a single-threaded Direct2D factory with debugging information
-    D2D1_FACTORY_OPTIONS const options = {D2D1_DEBUG_LEVEL_INFORMATION};
-    HR(D2D1CreateFactory(D2D1_FACTORY_TYPE_SINGLE_THREADED,
-                         options,
-                         d2Factory.GetAddressOf()));
-    // Create the Direct2D device that links back to the Direct3D device
-    HR(d2Factory->CreateDevice(dxgiDevice.Get(),
-                               d2Device.GetAddressOf()));
+auto BorderlessWindow::create_device_context() -> ComPtr<ID2D1DeviceContext> {
     // Create the Direct2D device context that is the actual render target
-    // and exposes drawing commands
-    HR(d2Device->CreateDeviceContext(D2D1_DEVICE_CONTEXT_OPTIONS_NONE,
-                                     dc.GetAddressOf()));
+    // and exposes drawing commands; one per window, the device is shared
+    ComPtr<ID2D1DeviceContext> created;
+    HR(resources.get(devices)->d2d->CreateDeviceContext(D2D1_DEVICE_CONTEXT_OPTIONS_NONE,
+                                                        created.GetAddressOf()));
+    return created;
+}
+
+void BorderlessWindow::create_composition() {
+    for (const borderless::ResourceId id: {target.id, root_visual.id, visual.id, animator.id, layers.id}) {
+        resources.materialize(id);
+    }
+    HR(resources.get(devices)->composition->Commit());
+}
+
+void BorderlessWindow::create_text() {
+    HR(DWriteCreateFactory(DWRITE_FACTORY_TYPE_SHARED,
+                           __uuidof(writeFactory),
+                           reinterpret_cast<IUnknown **>(writeFactory.GetAddressOf())));
+
+    text_cache = std::make_unique<DWriteTextCache>(DWriteTextBackend{writeFactory});
+}
+
+void BorderlessWindow::init_scene(borderless::Size size) {
+    resources.materialize(bitmap);
+    resources.materialize(renderer);
+
+    const borderless::Rect client{0, 0, size.width, size.height};
+    frame_damage.set_surface(client);
+    layer_damage.assign(1, borderless::DamageRegion());
+    layer_damage[0].set_surface(client);
+    swap_damage = borderless::SwapChainDamage(swap_chain_buffers);
+    swap_damage.reset(client);
+    resizer.reset(size);
+    resizer.set_interval(refresh_interval());
+    animations.set_interval(resizer.interval());
+    scene.set_transform(scene.root(), dpi.transform());
+    build_scene();
+}
+
+auto BorderlessWindow::bind_back_buffer() -> ComPtr<ID2D1Bitmap1> {
     // Retrieve the swap chain's back buffer
-    HR(swapChain->GetBuffer(
+    ComPtr<IDXGISurface2> surface;
+    HR(resources.get(swapChain)->GetBuffer(
             0, // index
             __uuidof(surface),
             reinterpret_cast<void **>(surface.GetAddressOf())));
@@ -393,38 +655,103 @@ void BorderlessWindow::init_direct2d() {
     properties.pixelFormat.format = DXGI_FORMAT_B8G8R8A8_UNORM;
     properties.bitmapOptions = D2D1_BITMAP_OPTIONS_TARGET |
                                D2D1_BITMAP_OPTIONS_CANNOT_DRAW;
-    HR(dc->CreateBitmapFromDxgiSurface(surface.Get(),
-                                       properties,
-                                       bitmap.GetAddressOf()));
+    const auto &context = resources.get(dc);
+    ComPtr<ID2D1Bitmap1> created;
+    HR(context->CreateBitmapFromDxgiSurface(surface.Get(),
+                                            properties,
+                                            created.GetAddressOf()));
     // Point the device context to the bitmap for rendering
-    dc->SetTarget(bitmap.Get());
-
-    HR(DCompositionCreateDevice(
-            dxgiDevice.Get(),
-            __uuidof(dcompDevice),
-            reinterpret_cast<void **>(dcompDevice.GetAddressOf())));
+    context->SetTarget(created.Get());
+    return created;
+}
 
+void BorderlessWindow::resize_swap_chain(borderless::Size size) {
+    BORDERLESS_TRACE_SCOPE(borderless::trace::Event::resize_swap_chain, (size.width << 16) | (size.height & 0xFFFF));
+    // only the target bitmap references the buffers; device, context and visual stay alive
+    const auto &context = resources.get(dc);
+    context->SetTarget(nullptr);
+    resources.release(bitmap);
+
+    {
+        D2DDeviceLock lock(context.Get());
+        HR(resources.get(swapChain)->ResizeBuffers(0, // keep buffer count
+                                                   static_cast<UINT>(size.width),
+                                                   static_cast<UINT>(size.height),
+                                                   DXGI_FORMAT_UNKNOWN, // keep format
+                                                   swap_chain_flags));
+    }
+    resources.materialize(bitmap);
 
-    HR(dcompDevice->CreateTargetForHwnd(handle,
-                                        true, // Top most
-                                        target.GetAddressOf()));
+    const borderless::Rect client{0, 0, size.width, size.height};
+    frame_damage.set_surface(client);
+    for (auto &region: layer_damage) {
+        region.set_surface(client);
+    }
+    swap_damage.reset(client);
+    frame_damage.add_all();
+    scheduler.request_frame();
+    if (!threaded_rendering) {
+        // the modal size loop starves RunApp, so render from here
+        render_frame();
+    }
+}
 
-    HR(dcompDevice->CreateVisual(visual.GetAddressOf()));
-    HR(visual->SetContent(swapChain.Get()));
-    HR(target->SetRoot(visual.Get()));
-    HR(dcompDevice->Commit());
+void BorderlessWindow::apply_pending_resize(bool flush) {
+    // the swap chain is created on a startup worker; WM_SIZE from ShowWindow only records the size.
+    // A recovery creates it at the size the window has by then. With a render thread the resizer
+    // and the swap chain are its own: WM_SIZE is posted and render_thread_frame flushes it
+    if (!started || recovery_pending || render_thread) {
+        return;
+    }
+    const auto now = borderless::ResizeCoalescer::Clock::now();
+    auto resize = [this](borderless::Size size) { resize_swap_chain(size); };
+    try {
+        if (flush) {
+            resizer.flush(now, resize);
+        } else {
+            resizer.apply(now, resize);
+        }
+    } catch (const ComException &error) {
+        handle_device_error(error);
+        return;
+    }
 
-    D2D1_COLOR_F const brushColor = D2D1::ColorF(0.18f,  // red
-                                                 0.55f,  // green
-                                                 0.34f,  // blue
-                                                 0.75f); // alpha
-    HR(dc->CreateSolidColorBrush(brushColor,
-                                 brush.GetAddressOf()));
+    if (resizer.pending()) {
+        // nothing else may arrive during a drag pause, so make sure the last size lands
+        const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(resizer.wait_time(now));
+        ::SetTimer(handle, resize_timer, static_cast<UINT>(wait.count()) + 1, nullptr);
+    } else {
+        ::KillTimer(handle, resize_timer);
+    }
+}
 
+auto BorderlessWindow::refresh_interval() const -> std::chrono::nanoseconds {
+    DWM_TIMING_INFO timing = {};
+    timing.cbSize = sizeof(timing);
+    if (SUCCEEDED(::DwmGetCompositionTimingInfo(nullptr, &timing)) &&
+        timing.rateRefresh.uiNumerator != 0 && timing.rateRefresh.uiDenominator != 0) {
+        return std::chrono::nanoseconds(1'000'000'000ull * timing.rateRefresh.uiDenominator /
+                                        timing.rateRefresh.uiNumerator);
+    }
+    return std::chrono::microseconds(16'667);
+}
 
-    HR(DWriteCreateFactory(DWRITE_FACTORY_TYPE_SHARED,
-                           __uuidof(writeFactory),
-                           reinterpret_cast<IUnknown **>(writeFactory.GetAddressOf())));
+void BorderlessWindow::build_scene() {
+    ellipse_node = scene.add(scene.root(), borderless::EllipseNode{
+            {100.0f, 100.0f}, // center
+            100.0f,           // x radius
+            100.0f,           // y radius
+            {0.18f, 0.55f, 0.34f, 0.75f}
+    });
+    const auto label = scene.add(scene.root(), borderless::TextNode{
+            {{L"Arial", DWRITE_FONT_WEIGHT_NORMAL, 48.0f, L"en-us"}, L"Hello, World!",
+             300.0f,  // max width, one line at 48px
+             60.0f},  // max height
+            {50.0f, 150.0f}, // origin
+            {0.0f, 0.0f, 0.0f, 1.0f}
+    });
+    scene.set_layer(ellipse_node, ellipse_layer);
+    scene.set_layer(label, label_layer);
 }
 
 void BorderlessWindow::draw() {
@@ -434,84 +761,280 @@ void BorderlessWindow::draw() {
     if (i >= 3) i = 0;
     float alpha[] = {0.25f, 0.5f, 1.0f};
 
-    // Draw something
-    dc->BeginDraw();
-    dc->Clear();
-
-    D2D1_COLOR_F const brushColor = D2D1::ColorF(0.18f,  // red
-                                                 0.55f,  // green
-                                                 0.34f,  // blue
-                                                 alpha[i]); // alpha
-    brush->SetColor(brushColor);
-    D2D1_POINT_2F const ellipseCenter = D2D1::Point2F(100.0f,  // x
-                                                      100.0f); // y
-    D2D1_ELLIPSE const ellipse = D2D1::Ellipse(ellipseCenter,
-                                               100.0f,  // x radius
-                                               100.0f); // y radius
-    dc->FillEllipse(ellipse, brush.Get());
-
-    std::wstring helloText = L"Hello, World!";
-    D2D1_RECT_F textRect = D2D1::RectF(50.0f,  // left
-                                       150.0f, // top
-                                       150.0f, // right
-                                       200.0f); // bottom
-    brush->SetColor(D2D1::ColorF(D2D1::ColorF::Black));
-
-    ComPtr<IDWriteTextFormat> textFormat;
-    HR(writeFactory->CreateTextFormat(
-            L"Arial", // font family
-            nullptr,  // font collection
-            DWRITE_FONT_WEIGHT_NORMAL,
-            DWRITE_FONT_STYLE_NORMAL,
-            DWRITE_FONT_STRETCH_NORMAL,
-            48.0f,    // font size
-            L"en-us", // locale
-            textFormat.GetAddressOf()
-    ));
-
-    dc->DrawText(
-            helloText.c_str(),
-            (UINT32) helloText.size(),
-            textFormat.Get(),
-            &textRect,
-            brush.Get()
-    );
-    HR(dc->EndDraw());
-
-    // Make the swap chain available to the composition engine
-    HR(swapChain->Present(1,   // sync
-                          0)); // flags
-}
-
-void BorderlessWindow::set_transparent_window(float d) {
-    ::SetWindowLongPtr(handle, GWL_STYLE, static_cast<LONG>(Style::basic_borderless));
-//    ::SetWindowLongPtr(handle, GWL_EXSTYLE, static_cast<LONG>(Style::transparent));
-//    ::SetLayeredWindowAttributes(handle, RGB(0, 0, 0), static_cast<BYTE>(d * 255), LWA_ALPHA);
-    ::SetWindowLongPtr(handle, GWL_STYLE, static_cast<LONG>(Style::transparent));
-
-    // redraw frame
-    ::SetWindowPos(handle, nullptr, 300, 100, 0, 0, SWP_FRAMECHANGED | SWP_NOMOVE | SWP_NOSIZE);
-    ::ShowWindow(handle, SW_SHOW);
+    if (render_thread) {
+        render_thread->post(EllipseAlphaCommand{alpha[i]});
+    } else {
+        set_ellipse_alpha(alpha[i]);
+    }
+}
+
+void BorderlessWindow::set_ellipse_alpha(float alpha) {
+    auto ellipse = std::get<borderless::EllipseNode>(scene.content(ellipse_node));
+    ellipse.color.a = alpha;
+    scene.set_content(ellipse_node, ellipse);
+
+    scheduler.request_frame();
+}
+
+void BorderlessWindow::set_scene_scale(float scale) {
+    // every node's pixel bounds change, so the old and new ones are repainted
+    scene.set_transform(scene.root(), borderless::Transform::scale(scale, scale));
+    scheduler.request_frame();
+}
+
+void BorderlessWindow::execute(RenderCommand &command) {
+    if (auto resize = std::get_if<ResizeCommand>(&command)) {
+        // applied in render_thread_frame, so a burst of WM_SIZE costs one ResizeBuffers
+        resizer.request(resize->size);
+    } else if (auto alpha = std::get_if<EllipseAlphaCommand>(&command)) {
+        set_ellipse_alpha(alpha->alpha);
+    } else if (auto scale = std::get_if<ScaleCommand>(&command)) {
+        set_scene_scale(scale->scale);
+        if (scale->size.width > 0 && scale->size.height > 0) {
+            // flushed with the scale at the start of the next frame
+            resizer.request(scale->size);
+        }
+    }
+}
+
+void BorderlessWindow::start_render_thread() {
+    borderless::RenderThread<RenderCommand>::Hooks hooks;
+    hooks.execute = [this](RenderCommand &command) { execute(command); };
+    hooks.frame = [this] { return render_thread_frame(); };
+    // wakes the message loop so RunApp can rethrow, or check_render_thread can recover
+    hooks.failed = [this] { ::PostMessageW(handle, WM_NULL, 0, 0); };
+    render_thread = std::make_unique<borderless::RenderThread<RenderCommand>>(std::move(hooks));
+}
+
+void BorderlessWindow::check_render_thread() {
+    if (render_thread) {
+        try {
+            render_thread->rethrow_if_failed();
+            return;
+        } catch (const ComException &error) {
+            if (!device_lost(error.result)) {
+                throw;
+            }
+        }
+        // the thread has ended, so its state is the UI thread's until a new one starts
+        render_thread.reset();
+        recovery_pending = true;
+    }
+    if (recover_device()) {
+        start_render_thread();
+    }
+}
+
+auto BorderlessWindow::render_thread_frame() -> borderless::FrameClockType::duration {
+    if (resizer.pending()) {
+        resizer.flush(borderless::ResizeCoalescer::Clock::now(),
+                      [this](borderless::Size size) { resize_swap_chain(size); });
+    }
+    // block on the swap chain for at most a refresh so queued commands are still picked up
+    scheduler.tick([this] { return render_scene(); }, resizer.interval());
+
+    const auto now = frame_clock.now();
+    if (scheduler.waits_on_swap_chain(now)) {
+        return borderless::FrameClockType::duration::zero();
+    }
+    return scheduler.wait_timeout(now);
+}
+
+void BorderlessWindow::render_frame() {
+    if (recovery_pending && !recover_device()) {
+        return;
+    }
+    try {
+        scheduler.tick([this] { return render_scene(); });
+    } catch (const ComException &error) {
+        handle_device_error(error);
+    }
+}
+
+void BorderlessWindow::handle_device_error(const ComException &error) {
+    if (!device_lost(error.result)) {
+        throw;
+    }
+    recovery_pending = true;
+    recover_device();
+}
+
+void BorderlessWindow::schedule_recovery() {
+    if (render_thread) {
+        // its state is the UI thread's once it has stopped; check_render_thread starts a new one
+        render_thread->stop();
+        render_thread.reset();
+    }
+    recovery_pending = true;
+}
+
+auto BorderlessWindow::recover_device() -> bool {
+    // the first window to notice replaces the shared devices, the others pick up the new ones
+    auto &pool = GraphicsDevices::pool(threaded_rendering);
+    if (pool.generation() == devices_generation) {
+        pool.invalidate();
+    }
+    if (frame_latency_waitable) {
+        // belongs to the lost swap chain; the new one brings its own
+        ::CloseHandle(frame_latency_waitable);
+        frame_latency_waitable = nullptr;
+    }
+    try {
+        BORDERLESS_TRACE_SCOPE(borderless::trace::Event::device_rebuild, static_cast<uint32_t>(resources.size()));
+        resources.rebuild();
+        HR(resources.get(devices)->composition->Commit());
+    } catch (const ComException &error) {
+        if (!device_lost(error.result)) {
+            throw;
+        }
+        // lost again while rebuilding; nothing of it was kept, so the next frame starts over
+        recovery_pending = true;
+        scheduler.request_frame();
+        return false;
+    }
+    recovery_pending = false;
+    ::OutputDebugStringA(borderless::format_resource_stats(resources.stats()).c_str());
+
+    // the new compositor has no cached layers and the new swap chain no pixels: paint everything
+    layer_policy.reset();
+    const auto size = client_size();
+    const borderless::Rect client{0, 0, size.width, size.height};
+    resizer.reset(size);
+    frame_damage.set_surface(client);
+    for (auto &region: layer_damage) {
+        region.set_surface(client);
+    }
+    swap_damage.reset(client);
+    frame_damage.add_all();
+    // commands the render thread did not get to are gone with it
+    scene.set_transform(scene.root(), dpi.transform());
+    // the new root visual starts opaque; a finished fade is applied again
+    if (opacity != 1.0f) {
+        animations.add(borderless::tween(panel_target, borderless::AnimatedProperty::opacity, opacity, opacity,
+                                         std::chrono::milliseconds(0)));
+    }
+    scheduler.request_frame();
+    return true;
+}
+
+auto BorderlessWindow::render_scene() -> bool {
+    using borderless::LayerPlacement;
+    BORDERLESS_TRACE_SCOPE(borderless::trace::Event::render_scene, 0);
+    for (auto &region: layer_damage) {
+        region.clear();
+    }
+    scene.update(layer_damage);
+    for (uint32_t layer = 1; layer < layer_damage.size(); ++layer) {
+        if (!layer_damage[layer].empty()) {
+            BORDERLESS_TRACE_INSTANT(borderless::trace::Event::layer_update, layer);
+        }
+    }
+
+    borderless::layer_samples(scene, layer_damage, layer_runs);
+    const auto &decisions = layer_policy.frame(frame_clock.now(), layer_runs);
+    for (const auto &decision: decisions) {
+        BORDERLESS_TRACE_INSTANT(borderless::trace::Event::layer_change,
+                                 decision.layer << 2 | static_cast<uint32_t>(decision.to));
+    }
+    auto &compositor = resources.get(layers);
+    auto &painter = resources.get(renderer);
+    compositor.update(decisions, layer_policy, frame_damage);
+    compositor.render(scene, layer_damage, resources.get(dc).Get(), painter);
+    if (compositor.take_changes()) {
+        if (threaded_rendering) {
+            HR(compositor.device()->Commit());
+        } else {
+            // the WindowManager commits once for all windows
+            layer_commit = true;
+        }
+    }
+
+    // the swap chain repaints what is left of the scene
+    auto in_swap_chain = [this](uint32_t layer) {
+        return layer_policy.placement(layer) == LayerPlacement::swap_chain;
+    };
+    for (uint32_t layer = 0; layer < layer_damage.size(); ++layer) {
+        if (in_swap_chain(layer)) {
+            frame_damage.add(layer_damage[layer]);
+        }
+    }
+    if (frame_damage.empty()) {
+        return false;
+    }
+    const auto &repaint = swap_damage.begin_frame(frame_damage);
+
+    painter.begin_frame();
+    borderless::paint(scene, repaint, painter, in_swap_chain);
+    painter.end_frame();
+    return true;
+}
+
+auto BorderlessWindow::take_layer_commit() -> bool {
+    const bool commit = layer_commit;
+    layer_commit = false;
+    return commit;
+}
+
+void BorderlessWindow::present_frame() {
+    // tell the composition engine which parts changed since the last present
+    std::vector<RECT> dirty;
+    dirty.reserve(frame_damage.rects().size());
+    for (const auto &rect: frame_damage.rects()) {
+        dirty.push_back(RECT{rect.left, rect.top, rect.right, rect.bottom});
+    }
+    DXGI_PRESENT_PARAMETERS parameters = {};
+    if (!swap_damage.present_all()) {
+        parameters.DirtyRectsCount = static_cast<UINT>(dirty.size());
+        parameters.pDirtyRects = dirty.data();
+    }
+    frame_damage.clear();
+
+    BORDERLESS_TRACE_SCOPE(borderless::trace::Event::present, parameters.DirtyRectsCount);
+    D2DDeviceLock lock(resources.get(dc).Get());
+    HR(resources.get(swapChain)->Present1(1,   // sync
+                                          0,   // flags
+                                          &parameters));
 }
 
 void BorderlessWindow::load_statics() {
-    hIcon = static_cast<HICON>(LoadImage(nullptr, L"../assets/penguin.ico", IMAGE_ICON, 0, 0, LR_LOADFROMFILE));
+    const auto directory = executable_directory();
+    // SM_CXICON is already scaled to the system DPI
+    hIcon = load_packed_icon(directory / L"assets.pack", "penguin.ico", ::GetSystemMetrics(SM_CXICON));
+    if (hIcon == nullptr) {
+        // a build without assets.pack: the loose file, found from the executable rather than the cwd
+        const auto loose = directory / L".." / L"assets" / L"penguin.ico";
+        hIcon = static_cast<HICON>(::LoadImageW(nullptr, loose.c_str(), IMAGE_ICON, 0, 0,
+                                                LR_LOADFROMFILE | LR_DEFAULTSIZE));
+    }
     if (hIcon == nullptr) {
         throw last_error("failed to load icon");
     }
 }
 
- auto BorderlessWindow::RunApp() -> void {
+auto BorderlessWindow::RunApp(bool threaded, int windows, borderless::MessageRecorder *recorder) -> void {
+    BorderlessWindow::recorder = recorder;
     try {
-        BorderlessWindow window;
-
-        MSG msg;
-        while (::GetMessageW(&msg, nullptr, 0, 0) == TRUE) {
-            ::TranslateMessage(&msg);
-            ::DispatchMessageW(&msg);
+        WindowManager manager;
+        for (int i = 0; i < windows; ++i) {
+            // one tray icon for the app; the panels cascade from the first
+            manager.open({threaded, i == 0, {100 + 40 * i, 100 + 40 * i}});
         }
+        manager.run();
     }
     catch (const std::exception& e) {
         ::MessageBoxA(nullptr, e.what(), "Unhandled Exception", MB_OK|MB_ICONERROR);
     }
+    BorderlessWindow::recorder = nullptr;
+}
+
+auto BorderlessWindow::SwapChainPresenter::ready(borderless::FrameClockType::duration timeout) -> bool {
+    if (!window.frame_latency_waitable) {
+        return true;
+    }
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count();
+    return ::WaitForSingleObjectEx(window.frame_latency_waitable, static_cast<DWORD>(ms), TRUE) == WAIT_OBJECT_0;
+}
+
+auto BorderlessWindow::SwapChainPresenter::present() -> void {
+    window.present_frame();
 }
@@ -1,59 +1,301 @@
 ﻿#pragma once
 
 #include "pch.h"
+#include <chrono>
+#include <memory>
+#include <variant>
+
 #include "TrayWindow.h"
+#include "DWriteText.hpp"
+#include "D2DRenderer.hpp"
+#include "GraphicsDevices.hpp"
+#include "LayerCompositor.hpp"
+#include "VisualAnimator.hpp"
+#include "core/Animation.hpp"
+#include "core/Dpi.hpp"
+#include "core/FrameScheduler.hpp"
+#include "core/HitTester.hpp"
+#include "core/LayerPolicy.hpp"
+#include "core/MessageDispatcher.hpp"
+#include "core/MessageRecording.hpp"
+#include "core/RenderThread.hpp"
+#include "core/ResourceRegistry.hpp"
+#include "core/ResizeCoalescer.hpp"
+#include "core/Scene.hpp"
+#include "core/StageGraph.hpp"
+#include "core/Trace.hpp"
+#include "core/WindowMessages.hpp"
 
 
 class BorderlessWindow {
 public:
-    BorderlessWindow();
+    struct Options {
+        bool threaded = false; // draw and present on a dedicated render thread instead of the message loop
+        bool tray = true;      // add the notification area icon and its popup
+        POINT origin = {100, 100};
+    };
+
+    explicit BorderlessWindow(const Options &options);
+
+    explicit BorderlessWindow(bool threaded = false) : BorderlessWindow(Options{threaded}) {}
 
     auto set_borderless(bool enabled) -> void;
 
     auto set_borderless_shadow(bool enabled) -> void;
 
-    HICON hIcon;
+    HICON hIcon = nullptr;
 
-    static auto RunApp() -> void;
+    // the process-wide devices this window renders with, for other windows (the tray popup);
+    // nullptr until startup has acquired them
+    auto shared_devices() const -> std::shared_ptr<GraphicsDevices>;
+
+    // windows: how many borderless panels to open; they share one set of devices. With a recorder,
+    // every message of every panel is appended to it (tools/message_replay replays them)
+    static auto RunApp(bool threaded = false, int windows = 1, borderless::MessageRecorder *recorder = nullptr)
+            -> void;
 
 private:
+    friend class WindowManager;
+
     static auto CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) noexcept -> LRESULT;
 
-    auto hit_test(POINT cursor) const -> LRESULT;
+    using MessageDispatcher = borderless::MessageDispatcher<BorderlessWindow>;
+
+    // handlers for every message WndProc does not leave to DefWindowProcW: WindowMessages, which
+    // tools/message_replay registers for its ReplayWindow too
+    static auto dispatcher() -> MessageDispatcher &;
+
+    friend struct borderless::WindowMessages<BorderlessWindow>;
+
+    // what WindowMessages asks of the window
+    auto is_borderless() const -> bool { return borderless; }
+
+    auto has_composition() const -> bool;
+
+    auto has_shadow() const -> bool { return borderless_shadow; }
+
+    auto target_opacity() const -> float { return opacity; }
+
+    auto hit_tests() -> borderless::HitTester & { return hit_tester; }
+
+    // the maximized window's client area is the monitor's work area
+    void fit_client_area(const borderless::Message &message);
+
+    // to the swap chain: coalesced to a vblank, or posted to the render thread
+    void resize_client(borderless::Size size, bool maximized);
+
+    void flush_resize() { apply_pending_resize(true); }
+
+    // the hit tester re-reads the window rect
+    void moved(borderless::Point) {}
+
+    // the scale, then the suggested rect of WM_DPICHANGED
+    void change_dpi(uint32_t new_dpi, const borderless::Message &message);
+
+    void invalidate_monitors();
+
+    void refresh_capabilities(uint8_t changed);
+
+    void show_tray_popup();
+
+    void prewarm_tray_popup() { trayWindow->prewarm(); }
+
+    void restore() { ::ShowWindow(handle, SW_RESTORE); }
+
+    void close() { ::DestroyWindow(handle); }
+
+    // WM_DESTROY: stops rendering and lets go of the tray icon
+    void destroyed();
+
+    // set by RunApp for --record; UI thread only
+    static inline borderless::MessageRecorder *recorder = nullptr;
+    static inline uint16_t recorded_windows = 0;
+    const uint16_t recording_id = recorded_windows++; // this window in the recording
+
+    auto hit_test(borderless::Point cursor) -> LRESULT;
+
+    auto refresh_hit_tester() -> bool;
 
     bool borderless = true; // is the window currently borderless
-    bool borderless_resize = true; // should the window allow resizing by dragging the borders while borderless
-    bool borderless_drag = true; // should the window allow moving my dragging the client area
     bool borderless_shadow = true; // should the window display a native aero shadow while borderless
 
+    // border metrics, window rect and custom regions for WM_NCHITTEST; also owns the
+    // resize (F9) and drag (F8) toggles
+    borderless::HitTester hit_tester;
+
+    // DPI of the monitor the window is on; the scene is in DIPs and scaled to it
+    borderless::DpiContext dpi;
+    // WM_DPICHANGED is moving the window; with a render thread its scale and WM_SIZE are posted together
+    bool dpi_changing = false;
+
     HWND handle;
 
+    // fades the composition visual to d; the compositor runs the curve
     void set_opacity(float d);
 
 private:
-    ComPtr<ID3D11Device> direct3dDevice;
-    ComPtr<IDXGIDevice> dxgiDevice;
-    ComPtr<IDXGIFactory2> dxFactory;
-    ComPtr<IDXGISwapChain1> swapChain;
-    ComPtr<ID2D1Factory2> d2Factory;
-    ComPtr<ID2D1Device1> d2Device;
-    ComPtr<ID2D1DeviceContext> dc;
-    ComPtr<IDXGISurface2> surface;
-    ComPtr<ID2D1Bitmap1> bitmap;
-    ComPtr<IDCompositionDevice> dcompDevice;
-    ComPtr<IDCompositionTarget> target;
-    ComPtr<IDCompositionVisual> visual;
-    ComPtr<ID2D1SolidColorBrush> brush;
+    // everything created from the devices, with the recipe that creates it, so a lost device is
+    // recovered by rebuilding them all; see declare_resources
+    borderless::ResourceRegistry resources;
+    // borrowed from GraphicsDevices::pool(); released after everything below that was created from it
+    borderless::Resource<std::shared_ptr<GraphicsDevices>> devices;
+    borderless::Resource<ComPtr<IDXGISwapChain1>> swapChain;
+    borderless::Resource<ComPtr<ID2D1DeviceContext>> dc;
+    borderless::Resource<ComPtr<ID2D1Bitmap1>> bitmap; // the back buffer, dc's target
+    borderless::Resource<ComPtr<IDCompositionTarget>> target;
+    // the animated one; holds the swap chain and cached layers
+    borderless::Resource<ComPtr<IDCompositionVisual>> root_visual;
+    borderless::Resource<ComPtr<IDCompositionVisual>> visual;
+    uint64_t devices_generation = 0; // of the pool when devices was acquired
     ComPtr<IDWriteFactory> writeFactory;
+    std::unique_ptr<DWriteTextCache> text_cache;
+
+
+    // creates the window, devices and scene as a stage graph; see startup_report for the timings
+    void startup(const Options &options);
+
+    // records how every device-dependent object is created; startup then materializes them
+    void declare_resources();
+
+    auto create_swap_chain(borderless::Size size) -> ComPtr<IDXGISwapChain1>;
+
+    auto client_size() const -> borderless::Size;
+
+    auto create_device_context() -> ComPtr<ID2D1DeviceContext>;
 
+    void create_composition();
 
-    void init_direct2d();
+    void create_text();
+
+    void init_scene(borderless::Size size);
+
+    bool started = false; // every startup stage has run
+    borderless::StageReport startup_report;
+
+    auto bind_back_buffer() -> ComPtr<ID2D1Bitmap1>;
+
+    void resize_swap_chain(borderless::Size size);
+
+    // applies the latest WM_SIZE if a vblank has passed since the last resize, or right away when flushing;
+    // single-threaded only, the render thread flushes its own
+    void apply_pending_resize(bool flush);
+
+    auto refresh_interval() const -> std::chrono::nanoseconds;
+
+    static constexpr UINT_PTR resize_timer = 1;
+    borderless::ResizeCoalescer resizer;
 
     void draw();
 
-    void set_transparent_window(float d);
+    void build_scene();
+
+    // draws the damaged part of the scene, false when nothing changed
+    auto render_scene() -> bool;
+
+    void present_frame();
+
+    // renders and presents if the scheduler has a frame due and the swap chain is ready
+    void render_frame();
+
+    // after DXGI_ERROR_DEVICE_REMOVED and friends: new devices, every resource rebuilt and a full
+    // repaint. False if the device was lost again meanwhile; recovery_pending stays set and the
+    // next frame tries again
+    auto recover_device() -> bool;
+
+    // called in a catch block: recovers from a lost device, rethrows anything else
+    void handle_device_error(const ComException &error);
+
+    // a lost device reported outside the window's frame, e.g. by the WindowManager's commit: stops
+    // the render thread and recovers on the next tick
+    void schedule_recovery();
+
+    bool recovery_pending = false;
+
+    struct SwapChainPresenter : borderless::FramePresenter {
+        explicit SwapChainPresenter(BorderlessWindow &window) : window(window) {}
+
+        auto ready(borderless::FrameClockType::duration timeout) -> bool override;
+
+        auto present() -> void override;
+
+        BorderlessWindow &window;
+    };
+
+    static constexpr UINT swap_chain_flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+    static constexpr UINT swap_chain_buffers = 2;
+    HANDLE frame_latency_waitable = nullptr; // closed on device loss and on WM_DESTROY
+    borderless::SteadyFrameClock frame_clock;
+    SwapChainPresenter presenter{*this};
+    borderless::FrameScheduler scheduler{frame_clock, presenter};
+
+    // retained content of the client area; only damaged rects are repainted and presented
+    borderless::Scene scene;
+    borderless::NodeId ellipse_node = 0;
+    borderless::DamageRegion frame_damage; // of the swap chain
+    borderless::SwapChainDamage swap_damage;
+    borderless::Resource<D2DRenderer> renderer;
+
+    // scene layers that rarely change are cached in composition surfaces of their own
+    static constexpr uint32_t ellipse_layer = 1;
+    static constexpr uint32_t label_layer = 2;
+    borderless::LayerDamage layer_damage;
+    std::vector<borderless::LayerSample> layer_runs;
+    borderless::LayerPolicy layer_policy;
+    borderless::Resource<LayerCompositor> layers;
+    bool layer_commit = false; // cached layers changed and the device was not committed yet
+
+    // true once after render_scene changed cached layers on the UI thread
+    auto take_layer_commit() -> bool;
+
+    void set_ellipse_alpha(float alpha);
+
+    // pixels per DIP for the whole scene
+    void set_scene_scale(float scale);
+
+    // property animations of the composition visual, ticked on the UI thread by the WindowManager,
+    // which commits the shared composition device once for all windows
+    borderless::Timeline animations{true};
+    borderless::Resource<VisualAnimator> animator;
+    uint32_t panel_target = 0;
+    borderless::PropertyBatch property_changes;
+    float opacity = 1.0f; // where the last opacity animation ends
+
+    // ticks the timeline if it is due and applies its changes; true if the device needs a commit
+    auto animate(borderless::FrameClockType::time_point now) -> bool;
+
+    // state changes the UI thread hands to the render thread, which owns everything that draws
+    struct ResizeCommand {
+        borderless::Size size;
+    };
+    struct EllipseAlphaCommand {
+        float alpha;
+    };
+    struct ScaleCommand {
+        float scale;
+        borderless::Size size{}; // the client size after WM_DPICHANGED, none if empty
+    };
+    using RenderCommand = std::variant<ResizeCommand, EllipseAlphaCommand, ScaleCommand>;
+
+    void execute(RenderCommand &command);
+
+    // one render thread iteration; returns how long the thread may sleep
+    auto render_thread_frame() -> borderless::FrameClockType::duration;
+
+    void start_render_thread();
+
+    // rethrows what ended the render thread; a lost device is recovered here and a new thread started
+    void check_render_thread();
+
+    const bool threaded_rendering;
+
+    bool closed = false; // WM_DESTROY has run; the WindowManager lets go of the window
 
     TrayWindow *trayWindow = nullptr;
 
+    size_t capability_listener = 0; // unsubscribed on WM_DESTROY, the snapshot outlives the window
+
     void load_statics();
+
+    // last member: destroyed (and joined) before the state it renders
+    std::unique_ptr<borderless::RenderThread<RenderCommand>> render_thread;
 };
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "pch.h"
+
+struct ComException {
+    HRESULT result;
+
+    ComException(HRESULT const value) :
+            result(value) {}
+};
+
+inline void HR(HRESULT const result) {
+    if (S_OK != result) {
+        throw ComException(result);
+    }
+}
+
+// the device is gone and everything created from it has to be created again
+inline auto device_lost(HRESULT const result) -> bool {
+    return result == DXGI_ERROR_DEVICE_REMOVED || result == DXGI_ERROR_DEVICE_RESET ||
+           result == D2DERR_RECREATE_TARGET;
+}
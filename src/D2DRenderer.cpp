@@ -0,0 +1,126 @@
+#include "D2DRenderer.hpp"
+#include "ComError.hpp"
+
+namespace {
+    auto to_d2d(const borderless::Color &color) -> const D2D1_COLOR_F & {
+        static_assert(sizeof(borderless::Color) == sizeof(D2D1_COLOR_F), "Color must match D2D1_COLOR_F");
+        return reinterpret_cast<const D2D1_COLOR_F &>(color);
+    }
+}
+
+auto D2DBrushBackend::create_brush(const borderless::BrushKey &key) -> Brush {
+    const auto properties = D2D1::BrushProperties(key.opacity);
+    if (key.kind == borderless::BrushKind::solid) {
+        ComPtr<ID2D1SolidColorBrush> solid;
+        HR(dc->CreateSolidColorBrush(to_d2d(key.color), properties, solid.GetAddressOf()));
+        return solid;
+    }
+    D2D1_GRADIENT_STOP stops[borderless::max_gradient_stops];
+    for (size_t i = 0; i < key.stop_count; ++i) {
+        stops[i] = {key.stops[i].offset, to_d2d(key.stops[i].color)};
+    }
+    ComPtr<ID2D1GradientStopCollection> collection;
+    HR(dc->CreateGradientStopCollection(stops, key.stop_count, collection.GetAddressOf()));
+    ComPtr<ID2D1LinearGradientBrush> linear;
+    HR(dc->CreateLinearGradientBrush(D2D1::LinearGradientBrushProperties(D2D1::Point2F(key.start.x, key.start.y),
+                                                                         D2D1::Point2F(key.end.x, key.end.y)),
+                                     properties, collection.Get(), linear.GetAddressOf()));
+    return linear;
+}
+
+D2DRenderer::D2DRenderer(ComPtr<ID2D1DeviceContext> dc, DWriteTextCache &text_cache) :
+        dc(dc),
+        brushes(D2DBrushBackend{std::move(dc)}),
+        text_cache(text_cache) {}
+
+auto D2DRenderer::add_image(ComPtr<ID2D1Bitmap> image) -> uint32_t {
+    images.push_back(std::move(image));
+    return static_cast<uint32_t>(images.size() - 1);
+}
+
+auto D2DRenderer::set_offset(borderless::Point o) -> void {
+    offset = o;
+}
+
+auto D2DRenderer::begin_frame() -> void {
+    brushes.begin_frame();
+    dc->BeginDraw();
+    set_transform({});
+}
+
+auto D2DRenderer::end_frame() -> void {
+    HR(dc->EndDraw());
+}
+
+auto D2DRenderer::push_clip(const borderless::Rect &clip) -> void {
+    // clips are in device space, the current transform would apply to them
+    dc->SetTransform(offset_transform());
+    dc->PushAxisAlignedClip(D2D1::RectF(static_cast<float>(clip.left), static_cast<float>(clip.top),
+                                        static_cast<float>(clip.right), static_cast<float>(clip.bottom)),
+                            D2D1_ANTIALIAS_MODE_ALIASED);
+    dc->SetTransform(transform);
+}
+
+auto D2DRenderer::pop_clip() -> void {
+    dc->PopAxisAlignedClip();
+}
+
+auto D2DRenderer::set_transform(const borderless::Transform &t) -> void {
+    static_assert(sizeof(borderless::Transform) == sizeof(D2D1_MATRIX_3X2_F), "Transform must match D2D1_MATRIX_3X2_F");
+    transform = reinterpret_cast<const D2D1_MATRIX_3X2_F &>(t);
+    transform._31 += static_cast<float>(offset.x);
+    transform._32 += static_cast<float>(offset.y);
+    dc->SetTransform(transform);
+}
+
+auto D2DRenderer::clear(const borderless::Color &color) -> void {
+    dc->Clear(to_d2d(color));
+}
+
+auto D2DRenderer::fill_rect(const borderless::RectF &rect, const borderless::Color &color) -> void {
+    dc->FillRectangle(D2D1::RectF(rect.left, rect.top, rect.right, rect.bottom), brush_for(color));
+}
+
+auto D2DRenderer::fill_ellipse(borderless::PointF center, float radius_x, float radius_y,
+                               const borderless::Color &color) -> void {
+    dc->FillEllipse(D2D1::Ellipse(D2D1::Point2F(center.x, center.y), radius_x, radius_y), brush_for(color));
+}
+
+auto D2DRenderer::draw_mask(const borderless::AlphaMask &mask, borderless::Point origin,
+                            const borderless::Color &color) -> void {
+    ComPtr<ID2D1Bitmap> bitmap;
+    HR(dc->CreateBitmap(D2D1::SizeU(static_cast<UINT32>(mask.width), static_cast<UINT32>(mask.height)),
+                        mask.pixels, static_cast<UINT32>(mask.stride),
+                        D2D1::BitmapProperties(D2D1::PixelFormat(DXGI_FORMAT_A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED)),
+                        bitmap.GetAddressOf()));
+
+    // FillOpacityMask requires aliased rendering
+    const auto mode = dc->GetAntialiasMode();
+    dc->SetAntialiasMode(D2D1_ANTIALIAS_MODE_ALIASED);
+    dc->SetTransform(offset_transform());
+    const auto destination = D2D1::RectF(static_cast<float>(origin.x), static_cast<float>(origin.y),
+                                         static_cast<float>(origin.x + mask.width),
+                                         static_cast<float>(origin.y + mask.height));
+    dc->FillOpacityMask(bitmap.Get(), brush_for(color), D2D1_OPACITY_MASK_CONTENT_GRAPHICS, &destination, nullptr);
+    dc->SetTransform(transform);
+    dc->SetAntialiasMode(mode);
+}
+
+auto D2DRenderer::draw_text(const borderless::TextLayoutKey &layout, borderless::PointF origin,
+                            const borderless::Color &color) -> void {
+    // layout is cached, so steady-state frames allocate nothing for text; clipped to the layout box,
+    // which is what the scene damages for it
+    dc->DrawTextLayout(D2D1::Point2F(origin.x, origin.y), text_cache.layout(layout).Get(), brush_for(color),
+                       D2D1_DRAW_TEXT_OPTIONS_CLIP);
+}
+
+auto D2DRenderer::draw_image(uint32_t image, const borderless::RectF &d, float opacity) -> void {
+    if (image < images.size()) {
+        dc->DrawBitmap(images[image].Get(), D2D1::RectF(d.left, d.top, d.right, d.bottom), opacity);
+    }
+}
+
+auto D2DRenderer::brush_for(const borderless::Color &color) -> ID2D1Brush * {
+    // one immutable brush per color, so consecutive draws in different colors change no brush state
+    return brushes.solid(color).Get();
+}
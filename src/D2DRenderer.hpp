@@ -0,0 +1,100 @@
+#pragma once
+
+#include <vector>
+
+#include "pch.h"
+#include "DWriteText.hpp"
+#include "core/BrushCache.hpp"
+#include "core/Renderer.hpp"
+
+// Direct2D brushes behind borderless::BrushCache
+struct D2DBrushBackend {
+    using Brush = ComPtr<ID2D1Brush>;
+
+    ComPtr<ID2D1DeviceContext> dc;
+
+    auto create_brush(const borderless::BrushKey &key) -> Brush;
+};
+
+using D2DBrushCache = borderless::BrushCache<D2DBrushBackend>;
+
+// borderless::Renderer on top of a Direct2D device context
+class D2DRenderer : public borderless::Renderer {
+public:
+    D2DRenderer(ComPtr<ID2D1DeviceContext> dc, DWriteTextCache &text_cache);
+
+    auto add_image(ComPtr<ID2D1Bitmap> image) -> uint32_t;
+
+    // target pixels are scene pixels moved by offset, e.g. to draw a layer into a composition surface
+    auto set_offset(borderless::Point offset) -> void;
+
+    auto begin_frame() -> void override;
+
+    auto end_frame() -> void override;
+
+    auto push_clip(const borderless::Rect &clip) -> void override;
+
+    auto pop_clip() -> void override;
+
+    auto set_transform(const borderless::Transform &transform) -> void override;
+
+    auto clear(const borderless::Color &color) -> void override;
+
+    auto fill_rect(const borderless::RectF &rect, const borderless::Color &color) -> void override;
+
+    auto fill_ellipse(borderless::PointF center, float radius_x, float radius_y,
+                      const borderless::Color &color) -> void override;
+
+    auto draw_mask(const borderless::AlphaMask &mask, borderless::Point origin,
+                   const borderless::Color &color) -> void override;
+
+    auto draw_text(const borderless::TextLayoutKey &layout, borderless::PointF origin,
+                   const borderless::Color &color) -> void override;
+
+    auto draw_image(uint32_t image, const borderless::RectF &destination, float opacity) -> void override;
+
+    auto brush_stats() const -> const borderless::BrushCacheStats & { return brushes.stats(); }
+
+private:
+    auto brush_for(const borderless::Color &color) -> ID2D1Brush *;
+
+    ComPtr<ID2D1DeviceContext> dc;
+    D2DBrushCache brushes;
+    DWriteTextCache &text_cache;
+    std::vector<ComPtr<ID2D1Bitmap>> images;
+    D2D1_MATRIX_3X2_F transform = D2D1::Matrix3x2F::Identity();
+    borderless::Point offset{};
+
+    auto offset_transform() const -> D2D1_MATRIX_3X2_F {
+        return D2D1::Matrix3x2F::Translation(static_cast<float>(offset.x), static_cast<float>(offset.y));
+    }
+};
+
+// the factory lock of a multithreaded D2D factory, held around direct D3D/DXGI calls (Present,
+// ResizeBuffers) that D2D does not serialize; windows sharing a device may draw on two threads.
+// Does nothing for a single-threaded factory
+class D2DDeviceLock {
+public:
+    explicit D2DDeviceLock(ID2D1Resource *resource) {
+        ComPtr<ID2D1Factory> factory;
+        resource->GetFactory(factory.GetAddressOf());
+        if (SUCCEEDED(factory.As(&lock)) && lock->GetMultithreadProtected()) {
+            lock->Enter();
+        } else {
+            lock.Reset();
+        }
+    }
+
+    ~D2DDeviceLock() {
+        if (lock) {
+            lock->Leave();
+        }
+    }
+
+    D2DDeviceLock(const D2DDeviceLock &) = delete;
+
+    auto operator=(const D2DDeviceLock &) -> D2DDeviceLock & = delete;
+
+private:
+    ComPtr<ID2D1Multithread> lock;
+};
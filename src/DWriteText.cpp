@@ -0,0 +1,30 @@
+#include "DWriteText.hpp"
+#include "ComError.hpp"
+
+auto DWriteTextBackend::create_format(const borderless::TextFormatKey &key) -> Format {
+    Format format;
+    HR(factory->CreateTextFormat(
+            key.family.c_str(),
+            nullptr,  // font collection
+            static_cast<DWRITE_FONT_WEIGHT>(key.weight),
+            DWRITE_FONT_STYLE_NORMAL,
+            DWRITE_FONT_STRETCH_NORMAL,
+            key.size,
+            key.locale.c_str(),
+            format.GetAddressOf()
+    ));
+    return format;
+}
+
+auto DWriteTextBackend::create_layout(const Format &format, const borderless::TextLayoutKey &key) -> Layout {
+    Layout layout;
+    HR(factory->CreateTextLayout(
+            key.text.c_str(),
+            static_cast<UINT32>(key.text.size()),
+            format.Get(),
+            key.max_width,
+            key.max_height,
+            layout.GetAddressOf()
+    ));
+    return layout;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "pch.h"
+#include "core/TextCache.hpp"
+
+// DirectWrite objects behind borderless::TextCache
+struct DWriteTextBackend {
+    using Format = ComPtr<IDWriteTextFormat>;
+    using Layout = ComPtr<IDWriteTextLayout>;
+
+    ComPtr<IDWriteFactory> factory;
+
+    auto create_format(const borderless::TextFormatKey &key) -> Format;
+
+    auto create_layout(const Format &format, const borderless::TextLayoutKey &key) -> Layout;
+};
+
+using DWriteTextCache = borderless::TextCache<DWriteTextBackend>;
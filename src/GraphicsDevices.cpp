@@ -0,0 +1,49 @@
+#include "GraphicsDevices.hpp"
+#include "ComError.hpp"
+
+auto GraphicsDevices::create(bool multithreaded) -> std::unique_ptr<GraphicsDevices> {
+    auto devices = std::make_unique<GraphicsDevices>();
+    auto create_device = [&](D3D_DRIVER_TYPE type) {
+        return D3D11CreateDevice(nullptr,    // Adapter
+                                 type,
+                                 nullptr,    // Module
+                                 D3D11_CREATE_DEVICE_BGRA_SUPPORT,
+                                 nullptr, 0, // Highest available feature level
+                                 D3D11_SDK_VERSION,
+                                 &devices->d3d,
+                                 nullptr,    // Actual feature level
+                                 nullptr);   // Device context
+    };
+    // GPU-less machines (VMs, CI) get the WARP software rasterizer
+    if (FAILED(create_device(D3D_DRIVER_TYPE_HARDWARE))) {
+        HR(create_device(D3D_DRIVER_TYPE_WARP));
+    }
+
+    HR(devices->d3d.As(&devices->dxgi));
+
+    HR(CreateDXGIFactory2(
+            DXGI_CREATE_FACTORY_DEBUG,
+            __uuidof(devices->factory),
+            reinterpret_cast<void **>(devices->factory.GetAddressOf())));
+
+    // Create a Direct2D factory with debugging information
+    D2D1_FACTORY_OPTIONS const options = {D2D1_DEBUG_LEVEL_INFORMATION};
+    HR(D2D1CreateFactory(multithreaded ? D2D1_FACTORY_TYPE_MULTI_THREADED : D2D1_FACTORY_TYPE_SINGLE_THREADED,
+                         options,
+                         devices->d2d_factory.GetAddressOf()));
+    // Create the Direct2D device that links back to the Direct3D device
+    HR(devices->d2d_factory->CreateDevice(devices->dxgi.Get(),
+                                          devices->d2d.GetAddressOf()));
+
+    HR(DCompositionCreateDevice(
+            devices->dxgi.Get(),
+            __uuidof(devices->composition),
+            reinterpret_cast<void **>(devices->composition.GetAddressOf())));
+    return devices;
+}
+
+auto GraphicsDevices::pool(bool multithreaded) -> borderless::SharedPool<GraphicsDevices> & {
+    static borderless::SharedPool<GraphicsDevices> single_threaded([] { return create(false); });
+    static borderless::SharedPool<GraphicsDevices> multi_threaded([] { return create(true); });
+    return multithreaded ? multi_threaded : single_threaded;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <memory>
+
+#include "pch.h"
+#include "core/SharedPool.hpp"
+
+// the devices and factories every window of the process renders with; a window only creates its
+// own swap chain, device context and composition target and visual from them
+struct GraphicsDevices {
+    ComPtr<ID3D11Device> d3d;
+    ComPtr<IDXGIDevice> dxgi;
+    ComPtr<IDXGIFactory2> factory;
+    ComPtr<ID2D1Factory2> d2d_factory;
+    ComPtr<ID2D1Device1> d2d;
+    ComPtr<IDCompositionDevice> composition;
+
+    // multithreaded: a D2D factory that serializes access, for windows drawing on a render thread
+    static auto create(bool multithreaded) -> std::unique_ptr<GraphicsDevices>;
+
+    // the process-wide set; windows with and without a render thread get separate ones
+    static auto pool(bool multithreaded) -> borderless::SharedPool<GraphicsDevices> &;
+};
@@ -0,0 +1,144 @@
+#include "LayerCompositor.hpp"
+#include "ComError.hpp"
+
+LayerCompositor::LayerCompositor(ComPtr<IDCompositionDevice> device, ComPtr<IDCompositionVisual> root,
+                                 ComPtr<IDCompositionVisual> swap_chain_visual) :
+        composition(std::move(device)),
+        root(std::move(root)),
+        swap_chain_visual(std::move(swap_chain_visual)) {}
+
+auto LayerCompositor::update(const std::vector<borderless::LayerDecision> &decisions,
+                             const borderless::LayerPolicy &policy,
+                             borderless::DamageRegion &swap_chain_damage) -> void {
+    using borderless::LayerPlacement;
+    for (const auto &decision: decisions) {
+        if (decision.to == LayerPlacement::swap_chain) {
+            // the swap chain takes the layer back, wherever it is now
+            auto it = layers.find(decision.layer);
+            if (it != layers.end()) {
+                swap_chain_damage.add(it->second.bounds);
+                layers.erase(it);
+            }
+            swap_chain_damage.add(policy.bounds(decision.layer));
+        } else if (decision.from == LayerPlacement::swap_chain) {
+            // and clears what moves into a surface
+            Layer layer;
+            HR(composition->CreateVisual(layer.visual.GetAddressOf()));
+            layers.emplace(decision.layer, std::move(layer));
+            swap_chain_damage.add(policy.bounds(decision.layer));
+        }
+    }
+
+    // a surface follows its layer's size; it is repainted in full when that changes. The policy's
+    // bounds are the scene's, which cover every pixel the layer draws (text included, it is clipped
+    // to its box), so nothing is cropped when a layer moves out of the swap chain
+    for (auto &[id, layer]: layers) {
+        const auto bounds = policy.bounds(id);
+        if (bounds.width() != layer.bounds.width() || bounds.height() != layer.bounds.height()) {
+            layer.surface.Reset();
+            layer.painted = false;
+            if (!bounds.empty()) {
+                HR(composition->CreateSurface(static_cast<UINT>(bounds.width()), static_cast<UINT>(bounds.height()),
+                                              DXGI_FORMAT_B8G8R8A8_UNORM, DXGI_ALPHA_MODE_PREMULTIPLIED,
+                                              layer.surface.GetAddressOf()));
+            }
+            HR(layer.visual->SetContent(layer.surface.Get()));
+            changed = true;
+        } else if (bounds.left != layer.bounds.left || bounds.top != layer.bounds.top) {
+            layer.painted = false;
+        }
+        if (bounds != layer.bounds) {
+            HR(layer.visual->SetOffsetX(static_cast<float>(bounds.left)));
+            HR(layer.visual->SetOffsetY(static_cast<float>(bounds.top)));
+            layer.bounds = bounds;
+            changed = true;
+        }
+    }
+
+    const auto stacking = policy.stacking();
+    if (stacking != stacked) {
+        restack(stacking, policy);
+    }
+}
+
+auto LayerCompositor::restack(const std::vector<uint32_t> &stacking, const borderless::LayerPolicy &policy) -> void {
+    HR(root->RemoveAllVisuals());
+    // AddVisual(visual, TRUE, nullptr) puts the visual on top of its siblings
+    bool swap_chain_added = false;
+    for (const auto id: stacking) {
+        if (!swap_chain_added && policy.placement(id) == borderless::LayerPlacement::above) {
+            HR(root->AddVisual(swap_chain_visual.Get(), TRUE, nullptr));
+            swap_chain_added = true;
+        }
+        HR(root->AddVisual(layers.at(id).visual.Get(), TRUE, nullptr));
+    }
+    if (!swap_chain_added) {
+        HR(root->AddVisual(swap_chain_visual.Get(), TRUE, nullptr));
+    }
+    stacked = stacking;
+    changed = true;
+}
+
+auto LayerCompositor::render(const borderless::Scene &scene, const borderless::LayerDamage &damage,
+                             ID2D1DeviceContext *dc, D2DRenderer &renderer) -> void {
+    ComPtr<ID2D1Image> swap_chain_target;
+    bool drew = false;
+    for (auto &[id, layer]: layers) {
+        if (!layer.surface) {
+            continue;
+        }
+        // one update rect per surface; DirectComposition keeps everything outside it
+        auto update = layer.bounds;
+        if (layer.painted) {
+            if (id >= damage.size() || !damage[id].intersects(layer.bounds)) {
+                continue;
+            }
+            update = borderless::intersect(damage[id].bounds(), layer.bounds);
+        }
+        if (!drew) {
+            dc->GetTarget(swap_chain_target.GetAddressOf());
+            drew = true;
+        }
+        paint(id, layer, scene, update, dc, renderer);
+        layer.painted = true;
+        changed = true;
+    }
+    if (drew) {
+        dc->SetTarget(swap_chain_target.Get());
+        renderer.set_offset({});
+    }
+}
+
+auto LayerCompositor::paint(uint32_t id, Layer &layer, const borderless::Scene &scene,
+                            const borderless::Rect &update, ID2D1DeviceContext *dc, D2DRenderer &renderer) -> void {
+    const RECT local = {update.left - layer.bounds.left, update.top - layer.bounds.top,
+                        update.right - layer.bounds.left, update.bottom - layer.bounds.top};
+    ComPtr<IDXGISurface> pixels;
+    POINT offset = {};
+    HR(layer.surface->BeginDraw(&local, __uuidof(pixels), reinterpret_cast<void **>(pixels.GetAddressOf()), &offset));
+
+    D2D1_BITMAP_PROPERTIES1 properties = {};
+    properties.pixelFormat.alphaMode = D2D1_ALPHA_MODE_PREMULTIPLIED;
+    properties.pixelFormat.format = DXGI_FORMAT_B8G8R8A8_UNORM;
+    properties.bitmapOptions = D2D1_BITMAP_OPTIONS_TARGET | D2D1_BITMAP_OPTIONS_CANNOT_DRAW;
+    ComPtr<ID2D1Bitmap1> target;
+    HR(dc->CreateBitmapFromDxgiSurface(pixels.Get(), properties, target.GetAddressOf()));
+    dc->SetTarget(target.Get());
+
+    // offset is where the update rect starts in the surface, which may be part of an atlas
+    renderer.set_offset({offset.x - update.left, offset.y - update.top});
+    borderless::DamageRegion region;
+    region.add(update);
+    renderer.begin_frame();
+    borderless::paint(scene, region, renderer, [id](uint32_t layer) { return layer == id; });
+    renderer.end_frame();
+
+    dc->SetTarget(nullptr);
+    HR(layer.surface->EndDraw());
+}
+
+auto LayerCompositor::take_changes() -> bool {
+    const bool result = changed;
+    changed = false;
+    return result;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "pch.h"
+#include "D2DRenderer.hpp"
+#include "core/LayerPolicy.hpp"
+#include "core/Scene.hpp"
+
+/* Gives the scene layers borderless::LayerPolicy caches a DirectComposition surface and visual of
+ * their own. Under the window's root visual sit, bottom to top, the layers placed below the swap
+ * chain, the swap chain visual and the layers placed above it. A cached layer is only painted when
+ * its own damage touches it, everything else keeps going through the swap chain.
+ * Nothing is committed here; take_changes() says when the device needs a commit.
+ */
+class LayerCompositor {
+public:
+    LayerCompositor(ComPtr<IDCompositionDevice> device, ComPtr<IDCompositionVisual> root,
+                    ComPtr<IDCompositionVisual> swap_chain_visual);
+
+    // follows the policy's decisions of this frame; pixels that move into or out of the swap chain
+    // are added to swap_chain_damage
+    auto update(const std::vector<borderless::LayerDecision> &decisions, const borderless::LayerPolicy &policy,
+                borderless::DamageRegion &swap_chain_damage) -> void;
+
+    // repaints the damaged part of every cached layer; dc's target is restored afterwards
+    auto render(const borderless::Scene &scene, const borderless::LayerDamage &damage, ID2D1DeviceContext *dc,
+                D2DRenderer &renderer) -> void;
+
+    // true once after visuals or surfaces changed
+    auto take_changes() -> bool;
+
+    auto device() const -> IDCompositionDevice * { return composition.Get(); }
+
+private:
+    struct Layer {
+        ComPtr<IDCompositionVisual> visual;
+        ComPtr<IDCompositionSurface> surface;
+        borderless::Rect bounds{};      // in window pixels, the size of surface
+        bool painted = false;           // surface holds the whole layer
+    };
+
+    auto restack(const std::vector<uint32_t> &stacking, const borderless::LayerPolicy &policy) -> void;
+
+    auto paint(uint32_t id, Layer &layer, const borderless::Scene &scene, const borderless::Rect &update,
+               ID2D1DeviceContext *dc, D2DRenderer &renderer) -> void;
+
+    ComPtr<IDCompositionDevice> composition;
+    ComPtr<IDCompositionVisual> root;
+    ComPtr<IDCompositionVisual> swap_chain_visual;
+    std::map<uint32_t, Layer> layers;
+    std::vector<uint32_t> stacked; // bottom to top, as the visuals are under root
+    bool changed = false;
+};
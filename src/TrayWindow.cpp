@@ -5,11 +5,13 @@
 #include "TrayWindow.h"
 #include "pch.h"
 #include "BorderlessWindow.hpp"
+#include "ComError.hpp"
+#include "D2DRenderer.hpp"
 
 TrayWindow::TrayWindow(HWND parent, void *userdata) {
-    parent = parent;
+    this->parent = parent;
 
-    auto window = static_cast<BorderlessWindow *>(userdata);
+    window = static_cast<BorderlessWindow *>(userdata);
     // create trayicon
     ZeroMemory(&nid, sizeof(NOTIFYICONDATA));
     nid.cbSize = sizeof(NOTIFYICONDATA);
@@ -23,48 +25,194 @@ TrayWindow::TrayWindow(HWND parent, void *userdata) {
     Shell_NotifyIcon(NIM_ADD, &nid);
 }
 
+TrayWindow::~TrayWindow() {
+    if (hwnd) {
+        ::DestroyWindow(hwnd);
+    }
+    Shell_NotifyIcon(NIM_DELETE, &nid);
+    hwnd = nullptr;
+    parent = nullptr;
+}
+
+void TrayWindow::prewarm() {
+    if (state.prewarm() && create_popup()) {
+        state.created();
+    }
+}
+
 void TrayWindow::showTrayWindowAt(LPPOINT point) {
-    // Register the window class if it's not already registered
-    WNDCLASS wc = { 0 };
-    wc.lpfnWndProc = &TrayWindow::WndProc;
-    wc.hInstance = nullptr;
-    wc.hbrBackground = (HBRUSH)(COLOR_WINDOW + 1);
-    wc.lpszClassName = L"TrayWindowClass"; // Changed window class name
-    if (!GetClassInfo(NULL, wc.lpszClassName, &wc)) {
-        RegisterClass(&wc);
+    const auto clicked = borderless::TrayPopupState::Clock::now();
+    if (state.show(clicked)) {
+        if (!create_popup()) {
+            state.destroyed();
+            MessageBox(nullptr, L"Window Creation Failed!", L"Error", MB_ICONERROR | MB_OK);
+            return;
+        }
+        state.created();
+    } else if (!dc || devices != window->shared_devices()) {
+        // created before startup had devices, or they were lost and replaced since
+        attach_surface();
     }
 
-    // Create the window
-    hwnd = CreateWindowEx(
-            0,
-            wc.lpszClassName, // Use the registered window class name
+    // on the monitor that was clicked, inside its work area
+    MONITORINFO monitor = {};
+    monitor.cbSize = sizeof(monitor);
+    ::GetMonitorInfoW(::MonitorFromPoint(*point, MONITOR_DEFAULTTONEAREST), &monitor);
+    const auto origin = borderless::popup_origin(
+            {point->x, point->y}, {popup_width, popup_height},
+            {monitor.rcWork.left, monitor.rcWork.top, monitor.rcWork.right, monitor.rcWork.bottom});
+
+    // the content was presented when the popup was created, showing it is a move and a flag
+    ::SetWindowPos(hwnd, HWND_TOPMOST, origin.x, origin.y, 0, 0, SWP_NOSIZE | SWP_SHOWWINDOW);
+    SetForegroundWindow(hwnd);
+    // up to the point DWM has it; it appears with the next composition pass
+    state.visible(borderless::TrayPopupState::Clock::now());
+}
+
+void TrayWindow::hide() {
+    if (state.hide()) {
+        ::ShowWindow(hwnd, SW_HIDE);
+    }
+}
+
+auto TrayWindow::create_popup() -> bool {
+    static const wchar_t *class_name = [] {
+        WNDCLASSW wc = {0};
+        wc.lpfnWndProc = &TrayWindow::WndProc;
+        wc.hInstance = nullptr;
+        wc.hbrBackground = (HBRUSH) (COLOR_WINDOW + 1);
+        wc.hCursor = ::LoadCursorW(nullptr, IDC_ARROW);
+        wc.lpszClassName = L"TrayWindowClass";
+        RegisterClassW(&wc);
+        return wc.lpszClassName;
+    }();
+
+    // a tool window has no task bar button; unowned, so it also opens while the main window is minimized
+    hwnd = CreateWindowExW(
+            WS_EX_TOOLWINDOW | WS_EX_TOPMOST,
+            class_name,
             L"TrayWindow",
-            WS_OVERLAPPEDWINDOW,
-            point->x-100, point->y-400,
-            200, 400,
-            parent,
+            WS_POPUP | WS_BORDER,
+            0, 0,
+            popup_width, popup_height,
             nullptr,
             nullptr,
-            nullptr);
-
+            nullptr,
+            this);
     if (hwnd == NULL) {
-        MessageBox(nullptr, L"Window Creation Failed!", L"Error", MB_ICONERROR | MB_OK);
+        return false;
+    }
+
+    attach_surface();
+    return true;
+}
+
+void TrayWindow::attach_surface() {
+    release_popup();
+    try {
+        create_surface();
+        render_popup();
+    } catch (const ComException &) {
+        // without a device the class background still paints it
+        release_popup();
+    }
+}
+
+void TrayWindow::create_surface() {
+    devices = window->shared_devices();
+    if (!devices) {
         return;
     }
 
-    // Show the window
-    ShowWindow(hwnd, SW_SHOW);
-    UpdateWindow(hwnd);
-    SetForegroundWindow(hwnd);
+    DXGI_SWAP_CHAIN_DESC1 description = {};
+    description.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+    description.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+    description.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL;
+    description.BufferCount = 2;
+    description.SampleDesc.Count = 1;
+    description.AlphaMode = DXGI_ALPHA_MODE_IGNORE;
+    description.Width = popup_width;
+    description.Height = popup_height;
+    HR(devices->factory->CreateSwapChainForComposition(devices->dxgi.Get(), &description, nullptr,
+                                                       swapChain.GetAddressOf()));
+
+    // a context of its own: the main window's may be in use on the render thread
+    HR(devices->d2d->CreateDeviceContext(D2D1_DEVICE_CONTEXT_OPTIONS_NONE, dc.GetAddressOf()));
+    ComPtr<IDXGISurface2> surface;
+    HR(swapChain->GetBuffer(0, __uuidof(surface), reinterpret_cast<void **>(surface.GetAddressOf())));
+    D2D1_BITMAP_PROPERTIES1 properties = {};
+    properties.pixelFormat.alphaMode = D2D1_ALPHA_MODE_IGNORE;
+    properties.pixelFormat.format = DXGI_FORMAT_B8G8R8A8_UNORM;
+    properties.bitmapOptions = D2D1_BITMAP_OPTIONS_TARGET | D2D1_BITMAP_OPTIONS_CANNOT_DRAW;
+    HR(dc->CreateBitmapFromDxgiSurface(surface.Get(), properties, bitmap.GetAddressOf()));
+    dc->SetTarget(bitmap.Get());
+
+    HR(devices->composition->CreateTargetForHwnd(hwnd, true, target.GetAddressOf()));
+    HR(devices->composition->CreateVisual(visual.GetAddressOf()));
+    HR(visual->SetContent(swapChain.Get()));
+    HR(target->SetRoot(visual.Get()));
+    HR(devices->composition->Commit());
+}
+
+void TrayWindow::render_popup() {
+    if (!dc) {
+        return;
+    }
+    dc->BeginDraw();
+    dc->Clear(D2D1::ColorF(0.97f, 0.97f, 0.98f));
+    ComPtr<ID2D1SolidColorBrush> accent;
+    HR(dc->CreateSolidColorBrush(D2D1::ColorF(0.18f, 0.55f, 0.34f), accent.GetAddressOf()));
+    dc->FillRectangle(D2D1::RectF(0.0f, 0.0f, static_cast<float>(popup_width), 4.0f), accent.Get());
+    HR(dc->EndDraw());
+    D2DDeviceLock lock(dc.Get());
+    HR(swapChain->Present(1, 0));
+}
+
+void TrayWindow::release_popup() {
+    visual.Reset();
+    target.Reset();
+    if (dc) {
+        dc->SetTarget(nullptr);
+    }
+    bitmap.Reset();
+    dc.Reset();
+    swapChain.Reset();
+    devices.reset();
 }
 
 auto TrayWindow::WndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) noexcept -> LRESULT {
+    if (msg == WM_NCCREATE) {
+        auto userdata = reinterpret_cast<CREATESTRUCTW *>(lparam)->lpCreateParams;
+        ::SetWindowLongPtrW(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(userdata));
+    }
+    auto tray = reinterpret_cast<TrayWindow *>(::GetWindowLongPtrW(hwnd, GWLP_USERDATA));
+    if (!tray) {
+        return DefWindowProc(hwnd, msg, wparam, lparam);
+    }
     switch (msg) {
+        case WM_ACTIVATE:
+            // like the shell's own flyouts: clicking anywhere else dismisses it
+            if (LOWORD(wparam) == WA_INACTIVE) {
+                tray->hide();
+            }
+            break;
+        case WM_KEYDOWN:
+            if (wparam == VK_ESCAPE) {
+                tray->hide();
+                return 0;
+            }
+            break;
+        case WM_CLOSE:
+            // pooled: hidden, not destroyed
+            tray->hide();
+            return 0;
         case WM_DESTROY:
-            PostQuitMessage(0);
+            tray->release_popup();
+            tray->state.destroyed();
+            tray->hwnd = nullptr;
             break;
         default:
-            return DefWindowProc(hwnd, msg, wparam, lparam);
+            break;
     }
-    return 0;
+    return DefWindowProc(hwnd, msg, wparam, lparam);
 }
@@ -6,19 +6,51 @@
 #define BORDERLESSWINDOW_TRAYWINDOW_H
 
 #include "pch.h"
+#include "GraphicsDevices.hpp"
+#include "core/TrayPopup.hpp"
+
+class BorderlessWindow;
+
 class TrayWindow {
 public:
     NOTIFYICONDATA nid;
-    HWND hwnd= nullptr;
+    HWND hwnd= nullptr; // the popup; created once, then only shown and hidden
     HWND parent= nullptr;
     explicit TrayWindow(HWND parent,void* userdata);
+    // creates the popup hidden, so the first click only has to show it
+    void prewarm();
     void showTrayWindowAt(LPPOINT point);
+    void hide();
+    auto stats() const -> const borderless::TrayPopupStats & { return state.stats(); }
     static auto CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) noexcept -> LRESULT;
 
-    ~TrayWindow(){
-        hwnd= nullptr;
-        parent= nullptr;
-    }
+    ~TrayWindow();
+
+private:
+    static constexpr int popup_width = 200;
+    static constexpr int popup_height = 400;
+
+    auto create_popup() -> bool;
+
+    // a swap chain and device context of the popup's own on the main window's devices
+    void create_surface();
+
+    // (re)creates the surface on the main window's current devices and presents the content
+    void attach_surface();
+
+    void render_popup();
+
+    void release_popup();
+
+    BorderlessWindow *window = nullptr;
+    borderless::TrayPopupState state;
+
+    std::shared_ptr<GraphicsDevices> devices; // the main window's
+    ComPtr<IDXGISwapChain1> swapChain;
+    ComPtr<ID2D1DeviceContext> dc;
+    ComPtr<ID2D1Bitmap1> bitmap;
+    ComPtr<IDCompositionTarget> target;
+    ComPtr<IDCompositionVisual> visual;
 };
 
 
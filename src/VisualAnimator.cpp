@@ -0,0 +1,81 @@
+#include "VisualAnimator.hpp"
+#include "ComError.hpp"
+
+VisualAnimator::VisualAnimator(ComPtr<IDCompositionDevice> device) :
+        composition(std::move(device)) {}
+
+auto VisualAnimator::add_target(ComPtr<IDCompositionVisual> visual) -> uint32_t {
+    Target target{std::move(visual)};
+    HR(composition->CreateEffectGroup(target.effects.GetAddressOf()));
+    HR(composition->CreateScaleTransform(target.scale.GetAddressOf()));
+    HR(target.visual->SetEffect(target.effects.Get()));
+    HR(target.visual->SetTransform(target.scale.Get()));
+    targets.push_back(std::move(target));
+    return static_cast<uint32_t>(targets.size() - 1);
+}
+
+auto VisualAnimator::apply(const borderless::PropertyBatch &batch) -> bool {
+    using borderless::AnimatedProperty;
+    bool changed = false;
+    for (const auto &change: batch) {
+        if (change.target >= targets.size()) {
+            continue;
+        }
+        const auto &target = targets[change.target];
+        // every DComp setter has an overload for a static value and one for an animation
+        switch (change.property) {
+            case AnimatedProperty::opacity:
+                if (change.curve) {
+                    HR(target.effects->SetOpacity(create_animation(*change.curve).Get()));
+                } else {
+                    HR(target.effects->SetOpacity(change.value));
+                }
+                break;
+            case AnimatedProperty::offset_x:
+                if (change.curve) {
+                    HR(target.visual->SetOffsetX(create_animation(*change.curve).Get()));
+                } else {
+                    HR(target.visual->SetOffsetX(change.value));
+                }
+                break;
+            case AnimatedProperty::offset_y:
+                if (change.curve) {
+                    HR(target.visual->SetOffsetY(create_animation(*change.curve).Get()));
+                } else {
+                    HR(target.visual->SetOffsetY(change.value));
+                }
+                break;
+            case AnimatedProperty::scale_x:
+                if (change.curve) {
+                    HR(target.scale->SetScaleX(create_animation(*change.curve).Get()));
+                } else {
+                    HR(target.scale->SetScaleX(change.value));
+                }
+                break;
+            case AnimatedProperty::scale_y:
+                if (change.curve) {
+                    HR(target.scale->SetScaleY(create_animation(*change.curve).Get()));
+                } else {
+                    HR(target.scale->SetScaleY(change.value));
+                }
+                break;
+        }
+        changed = true;
+    }
+    return changed;
+}
+
+auto VisualAnimator::create_animation(const borderless::CompositorCurve &curve) -> ComPtr<IDCompositionAnimation> {
+    ComPtr<IDCompositionAnimation> animation;
+    HR(composition->CreateAnimation(animation.GetAddressOf()));
+    for (const auto &segment: curve.segments) {
+        HR(animation->AddCubic(segment.begin, segment.constant, segment.linear, segment.quadratic, segment.cubic));
+    }
+    if (curve.repeat_duration > 0.0) {
+        HR(animation->AddRepeat(curve.repeat_offset, curve.repeat_duration));
+    }
+    if (curve.end_offset > 0.0) {
+        HR(animation->End(curve.end_offset, curve.end_value));
+    }
+    return animation;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include "pch.h"
+#include "core/Animation.hpp"
+
+/* Applies borderless::Timeline batches to DirectComposition visuals. Static values are set
+ * directly; offloaded animations become IDCompositionAnimation curves that the compositor runs on
+ * its own thread. Nothing is committed here: the caller commits the device once per frame, after
+ * every window applied its batch.
+ */
+class VisualAnimator {
+public:
+    explicit VisualAnimator(ComPtr<IDCompositionDevice> device);
+
+    // returns the target id for borderless::Animation; opacity goes through an effect group and
+    // scale through a scale transform about the visual's top-left corner, both set on the visual
+    auto add_target(ComPtr<IDCompositionVisual> visual) -> uint32_t;
+
+    // true if anything changed and the device needs a commit
+    auto apply(const borderless::PropertyBatch &batch) -> bool;
+
+    auto device() const -> IDCompositionDevice * { return composition.Get(); }
+
+private:
+    struct Target {
+        ComPtr<IDCompositionVisual> visual;
+        ComPtr<IDCompositionEffectGroup> effects;
+        ComPtr<IDCompositionScaleTransform> scale;
+    };
+
+    auto create_animation(const borderless::CompositorCurve &curve) -> ComPtr<IDCompositionAnimation>;
+
+    ComPtr<IDCompositionDevice> composition;
+    std::vector<Target> targets;
+};
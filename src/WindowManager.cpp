@@ -0,0 +1,105 @@
+#include "WindowManager.hpp"
+#include "ComError.hpp"
+
+#include <algorithm>
+
+auto WindowManager::open(const BorderlessWindow::Options &options) -> BorderlessWindow & {
+    windows.push_back(std::make_unique<BorderlessWindow>(options));
+    return *windows.back();
+}
+
+void WindowManager::run() {
+    MSG msg;
+    while (!windows.empty()) {
+        wait();
+        while (::PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE)) {
+            if (msg.message == WM_QUIT) {
+                return;
+            }
+            ::TranslateMessage(&msg);
+            ::DispatchMessageW(&msg);
+        }
+        remove_closed();
+        tick();
+    }
+}
+
+void WindowManager::wait() {
+    std::vector<HANDLE> waitables;
+    DWORD milliseconds = INFINITE;
+    auto wake_within = [&](borderless::FrameScheduler::Clock::duration timeout) {
+        if (timeout != borderless::FrameScheduler::Clock::duration::max()) {
+            const auto ms = static_cast<DWORD>(std::chrono::ceil<std::chrono::milliseconds>(timeout).count());
+            milliseconds = std::min(milliseconds, ms);
+        }
+    };
+    for (const auto &window: windows) {
+        const auto now = window->frame_clock.now();
+        // animations tick here for every window, render thread or not
+        wake_within(window->animations.next_wake(now));
+        if (window->render_thread) {
+            // paced on its own thread
+            continue;
+        }
+        // MsgWaitForMultipleObjectsEx takes one slot less than MAXIMUM_WAIT_OBJECTS
+        if (window->frame_latency_waitable && window->scheduler.waits_on_swap_chain(now) &&
+            waitables.size() < MAXIMUM_WAIT_OBJECTS - 1) {
+            waitables.push_back(window->frame_latency_waitable);
+            continue;
+        }
+        wake_within(window->scheduler.wait_timeout(now));
+    }
+    ::MsgWaitForMultipleObjectsEx(static_cast<DWORD>(waitables.size()), waitables.data(), milliseconds,
+                                  QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+}
+
+void WindowManager::tick() {
+    uint32_t animated = 0;
+    for (const auto &window: windows) {
+        if (window->threaded_rendering) {
+            window->check_render_thread();
+        } else {
+            window->render_frame();
+        }
+        // property changes and repainted layers go out in the same commit
+        const bool animated_window = window->animate(window->frame_clock.now());
+        const bool layers_changed = window->take_layer_commit();
+        // nothing to commit for a window whose device is still being recovered
+        const auto animator = window->resources.find(window->animator);
+        if (animator && (animated_window || layers_changed)) {
+            ++animated;
+            const auto device = animator->device();
+            if (std::find(commits.begin(), commits.end(), device) == commits.end()) {
+                commits.push_back(device);
+            }
+        }
+    }
+    if (commits.empty()) {
+        return;
+    }
+    // one commit per frame for all windows; normally they all share one device
+    BORDERLESS_TRACE_SCOPE(borderless::trace::Event::composition_commit, animated);
+    for (const auto device: commits) {
+        try {
+            HR(device->Commit());
+        } catch (const ComException &error) {
+            if (!device_lost(error.result)) {
+                throw;
+            }
+            // often the only device call of an idle frame; every window on the device recovers next tick
+            for (const auto &window: windows) {
+                const auto animator = window->resources.find(window->animator);
+                if (animator && animator->device() == device) {
+                    window->schedule_recovery();
+                }
+            }
+        }
+    }
+    commits.clear();
+}
+
+void WindowManager::remove_closed() {
+    windows.erase(std::remove_if(windows.begin(), windows.end(),
+                                 [](const std::unique_ptr<BorderlessWindow> &window) { return window->closed; }),
+                  windows.end());
+}
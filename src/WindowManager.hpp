@@ -0,0 +1,32 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "BorderlessWindow.hpp"
+
+/* Owns the process's BorderlessWindows and drives them from one message loop: a single wait on
+ * every window's swap chain, frame deadline and animation deadline, then one render tick over all
+ * windows that do not have a render thread. The windows share their devices through
+ * GraphicsDevices::pool(), so the animation changes of every window go out in one composition commit.
+ */
+class WindowManager {
+public:
+    auto open(const BorderlessWindow::Options &options) -> BorderlessWindow &;
+
+    auto size() const -> size_t { return windows.size(); }
+
+    // returns when the last window is closed or on WM_QUIT
+    void run();
+
+private:
+    // until a message arrives, a frame is due or a swap chain can take one
+    void wait();
+
+    void tick();
+
+    void remove_closed();
+
+    std::vector<std::unique_ptr<BorderlessWindow>> windows;
+    std::vector<IDCompositionDevice *> commits; // devices with uncommitted changes this tick
+};
@@ -0,0 +1,332 @@
+#include "Animation.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "Trace.hpp"
+
+namespace borderless {
+
+    namespace {
+        constexpr uint32_t max_unrolled_iterations = 8;
+
+        // one coordinate of the Bezier at parameter s, as the cubic a s^3 + b s^2 + c s
+        struct BezierAxis {
+            float a, b, c;
+
+            auto at(float s) const -> float { return ((a * s + b) * s + c) * s; }
+
+            auto slope(float s) const -> float { return (3 * a * s + 2 * b) * s + c; }
+        };
+
+        auto bezier_axis(float p1, float p2) -> BezierAxis {
+            const auto c = 3 * p1;
+            const auto b = 3 * (p2 - p1) - c;
+            return {1 - c - b, b, c};
+        }
+
+        auto at_progress(const std::vector<Keyframe> &keyframes, double progress) -> float {
+            if (progress <= keyframes.front().offset) {
+                return keyframes.front().value;
+            }
+            if (progress >= keyframes.back().offset) {
+                return keyframes.back().value;
+            }
+            size_t i = 0;
+            while (i + 2 < keyframes.size() && keyframes[i + 1].offset <= progress) {
+                ++i;
+            }
+            const auto &from = keyframes[i];
+            const auto &to = keyframes[i + 1];
+            const auto span = double(to.offset) - from.offset;
+            if (span <= 0.0) {
+                return to.value;
+            }
+            const auto eased = from.easing(static_cast<float>((progress - from.offset) / span));
+            return from.value + (to.value - from.value) * eased;
+        }
+
+        auto seconds(FrameClockType::duration duration) -> double {
+            return std::chrono::duration<double>(duration).count();
+        }
+    }
+
+    auto Easing::operator()(float t) const -> float {
+        t = std::min(std::max(t, 0.0f), 1.0f);
+        const auto y = bezier_axis(y1, y2);
+        if (polynomial()) {
+            return y.at(t);
+        }
+        // solve x(s) = t: Newton from s = t, bisection if the slope flattens out
+        const auto x = bezier_axis(x1, x2);
+        auto s = t;
+        for (int i = 0; i < 8; ++i) {
+            const auto error = x.at(s) - t;
+            if (std::fabs(error) < 1e-6f) {
+                return y.at(s);
+            }
+            const auto slope = x.slope(s);
+            if (std::fabs(slope) < 1e-6f) {
+                break;
+            }
+            s -= error / slope;
+        }
+        float low = 0.0f, high = 1.0f;
+        s = t;
+        for (int i = 0; i < 32 && high - low > 1e-7f; ++i) {
+            if (x.at(s) < t) {
+                low = s;
+            } else {
+                high = s;
+            }
+            s = (low + high) / 2;
+        }
+        return y.at(s);
+    }
+
+    auto tween(uint32_t target, AnimatedProperty property, float from, float to, FrameClockType::duration duration,
+               Easing easing) -> Animation {
+        Animation animation;
+        animation.target = target;
+        animation.property = property;
+        animation.keyframes = {{0.0f, from, easing}, {1.0f, to, {}}};
+        animation.duration = duration;
+        return animation;
+    }
+
+    auto validate(const Animation &animation) -> void {
+        const auto &keyframes = animation.keyframes;
+        if (keyframes.size() < 2) {
+            throw std::invalid_argument("an animation needs at least two keyframes");
+        }
+        if (keyframes.front().offset != 0.0f || keyframes.back().offset != 1.0f) {
+            throw std::invalid_argument("keyframe offsets must run from 0 to 1");
+        }
+        for (size_t i = 1; i < keyframes.size(); ++i) {
+            if (keyframes[i].offset < keyframes[i - 1].offset) {
+                throw std::invalid_argument("keyframe offsets must not decrease");
+            }
+        }
+        if (animation.duration.count() < 0 || animation.delay.count() < 0) {
+            throw std::invalid_argument("negative animation duration or delay");
+        }
+    }
+
+    auto sample(const Animation &animation, FrameClockType::duration elapsed) -> float {
+        const auto &keyframes = animation.keyframes;
+        if (keyframes.empty()) {
+            return 0.0f;
+        }
+        const auto local = elapsed - animation.delay;
+        if (local.count() < 0) {
+            return keyframes.front().value;
+        }
+        const auto duration = animation.duration.count();
+        const auto iteration = duration > 0 ? local.count() / duration : int64_t{0};
+        if (duration <= 0 || (animation.iterations != 0 && iteration >= animation.iterations)) {
+            // an even number of alternating iterations ends where it started
+            const bool backwards = animation.alternate && animation.iterations % 2 == 0 && animation.iterations != 0;
+            return backwards ? keyframes.front().value : keyframes.back().value;
+        }
+        auto progress = double(local.count() - iteration * duration) / double(duration);
+        if (animation.alternate && iteration % 2 == 1) {
+            progress = 1.0 - progress;
+        }
+        return at_progress(keyframes, progress);
+    }
+
+    auto end_time(const Animation &animation) -> FrameClockType::duration {
+        if (animation.iterations == 0) {
+            return FrameClockType::duration::max();
+        }
+        return animation.delay + animation.duration * animation.iterations;
+    }
+
+    auto CompositorCurve::evaluate(double t) const -> float {
+        if (end_offset > 0.0 && t >= end_offset) {
+            return end_value;
+        }
+        if (repeat_duration > 0.0 && t >= repeat_offset) {
+            t = repeat_offset - repeat_duration + std::fmod(t - repeat_offset, repeat_duration);
+        }
+        if (segments.empty()) {
+            return end_value;
+        }
+        auto segment = std::upper_bound(segments.begin(), segments.end(), t,
+                                        [](double time, const CubicSegment &s) { return time < s.begin; });
+        if (segment != segments.begin()) {
+            --segment;
+        }
+        const auto u = static_cast<float>(std::max(t - segment->begin, 0.0));
+        return segment->constant + u * (segment->linear + u * (segment->quadratic + u * segment->cubic));
+    }
+
+    auto compositor_curve(const Animation &animation) -> std::optional<CompositorCurve> {
+        const auto &keyframes = animation.keyframes;
+        if (animation.alternate || animation.duration.count() <= 0 ||
+            animation.iterations > max_unrolled_iterations || keyframes.size() < 2) {
+            return std::nullopt;
+        }
+        for (size_t i = 0; i + 1 < keyframes.size(); ++i) {
+            if (!keyframes[i].easing.polynomial()) {
+                return std::nullopt;
+            }
+        }
+
+        CompositorCurve curve;
+        const auto duration = seconds(animation.duration);
+        const auto delay = seconds(animation.delay);
+        if (delay > 0.0) {
+            curve.segments.push_back({0.0, keyframes.front().value, 0.0f, 0.0f, 0.0f});
+        }
+        const auto iterations = animation.iterations == 0 ? uint32_t{1} : animation.iterations;
+        for (uint32_t k = 0; k < iterations; ++k) {
+            for (size_t i = 0; i + 1 < keyframes.size(); ++i) {
+                const auto &from = keyframes[i];
+                const auto &to = keyframes[i + 1];
+                const auto span = (double(to.offset) - from.offset) * duration;
+                if (span <= 0.0) {
+                    continue;
+                }
+                // value(u) = from + delta * y(u / span), with y a polynomial in time
+                const auto y = bezier_axis(from.easing.y1, from.easing.y2);
+                const double delta = double(to.value) - from.value;
+                curve.segments.push_back({delay + k * duration + from.offset * duration, from.value,
+                                          static_cast<float>(delta * y.c / span),
+                                          static_cast<float>(delta * y.b / (span * span)),
+                                          static_cast<float>(delta * y.a / (span * span * span))});
+            }
+        }
+        if (animation.iterations == 0) {
+            curve.repeat_offset = delay + duration;
+            curve.repeat_duration = duration;
+        } else {
+            curve.end_offset = delay + iterations * duration;
+            curve.end_value = keyframes.back().value;
+        }
+        return curve;
+    }
+
+    auto Timeline::add(Animation animation) -> bool {
+        validate(animation);
+        Entry entry;
+        entry.end = end_time(animation);
+        if (compositor_) {
+            if (auto curve = compositor_curve(animation)) {
+                entry.curve = std::make_unique<CompositorCurve>(std::move(*curve));
+            }
+        }
+        const bool offloaded = entry.curve != nullptr;
+        const auto k = key(animation.target, animation.property);
+        entry.animation = std::move(animation);
+
+        auto existing = index_.find(k);
+        if (existing != index_.end()) {
+            ++stats_.cancelled;
+            entries_[existing->second] = std::move(entry);
+        } else {
+            index_.emplace(k, entries_.size());
+            entries_.push_back(std::move(entry));
+        }
+        pending_ = true;
+        return offloaded;
+    }
+
+    auto Timeline::cancel(uint32_t target, AnimatedProperty property) -> bool {
+        auto it = index_.find(key(target, property));
+        if (it == index_.end()) {
+            return false;
+        }
+        entries_[it->second].cancelled = true;
+        pending_ = true;
+        return true;
+    }
+
+    auto Timeline::value(uint32_t target, AnimatedProperty property, Clock::time_point now) const
+    -> std::optional<float> {
+        auto it = index_.find(key(target, property));
+        if (it == index_.end()) {
+            return std::nullopt;
+        }
+        const auto &entry = entries_[it->second];
+        return sample(entry.animation, entry.started ? now - entry.start : Clock::duration::zero());
+    }
+
+    auto Timeline::tick(Clock::time_point now, PropertyBatch &batch) -> void {
+        BORDERLESS_TRACE_SCOPE(trace::Event::animation_tick, static_cast<uint32_t>(entries_.size()));
+        ++stats_.ticks;
+        last_tick_ = now;
+        pending_ = false;
+        sampled_ = 0;
+        next_end_ = Clock::time_point::max();
+        const auto before = batch.size();
+
+        for (size_t i = 0; i < entries_.size();) {
+            auto &entry = entries_[i];
+            const auto &animation = entry.animation;
+            if (!entry.started) {
+                entry.start = now;
+                entry.started = true;
+                if (entry.curve) {
+                    batch.push_back({animation.target, animation.property, sample(animation, {}), entry.curve.get()});
+                    ++stats_.offloaded;
+                }
+            }
+            const auto elapsed = now - entry.start;
+            if (entry.cancelled) {
+                batch.push_back({animation.target, animation.property, sample(animation, elapsed), nullptr});
+                ++stats_.cancelled;
+                remove(i);
+                continue;
+            }
+            const bool finished = elapsed >= entry.end;
+            if (entry.curve && !finished) {
+                if (entry.end != Clock::duration::max()) {
+                    next_end_ = std::min(next_end_, entry.start + entry.end);
+                }
+                ++i;
+                continue;
+            }
+            // a finished compositor animation is replaced by its static end value
+            const auto value = sample(animation, elapsed);
+            if (entry.curve || !entry.emitted || value != entry.last) {
+                batch.push_back({animation.target, animation.property, value, nullptr});
+                entry.emitted = true;
+                entry.last = value;
+            }
+            if (finished) {
+                ++stats_.completed;
+                remove(i);
+                continue;
+            }
+            ++sampled_;
+            ++i;
+        }
+        stats_.changes += batch.size() - before;
+    }
+
+    auto Timeline::next_wake(Clock::time_point now) const -> Clock::duration {
+        if (pending_) {
+            return Clock::duration::zero();
+        }
+        auto wake = Clock::duration::max();
+        if (sampled_ > 0) {
+            const auto next = last_tick_ + interval_;
+            wake = next <= now ? Clock::duration::zero() : next - now;
+        }
+        if (next_end_ != Clock::time_point::max()) {
+            wake = std::min(wake, next_end_ <= now ? Clock::duration::zero() : next_end_ - now);
+        }
+        return wake;
+    }
+
+    auto Timeline::remove(size_t index) -> void {
+        index_.erase(key(entries_[index].animation.target, entries_[index].animation.property));
+        if (index + 1 != entries_.size()) {
+            entries_[index] = std::move(entries_.back());
+            index_[key(entries_[index].animation.target, entries_[index].animation.property)] = index;
+        }
+        entries_.pop_back();
+    }
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "FrameScheduler.hpp"
+
+namespace borderless {
+
+    /* CSS-style timing function: a cubic Bezier from (0, 0) to (1, 1) through (x1, y1) and (x2, y2).
+     * The named curves keep x linear in time (x1 = 1/3, x2 = 2/3), which makes the eased value a
+     * cubic polynomial in time, and those are the ones the compositor can run.
+     */
+    struct Easing {
+        float x1 = 1.0f / 3, y1 = 1.0f / 3;
+        float x2 = 2.0f / 3, y2 = 2.0f / 3;
+
+        static constexpr auto linear() -> Easing { return {}; }
+
+        static constexpr auto ease_in() -> Easing { return {1.0f / 3, 0.0f, 2.0f / 3, 1.0f / 3}; }        // t^2
+
+        static constexpr auto ease_out() -> Easing { return {1.0f / 3, 2.0f / 3, 2.0f / 3, 1.0f}; }       // 1 - (1 - t)^2
+
+        static constexpr auto ease_in_out() -> Easing { return {1.0f / 3, 0.0f, 2.0f / 3, 1.0f}; }        // 3t^2 - 2t^3
+
+        static constexpr auto cubic_bezier(float x1, float y1, float x2, float y2) -> Easing {
+            return {x1, y1, x2, y2};
+        }
+
+        // eased progress at time fraction t in [0, 1]
+        auto operator()(float t) const -> float;
+
+        auto polynomial() const -> bool { return x1 == 1.0f / 3 && x2 == 2.0f / 3; }
+    };
+
+    // the value at offset (0 to 1 of an iteration), eased towards the next keyframe's value
+    struct Keyframe {
+        float offset = 0.0f;
+        float value = 0.0f;
+        Easing easing;
+    };
+
+    enum class AnimatedProperty : uint8_t {
+        opacity,
+        offset_x,
+        offset_y,
+        scale_x,
+        scale_y,
+    };
+
+    // keyframes of one property of one target; the shell decides what a target id refers to
+    struct Animation {
+        uint32_t target = 0;
+        AnimatedProperty property = AnimatedProperty::opacity;
+        std::vector<Keyframe> keyframes; // offsets from 0 to 1, not decreasing
+        FrameClockType::duration duration{};
+        FrameClockType::duration delay{};  // holds the first value until then
+        uint32_t iterations = 1;           // 0 repeats forever
+        bool alternate = false;            // every other iteration runs backwards
+    };
+
+    // from -> to in one eased step
+    auto tween(uint32_t target, AnimatedProperty property, float from, float to, FrameClockType::duration duration,
+               Easing easing = Easing::ease_out()) -> Animation;
+
+    // throws std::invalid_argument for fewer than two keyframes or offsets out of order or range
+    auto validate(const Animation &animation) -> void;
+
+    // the value elapsed after the animation started; holds the last value once it has finished
+    auto sample(const Animation &animation, FrameClockType::duration elapsed) -> float;
+
+    // elapsed time at which the animation has finished, duration::max() if it repeats forever
+    auto end_time(const Animation &animation) -> FrameClockType::duration;
+
+    // value(t) = constant + linear * u + quadratic * u^2 + cubic * u^3, u = t - begin, in seconds
+    struct CubicSegment {
+        double begin = 0.0;
+        float constant = 0.0f;
+        float linear = 0.0f;
+        float quadratic = 0.0f;
+        float cubic = 0.0f;
+    };
+
+    // the same piecewise curve IDCompositionAnimation takes (AddCubic, AddRepeat, End), in seconds
+    struct CompositorCurve {
+        std::vector<CubicSegment> segments;
+        double repeat_offset = 0.0; // > 0: from here on the previous repeat_duration seconds repeat forever
+        double repeat_duration = 0.0;
+        double end_offset = 0.0;    // > 0: end_value holds from here on
+        float end_value = 0.0f;
+
+        auto evaluate(double seconds) const -> float;
+    };
+
+    // the animation as cubic segments, or nullopt when only the CPU can run it: a Bezier easing,
+    // alternate, a zero duration or more than a few iterations to unroll
+    auto compositor_curve(const Animation &animation) -> std::optional<CompositorCurve>;
+
+    // curve: set for an animation handed to the compositor, and valid until the timeline changes next;
+    // otherwise value is the property's new static value
+    struct PropertyChange {
+        uint32_t target;
+        AnimatedProperty property;
+        float value;
+        const CompositorCurve *curve;
+    };
+
+    using PropertyBatch = std::vector<PropertyChange>;
+
+    struct TimelineStats {
+        uint64_t ticks = 0;
+        uint64_t changes = 0;   // property changes emitted
+        uint64_t offloaded = 0; // animations handed to the compositor
+        uint64_t completed = 0;
+        uint64_t cancelled = 0; // including those replaced by another animation of the same property
+    };
+
+    /* Runs animations against the frame clock and reports what changed as one batch per tick, so
+     * the shell can apply a frame's changes and commit them together. With a compositor, animations
+     * that compositor_curve() can express are handed over once and only their end comes back;
+     * everything else is sampled on every tick. Time only comes in through tick(), so a fake clock
+     * gives the same batches every run.
+     * An animation starts at the first tick after add(); adding one for a property that is already
+     * animating replaces the old one.
+     */
+    class Timeline {
+    public:
+        using Clock = FrameClockType;
+
+        // compositor: the shell can run CompositorCurves itself (DirectComposition)
+        explicit Timeline(bool compositor = false) : compositor_(compositor) {}
+
+        // returns true when the compositor runs the animation; throws like validate()
+        auto add(Animation animation) -> bool;
+
+        // stops the animation at its value at the next tick; false if the property was not animating
+        auto cancel(uint32_t target, AnimatedProperty property) -> bool;
+
+        // the value of the property's animation at now, nullopt if none is running
+        auto value(uint32_t target, AnimatedProperty property, Clock::time_point now) const -> std::optional<float>;
+
+        // appends the changes since the last tick to batch
+        auto tick(Clock::time_point now, PropertyBatch &batch) -> void;
+
+        // how long until the next tick has work: zero when due, max() when idle
+        auto next_wake(Clock::time_point now) const -> Clock::duration;
+
+        auto due(Clock::time_point now) const -> bool { return next_wake(now) == Clock::duration::zero(); }
+
+        // CPU-sampled animations tick at most once per interval, normally the refresh interval
+        auto set_interval(Clock::duration interval) -> void { interval_ = interval; }
+
+        auto size() const -> size_t { return entries_.size(); }
+
+        auto stats() const -> const TimelineStats & { return stats_; }
+
+    private:
+        struct Entry {
+            Animation animation;
+            std::unique_ptr<CompositorCurve> curve; // set when the compositor runs it
+            Clock::duration end{};
+            Clock::time_point start{};
+            bool started = false;
+            bool cancelled = false;
+            bool emitted = false;
+            float last = 0.0f;
+        };
+
+        static auto key(uint32_t target, AnimatedProperty property) -> uint64_t {
+            return uint64_t{target} << 8 | static_cast<uint8_t>(property);
+        }
+
+        auto remove(size_t index) -> void;
+
+        bool compositor_;
+        Clock::duration interval_ = std::chrono::microseconds(16'667);
+        std::vector<Entry> entries_;
+        std::unordered_map<uint64_t, size_t> index_; // key() -> entries_ index
+        bool pending_ = false;     // added or cancelled since the last tick
+        size_t sampled_ = 0;       // entries sampled on every tick
+        Clock::time_point last_tick_{};
+        Clock::time_point next_end_ = Clock::time_point::max(); // earliest end of a compositor animation
+        TimelineStats stats_;
+    };
+}
@@ -0,0 +1,320 @@
+#include "AssetPack.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "Lz4.hpp"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace borderless {
+
+    auto MappedFile::open(const std::filesystem::path &path) -> bool {
+        close();
+#if defined(_WIN32)
+        file_ = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) {
+            file_ = nullptr;
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!::GetFileSizeEx(file_, &size) || size.QuadPart == 0) {
+            close();
+            return false;
+        }
+        mapping_ = ::CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_) {
+            close();
+            return false;
+        }
+        data_ = static_cast<const uint8_t *>(::MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        if (!data_) {
+            close();
+            return false;
+        }
+        size_ = static_cast<size_t>(size.QuadPart);
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info{};
+        if (::fstat(fd, &info) != 0 || info.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void *data = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // the mapping keeps the file alive
+        if (data == MAP_FAILED) {
+            return false;
+        }
+        data_ = static_cast<const uint8_t *>(data);
+        size_ = static_cast<size_t>(info.st_size);
+#endif
+        return true;
+    }
+
+    auto MappedFile::close() -> void {
+#if defined(_WIN32)
+        if (data_) {
+            ::UnmapViewOfFile(data_);
+        }
+        if (mapping_) {
+            ::CloseHandle(mapping_);
+        }
+        if (file_) {
+            ::CloseHandle(file_);
+        }
+        mapping_ = nullptr;
+        file_ = nullptr;
+#else
+        if (data_) {
+            ::munmap(const_cast<uint8_t *>(data_), size_);
+        }
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    auto pack::hash_name(std::string_view name) -> uint64_t {
+        // FNV-1a
+        uint64_t hash = 14695981039346656037ull;
+        for (const char c: name) {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    auto AssetPackWriter::add(std::string name, std::vector<uint8_t> data, bool compress) -> void {
+        auto existing = std::find_if(assets_.begin(), assets_.end(), [&](const Asset &a) { return a.name == name; });
+        if (existing != assets_.end()) {
+            existing->data = std::move(data);
+            existing->compress = compress;
+            return;
+        }
+        assets_.push_back({std::move(name), std::move(data), compress});
+    }
+
+    auto AssetPackWriter::build() const -> std::vector<uint8_t> {
+        std::vector<const Asset *> sorted;
+        for (const auto &asset: assets_) {
+            sorted.push_back(&asset);
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const Asset *a, const Asset *b) {
+            const auto ha = pack::hash_name(a->name), hb = pack::hash_name(b->name);
+            return ha != hb ? ha < hb : a->name < b->name;
+        });
+
+        std::vector<pack::Entry> entries(sorted.size());
+        std::string names;
+        std::vector<uint8_t> data;
+        std::vector<uint8_t> compressed;
+        for (size_t i = 0; i < sorted.size(); ++i) {
+            const auto &asset = *sorted[i];
+            auto &entry = entries[i];
+            entry.name_hash = pack::hash_name(asset.name);
+            entry.name_offset = static_cast<uint32_t>(names.size());
+            entry.name_size = static_cast<uint16_t>(asset.name.size());
+            names += asset.name;
+
+            entry.size = static_cast<uint32_t>(asset.data.size());
+            data.resize((data.size() + 7) & ~size_t{7});
+            entry.data_offset = data.size(); // relative until the header size is known
+            compressed.clear();
+            if (asset.compress && lz4::compress(view(asset.data), compressed) < asset.data.size()) {
+                entry.flags = pack::compressed;
+                entry.stored_size = static_cast<uint32_t>(compressed.size());
+                data.insert(data.end(), compressed.begin(), compressed.end());
+            } else {
+                entry.flags = 0;
+                entry.stored_size = entry.size;
+                data.insert(data.end(), asset.data.begin(), asset.data.end());
+            }
+        }
+
+        pack::Header header{};
+        std::memcpy(header.magic, pack::magic, sizeof(header.magic));
+        header.version = pack::version;
+        header.entry_count = static_cast<uint32_t>(entries.size());
+        header.names_offset = sizeof(pack::Header) + entries.size() * sizeof(pack::Entry);
+        header.names_size = names.size();
+        const auto data_offset = (header.names_offset + names.size() + 7) & ~uint64_t{7};
+        for (auto &entry: entries) {
+            entry.data_offset += data_offset;
+        }
+
+        std::vector<uint8_t> out(static_cast<size_t>(data_offset) + data.size());
+        std::memcpy(out.data(), &header, sizeof(header));
+        if (!entries.empty()) {
+            std::memcpy(out.data() + sizeof(header), entries.data(), entries.size() * sizeof(pack::Entry));
+        }
+        std::memcpy(out.data() + header.names_offset, names.data(), names.size());
+        if (!data.empty()) {
+            std::memcpy(out.data() + data_offset, data.data(), data.size());
+        }
+        return out;
+    }
+
+    auto AssetPackWriter::write(const std::filesystem::path &path) const -> bool {
+        const auto bytes = build();
+        std::FILE *file = nullptr;
+#if defined(_WIN32)
+        if (_wfopen_s(&file, path.c_str(), L"wb") != 0) {
+            file = nullptr;
+        }
+#else
+        file = std::fopen(path.c_str(), "wb");
+#endif
+        if (!file) {
+            return false;
+        }
+        const bool written = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+        return std::fclose(file) == 0 && written;
+    }
+
+    auto AssetPack::open(const std::filesystem::path &path) -> bool {
+        close();
+        if (!file_.open(path)) {
+            return fail("cannot map " + path.string());
+        }
+        if (!parse(file_.bytes())) {
+            file_.close();
+            return false;
+        }
+        return true;
+    }
+
+    auto AssetPack::open(ByteView bytes) -> bool {
+        close();
+        return parse(bytes);
+    }
+
+    auto AssetPack::parse(ByteView bytes) -> bool {
+        entries_ = nullptr;
+        entry_count_ = 0;
+        decoded_.clear();
+        decoded_bytes_ = 0;
+        bytes_ = bytes;
+
+        if (reinterpret_cast<uintptr_t>(bytes.data) % alignof(pack::Entry) != 0) {
+            return fail("pack data is not 8-byte aligned");
+        }
+        pack::Header header{};
+        if (bytes.size < sizeof(header)) {
+            return fail("truncated header");
+        }
+        std::memcpy(&header, bytes.data, sizeof(header));
+        if (std::memcmp(header.magic, pack::magic, sizeof(header.magic)) != 0) {
+            return fail("not an asset pack");
+        }
+        if (header.version != pack::version) {
+            return fail("unsupported pack version " + std::to_string(header.version));
+        }
+        const auto index = bytes.sub(sizeof(header), size_t{header.entry_count} * sizeof(pack::Entry));
+        names_ = bytes.sub(static_cast<size_t>(header.names_offset), static_cast<size_t>(header.names_size));
+        if (index.size != size_t{header.entry_count} * sizeof(pack::Entry) ||
+            names_.size != header.names_size) {
+            return fail("truncated index");
+        }
+        entries_ = reinterpret_cast<const pack::Entry *>(index.data);
+        for (size_t i = 0; i < header.entry_count; ++i) {
+            const auto &entry = entries_[i];
+            if (bytes.sub(static_cast<size_t>(entry.data_offset), entry.stored_size).size != entry.stored_size ||
+                names_.sub(entry.name_offset, entry.name_size).size != entry.name_size ||
+                (!(entry.flags & pack::compressed) && entry.stored_size != entry.size)) {
+                entries_ = nullptr;
+                return fail("entry " + std::to_string(i) + " out of range");
+            }
+        }
+        entry_count_ = header.entry_count;
+        decoded_.resize(entry_count_);
+        error_.clear();
+        return true;
+    }
+
+    auto AssetPack::close() -> void {
+        entries_ = nullptr;
+        entry_count_ = 0;
+        bytes_ = {};
+        names_ = {};
+        decoded_.clear();
+        decoded_bytes_ = 0;
+        file_.close();
+    }
+
+    auto AssetPack::find(std::string_view name) const -> const pack::Entry * {
+        const auto hash = pack::hash_name(name);
+        const auto end = entries_ + entry_count_;
+        auto it = std::lower_bound(entries_, end, hash, [](const pack::Entry &entry, uint64_t h) {
+            return entry.name_hash < h;
+        });
+        for (; it != end && it->name_hash == hash; ++it) {
+            if (name_of(*it) == name) {
+                return it;
+            }
+        }
+        return nullptr;
+    }
+
+    auto AssetPack::name_of(const pack::Entry &entry) const -> std::string_view {
+        return {reinterpret_cast<const char *>(names_.data) + entry.name_offset, entry.name_size};
+    }
+
+    auto AssetPack::get(std::string_view name) -> std::optional<ByteView> {
+        const auto entry = find(name);
+        if (!entry) {
+            return std::nullopt;
+        }
+        const auto stored = bytes_.sub(static_cast<size_t>(entry->data_offset), entry->stored_size);
+        if (!(entry->flags & pack::compressed)) {
+            return stored;
+        }
+
+        std::lock_guard<std::mutex> lock(decode_mutex_);
+        auto &decoded = decoded_[static_cast<size_t>(entry - entries_)];
+        if (!decoded) {
+            auto bytes = std::make_unique<std::vector<uint8_t>>(entry->size);
+            if (lz4::decompress(stored, bytes->data(), bytes->size()) != entry->size) {
+                return std::nullopt;
+            }
+            decoded_bytes_ += bytes->size();
+            decoded = std::move(bytes);
+        }
+        return view(*decoded);
+    }
+
+    auto AssetPack::names() const -> std::vector<std::string_view> {
+        std::vector<std::string_view> result;
+        result.reserve(entry_count_);
+        for (size_t i = 0; i < entry_count_; ++i) {
+            result.push_back(name_of(entries_[i]));
+        }
+        return result;
+    }
+
+    auto AssetPack::decoded_bytes() const -> size_t {
+        std::lock_guard<std::mutex> lock(decode_mutex_);
+        return decoded_bytes_;
+    }
+
+    auto AssetPack::fail(std::string message) -> bool {
+        error_ = std::move(message);
+        return false;
+    }
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ByteView.hpp"
+
+namespace borderless {
+
+    // a read-only memory mapping of a whole file; CreateFileMapping on Windows, mmap elsewhere
+    class MappedFile {
+    public:
+        MappedFile() = default;
+
+        ~MappedFile() { close(); }
+
+        MappedFile(const MappedFile &) = delete;
+
+        auto operator=(const MappedFile &) -> MappedFile & = delete;
+
+        auto open(const std::filesystem::path &path) -> bool;
+
+        auto close() -> void;
+
+        auto bytes() const -> ByteView { return {data_, size_}; }
+
+        auto is_open() const -> bool { return data_ != nullptr; }
+
+    private:
+        const uint8_t *data_ = nullptr;
+        size_t size_ = 0;
+#if defined(_WIN32)
+        void *file_ = nullptr;
+        void *mapping_ = nullptr;
+#endif
+    };
+
+    /* On-disk layout of an asset pack, little endian:
+     *   Header | Entry[entry_count] sorted by (name_hash, name) | names | data
+     * Data blocks are 8-byte aligned and either stored raw or as one LZ4 block.
+     */
+    namespace pack {
+        constexpr char magic[4] = {'B', 'P', 'A', 'K'};
+        constexpr uint32_t version = 1;
+        constexpr uint16_t compressed = 1;
+
+        struct Header {
+            char magic[4];
+            uint32_t version;
+            uint32_t entry_count;
+            uint32_t reserved;
+            uint64_t names_offset;
+            uint64_t names_size;
+        };
+        static_assert(sizeof(Header) == 32, "packed layout");
+
+        struct Entry {
+            uint64_t name_hash;
+            uint64_t data_offset;
+            uint32_t stored_size;
+            uint32_t size;
+            uint32_t name_offset; // into the names block
+            uint16_t name_size;
+            uint16_t flags;
+        };
+        static_assert(sizeof(Entry) == 32, "packed layout");
+
+        auto hash_name(std::string_view name) -> uint64_t;
+    }
+
+    // builds a pack; used by tools/asset_pack at build time
+    class AssetPackWriter {
+    public:
+        // compress: store as LZ4 if that is smaller; a later add with the same name replaces
+        auto add(std::string name, std::vector<uint8_t> data, bool compress = true) -> void;
+
+        auto build() const -> std::vector<uint8_t>;
+
+        auto write(const std::filesystem::path &path) const -> bool;
+
+    private:
+        struct Asset {
+            std::string name;
+            std::vector<uint8_t> data;
+            bool compress;
+        };
+        std::vector<Asset> assets_;
+    };
+
+    /* A memory-mapped asset pack. open() validates the header and index only; nothing is read or
+     * decoded until an entry is asked for. Raw entries are views into the mapping, compressed ones
+     * are decoded on first access and kept for the pack's lifetime. get() may be called from any
+     * thread.
+     */
+    class AssetPack {
+    public:
+        AssetPack() = default;
+
+        AssetPack(const AssetPack &) = delete;
+
+        auto operator=(const AssetPack &) -> AssetPack & = delete;
+
+        auto open(const std::filesystem::path &path) -> bool;
+
+        // a pack already in memory (embedded or just built); bytes must outlive the pack
+        auto open(ByteView bytes) -> bool;
+
+        auto close() -> void;
+
+        auto error() const -> const std::string & { return error_; }
+
+        auto size() const -> size_t { return entry_count_; }
+
+        auto contains(std::string_view name) const -> bool { return find(name) != nullptr; }
+
+        auto get(std::string_view name) -> std::optional<ByteView>;
+
+        auto names() const -> std::vector<std::string_view>;
+
+        // bytes decoded from LZ4 so far
+        auto decoded_bytes() const -> size_t;
+
+    private:
+        auto parse(ByteView bytes) -> bool;
+
+        auto find(std::string_view name) const -> const pack::Entry *;
+
+        auto name_of(const pack::Entry &entry) const -> std::string_view;
+
+        auto fail(std::string message) -> bool;
+
+        MappedFile file_;
+        ByteView bytes_;
+        const pack::Entry *entries_ = nullptr;
+        size_t entry_count_ = 0;
+        ByteView names_;
+        std::string error_;
+
+        mutable std::mutex decode_mutex_;
+        std::vector<std::unique_ptr<std::vector<uint8_t>>> decoded_; // per entry, filled on first get()
+        size_t decoded_bytes_ = 0;
+    };
+}
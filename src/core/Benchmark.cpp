@@ -0,0 +1,470 @@
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <stdexcept>
+
+namespace borderless {
+
+    namespace {
+        using Clock = std::chrono::steady_clock;
+
+        constexpr int json_version = 1;
+
+        auto percentile(std::vector<double> values, double p) -> double {
+            if (values.empty()) {
+                return 0.0;
+            }
+            const auto rank = static_cast<size_t>(p * static_cast<double>(values.size() - 1) + 0.5);
+            std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(rank), values.end());
+            return values[rank];
+        }
+
+        auto append_escaped(std::string &out, const std::string &text) -> void {
+            for (const char c: text) {
+                if (c == '"' || c == '\\') {
+                    out += '\\';
+                }
+                if (static_cast<unsigned char>(c) >= 0x20) {
+                    out += c;
+                }
+            }
+        }
+
+        // just enough JSON for what to_json writes: objects, arrays, strings without \u escapes
+        // and numbers
+        struct JsonReader {
+            const char *at;
+            const char *end;
+
+            auto skip_space() -> void {
+                while (at != end && (*at == ' ' || *at == '\n' || *at == '\r' || *at == '\t')) {
+                    ++at;
+                }
+            }
+
+            auto accept(char c) -> bool {
+                skip_space();
+                if (at != end && *at == c) {
+                    ++at;
+                    return true;
+                }
+                return false;
+            }
+
+            auto string(std::string &value) -> bool {
+                if (!accept('"')) {
+                    return false;
+                }
+                value.clear();
+                while (at != end && *at != '"') {
+                    if (*at == '\\' && ++at == end) {
+                        return false;
+                    }
+                    value += *at++;
+                }
+                return at != end && *at++ == '"';
+            }
+
+            auto number(double &value) -> bool {
+                skip_space();
+                const std::string text(at, static_cast<size_t>(std::min<std::ptrdiff_t>(end - at, 64)));
+                char *stop = nullptr;
+                value = std::strtod(text.c_str(), &stop);
+                if (stop == text.c_str()) {
+                    return false;
+                }
+                at += stop - text.c_str();
+                return true;
+            }
+
+            // a value whose key is not known here
+            auto skip() -> bool {
+                skip_space();
+                if (at == end) {
+                    return false;
+                }
+                if (*at == '"') {
+                    std::string ignored;
+                    return string(ignored);
+                }
+                if (*at == '[' || *at == '{') {
+                    const char close = *at == '[' ? ']' : '}';
+                    ++at;
+                    if (accept(close)) {
+                        return true;
+                    }
+                    do {
+                        if (close == '}') {
+                            std::string key;
+                            if (!string(key) || !accept(':')) {
+                                return false;
+                            }
+                        }
+                        if (!skip()) {
+                            return false;
+                        }
+                    } while (accept(','));
+                    return accept(close);
+                }
+                double ignored;
+                return number(ignored);
+            }
+
+            template<typename Member>
+            auto object(Member &&member) -> bool {
+                if (!accept('{')) {
+                    return false;
+                }
+                if (accept('}')) {
+                    return true;
+                }
+                do {
+                    std::string key;
+                    if (!string(key) || !accept(':') || !member(key)) {
+                        return false;
+                    }
+                } while (accept(','));
+                return accept('}');
+            }
+
+            template<typename Element>
+            auto array(Element &&element) -> bool {
+                if (!accept('[')) {
+                    return false;
+                }
+                if (accept(']')) {
+                    return true;
+                }
+                do {
+                    if (!element()) {
+                        return false;
+                    }
+                } while (accept(','));
+                return accept(']');
+            }
+        };
+    }
+
+    auto summarize(BenchmarkResult &result) -> void {
+        const auto &samples = result.samples;
+        if (samples.empty()) {
+            result.median = result.p10 = result.p90 = result.mean = result.stddev = 0.0;
+            return;
+        }
+        result.median = percentile(samples, 0.50);
+        result.p10 = percentile(samples, 0.10);
+        result.p90 = percentile(samples, 0.90);
+        result.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size());
+        double squares = 0.0;
+        for (const auto sample: samples) {
+            squares += (sample - result.mean) * (sample - result.mean);
+        }
+        result.stddev = samples.size() > 1 ? std::sqrt(squares / static_cast<double>(samples.size() - 1)) : 0.0;
+    }
+
+    auto format_benchmark_results(const std::vector<BenchmarkResult> &results) -> std::string {
+        std::string out;
+        char line[200];
+        std::snprintf(line, sizeof(line), "%-32s %12s %12s %12s %12s %8s\n", "benchmark", "iterations", "median ns",
+                      "p10 ns", "p90 ns", "stddev");
+        out += line;
+        for (const auto &r: results) {
+            std::snprintf(line, sizeof(line), "%-32s %12llu %12.2f %12.2f %12.2f %7.1f%%\n", r.name.c_str(),
+                          static_cast<unsigned long long>(r.iterations), r.median, r.p10, r.p90,
+                          r.mean > 0.0 ? 100.0 * r.stddev / r.mean : 0.0);
+            out += line;
+        }
+        return out;
+    }
+
+    auto to_json(const std::vector<BenchmarkResult> &results) -> std::string {
+        std::string out;
+        char line[200];
+        std::snprintf(line, sizeof(line), "{\"version\":%d,\"benchmarks\":[", json_version);
+        out += line;
+        for (size_t i = 0; i < results.size(); ++i) {
+            const auto &r = results[i];
+            out += i ? ",\n" : "\n";
+            out += "{\"name\":\"";
+            append_escaped(out, r.name);
+            std::snprintf(line, sizeof(line),
+                          R"(","iterations":%llu,"median":%.3f,"p10":%.3f,"p90":%.3f,"mean":%.3f,"stddev":%.3f,)",
+                          static_cast<unsigned long long>(r.iterations), r.median, r.p10, r.p90, r.mean, r.stddev);
+            out += line;
+            out += "\"samples\":[";
+            for (size_t s = 0; s < r.samples.size(); ++s) {
+                std::snprintf(line, sizeof(line), s ? ",%.3f" : "%.3f", r.samples[s]);
+                out += line;
+            }
+            out += "]}";
+        }
+        out += "\n]}\n";
+        return out;
+    }
+
+    auto parse_json(const std::string &json, std::vector<BenchmarkResult> &results) -> bool {
+        results.clear();
+        JsonReader in{json.data(), json.data() + json.size()};
+        double version = 0.0;
+        const bool ok = in.object([&](const std::string &key) {
+            if (key == "version") {
+                return in.number(version);
+            }
+            if (key != "benchmarks") {
+                return in.skip();
+            }
+            return in.array([&] {
+                BenchmarkResult result;
+                const bool read = in.object([&](const std::string &field) {
+                    if (field == "name") {
+                        return in.string(result.name);
+                    }
+                    if (field == "iterations") {
+                        double iterations;
+                        if (!in.number(iterations) || iterations < 0.0) {
+                            return false;
+                        }
+                        result.iterations = static_cast<uint64_t>(iterations);
+                        return true;
+                    }
+                    if (field == "samples") {
+                        return in.array([&] {
+                            double sample;
+                            if (!in.number(sample)) {
+                                return false;
+                            }
+                            result.samples.push_back(sample);
+                            return true;
+                        });
+                    }
+                    // the summary is recomputed from the samples
+                    return in.skip();
+                });
+                if (!read || result.name.empty()) {
+                    return false;
+                }
+                summarize(result);
+                results.push_back(std::move(result));
+                return true;
+            });
+        });
+        in.skip_space();
+        return ok && in.at == in.end && version == json_version;
+    }
+
+    auto save_results(const std::vector<BenchmarkResult> &results, const std::string &path) -> bool {
+        std::FILE *file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            return false;
+        }
+        const auto json = to_json(results);
+        const bool ok = std::fwrite(json.data(), 1, json.size(), file) == json.size();
+        return std::fclose(file) == 0 && ok;
+    }
+
+    auto load_results(const std::string &path, std::vector<BenchmarkResult> &results) -> bool {
+        std::FILE *file = std::fopen(path.c_str(), "rb");
+        if (!file) {
+            return false;
+        }
+        std::string json;
+        char buffer[4096];
+        size_t read;
+        while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            json.append(buffer, read);
+        }
+        const bool ok = !std::ferror(file);
+        std::fclose(file);
+        return ok && parse_json(json, results);
+    }
+
+    auto BenchmarkSuite::add(std::string name, Body body) -> void {
+        for (const auto &entry: entries_) {
+            if (entry.name == name) {
+                throw std::invalid_argument("duplicate benchmark name");
+            }
+        }
+        entries_.push_back({std::move(name), std::move(body)});
+    }
+
+    auto BenchmarkSuite::names() const -> std::vector<std::string> {
+        std::vector<std::string> result;
+        for (const auto &entry: entries_) {
+            result.push_back(entry.name);
+        }
+        return result;
+    }
+
+    auto BenchmarkSuite::timed(Body &body, uint64_t iterations) -> std::chrono::nanoseconds {
+        const auto start = Clock::now();
+        sink_ += body(iterations);
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+    }
+
+    auto BenchmarkSuite::run(const BenchmarkOptions &options) -> std::vector<BenchmarkResult> {
+        std::vector<BenchmarkResult> results;
+        for (auto &entry: entries_) {
+            if (!options.filter.empty() && entry.name.find(options.filter) == std::string::npos) {
+                continue;
+            }
+            BenchmarkResult result;
+            result.name = entry.name;
+
+            // grow the count until one run fills min_run_time; the first call doubles as a warm-up
+            uint64_t iterations = 1;
+            for (;;) {
+                const auto elapsed = timed(entry.body, iterations);
+                if (elapsed >= options.min_run_time || iterations >= (uint64_t{1} << 40)) {
+                    break;
+                }
+                const auto estimate = static_cast<double>(iterations) *
+                                      static_cast<double>(options.min_run_time.count()) * 1.2 /
+                                      static_cast<double>(std::max<int64_t>(elapsed.count(), 1));
+                iterations = std::clamp<uint64_t>(static_cast<uint64_t>(estimate), iterations * 2, iterations * 100);
+            }
+            result.iterations = iterations;
+
+            for (uint32_t i = 0; i < options.warmup_runs; ++i) {
+                timed(entry.body, iterations);
+            }
+            for (uint32_t i = 0; i < options.runs; ++i) {
+                const auto elapsed = timed(entry.body, iterations);
+                result.samples.push_back(static_cast<double>(elapsed.count()) / static_cast<double>(iterations));
+            }
+            summarize(result);
+            results.push_back(std::move(result));
+        }
+        return results;
+    }
+
+    auto verdict_name(BenchmarkVerdict verdict) -> const char * {
+        switch (verdict) {
+            case BenchmarkVerdict::unchanged:
+                return "unchanged";
+            case BenchmarkVerdict::faster:
+                return "faster";
+            case BenchmarkVerdict::slower:
+                return "SLOWER";
+            case BenchmarkVerdict::added:
+                return "new";
+            case BenchmarkVerdict::missing:
+                return "MISSING";
+        }
+        return "unknown";
+    }
+
+    auto rank_sum_p_value(const std::vector<double> &a, const std::vector<double> &b) -> double {
+        if (a.size() < 2 || b.size() < 2) {
+            return 1.0;
+        }
+        // pooled samples in order, a's marked, ties given their average rank
+        std::vector<std::pair<double, bool>> pooled;
+        pooled.reserve(a.size() + b.size());
+        for (const auto value: a) {
+            pooled.emplace_back(value, true);
+        }
+        for (const auto value: b) {
+            pooled.emplace_back(value, false);
+        }
+        std::sort(pooled.begin(), pooled.end());
+        const auto n = static_cast<double>(pooled.size());
+        double rank_sum = 0.0;
+        double ties = 0.0; // sum of t^3 - t over groups of t equal values
+        for (size_t i = 0; i < pooled.size();) {
+            size_t j = i;
+            while (j < pooled.size() && pooled[j].first == pooled[i].first) {
+                ++j;
+            }
+            const auto rank = static_cast<double>(i + j + 1) / 2.0; // ranks i + 1 .. j
+            for (size_t k = i; k < j; ++k) {
+                rank_sum += pooled[k].second ? rank : 0.0;
+            }
+            const auto t = static_cast<double>(j - i);
+            ties += t * t * t - t;
+            i = j;
+        }
+
+        const auto n1 = static_cast<double>(a.size());
+        const auto n2 = static_cast<double>(b.size());
+        const auto u = rank_sum - n1 * (n1 + 1.0) / 2.0;
+        const auto mean = n1 * n2 / 2.0;
+        const auto variance = n1 * n2 / 12.0 * ((n + 1.0) - ties / (n * (n - 1.0)));
+        if (variance <= 0.0) {
+            return 1.0; // every sample equal
+        }
+        // continuity-corrected
+        const auto z = std::max(std::abs(u - mean) - 0.5, 0.0) / std::sqrt(variance);
+        return std::erfc(z / std::sqrt(2.0));
+    }
+
+    auto compare(const std::vector<BenchmarkResult> &baseline, const std::vector<BenchmarkResult> &current,
+                 const CompareOptions &options) -> std::vector<BenchmarkComparison> {
+        std::vector<BenchmarkComparison> comparisons;
+        for (const auto &result: current) {
+            BenchmarkComparison c;
+            c.name = result.name;
+            c.current_median = result.median;
+            const auto base = std::find_if(baseline.begin(), baseline.end(),
+                                           [&](const BenchmarkResult &b) { return b.name == result.name; });
+            if (base == baseline.end()) {
+                c.verdict = BenchmarkVerdict::added;
+                comparisons.push_back(c);
+                continue;
+            }
+            c.baseline_median = base->median;
+            c.change = base->median > 0.0 ? result.median / base->median - 1.0 : 0.0;
+            c.p_value = rank_sum_p_value(base->samples, result.samples);
+            if (c.p_value < options.alpha && std::abs(c.change) > options.threshold) {
+                c.verdict = c.change > 0.0 ? BenchmarkVerdict::slower : BenchmarkVerdict::faster;
+            }
+            comparisons.push_back(c);
+        }
+        for (const auto &base: baseline) {
+            const auto ran = std::any_of(current.begin(), current.end(),
+                                         [&](const BenchmarkResult &r) { return r.name == base.name; });
+            if (!ran) {
+                BenchmarkComparison c;
+                c.name = base.name;
+                c.baseline_median = base.median;
+                c.verdict = BenchmarkVerdict::missing;
+                comparisons.push_back(c);
+            }
+        }
+        return comparisons;
+    }
+
+    auto format_comparison(const std::vector<BenchmarkComparison> &comparisons) -> std::string {
+        std::string out;
+        char line[200];
+        std::snprintf(line, sizeof(line), "%-32s %12s %12s %9s %9s  %s\n", "benchmark", "baseline ns", "current ns",
+                      "change", "p", "verdict");
+        out += line;
+        for (const auto &c: comparisons) {
+            if (c.verdict == BenchmarkVerdict::added) {
+                std::snprintf(line, sizeof(line), "%-32s %12s %12.2f %9s %9s  %s\n", c.name.c_str(), "-",
+                              c.current_median, "-", "-", verdict_name(c.verdict));
+            } else if (c.verdict == BenchmarkVerdict::missing) {
+                std::snprintf(line, sizeof(line), "%-32s %12.2f %12s %9s %9s  %s\n", c.name.c_str(),
+                              c.baseline_median, "-", "-", "-", verdict_name(c.verdict));
+            } else {
+                std::snprintf(line, sizeof(line), "%-32s %12.2f %12.2f %+8.1f%% %9.2g  %s\n", c.name.c_str(),
+                              c.baseline_median, c.current_median, 100.0 * c.change, c.p_value,
+                              verdict_name(c.verdict));
+            }
+            out += line;
+        }
+        return out;
+    }
+
+    auto regressions(const std::vector<BenchmarkComparison> &comparisons, bool filtered) -> size_t {
+        return static_cast<size_t>(std::count_if(comparisons.begin(), comparisons.end(),
+                                                 [&](const BenchmarkComparison &c) {
+                                                     return c.verdict == BenchmarkVerdict::slower ||
+                                                            (c.verdict == BenchmarkVerdict::missing && !filtered);
+                                                 }));
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace borderless {
+
+    struct BenchmarkOptions {
+        uint32_t warmup_runs = 2;
+        uint32_t runs = 15;
+        // a run repeats the body until it takes at least this long, so the clock's resolution and
+        // overhead stay well below the measurement
+        std::chrono::nanoseconds min_run_time = std::chrono::milliseconds(5);
+        std::string filter; // runs the benchmarks whose name contains it; empty runs all
+    };
+
+    struct BenchmarkResult {
+        std::string name;
+        uint64_t iterations = 0;     // per run
+        std::vector<double> samples; // ns per iteration, one per run
+        double median = 0.0;
+        double p10 = 0.0;
+        double p90 = 0.0;
+        double mean = 0.0;
+        double stddev = 0.0;
+    };
+
+    // fills in median, percentiles, mean and stddev from result.samples
+    auto summarize(BenchmarkResult &result) -> void;
+
+    // one line per benchmark
+    auto format_benchmark_results(const std::vector<BenchmarkResult> &results) -> std::string;
+
+    // {"version":1,"benchmarks":[...]} with the summary and every sample
+    auto to_json(const std::vector<BenchmarkResult> &results) -> std::string;
+
+    // reads what to_json writes; false on anything else
+    auto parse_json(const std::string &json, std::vector<BenchmarkResult> &results) -> bool;
+
+    auto save_results(const std::vector<BenchmarkResult> &results, const std::string &path) -> bool;
+
+    auto load_results(const std::string &path, std::vector<BenchmarkResult> &results) -> bool;
+
+    /* Named workloads, run with warm-up and repeated timed runs. A body runs its workload the
+     * given number of times and returns something computed from it, which the suite keeps so
+     * the optimizer cannot drop the work. Each benchmark is calibrated once to the iteration
+     * count that fills min_run_time; every run after that uses the same count.
+     */
+    class BenchmarkSuite {
+    public:
+        using Body = std::function<uint64_t(uint64_t iterations)>;
+
+        // names are unique; throws std::invalid_argument for a duplicate
+        auto add(std::string name, Body body) -> void;
+
+        auto names() const -> std::vector<std::string>;
+
+        auto run(const BenchmarkOptions &options) -> std::vector<BenchmarkResult>;
+
+        // folded from every body's result
+        auto sink() const -> uint64_t { return sink_; }
+
+    private:
+        struct Entry {
+            std::string name;
+            Body body;
+        };
+
+        auto timed(Body &body, uint64_t iterations) -> std::chrono::nanoseconds;
+
+        std::vector<Entry> entries_;
+        uint64_t sink_ = 0;
+    };
+
+    enum class BenchmarkVerdict : uint8_t {
+        unchanged, // within the threshold, or the difference is not significant
+        faster,
+        slower,
+        added,     // not in the baseline
+        missing,   // in the baseline, but not run: renamed, dropped or filtered out
+    };
+
+    auto verdict_name(BenchmarkVerdict verdict) -> const char *;
+
+    struct CompareOptions {
+        double threshold = 0.10; // relative change of the median that counts
+        double alpha = 0.01;     // significance level of the rank-sum test
+    };
+
+    struct BenchmarkComparison {
+        std::string name;
+        double baseline_median = 0.0;
+        double current_median = 0.0;
+        double change = 0.0;  // current / baseline - 1
+        double p_value = 1.0; // two-sided, Mann-Whitney U
+        BenchmarkVerdict verdict = BenchmarkVerdict::unchanged;
+    };
+
+    // two-sided p-value of the Mann-Whitney U test (normal approximation with tie correction) that
+    // a and b come from the same distribution; 1 when either has fewer than two samples
+    auto rank_sum_p_value(const std::vector<double> &a, const std::vector<double> &b) -> double;
+
+    // one comparison per benchmark in current, then one per baseline benchmark missing from it;
+    // slower or faster needs both a change beyond the threshold and a significant difference
+    // between the samples
+    auto compare(const std::vector<BenchmarkResult> &baseline, const std::vector<BenchmarkResult> &current,
+                 const CompareOptions &options = {}) -> std::vector<BenchmarkComparison>;
+
+    auto format_comparison(const std::vector<BenchmarkComparison> &comparisons) -> std::string;
+
+    // slower benchmarks, and missing ones unless the run was filtered and skipped them on purpose
+    auto regressions(const std::vector<BenchmarkComparison> &comparisons, bool filtered = false) -> size_t;
+}
@@ -0,0 +1,91 @@
+#include "BrushCache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace borderless {
+
+    namespace {
+        // the bits, not std::hash<float>: that hashes every float as a byte string, which dominated a lookup
+        auto bits(float value) -> uint64_t {
+            // -0 and 0 compare equal, so they must hash equal
+            if (value == 0.0f) {
+                return 0;
+            }
+            uint32_t word;
+            std::memcpy(&word, &value, sizeof(word));
+            return word;
+        }
+
+        auto mix(uint64_t seed, uint64_t value) -> uint64_t {
+            seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+            return seed * 0xff51afd7ed558ccdull;
+        }
+
+        auto hash_color(uint64_t seed, const Color &color) -> uint64_t {
+            return mix(mix(seed, bits(color.r) << 32 | bits(color.g)), bits(color.b) << 32 | bits(color.a));
+        }
+    }
+
+    auto BrushKey::linear(PointF start, PointF end, std::initializer_list<GradientStop> stops,
+                          float opacity) -> BrushKey {
+        if (stops.size() < 2 || stops.size() > max_gradient_stops) {
+            throw std::invalid_argument("a linear gradient takes 2 to max_gradient_stops stops");
+        }
+        BrushKey key;
+        key.kind = BrushKind::linear_gradient;
+        key.opacity = opacity;
+        key.start = start;
+        key.end = end;
+        key.stop_count = static_cast<uint8_t>(stops.size());
+        std::copy(stops.begin(), stops.end(), key.stops.begin());
+        return key;
+    }
+
+    auto operator==(const BrushKey &a, const BrushKey &b) -> bool {
+        if (a.kind != b.kind || a.opacity != b.opacity) {
+            return false;
+        }
+        if (a.kind == BrushKind::solid) {
+            return a.color == b.color;
+        }
+        if (a.start.x != b.start.x || a.start.y != b.start.y || a.end.x != b.end.x || a.end.y != b.end.y ||
+            a.stop_count != b.stop_count) {
+            return false;
+        }
+        for (size_t i = 0; i < a.stop_count; ++i) {
+            if (a.stops[i].offset != b.stops[i].offset || a.stops[i].color != b.stops[i].color) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    auto BrushKeyHash::operator()(const BrushKey &key) const -> size_t {
+        // only what operator== compares for the kind
+        auto h = mix(static_cast<uint64_t>(key.kind), bits(key.opacity));
+        if (key.kind == BrushKind::solid) {
+            return static_cast<size_t>(hash_color(h, key.color) >> 16);
+        }
+        h = mix(mix(h, bits(key.start.x) << 32 | bits(key.start.y)), bits(key.end.x) << 32 | bits(key.end.y));
+        for (size_t i = 0; i < key.stop_count; ++i) {
+            h = hash_color(mix(h, bits(key.stops[i].offset)), key.stops[i].color);
+        }
+        return static_cast<size_t>(h >> 16);
+    }
+
+    auto format_brush_stats(const BrushCacheStats &stats) -> std::string {
+        const auto lookups = stats.hits + stats.misses;
+        char line[200];
+        std::snprintf(line, sizeof(line),
+                      "brushes: %llu hits, %llu created (%.1f%% hit rate), %llu trimmed, %zu used last frame\n",
+                      static_cast<unsigned long long>(stats.hits),
+                      static_cast<unsigned long long>(stats.misses),
+                      lookups ? 100.0 * double(stats.hits) / double(lookups) : 0.0,
+                      static_cast<unsigned long long>(stats.trimmed),
+                      stats.used);
+        return line;
+    }
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Color.hpp"
+#include "Geometry.hpp"
+
+namespace borderless {
+
+    enum class BrushKind : uint8_t {
+        solid,
+        linear_gradient,
+    };
+
+    struct GradientStop {
+        float offset = 0.0f; // 0..1 along the gradient
+        Color color;
+    };
+
+    constexpr size_t max_gradient_stops = 4;
+
+    // everything a brush is made of; two equal keys draw the same pixels
+    struct BrushKey {
+        BrushKind kind = BrushKind::solid;
+        Color color;                // solid only
+        float opacity = 1.0f;
+        PointF start;               // gradients, in the coordinates of what is drawn
+        PointF end;
+        uint8_t stop_count = 0;
+        std::array<GradientStop, max_gradient_stops> stops{};
+
+        static auto solid(const Color &color, float opacity = 1.0f) -> BrushKey {
+            BrushKey key;
+            key.color = color;
+            key.opacity = opacity;
+            return key;
+        }
+
+        // throws std::invalid_argument for fewer than two or more than max_gradient_stops stops
+        static auto linear(PointF start, PointF end, std::initializer_list<GradientStop> stops,
+                           float opacity = 1.0f) -> BrushKey;
+    };
+
+    auto operator==(const BrushKey &a, const BrushKey &b) -> bool;
+
+    struct BrushKeyHash {
+        auto operator()(const BrushKey &key) const -> size_t;
+    };
+
+    struct BrushCacheStats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;        // each one is a brush created
+        uint64_t trimmed = 0;       // dropped after going unused for idle_frames, or over capacity
+        size_t used = 0;            // distinct brushes used in the last finished frame
+    };
+
+    auto format_brush_stats(const BrushCacheStats &stats) -> std::string;
+
+    /* Immutable brushes shared by everything drawn with the same color, opacity or gradient, instead
+     * of one brush whose color is changed before every draw. A brush is created on the first lookup
+     * of its key and never modified afterwards, so draws with different brushes need no state change
+     * in between and can be batched by the backend.
+     * Backend supplies the platform objects:
+     *   using Brush = ...;
+     *   auto create_brush(const BrushKey &) -> Brush;
+     * A frame is what lies between two begin_frame() calls, i.e. one paint pass of the renderer.
+     * begin_frame() drops brushes unused for idle_frames frames and, above capacity, the coldest ones;
+     * a brush used in the frame that just ended is never dropped. Not thread-safe; one cache per
+     * render target.
+     */
+    template<typename Backend>
+    class BrushCache {
+    public:
+        using Brush = typename Backend::Brush;
+
+        explicit BrushCache(Backend backend, size_t capacity = 64, uint64_t idle_frames = 120) :
+                backend_(std::move(backend)),
+                capacity_(capacity == 0 ? 1 : capacity),
+                idle_frames_(idle_frames) {}
+
+        BrushCache(const BrushCache &) = delete;
+
+        auto operator=(const BrushCache &) -> BrushCache & = delete;
+
+        BrushCache(BrushCache &&) = default;
+
+        auto operator=(BrushCache &&) -> BrushCache & = default;
+
+        // the brush for key, created on a miss; valid until the next begin_frame()
+        auto get(const BrushKey &key) -> const Brush & {
+            auto it = brushes_.find(key);
+            if (it == brushes_.end()) {
+                ++stats_.misses;
+                it = brushes_.emplace(key, Entry{backend_.create_brush(key), 0}).first;
+            } else {
+                ++stats_.hits;
+            }
+            if (it->second.last_used != frame_) {
+                it->second.last_used = frame_;
+                ++used_;
+            }
+            return it->second.brush;
+        }
+
+        auto solid(const Color &color, float opacity = 1.0f) -> const Brush & {
+            return get(BrushKey::solid(color, opacity));
+        }
+
+        // ends the frame, then trims what went cold
+        auto begin_frame() -> void {
+            stats_.used = used_;
+            used_ = 0;
+            const auto finished = frame_++;
+            for (auto it = brushes_.begin(); it != brushes_.end();) {
+                if (it->second.last_used + idle_frames_ < finished) {
+                    it = brushes_.erase(it);
+                    ++stats_.trimmed;
+                } else {
+                    ++it;
+                }
+            }
+            if (brushes_.size() > capacity_) {
+                trim_to_capacity(finished);
+            }
+        }
+
+        // drops every brush, e.g. after the device was lost
+        auto clear() -> void {
+            brushes_.clear();
+            used_ = 0;
+        }
+
+        auto size() const -> size_t { return brushes_.size(); }
+
+        auto stats() const -> const BrushCacheStats & { return stats_; }
+
+        auto backend() -> Backend & { return backend_; }
+
+    private:
+        struct Entry {
+            Brush brush;
+            uint64_t last_used = 0; // frame
+        };
+
+        auto trim_to_capacity(uint64_t finished) -> void {
+            using Iterator = typename decltype(brushes_)::iterator;
+            std::vector<Iterator> coldest;
+            coldest.reserve(brushes_.size());
+            for (auto it = brushes_.begin(); it != brushes_.end(); ++it) {
+                if (it->second.last_used < finished) {
+                    coldest.push_back(it);
+                }
+            }
+            const auto excess = std::min(brushes_.size() - capacity_, coldest.size());
+            std::nth_element(coldest.begin(), coldest.begin() + static_cast<ptrdiff_t>(excess), coldest.end(),
+                             [](Iterator a, Iterator b) { return a->second.last_used < b->second.last_used; });
+            for (size_t i = 0; i < excess; ++i) {
+                brushes_.erase(coldest[i]);
+                ++stats_.trimmed;
+            }
+        }
+
+        Backend backend_;
+        size_t capacity_;
+        uint64_t idle_frames_;
+        std::unordered_map<BrushKey, Entry, BrushKeyHash> brushes_;
+        uint64_t frame_ = 1;
+        size_t used_ = 0;
+        BrushCacheStats stats_;
+    };
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace borderless {
+
+    // a non-owning range of bytes, e.g. part of a memory-mapped file
+    struct ByteView {
+        const uint8_t *data = nullptr;
+        size_t size = 0;
+
+        auto empty() const -> bool { return size == 0; }
+
+        auto begin() const -> const uint8_t * { return data; }
+
+        auto end() const -> const uint8_t * { return data + size; }
+
+        // [offset, offset + length) or an empty view when that is out of range
+        auto sub(size_t offset, size_t length) const -> ByteView {
+            if (offset > size || length > size - offset) {
+                return {};
+            }
+            return {data + offset, length};
+        }
+    };
+
+    inline auto view(const std::vector<uint8_t> &bytes) -> ByteView { return {bytes.data(), bytes.size()}; }
+}
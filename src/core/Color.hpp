@@ -0,0 +1,20 @@
+#pragma once
+
+namespace borderless {
+
+    // straight (non-premultiplied) RGBA in 0..1, same layout as D2D1_COLOR_F
+    struct Color {
+        float r = 0.0f;
+        float g = 0.0f;
+        float b = 0.0f;
+        float a = 1.0f;
+    };
+
+    inline auto operator==(const Color &x, const Color &y) -> bool {
+        return x.r == y.r && x.g == y.g && x.b == y.b && x.a == y.a;
+    }
+
+    inline auto operator!=(const Color &x, const Color &y) -> bool {
+        return !(x == y);
+    }
+}
@@ -0,0 +1,314 @@
+#include "CpuKernels.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define BORDERLESS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(BORDERLESS_X86) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define BORDERLESS_HAS_SSE2 1
+#endif
+
+// AVX2 kernels are always compiled on x86 and only selected when the CPU supports them
+#if defined(BORDERLESS_X86) && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+#define BORDERLESS_HAS_AVX2 1
+#if defined(__GNUC__) || defined(__clang__)
+#define BORDERLESS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define BORDERLESS_TARGET_AVX2
+#endif
+#endif
+
+namespace borderless::kernels {
+
+    namespace {
+
+        // ---- scalar --------------------------------------------------------------------------
+
+        auto scale_pixel(uint32_t p, uint32_t m) -> uint32_t {
+            return div255((p & 0xff) * m) |
+                   div255(((p >> 8) & 0xff) * m) << 8 |
+                   div255(((p >> 16) & 0xff) * m) << 16 |
+                   div255((p >> 24) * m) << 24;
+        }
+
+        auto over_pixel(uint32_t s, uint32_t d) -> uint32_t {
+            const uint32_t inv = 255 - (s >> 24);
+            uint32_t out = 0;
+            for (uint32_t shift = 0; shift < 32; shift += 8) {
+                const uint32_t c = ((s >> shift) & 0xff) + div255(((d >> shift) & 0xff) * inv);
+                out |= std::min(c, 255u) << shift; // saturate like packus for non-premultiplied input
+            }
+            return out;
+        }
+
+        void fill_scalar(uint32_t *dst, size_t count, uint32_t color) {
+            std::fill_n(dst, count, color);
+        }
+
+        void blend_solid_scalar(uint32_t *dst, size_t count, uint32_t color) {
+            for (size_t i = 0; i < count; ++i) {
+                dst[i] = over_pixel(color, dst[i]);
+            }
+        }
+
+        void blend_mask_scalar(uint32_t *dst, const uint8_t *mask, size_t count, uint32_t color) {
+            for (size_t i = 0; i < count; ++i) {
+                if (mask[i]) {
+                    dst[i] = over_pixel(scale_pixel(color, mask[i]), dst[i]);
+                }
+            }
+        }
+
+        void blend_bitmap_scalar(uint32_t *dst, const uint32_t *src, size_t count, uint8_t opacity) {
+            for (size_t i = 0; i < count; ++i) {
+                dst[i] = over_pixel(scale_pixel(src[i], opacity), dst[i]);
+            }
+        }
+
+        constexpr KernelTable scalar_table{fill_scalar, blend_solid_scalar, blend_mask_scalar, blend_bitmap_scalar};
+
+#if defined(BORDERLESS_HAS_SSE2)
+        // ---- SSE2, 4 pixels per step, two pixels per register as 16-bit channels ----------
+
+        inline auto div255_sse2(__m128i x) -> __m128i {
+            x = _mm_add_epi16(x, _mm_set1_epi16(128));
+            return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+        }
+
+        inline auto over_sse2(__m128i s, __m128i d) -> __m128i {
+            auto a = _mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3));
+            a = _mm_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+            const auto inv = _mm_sub_epi16(_mm_set1_epi16(255), a);
+            return _mm_add_epi16(s, div255_sse2(_mm_mullo_epi16(d, inv)));
+        }
+
+        void fill_sse2(uint32_t *dst, size_t count, uint32_t color) {
+            const auto c = _mm_set1_epi32(static_cast<int>(color));
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), c);
+            }
+            fill_scalar(dst + i, count - i, color);
+        }
+
+        void blend_solid_sse2(uint32_t *dst, size_t count, uint32_t color) {
+            const auto zero = _mm_setzero_si128();
+            const auto s = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(color)), zero);
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                auto d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+                const auto lo = over_sse2(s, _mm_unpacklo_epi8(d, zero));
+                const auto hi = over_sse2(s, _mm_unpackhi_epi8(d, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(lo, hi));
+            }
+            blend_solid_scalar(dst + i, count - i, color);
+        }
+
+        void blend_mask_sse2(uint32_t *dst, const uint8_t *mask, size_t count, uint32_t color) {
+            const auto zero = _mm_setzero_si128();
+            const auto c = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(color)), zero);
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                int32_t m4;
+                std::memcpy(&m4, mask + i, sizeof(m4));
+                if (m4 == 0) {
+                    continue;
+                }
+                // replicate each coverage byte across its pixel's four channels
+                auto m = _mm_cvtsi32_si128(m4);
+                m = _mm_unpacklo_epi8(m, m);
+                m = _mm_unpacklo_epi16(m, m);
+
+                auto d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+                const auto s_lo = div255_sse2(_mm_mullo_epi16(c, _mm_unpacklo_epi8(m, zero)));
+                const auto s_hi = div255_sse2(_mm_mullo_epi16(c, _mm_unpackhi_epi8(m, zero)));
+                const auto lo = over_sse2(s_lo, _mm_unpacklo_epi8(d, zero));
+                const auto hi = over_sse2(s_hi, _mm_unpackhi_epi8(d, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(lo, hi));
+            }
+            blend_mask_scalar(dst + i, mask + i, count - i, color);
+        }
+
+        void blend_bitmap_sse2(uint32_t *dst, const uint32_t *src, size_t count, uint8_t opacity) {
+            const auto zero = _mm_setzero_si128();
+            const auto o = _mm_set1_epi16(opacity);
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                auto s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+                auto d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+                const auto s_lo = div255_sse2(_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), o));
+                const auto s_hi = div255_sse2(_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), o));
+                const auto lo = over_sse2(s_lo, _mm_unpacklo_epi8(d, zero));
+                const auto hi = over_sse2(s_hi, _mm_unpackhi_epi8(d, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(lo, hi));
+            }
+            blend_bitmap_scalar(dst + i, src + i, count - i, opacity);
+        }
+
+        constexpr KernelTable sse2_table{fill_sse2, blend_solid_sse2, blend_mask_sse2, blend_bitmap_sse2};
+#endif
+
+#if defined(BORDERLESS_HAS_AVX2)
+        // ---- AVX2, 8 pixels per step; unpack/pack work per 128-bit lane, so order is preserved
+
+        BORDERLESS_TARGET_AVX2 inline auto div255_avx2(__m256i x) -> __m256i {
+            x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+            return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+        }
+
+        BORDERLESS_TARGET_AVX2 inline auto over_avx2(__m256i s, __m256i d) -> __m256i {
+            auto a = _mm256_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3));
+            a = _mm256_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+            const auto inv = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+            return _mm256_add_epi16(s, div255_avx2(_mm256_mullo_epi16(d, inv)));
+        }
+
+        BORDERLESS_TARGET_AVX2 void fill_avx2(uint32_t *dst, size_t count, uint32_t color) {
+            const auto c = _mm256_set1_epi32(static_cast<int>(color));
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), c);
+            }
+            fill_scalar(dst + i, count - i, color);
+        }
+
+        BORDERLESS_TARGET_AVX2 void blend_solid_avx2(uint32_t *dst, size_t count, uint32_t color) {
+            const auto zero = _mm256_setzero_si256();
+            const auto s = _mm256_unpacklo_epi8(_mm256_set1_epi32(static_cast<int>(color)), zero);
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                auto d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+                const auto lo = over_avx2(s, _mm256_unpacklo_epi8(d, zero));
+                const auto hi = over_avx2(s, _mm256_unpackhi_epi8(d, zero));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_packus_epi16(lo, hi));
+            }
+            blend_solid_scalar(dst + i, count - i, color);
+        }
+
+        BORDERLESS_TARGET_AVX2 void blend_mask_avx2(uint32_t *dst, const uint8_t *mask, size_t count, uint32_t color) {
+            const auto zero = _mm256_setzero_si256();
+            const auto c = _mm256_unpacklo_epi8(_mm256_set1_epi32(static_cast<int>(color)), zero);
+            // picks byte 0 of every 32-bit lane into all four of its bytes
+            const auto replicate = _mm256_setr_epi8(0, 0, 0, 0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12,
+                                                    0, 0, 0, 0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12);
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                int64_t m8;
+                std::memcpy(&m8, mask + i, sizeof(m8));
+                if (m8 == 0) {
+                    continue;
+                }
+                const auto m = _mm256_shuffle_epi8(
+                        _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(mask + i))),
+                        replicate);
+
+                auto d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+                const auto s_lo = div255_avx2(_mm256_mullo_epi16(c, _mm256_unpacklo_epi8(m, zero)));
+                const auto s_hi = div255_avx2(_mm256_mullo_epi16(c, _mm256_unpackhi_epi8(m, zero)));
+                const auto lo = over_avx2(s_lo, _mm256_unpacklo_epi8(d, zero));
+                const auto hi = over_avx2(s_hi, _mm256_unpackhi_epi8(d, zero));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_packus_epi16(lo, hi));
+            }
+            blend_mask_scalar(dst + i, mask + i, count - i, color);
+        }
+
+        BORDERLESS_TARGET_AVX2 void blend_bitmap_avx2(uint32_t *dst, const uint32_t *src, size_t count, uint8_t opacity) {
+            const auto zero = _mm256_setzero_si256();
+            const auto o = _mm256_set1_epi16(opacity);
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                auto s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+                auto d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+                const auto s_lo = div255_avx2(_mm256_mullo_epi16(_mm256_unpacklo_epi8(s, zero), o));
+                const auto s_hi = div255_avx2(_mm256_mullo_epi16(_mm256_unpackhi_epi8(s, zero), o));
+                const auto lo = over_avx2(s_lo, _mm256_unpacklo_epi8(d, zero));
+                const auto hi = over_avx2(s_hi, _mm256_unpackhi_epi8(d, zero));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_packus_epi16(lo, hi));
+            }
+            blend_bitmap_scalar(dst + i, src + i, count - i, opacity);
+        }
+
+        constexpr KernelTable avx2_table{fill_avx2, blend_solid_avx2, blend_mask_avx2, blend_bitmap_avx2};
+
+        auto cpu_has_avx2() -> bool {
+#if defined(_MSC_VER) && !defined(__clang__)
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7) {
+                return false;
+            }
+            __cpuid(info, 1);
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+            const bool avx = (info[2] & (1 << 28)) != 0;
+            if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+                return false;
+            }
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            return __builtin_cpu_supports("avx2");
+#endif
+        }
+#endif
+    }
+
+    auto simd_level_name(SimdLevel level) -> const char * {
+        switch (level) {
+            case SimdLevel::sse2:
+                return "sse2";
+            case SimdLevel::avx2:
+                return "avx2";
+            default:
+                return "scalar";
+        }
+    }
+
+    auto simd_supported(SimdLevel level) -> bool {
+        switch (level) {
+            case SimdLevel::scalar:
+                return true;
+            case SimdLevel::sse2:
+#if defined(BORDERLESS_HAS_SSE2)
+                return true;
+#else
+                return false;
+#endif
+            case SimdLevel::avx2:
+#if defined(BORDERLESS_HAS_AVX2)
+                static const bool avx2 = cpu_has_avx2();
+                return avx2;
+#else
+                return false;
+#endif
+        }
+        return false;
+    }
+
+    auto detect_simd() -> SimdLevel {
+        if (simd_supported(SimdLevel::avx2)) return SimdLevel::avx2;
+        if (simd_supported(SimdLevel::sse2)) return SimdLevel::sse2;
+        return SimdLevel::scalar;
+    }
+
+    auto kernels(SimdLevel level) -> const KernelTable & {
+#if defined(BORDERLESS_HAS_AVX2)
+        if (level == SimdLevel::avx2 && simd_supported(SimdLevel::avx2)) {
+            return avx2_table;
+        }
+#endif
+#if defined(BORDERLESS_HAS_SSE2)
+        if (level != SimdLevel::scalar) {
+            return sse2_table;
+        }
+#endif
+        (void) level;
+        return scalar_table;
+    }
+}
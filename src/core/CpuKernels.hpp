@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Pixel kernels of the CPU renderer. Pixels are premultiplied BGRA packed as uint32_t
+// (B in the low byte), the memory layout of DXGI_FORMAT_B8G8R8A8_UNORM.
+// Every SIMD level produces bit-identical results to the scalar kernels.
+namespace borderless::kernels {
+
+    enum class SimdLevel {
+        scalar,
+        sse2,
+        avx2,
+    };
+
+    auto simd_level_name(SimdLevel level) -> const char *;
+
+    // best level this build and CPU support
+    auto detect_simd() -> SimdLevel;
+
+    // whether level is compiled in and supported by the CPU
+    auto simd_supported(SimdLevel level) -> bool;
+
+    struct KernelTable {
+        // dst[i] = color
+        void (*fill)(uint32_t *dst, size_t count, uint32_t color);
+
+        // dst[i] = color over dst[i]
+        void (*blend_solid)(uint32_t *dst, size_t count, uint32_t color);
+
+        // dst[i] = (color * mask[i]) over dst[i]
+        void (*blend_mask)(uint32_t *dst, const uint8_t *mask, size_t count, uint32_t color);
+
+        // dst[i] = (src[i] * opacity) over dst[i]
+        void (*blend_bitmap)(uint32_t *dst, const uint32_t *src, size_t count, uint8_t opacity);
+    };
+
+    // falls back to the best supported level below the requested one
+    auto kernels(SimdLevel level) -> const KernelTable &;
+
+    // exact round(x / 255) for x <= 255 * 255
+    inline auto div255(uint32_t x) -> uint32_t {
+        x += 128;
+        return (x + (x >> 8)) >> 8;
+    }
+}
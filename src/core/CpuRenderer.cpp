@@ -0,0 +1,283 @@
+#include "CpuRenderer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace borderless {
+
+    namespace {
+        constexpr int subsamples = 4;
+        constexpr uint16_t full_subsample = 64; // coverage of one fully covered sub-row
+
+        auto to_byte(float v) -> uint32_t {
+            return static_cast<uint32_t>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+
+        // adds the coverage of [x0, x1) on one sub-row to acc, whose first element is pixel `base`
+        auto add_span(uint16_t *acc, int32_t base, float x0, float x1, int32_t lo, int32_t hi) -> void {
+            x0 = std::max(x0, static_cast<float>(lo));
+            x1 = std::min(x1, static_cast<float>(hi));
+            if (x1 <= x0) {
+                return;
+            }
+            const auto p0 = static_cast<int32_t>(std::floor(x0));
+            const auto p1 = static_cast<int32_t>(std::floor(x1));
+            if (p0 == p1) {
+                acc[p0 - base] += static_cast<uint16_t>((x1 - x0) * full_subsample + 0.5f);
+                return;
+            }
+            acc[p0 - base] += static_cast<uint16_t>((static_cast<float>(p0 + 1) - x0) * full_subsample + 0.5f);
+            for (int32_t p = p0 + 1; p < p1; ++p) {
+                acc[p - base] += full_subsample;
+            }
+            if (p1 < hi) {
+                acc[p1 - base] += static_cast<uint16_t>((x1 - static_cast<float>(p1)) * full_subsample + 0.5f);
+            }
+        }
+
+        // fraction of pixel [p, p + 1) covered by [a, b), as 0..255
+        auto pixel_coverage(int32_t p, float a, float b) -> uint32_t {
+            const float lo = std::max(a, static_cast<float>(p));
+            const float hi = std::min(b, static_cast<float>(p + 1));
+            return hi > lo ? to_byte(hi - lo) : 0;
+        }
+    }
+
+    auto premultiply(const Color &color) -> uint32_t {
+        const float a = std::clamp(color.a, 0.0f, 1.0f);
+        return to_byte(color.b * a) | to_byte(color.g * a) << 8 | to_byte(color.r * a) << 16 | to_byte(a) << 24;
+    }
+
+    CpuRenderer::CpuRenderer(Surface &surface, kernels::SimdLevel level) :
+            surface_(surface),
+            level_(kernels::simd_supported(level) ? level : kernels::detect_simd()),
+            k_(kernels::kernels(level_)) {
+        clips_.push_back({0, 0, surface_.width, surface_.height});
+    }
+
+    auto CpuRenderer::add_image(const BitmapView &image) -> uint32_t {
+        images_.push_back(image);
+        return static_cast<uint32_t>(images_.size() - 1);
+    }
+
+    auto CpuRenderer::begin_frame() -> void {
+        clips_.assign(1, {0, 0, surface_.width, surface_.height});
+        transform_ = {};
+    }
+
+    auto CpuRenderer::end_frame() -> void {
+    }
+
+    auto CpuRenderer::push_clip(const Rect &rect) -> void {
+        clips_.push_back(intersect(clip(), rect));
+    }
+
+    auto CpuRenderer::pop_clip() -> void {
+        if (clips_.size() > 1) {
+            clips_.pop_back();
+        }
+    }
+
+    auto CpuRenderer::clear(const Color &color) -> void {
+        const auto &c = clip();
+        if (c.empty()) {
+            return;
+        }
+        const auto pixel = premultiply(color);
+        for (int32_t y = c.top; y < c.bottom; ++y) {
+            k_.fill(surface_.row(y) + c.left, static_cast<size_t>(c.width()), pixel);
+        }
+    }
+
+    auto CpuRenderer::fill_rect(const RectF &rect, const Color &color) -> void {
+        const auto b = transform_.apply(rect);
+        const auto px = intersect(round_out(b), clip());
+        if (px.empty()) {
+            return;
+        }
+        const auto pixel = premultiply(color);
+        const auto width = static_cast<size_t>(px.width());
+
+        // coverage of every column; interior columns are 255
+        mask_.resize(width * 2);
+        auto columns = mask_.data();
+        auto row_mask = mask_.data() + width;
+        bool columns_full = true;
+        for (int32_t x = px.left; x < px.right; ++x) {
+            columns[x - px.left] = static_cast<uint8_t>(pixel_coverage(x, b.left, b.right));
+            columns_full = columns_full && columns[x - px.left] == 255;
+        }
+
+        for (int32_t y = px.top; y < px.bottom; ++y) {
+            auto dst = surface_.row(y) + px.left;
+            const auto row = pixel_coverage(y, b.top, b.bottom);
+            if (row == 255 && columns_full) {
+                if ((pixel >> 24) == 255) {
+                    k_.fill(dst, width, pixel);
+                } else {
+                    k_.blend_solid(dst, width, pixel);
+                }
+            } else if (row == 255) {
+                k_.blend_mask(dst, columns, width, pixel);
+            } else {
+                for (size_t i = 0; i < width; ++i) {
+                    row_mask[i] = static_cast<uint8_t>(kernels::div255(columns[i] * row));
+                }
+                k_.blend_mask(dst, row_mask, width, pixel);
+            }
+        }
+    }
+
+    auto CpuRenderer::fill_ellipse(PointF center, float radius_x, float radius_y, const Color &color) -> void {
+        const auto b = transform_.apply(RectF{center.x - radius_x, center.y - radius_y,
+                                              center.x + radius_x, center.y + radius_y});
+        const auto px = intersect(round_out(b), clip());
+        if (px.empty() || b.empty()) {
+            return;
+        }
+        const float cx = (b.left + b.right) * 0.5f, cy = (b.top + b.bottom) * 0.5f;
+        const float rx = (b.right - b.left) * 0.5f, ry = (b.bottom - b.top) * 0.5f;
+        const auto pixel = premultiply(color);
+        const auto width = static_cast<size_t>(px.width());
+
+        const bool opaque = (pixel >> 24) == 255;
+
+        coverage_.resize(width);
+        mask_.resize(width);
+        for (int32_t y = px.top; y < px.bottom; ++y) {
+            float x0[subsamples], x1[subsamples];
+            int rows = 0;
+            float inner_left = b.right, inner_right = b.left;
+            for (int s = 0; s < subsamples; ++s) {
+                const float sy = static_cast<float>(y) + (static_cast<float>(s) + 0.5f) / subsamples;
+                const float t = (sy - cy) / ry;
+                if (t <= -1.0f || t >= 1.0f) {
+                    continue;
+                }
+                const float half = rx * std::sqrt(1.0f - t * t);
+                x0[rows] = cx - half;
+                x1[rows] = cx + half;
+                inner_left = rows ? std::max(inner_left, x0[rows]) : x0[rows];
+                inner_right = rows ? std::min(inner_right, x1[rows]) : x1[rows];
+                ++rows;
+            }
+            if (rows == 0) {
+                continue;
+            }
+
+            // pixels covered by every sub-row take the solid path, only the edges need coverage
+            int32_t solid_left = px.right, solid_right = px.right;
+            if (rows == subsamples) {
+                solid_left = std::clamp(static_cast<int32_t>(std::ceil(inner_left)), px.left, px.right);
+                solid_right = std::clamp(static_cast<int32_t>(std::floor(inner_right)), solid_left, px.right);
+            }
+            const auto row = surface_.row(y);
+
+            const auto blend_edge = [&](int32_t lo, int32_t hi) {
+                if (lo >= hi) {
+                    return;
+                }
+                const auto n = static_cast<size_t>(hi - lo);
+                std::fill_n(coverage_.begin(), n, uint16_t{0});
+                for (int s = 0; s < rows; ++s) {
+                    add_span(coverage_.data(), lo, x0[s], x1[s], lo, hi);
+                }
+                size_t first = n, last = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    mask_[i] = static_cast<uint8_t>(std::min<uint16_t>(coverage_[i], 255));
+                    if (mask_[i]) {
+                        first = std::min(first, i);
+                        last = i;
+                    }
+                }
+                if (first <= last) {
+                    k_.blend_mask(row + lo + first, mask_.data() + first, last - first + 1, pixel);
+                }
+            };
+
+            blend_edge(px.left, solid_left);
+            if (solid_left < solid_right) {
+                const auto n = static_cast<size_t>(solid_right - solid_left);
+                if (opaque) {
+                    k_.fill(row + solid_left, n, pixel);
+                } else {
+                    k_.blend_solid(row + solid_left, n, pixel);
+                }
+            }
+            blend_edge(solid_right, px.right);
+        }
+    }
+
+    auto CpuRenderer::draw_mask(const AlphaMask &mask, Point origin, const Color &color) -> void {
+        const auto r = intersect({origin.x, origin.y, origin.x + mask.width, origin.y + mask.height}, clip());
+        if (r.empty()) {
+            return;
+        }
+        const auto pixel = premultiply(color);
+        for (int32_t y = r.top; y < r.bottom; ++y) {
+            const auto src = mask.pixels + static_cast<size_t>(y - origin.y) * mask.stride + (r.left - origin.x);
+            k_.blend_mask(surface_.row(y) + r.left, src, static_cast<size_t>(r.width()), pixel);
+        }
+    }
+
+    auto CpuRenderer::draw_text(const TextLayoutKey &layout, PointF origin, const Color &color) -> void {
+        if (!text_rasterizer_) {
+            return;
+        }
+        if (auto mask = text_rasterizer_(layout)) {
+            const auto p = transform_.apply(origin);
+            push_clip(round_out(transform_.apply(RectF{origin.x, origin.y, origin.x + layout.max_width,
+                                                       origin.y + layout.max_height})));
+            draw_mask(*mask, {static_cast<int32_t>(std::lround(p.x)), static_cast<int32_t>(std::lround(p.y))}, color);
+            pop_clip();
+        }
+    }
+
+    auto CpuRenderer::draw_glyphs(const GlyphAtlas &atlas, const std::vector<GlyphQuad> &quads,
+                                  const Color &color) -> void {
+        for (const auto &quad: quads) {
+            const auto page = atlas.page(quad.page);
+            if (!page.pixels) {
+                continue;
+            }
+            const AlphaMask glyph{page.pixels + static_cast<size_t>(quad.source.top) * page.stride + quad.source.left,
+                                  quad.source.width(), quad.source.height(), page.stride};
+            draw_mask(glyph, quad.origin, color);
+        }
+    }
+
+    auto CpuRenderer::draw_image(uint32_t image, const RectF &destination, float opacity) -> void {
+        if (image >= images_.size()) {
+            return;
+        }
+        const auto &img = images_[image];
+        const auto b = transform_.apply(destination);
+        const Rect d{static_cast<int32_t>(std::lround(b.left)), static_cast<int32_t>(std::lround(b.top)),
+                     static_cast<int32_t>(std::lround(b.right)), static_cast<int32_t>(std::lround(b.bottom))};
+        const auto r = intersect(d, clip());
+        if (r.empty() || img.width <= 0 || img.height <= 0) {
+            return;
+        }
+        const auto alpha = static_cast<uint8_t>(to_byte(opacity));
+        const auto width = static_cast<size_t>(r.width());
+        const bool unscaled = d.width() == img.width && d.height() == img.height;
+
+        sampled_.resize(width);
+        for (int32_t y = r.top; y < r.bottom; ++y) {
+            const auto dst = surface_.row(y) + r.left;
+            if (unscaled) {
+                const auto src = img.pixels + static_cast<size_t>(y - d.top) * img.stride + (r.left - d.left);
+                k_.blend_bitmap(dst, src, width, alpha);
+                continue;
+            }
+            // nearest neighbour, sampling at pixel centres
+            const auto sy = static_cast<int32_t>((int64_t{2} * (y - d.top) + 1) * img.height / (int64_t{2} * d.height()));
+            const auto src_row = img.pixels + static_cast<size_t>(sy) * img.stride;
+            for (int32_t x = r.left; x < r.right; ++x) {
+                const auto sx = static_cast<int32_t>((int64_t{2} * (x - d.left) + 1) * img.width / (int64_t{2} * d.width()));
+                sampled_[x - r.left] = src_row[sx];
+            }
+            k_.blend_bitmap(dst, sampled_.data(), width, alpha);
+        }
+    }
+}
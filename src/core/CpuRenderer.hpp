@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "CpuKernels.hpp"
+#include "GlyphAtlas.hpp"
+#include "Renderer.hpp"
+
+namespace borderless {
+
+    // premultiplied BGRA pixels, stride == width
+    struct Surface {
+        int32_t width = 0;
+        int32_t height = 0;
+        std::vector<uint32_t> pixels;
+
+        auto resize(int32_t w, int32_t h) -> void {
+            width = w;
+            height = h;
+            pixels.assign(static_cast<size_t>(w) * static_cast<size_t>(h), 0);
+        }
+
+        auto row(int32_t y) -> uint32_t * { return pixels.data() + static_cast<size_t>(y) * width; }
+
+        auto row(int32_t y) const -> const uint32_t * { return pixels.data() + static_cast<size_t>(y) * width; }
+    };
+
+    struct BitmapView {
+        const uint32_t *pixels = nullptr; // premultiplied BGRA
+        int32_t width = 0;
+        int32_t height = 0;
+        int32_t stride = 0; // pixels per row
+    };
+
+    // straight RGBA to packed premultiplied BGRA
+    auto premultiply(const Color &color) -> uint32_t;
+
+    /* Software renderer into a Surface, for GPU-less machines and headless rendering.
+     * Edges are anti-aliased with 4 vertical subsamples and exact horizontal coverage; blending
+     * is premultiplied source-over through the SIMD kernels. Transforms are applied to geometry
+     * bounds, so rotation and shear are approximated by the axis-aligned bounding box.
+     */
+    class CpuRenderer : public Renderer {
+    public:
+        // returns the glyph coverage for a layout, or nullptr to skip the text
+        using TextRasterizer = std::function<const AlphaMask *(const TextLayoutKey &)>;
+
+        explicit CpuRenderer(Surface &surface, kernels::SimdLevel level = kernels::detect_simd());
+
+        auto set_text_rasterizer(TextRasterizer rasterizer) -> void { text_rasterizer_ = std::move(rasterizer); }
+
+        // images must outlive the renderer; returns the id for draw_image and ImageNode
+        auto add_image(const BitmapView &image) -> uint32_t;
+
+        auto simd_level() const -> kernels::SimdLevel { return level_; }
+
+        auto begin_frame() -> void override;
+
+        auto end_frame() -> void override;
+
+        auto push_clip(const Rect &clip) -> void override;
+
+        auto pop_clip() -> void override;
+
+        auto set_transform(const Transform &transform) -> void override { transform_ = transform; }
+
+        auto clear(const Color &color) -> void override;
+
+        auto fill_rect(const RectF &rect, const Color &color) -> void override;
+
+        auto fill_ellipse(PointF center, float radius_x, float radius_y, const Color &color) -> void override;
+
+        auto draw_mask(const AlphaMask &mask, Point origin, const Color &color) -> void override;
+
+        auto draw_text(const TextLayoutKey &layout, PointF origin, const Color &color) -> void override;
+
+        auto draw_image(uint32_t image, const RectF &destination, float opacity) -> void override;
+
+        // quads from GlyphAtlas::layout, blended straight from the atlas pages; like draw_mask the
+        // positions are device pixels
+        auto draw_glyphs(const GlyphAtlas &atlas, const std::vector<GlyphQuad> &quads, const Color &color) -> void;
+
+    private:
+        auto clip() const -> const Rect & { return clips_.back(); }
+
+        Surface &surface_;
+        kernels::SimdLevel level_;
+        const kernels::KernelTable &k_;
+        Transform transform_;
+        std::vector<Rect> clips_;
+        std::vector<BitmapView> images_;
+        TextRasterizer text_rasterizer_;
+
+        // scratch rows reused across calls
+        std::vector<uint16_t> coverage_;
+        std::vector<uint8_t> mask_;
+        std::vector<uint32_t> sampled_;
+    };
+}
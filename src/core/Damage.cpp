@@ -0,0 +1,126 @@
+#include "Damage.hpp"
+
+#include <limits>
+
+namespace borderless {
+
+    namespace {
+        // nearby rects are merged while the union is at most this much larger than the parts
+        constexpr int64_t merge_slack_percent = 125;
+
+        auto worth_merging(const Rect &a, const Rect &b) -> bool {
+            if (intersects(a, b)) {
+                return true;
+            }
+            return unite(a, b).area() * 100 <= (a.area() + b.area()) * merge_slack_percent;
+        }
+    }
+
+    auto DamageRegion::add(Rect rect) -> void {
+        if (!surface_.empty()) {
+            rect = intersect(rect, surface_);
+        }
+        if (rect.empty()) {
+            return;
+        }
+
+        // absorb everything the new rect touches; merging can make it touch more, so repeat
+        for (bool merged = true; merged;) {
+            merged = false;
+            for (size_t i = 0; i < rects_.size(); ++i) {
+                if (worth_merging(rects_[i], rect)) {
+                    rect = unite(rects_[i], rect);
+                    rects_[i] = rects_.back();
+                    rects_.pop_back();
+                    merged = true;
+                    break;
+                }
+            }
+        }
+        rects_.push_back(rect);
+
+        while (rects_.size() > max_rects_) {
+            merge_cheapest_pair();
+        }
+    }
+
+    auto DamageRegion::add(const DamageRegion &other) -> void {
+        for (const auto &rect: other.rects_) {
+            add(rect);
+        }
+    }
+
+    auto DamageRegion::merge_cheapest_pair() -> void {
+        size_t best_i = 0, best_j = 1;
+        int64_t best_growth = std::numeric_limits<int64_t>::max();
+        for (size_t i = 0; i < rects_.size(); ++i) {
+            for (size_t j = i + 1; j < rects_.size(); ++j) {
+                const auto growth = unite(rects_[i], rects_[j]).area() - rects_[i].area() - rects_[j].area();
+                if (growth < best_growth) {
+                    best_growth = growth;
+                    best_i = i;
+                    best_j = j;
+                }
+            }
+        }
+        const auto merged = unite(rects_[best_i], rects_[best_j]);
+        rects_.erase(rects_.begin() + static_cast<std::ptrdiff_t>(best_j));
+        rects_.erase(rects_.begin() + static_cast<std::ptrdiff_t>(best_i));
+        // the union may now overlap others, re-add so the set stays disjoint
+        add(merged);
+    }
+
+    auto DamageRegion::area() const -> int64_t {
+        int64_t total = 0;
+        for (const auto &rect: rects_) {
+            total += rect.area();
+        }
+        return total;
+    }
+
+    auto DamageRegion::bounds() const -> Rect {
+        Rect result{};
+        for (const auto &rect: rects_) {
+            result = unite(result, rect);
+        }
+        return result;
+    }
+
+    auto DamageRegion::intersects(const Rect &rect) const -> bool {
+        for (const auto &r: rects_) {
+            if (borderless::intersects(r, rect)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    auto SwapChainDamage::reset(const Rect &surface) -> void {
+        surface_ = surface;
+        history_.clear();
+        repaint_.set_surface(surface);
+        full_frames_left_ = buffer_count_;
+    }
+
+    auto SwapChainDamage::begin_frame(const DamageRegion &frame) -> const DamageRegion & {
+        repaint_.clear();
+        repaint_.set_surface(surface_);
+
+        present_all_ = full_frames_left_ == buffer_count_;
+        if (full_frames_left_ > 0) {
+            --full_frames_left_;
+            repaint_.add_all();
+        } else {
+            repaint_.add(frame);
+            for (const auto &old: history_) {
+                repaint_.add(old);
+            }
+        }
+
+        history_.push_front(frame);
+        while (history_.size() > buffer_count_ - 1) {
+            history_.pop_back();
+        }
+        return repaint_;
+    }
+}
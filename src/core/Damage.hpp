@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "Geometry.hpp"
+
+namespace borderless {
+
+    /* Set of dirty pixel rects for one frame.
+     * Overlapping rects are merged on insertion, nearby rects are merged when the union wastes
+     * little area, and once more than max_rects remain the pair whose union grows the least is
+     * merged. The result never overlaps, so it can go straight to Present1.
+     */
+    class DamageRegion {
+    public:
+        explicit DamageRegion(size_t max_rects = 8) : max_rects_(max_rects == 0 ? 1 : max_rects) {}
+
+        // rects are clipped to the surface; an empty surface disables clipping
+        auto set_surface(const Rect &surface) -> void { surface_ = surface; }
+
+        auto surface() const -> const Rect & { return surface_; }
+
+        auto add(Rect rect) -> void;
+
+        auto add_all() -> void { add(surface_); }
+
+        auto add(const DamageRegion &other) -> void;
+
+        auto clear() -> void { rects_.clear(); }
+
+        auto empty() const -> bool { return rects_.empty(); }
+
+        auto rects() const -> const std::vector<Rect> & { return rects_; }
+
+        auto area() const -> int64_t;
+
+        auto bounds() const -> Rect;
+
+        auto intersects(const Rect &rect) const -> bool;
+
+    private:
+        auto merge_cheapest_pair() -> void;
+
+        std::vector<Rect> rects_;
+        Rect surface_{};
+        size_t max_rects_;
+    };
+
+    /* Turns per-frame damage into what must be repainted in a flip-model back buffer.
+     * With N buffers the buffer being drawn last held the frame from N-1 presents ago, so the
+     * repaint region is the union of this frame's damage and that of the previous N-1 frames,
+     * while Present1 is only told about this frame's damage.
+     */
+    class SwapChainDamage {
+    public:
+        explicit SwapChainDamage(size_t buffer_count = 2) :
+                buffer_count_(buffer_count == 0 ? 1 : buffer_count),
+                full_frames_left_(buffer_count_) {}
+
+        // forget history, e.g. after ResizeBuffers, so every buffer is painted in full once
+        auto reset(const Rect &surface) -> void;
+
+        // records frame damage and returns the region to repaint in the current back buffer
+        auto begin_frame(const DamageRegion &frame) -> const DamageRegion &;
+
+        auto repaint() const -> const DamageRegion & { return repaint_; }
+
+        // true for the first frame after reset(), which has no previous frame to be a delta of
+        auto present_all() const -> bool { return present_all_; }
+
+    private:
+        std::deque<DamageRegion> history_;
+        DamageRegion repaint_;
+        Rect surface_{};
+        size_t buffer_count_;
+        size_t full_frames_left_;
+        bool present_all_ = true;
+    };
+}
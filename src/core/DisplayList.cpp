@@ -0,0 +1,494 @@
+#include "DisplayList.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <tuple>
+
+namespace borderless {
+
+    namespace {
+        using display_list::Command;
+        using display_list::Op;
+
+        auto align8(size_t size) -> size_t { return (size + 7) & ~size_t{7}; }
+
+        auto from_int(int32_t value) -> float {
+            float bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+
+        auto to_int(float bits) -> int32_t {
+            int32_t value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        auto int_rect(const Command &c) -> Rect {
+            return {to_int(c.values[0]), to_int(c.values[1]), to_int(c.values[2]), to_int(c.values[3])};
+        }
+
+        auto float_rect(const Command &c) -> RectF { return {c.values[0], c.values[1], c.values[2], c.values[3]}; }
+
+        // bounds on what a list may hold, far beyond any surface: a coordinate or extent moved by a
+        // transform at most max_scale stays well inside int32_t when device_bounds rounds it out
+        constexpr float max_coordinate = 1 << 20;
+        constexpr float max_scale = 256.0f;
+
+        // false for NaN and infinities too
+        auto within(float value, float limit) -> bool { return std::abs(value) <= limit; }
+
+        auto within(std::initializer_list<float> values, float limit) -> bool {
+            return std::all_of(values.begin(), values.end(), [&](float v) { return within(v, limit); });
+        }
+
+        // the payload of c is finite and in range; ops and references are checked by the caller
+        auto valid_values(const Command &c) -> bool {
+            const auto &v = c.values;
+            if (!std::isfinite(c.color.r) || !std::isfinite(c.color.g) || !std::isfinite(c.color.b) ||
+                !std::isfinite(c.color.a)) {
+                return false;
+            }
+            switch (c.op) {
+                case Op::fill_rect:
+                case Op::fill_ellipse:
+                    return within({v[0], v[1], v[2], v[3]}, max_coordinate);
+                case Op::draw_image:
+                    return within({v[0], v[1], v[2], v[3]}, max_coordinate) && std::isfinite(v[4]);
+                case Op::draw_text:
+                    return within({v[0], v[1]}, max_coordinate);
+                case Op::draw_mask:
+                case Op::push_clip: {
+                    const auto ints = int_rect(c);
+                    return within({float(ints.left), float(ints.top), float(ints.right), float(ints.bottom)},
+                                  max_coordinate);
+                }
+                case Op::set_transform:
+                    return within({v[0], v[1], v[2], v[3]}, max_scale) && within({v[4], v[5]}, max_coordinate);
+                default:
+                    return true;
+            }
+        }
+
+        // wchar_t is UTF-16 on Windows and UTF-32 elsewhere; the file is UTF-16 either way
+        auto append_utf16(std::vector<uint8_t> &out, const std::wstring &text) -> uint32_t {
+            uint32_t units = 0;
+            auto put = [&](uint32_t unit) {
+                out.push_back(static_cast<uint8_t>(unit & 0xFF));
+                out.push_back(static_cast<uint8_t>(unit >> 8));
+                ++units;
+            };
+            for (const auto c: text) {
+                const auto code = static_cast<uint32_t>(c);
+                if (sizeof(wchar_t) == 4 && code > 0xFFFF) {
+                    put(0xD800 + ((code - 0x10000) >> 10));
+                    put(0xDC00 + ((code - 0x10000) & 0x3FF));
+                } else {
+                    put(code);
+                }
+            }
+            return units;
+        }
+
+        auto read_utf16(ByteView units) -> std::wstring {
+            std::wstring text;
+            text.reserve(units.size / 2);
+            for (size_t i = 0; i + 1 < units.size; i += 2) {
+                const uint32_t unit = units.data[i] | uint32_t{units.data[i + 1]} << 8;
+                if (sizeof(wchar_t) == 4 && unit >= 0xD800 && unit < 0xDC00 && i + 3 < units.size) {
+                    const uint32_t low = units.data[i + 2] | uint32_t{units.data[i + 3]} << 8;
+                    if (low >= 0xDC00 && low < 0xE000) {
+                        text += static_cast<wchar_t>(0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00));
+                        i += 2;
+                        continue;
+                    }
+                }
+                text += static_cast<wchar_t>(unit);
+            }
+            return text;
+        }
+    }
+
+    auto DisplayListRecorder::append(Op op, uint32_t arg, std::initializer_list<float> values, const Color &color)
+            -> void {
+        Command command{};
+        command.op = op;
+        command.arg = arg;
+        std::copy(values.begin(), values.end(), command.values);
+        command.color = color;
+        commands_.push_back(command);
+    }
+
+    auto DisplayListRecorder::push_clip(const Rect &clip) -> void {
+        append(Op::push_clip, 0,
+               {from_int(clip.left), from_int(clip.top), from_int(clip.right), from_int(clip.bottom)});
+    }
+
+    auto DisplayListRecorder::pop_clip() -> void {
+        append(Op::pop_clip, 0, {});
+    }
+
+    auto DisplayListRecorder::set_transform(const Transform &t) -> void {
+        append(Op::set_transform, 0, {t.m11, t.m12, t.m21, t.m22, t.dx, t.dy});
+    }
+
+    auto DisplayListRecorder::clear(const Color &color) -> void {
+        append(Op::clear, 0, {}, color);
+    }
+
+    auto DisplayListRecorder::fill_rect(const RectF &rect, const Color &color) -> void {
+        append(Op::fill_rect, 0, {rect.left, rect.top, rect.right, rect.bottom}, color);
+    }
+
+    auto DisplayListRecorder::fill_ellipse(PointF center, float radius_x, float radius_y, const Color &color) -> void {
+        append(Op::fill_ellipse, 0, {center.x, center.y, radius_x, radius_y}, color);
+    }
+
+    auto DisplayListRecorder::draw_mask(const AlphaMask &mask, Point origin, const Color &color) -> void {
+        const auto width = std::max(mask.width, 0), height = std::max(mask.height, 0);
+        const auto offset = static_cast<uint32_t>(blob_.size());
+        // rows are stored without padding, the stride becomes the width
+        for (int32_t y = 0; y < height && mask.pixels; ++y) {
+            const auto row = mask.pixels + static_cast<size_t>(y) * mask.stride;
+            blob_.insert(blob_.end(), row, row + width);
+        }
+        append(Op::draw_mask, offset, {from_int(origin.x), from_int(origin.y), from_int(mask.pixels ? width : 0),
+                                       from_int(mask.pixels ? height : 0)}, color);
+    }
+
+    auto DisplayListRecorder::add_string(const std::wstring &text) -> std::pair<uint32_t, uint32_t> {
+        if (blob_.size() % 2) {
+            blob_.push_back(0);
+        }
+        const auto offset = static_cast<uint32_t>(blob_.size());
+        return {offset, append_utf16(blob_, text)};
+    }
+
+    auto DisplayListRecorder::draw_text(const TextLayoutKey &layout, PointF origin, const Color &color) -> void {
+        auto [it, added] = text_index_.emplace(layout, static_cast<uint32_t>(texts_.size()));
+        if (added) {
+            display_list::Text text{};
+            std::tie(text.family_offset, text.family_size) = add_string(layout.format.family);
+            std::tie(text.locale_offset, text.locale_size) = add_string(layout.format.locale);
+            std::tie(text.text_offset, text.text_size) = add_string(layout.text);
+            text.weight = layout.format.weight;
+            text.size = layout.format.size;
+            text.max_width = layout.max_width;
+            text.max_height = layout.max_height;
+            texts_.push_back(text);
+        }
+        append(Op::draw_text, it->second, {origin.x, origin.y}, color);
+    }
+
+    auto DisplayListRecorder::draw_image(uint32_t image, const RectF &destination, float opacity) -> void {
+        append(Op::draw_image, image,
+               {destination.left, destination.top, destination.right, destination.bottom, opacity});
+    }
+
+    auto DisplayListRecorder::clear() -> void {
+        commands_.clear();
+        texts_.clear();
+        blob_.clear();
+        text_index_.clear();
+    }
+
+    auto DisplayListRecorder::build() const -> std::vector<uint8_t> {
+        display_list::Header header{};
+        std::memcpy(header.magic, display_list::magic, sizeof(header.magic));
+        header.version = display_list::version;
+        header.command_count = static_cast<uint32_t>(commands_.size());
+        header.text_count = static_cast<uint32_t>(texts_.size());
+        const auto texts_offset = sizeof(header) + commands_.size() * sizeof(Command);
+        header.blob_offset = align8(texts_offset + texts_.size() * sizeof(display_list::Text));
+        header.blob_size = blob_.size();
+
+        std::vector<uint8_t> out(static_cast<size_t>(header.blob_offset) + blob_.size());
+        std::memcpy(out.data(), &header, sizeof(header));
+        if (!commands_.empty()) {
+            std::memcpy(out.data() + sizeof(header), commands_.data(), commands_.size() * sizeof(Command));
+        }
+        if (!texts_.empty()) {
+            std::memcpy(out.data() + texts_offset, texts_.data(), texts_.size() * sizeof(display_list::Text));
+        }
+        if (!blob_.empty()) {
+            std::memcpy(out.data() + header.blob_offset, blob_.data(), blob_.size());
+        }
+        return out;
+    }
+
+    auto DisplayListRecorder::write(const std::filesystem::path &path) const -> bool {
+        const auto bytes = build();
+        std::FILE *file = std::fopen(path.string().c_str(), "wb");
+        if (!file) {
+            return false;
+        }
+        const bool written = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+        return std::fclose(file) == 0 && written;
+    }
+
+    auto DisplayList::open(const std::filesystem::path &path) -> bool {
+        close();
+        if (!file_.open(path)) {
+            return fail("cannot map " + path.string());
+        }
+        if (!parse(file_.bytes())) {
+            file_.close();
+            return false;
+        }
+        return true;
+    }
+
+    auto DisplayList::open(ByteView bytes) -> bool {
+        close();
+        return parse(bytes);
+    }
+
+    auto DisplayList::close() -> void {
+        file_.close();
+        bytes_ = {};
+        blob_ = {};
+        commands_ = nullptr;
+        count_ = 0;
+        texts_.clear();
+    }
+
+    auto DisplayList::mask(const Command &command) const -> AlphaMask {
+        const auto width = to_int(command.values[2]);
+        return {blob_.data + command.arg, width, to_int(command.values[3]), width};
+    }
+
+    auto DisplayList::parse(ByteView bytes) -> bool {
+        commands_ = nullptr;
+        count_ = 0;
+        texts_.clear();
+        bytes_ = bytes;
+
+        if (reinterpret_cast<uintptr_t>(bytes.data) % alignof(display_list::Header) != 0) {
+            return fail("display list is not 8-byte aligned");
+        }
+        display_list::Header header{};
+        if (bytes.size < sizeof(header)) {
+            return fail("truncated header");
+        }
+        std::memcpy(&header, bytes.data, sizeof(header));
+        if (std::memcmp(header.magic, display_list::magic, sizeof(header.magic)) != 0) {
+            return fail("not a display list");
+        }
+        if (header.version != display_list::version) {
+            return fail("unsupported display list version " + std::to_string(header.version));
+        }
+        const auto commands_size = size_t{header.command_count} * sizeof(Command);
+        const auto texts_size = size_t{header.text_count} * sizeof(display_list::Text);
+        const auto commands = bytes.sub(sizeof(header), commands_size);
+        const auto texts = bytes.sub(sizeof(header) + commands_size, texts_size);
+        blob_ = bytes.sub(static_cast<size_t>(header.blob_offset), static_cast<size_t>(header.blob_size));
+        if (commands.size != commands_size || texts.size != texts_size || blob_.size != header.blob_size) {
+            return fail("truncated display list");
+        }
+
+        auto string = [&](uint32_t offset, uint32_t units, std::wstring &out) {
+            const auto range = blob_.sub(offset, size_t{units} * 2);
+            if (range.size != size_t{units} * 2) {
+                return false;
+            }
+            out = read_utf16(range);
+            return true;
+        };
+        texts_.resize(header.text_count);
+        for (size_t i = 0; i < header.text_count; ++i) {
+            display_list::Text text;
+            std::memcpy(&text, texts.data + i * sizeof(text), sizeof(text));
+            auto &key = texts_[i];
+            if (!string(text.family_offset, text.family_size, key.format.family) ||
+                !string(text.locale_offset, text.locale_size, key.format.locale) ||
+                !string(text.text_offset, text.text_size, key.text)) {
+                texts_.clear();
+                return fail("text " + std::to_string(i) + " out of range");
+            }
+            if (!within({text.size, text.max_width, text.max_height}, max_coordinate)) {
+                texts_.clear();
+                return fail("text " + std::to_string(i) + " has an invalid layout box");
+            }
+            key.format.weight = text.weight;
+            key.format.size = text.size;
+            key.max_width = text.max_width;
+            key.max_height = text.max_height;
+        }
+
+        const auto list = reinterpret_cast<const Command *>(commands.data);
+        size_t clips = 0;
+        for (size_t i = 0; i < header.command_count; ++i) {
+            const auto &c = list[i];
+            bool valid = c.op < Op::count && valid_values(c);
+            if (c.op == Op::draw_text) {
+                valid &= c.arg < header.text_count;
+            } else if (c.op == Op::draw_mask) {
+                const auto width = to_int(c.values[2]), height = to_int(c.values[3]);
+                valid &= width >= 0 && height >= 0 && c.arg <= blob_.size &&
+                        static_cast<uint64_t>(width) * static_cast<uint64_t>(height) <= blob_.size - c.arg;
+            } else if (c.op == Op::push_clip) {
+                ++clips;
+            } else if (c.op == Op::pop_clip) {
+                valid &= clips-- > 0;
+            }
+            if (!valid) {
+                texts_.clear();
+                return fail("command " + std::to_string(i) + " is invalid");
+            }
+        }
+        if (clips != 0) {
+            // replay() would leave them pushed, and D2D fails EndDraw on that
+            texts_.clear();
+            return fail(std::to_string(clips) + " clips are not popped");
+        }
+        commands_ = list;
+        count_ = header.command_count;
+        error_.clear();
+        return true;
+    }
+
+    auto DisplayList::fail(std::string message) -> bool {
+        error_ = std::move(message);
+        return false;
+    }
+
+    auto replay(const DisplayList &list, Renderer &renderer) -> void {
+        const auto commands = list.commands();
+        for (size_t i = 0; i < list.size(); ++i) {
+            const auto &c = commands[i];
+            switch (c.op) {
+                case Op::clear:
+                    renderer.clear(c.color);
+                    break;
+                case Op::fill_rect:
+                    renderer.fill_rect(float_rect(c), c.color);
+                    break;
+                case Op::fill_ellipse:
+                    renderer.fill_ellipse({c.values[0], c.values[1]}, c.values[2], c.values[3], c.color);
+                    break;
+                case Op::draw_mask:
+                    renderer.draw_mask(list.mask(c), {to_int(c.values[0]), to_int(c.values[1])}, c.color);
+                    break;
+                case Op::draw_text:
+                    renderer.draw_text(list.text(c.arg), {c.values[0], c.values[1]}, c.color);
+                    break;
+                case Op::draw_image:
+                    renderer.draw_image(c.arg, float_rect(c), c.values[4]);
+                    break;
+                case Op::push_clip:
+                    renderer.push_clip(int_rect(c));
+                    break;
+                case Op::pop_clip:
+                    renderer.pop_clip();
+                    break;
+                case Op::set_transform:
+                    renderer.set_transform({c.values[0], c.values[1], c.values[2], c.values[3], c.values[4],
+                                            c.values[5]});
+                    break;
+                case Op::count:
+                    break;
+            }
+        }
+    }
+
+    namespace {
+        // where each command of a list draws, in device pixels; empty for state changes
+        auto device_bounds(const DisplayList &list, const Rect &surface) -> std::vector<Rect> {
+            std::vector<Rect> bounds(list.size());
+            std::vector<Rect> clips{surface};
+            Transform transform;
+            const auto commands = list.commands();
+            for (size_t i = 0; i < list.size(); ++i) {
+                const auto &c = commands[i];
+                Rect drawn{};
+                switch (c.op) {
+                    case Op::clear:
+                        drawn = clips.back();
+                        break;
+                    case Op::fill_rect:
+                    case Op::draw_image:
+                        drawn = round_out(transform.apply(float_rect(c)));
+                        break;
+                    case Op::fill_ellipse:
+                        drawn = round_out(transform.apply(RectF{c.values[0] - c.values[2], c.values[1] - c.values[3],
+                                                                c.values[0] + c.values[2], c.values[1] + c.values[3]}));
+                        break;
+                    case Op::draw_mask: {
+                        const Point origin{to_int(c.values[0]), to_int(c.values[1])};
+                        drawn = {origin.x, origin.y, origin.x + to_int(c.values[2]), origin.y + to_int(c.values[3])};
+                        break;
+                    }
+                    case Op::draw_text: {
+                        // renderers clip text to its layout box
+                        const auto &key = list.text(c.arg);
+                        drawn = round_out(transform.apply(RectF{c.values[0], c.values[1], c.values[0] + key.max_width,
+                                                                c.values[1] + key.max_height}));
+                        break;
+                    }
+                    case Op::push_clip:
+                        clips.push_back(intersect(clips.back(), int_rect(c)));
+                        break;
+                    case Op::pop_clip:
+                        clips.pop_back();
+                        break;
+                    case Op::set_transform:
+                        transform = {c.values[0], c.values[1], c.values[2], c.values[3], c.values[4], c.values[5]};
+                        break;
+                    case Op::count:
+                        break;
+                }
+                bounds[i] = intersect(drawn, clips.back());
+                if (bounds[i].empty()) {
+                    bounds[i] = {};
+                }
+            }
+            return bounds;
+        }
+
+        auto same_command(const DisplayList &a, const Command &x, const DisplayList &b, const Command &y) -> bool {
+            if (x.op != y.op || std::memcmp(x.values, y.values, sizeof(x.values)) != 0 || x.color != y.color) {
+                return false;
+            }
+            switch (x.op) {
+                case Op::draw_text:
+                    return a.text(x.arg) == b.text(y.arg);
+                case Op::draw_mask: {
+                    const auto p = a.mask(x), q = b.mask(y);
+                    return std::memcmp(p.pixels, q.pixels, static_cast<size_t>(p.width) * p.height) == 0;
+                }
+                default:
+                    return x.arg == y.arg;
+            }
+        }
+    }
+
+    auto diff(const DisplayList &before, const DisplayList &after, const Rect &surface) -> DisplayListDiff {
+        const auto a = device_bounds(before, surface);
+        const auto b = device_bounds(after, surface);
+        auto same = [&](size_t i, size_t j) {
+            return a[i] == b[j] && same_command(before, before.commands()[i], after, after.commands()[j]);
+        };
+
+        const auto shorter = std::min(a.size(), b.size());
+        size_t prefix = 0;
+        while (prefix < shorter && same(prefix, prefix)) {
+            ++prefix;
+        }
+        size_t suffix = 0;
+        while (suffix < shorter - prefix && same(a.size() - 1 - suffix, b.size() - 1 - suffix)) {
+            ++suffix;
+        }
+
+        DisplayListDiff result;
+        result.damage.set_surface(surface);
+        for (const auto *bounds: {&a, &b}) {
+            for (size_t i = prefix; i < bounds->size() - suffix; ++i) {
+                result.damage.add((*bounds)[i]);
+                ++result.changed;
+            }
+        }
+        return result;
+    }
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <initializer_list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "AssetPack.hpp"
+#include "ByteView.hpp"
+#include "Damage.hpp"
+#include "Renderer.hpp"
+
+namespace borderless {
+
+    /* On-disk layout of a display list, little endian:
+     *   Header | Command[command_count] | Text[text_count] | blob
+     * Commands have a fixed size and are replayed in place from the mapping. The blob holds the
+     * strings of text layouts (UTF-16) and the pixels of masks, which draw_mask reads in place too.
+     */
+    namespace display_list {
+        constexpr char magic[4] = {'B', 'D', 'L', 'S'};
+        constexpr uint32_t version = 1;
+
+        enum class Op : uint16_t {
+            clear,         // color
+            fill_rect,     // values: left, top, right, bottom; color
+            fill_ellipse,  // values: center x, y, radius x, y; color
+            draw_mask,     // arg: blob offset; ints: origin x, y, width, height; color
+            draw_text,     // arg: text index; values: origin x, y; color
+            draw_image,    // arg: image id; values: left, top, right, bottom, opacity
+            push_clip,     // ints: left, top, right, bottom
+            pop_clip,
+            set_transform, // values: m11, m12, m21, m22, dx, dy
+            count,
+        };
+
+        struct Header {
+            char magic[4];
+            uint32_t version;
+            uint32_t command_count;
+            uint32_t text_count;
+            uint64_t blob_offset;
+            uint64_t blob_size;
+        };
+        static_assert(sizeof(Header) == 32, "packed layout");
+
+        struct Command {
+            Op op;
+            uint16_t reserved;
+            uint32_t arg;
+            float values[6]; // int32_t bit patterns for the ints of clips and masks
+            Color color;
+        };
+        static_assert(sizeof(Command) == 48, "packed layout");
+
+        struct Text {
+            uint32_t family_offset; // byte offsets into the blob, sizes in UTF-16 code units
+            uint32_t family_size;
+            uint32_t locale_offset;
+            uint32_t locale_size;
+            uint32_t text_offset;
+            uint32_t text_size;
+            uint16_t weight;
+            uint16_t reserved;
+            float size;
+            float max_width;
+            float max_height;
+        };
+        static_assert(sizeof(Text) == 40, "packed layout");
+    }
+
+    /* Records the calls of a frame instead of drawing them: begin_frame() starts an empty list,
+     * then paint() or direct calls append commands. Mask pixels are copied into the list and every
+     * distinct text layout is stored once, so the list does not refer to anything of the caller's
+     * except image ids, which stay the backend's.
+     */
+    class DisplayListRecorder : public Renderer {
+    public:
+        auto begin_frame() -> void override { clear(); }
+
+        auto end_frame() -> void override {}
+
+        auto push_clip(const Rect &clip) -> void override;
+
+        auto pop_clip() -> void override;
+
+        auto set_transform(const Transform &transform) -> void override;
+
+        auto clear(const Color &color) -> void override;
+
+        auto fill_rect(const RectF &rect, const Color &color) -> void override;
+
+        auto fill_ellipse(PointF center, float radius_x, float radius_y, const Color &color) -> void override;
+
+        auto draw_mask(const AlphaMask &mask, Point origin, const Color &color) -> void override;
+
+        auto draw_text(const TextLayoutKey &layout, PointF origin, const Color &color) -> void override;
+
+        auto draw_image(uint32_t image, const RectF &destination, float opacity) -> void override;
+
+        auto clear() -> void;
+
+        auto size() const -> size_t { return commands_.size(); }
+
+        // the list in the layout above, 8-byte aligned sections
+        auto build() const -> std::vector<uint8_t>;
+
+        auto write(const std::filesystem::path &path) const -> bool;
+
+    private:
+        auto append(display_list::Op op, uint32_t arg, std::initializer_list<float> values, const Color &color = {})
+                -> void;
+
+        auto add_string(const std::wstring &text) -> std::pair<uint32_t, uint32_t>;
+
+        std::vector<display_list::Command> commands_;
+        std::vector<display_list::Text> texts_;
+        std::vector<uint8_t> blob_;
+        std::unordered_map<TextLayoutKey, uint32_t, TextLayoutKeyHash> text_index_;
+    };
+
+    /* A display list in memory or mapped from a file. open() checks the header and that every
+     * command refers to a valid text or blob range, holds finite coordinates in range and that clips
+     * balance, without copying or decoding commands; only the text layouts are decoded, once.
+     * Replaying never allocates.
+     */
+    class DisplayList {
+    public:
+        DisplayList() = default;
+
+        DisplayList(const DisplayList &) = delete;
+
+        auto operator=(const DisplayList &) -> DisplayList & = delete;
+
+        auto open(const std::filesystem::path &path) -> bool;
+
+        // bytes must outlive the list and be 8-byte aligned
+        auto open(ByteView bytes) -> bool;
+
+        auto close() -> void;
+
+        auto error() const -> const std::string & { return error_; }
+
+        auto size() const -> size_t { return count_; }
+
+        auto commands() const -> const display_list::Command * { return commands_; }
+
+        auto text(uint32_t index) const -> const TextLayoutKey & { return texts_[index]; }
+
+        // the pixels of a draw_mask command, pointing into the list
+        auto mask(const display_list::Command &command) const -> AlphaMask;
+
+        auto bytes() const -> ByteView { return bytes_; }
+
+    private:
+        auto parse(ByteView bytes) -> bool;
+
+        auto fail(std::string message) -> bool;
+
+        MappedFile file_;
+        ByteView bytes_;
+        ByteView blob_;
+        const display_list::Command *commands_ = nullptr;
+        size_t count_ = 0;
+        std::vector<TextLayoutKey> texts_;
+        std::string error_;
+    };
+
+    // issues the list's commands to renderer; frame begin and end are the caller's
+    auto replay(const DisplayList &list, Renderer &renderer) -> void;
+
+    struct DisplayListDiff {
+        size_t changed = 0;  // commands of either list between their common prefix and suffix
+        DamageRegion damage; // what to repaint to turn a frame of before into one of after
+    };
+
+    // compares commands by content and by the device bounds they draw to, so a command moved by a
+    // changed transform or clip counts as changed; the damage is the bounds of the changed
+    // commands of both lists, clipped to surface
+    auto diff(const DisplayList &before, const DisplayList &after, const Rect &surface) -> DisplayListDiff;
+}
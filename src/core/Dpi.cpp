@@ -0,0 +1,41 @@
+#include "Dpi.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace borderless {
+
+    DpiContext::DpiContext(uint32_t dpi) : dpi_(dpi) {
+        if (dpi == 0) {
+            throw std::invalid_argument("dpi must not be zero");
+        }
+    }
+
+    auto DpiContext::subscribe(Listener listener) -> size_t {
+        listeners_.push_back({next_id_, std::move(listener)});
+        return next_id_++;
+    }
+
+    auto DpiContext::unsubscribe(size_t id) -> void {
+        auto it = std::find_if(listeners_.begin(), listeners_.end(), [id](const Entry &e) { return e.id == id; });
+        if (it != listeners_.end()) {
+            listeners_.erase(it);
+        }
+    }
+
+    auto DpiContext::set_dpi(uint32_t dpi) -> bool {
+        if (dpi == 0) {
+            throw std::invalid_argument("dpi must not be zero");
+        }
+        if (dpi == dpi_) {
+            return false;
+        }
+        const DpiChange change{dpi_, dpi};
+        dpi_ = dpi;
+        ++changes_;
+        for (const auto &entry: listeners_) {
+            entry.listener(change);
+        }
+        return true;
+    }
+}
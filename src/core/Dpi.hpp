@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "Geometry.hpp"
+
+namespace borderless {
+
+    constexpr uint32_t default_dpi = 96;
+
+    // value at from_dpi converted to to_dpi, rounded half away from zero like MulDiv
+    constexpr auto rescale_for_dpi(int32_t value, uint32_t from_dpi, uint32_t to_dpi) -> int32_t {
+        const auto product = static_cast<int64_t>(value) * to_dpi;
+        const auto half = static_cast<int64_t>(from_dpi / 2);
+        return static_cast<int32_t>((product < 0 ? product - half : product + half) / static_cast<int64_t>(from_dpi));
+    }
+
+    // a length in 96-DPI units (DIPs) in pixels at dpi, e.g. 480 at 144 DPI is 720
+    constexpr auto scale_for_dpi(int32_t dips, uint32_t dpi) -> int32_t {
+        return rescale_for_dpi(dips, default_dpi, dpi);
+    }
+
+    constexpr auto scale_for_dpi(Size dips, uint32_t dpi) -> Size {
+        return {scale_for_dpi(dips.width, dpi), scale_for_dpi(dips.height, dpi)};
+    }
+
+    struct DpiChange {
+        uint32_t from = default_dpi;
+        uint32_t to = default_dpi;
+    };
+
+    /* The DPI of one window and everything derived from it. The scene is laid out in DIPs and
+     * transform() scales it to the pixels of the swap chain, so nothing is stretched by DWM.
+     * Caches that depend on the DPI (hit-test borders, the scene's pixel bounds) subscribe once;
+     * set_dpi() from WM_DPICHANGED then invalidates all of them in one call, in subscription order,
+     * before the window takes its new size.
+     */
+    class DpiContext {
+    public:
+        using Listener = std::function<void(const DpiChange &)>;
+
+        explicit DpiContext(uint32_t dpi = default_dpi);
+
+        auto dpi() const -> uint32_t { return dpi_; }
+
+        // pixels per DIP
+        auto scale() const -> float { return static_cast<float>(dpi_) / static_cast<float>(default_dpi); }
+
+        auto to_pixels(int32_t dips) const -> int32_t { return scale_for_dpi(dips, dpi_); }
+
+        auto to_pixels(Size dips) const -> Size { return scale_for_dpi(dips, dpi_); }
+
+        auto to_dips(int32_t pixels) const -> int32_t { return rescale_for_dpi(pixels, dpi_, default_dpi); }
+
+        // DIPs to pixels, for the scene's root
+        auto transform() const -> Transform { return Transform::scale(scale(), scale()); }
+
+        // returns an id for unsubscribe
+        auto subscribe(Listener listener) -> size_t;
+
+        auto unsubscribe(size_t id) -> void;
+
+        // notifies every listener if dpi differs from the current one; returns whether it did.
+        // Listeners must not call set_dpi()
+        auto set_dpi(uint32_t dpi) -> bool;
+
+        auto changes() const -> uint64_t { return changes_; }
+
+    private:
+        struct Entry {
+            size_t id;
+            Listener listener;
+        };
+
+        std::vector<Entry> listeners_;
+        size_t next_id_ = 0;
+        uint32_t dpi_;
+        uint64_t changes_ = 0;
+    };
+}
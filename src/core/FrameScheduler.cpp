@@ -0,0 +1,117 @@
+#include "FrameScheduler.hpp"
+
+#include <algorithm>
+
+namespace borderless {
+
+    namespace {
+        auto percentile(std::vector<FrameClockType::duration> values, double p) -> FrameClockType::duration {
+            if (values.empty()) {
+                return {};
+            }
+            const auto rank = static_cast<size_t>(p * static_cast<double>(values.size() - 1) + 0.5);
+            std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(rank), values.end());
+            return values[rank];
+        }
+    }
+
+    auto FrameStats::record(FrameClockType::duration cpu, FrameClockType::duration interval) -> void {
+        if (cpu_.size() < capacity_) {
+            cpu_.push_back(cpu);
+            interval_.push_back(interval);
+        } else {
+            cpu_[next_] = cpu;
+            interval_[next_] = interval;
+        }
+        next_ = (next_ + 1) % capacity_;
+        ++total_;
+        if (interval * 2 > expected_ * 3) {
+            ++late_;
+        }
+    }
+
+    auto FrameStats::summary() const -> FrameSummary {
+        FrameSummary s;
+        s.frames = cpu_.size();
+        if (cpu_.empty()) {
+            return s;
+        }
+        s.cpu_p50 = percentile(cpu_, 0.50);
+        s.cpu_p90 = percentile(cpu_, 0.90);
+        s.cpu_p99 = percentile(cpu_, 0.99);
+        s.cpu_max = *std::max_element(cpu_.begin(), cpu_.end());
+        s.interval_p50 = percentile(interval_, 0.50);
+        s.interval_p90 = percentile(interval_, 0.90);
+        s.interval_p99 = percentile(interval_, 0.99);
+        s.interval_max = *std::max_element(interval_.begin(), interval_.end());
+        return s;
+    }
+
+    auto FrameStats::reset() -> void {
+        cpu_.clear();
+        interval_.clear();
+        next_ = 0;
+        total_ = 0;
+        late_ = 0;
+    }
+
+    FrameScheduler::FrameScheduler(FrameClock &clock, FramePresenter &presenter) :
+            clock_(clock),
+            presenter_(presenter) {
+        stats_.set_expected_interval(interval_);
+    }
+
+    auto FrameScheduler::set_mode(FrameMode mode) -> void {
+        mode_ = mode;
+        deadline_ = clock_.now();
+        has_presented_ = false; // the interval across a mode switch says nothing
+    }
+
+    auto FrameScheduler::set_interval(Clock::duration interval) -> void {
+        interval_ = interval;
+        stats_.set_expected_interval(interval);
+    }
+
+    auto FrameScheduler::due(Clock::time_point now) const -> bool {
+        switch (mode_) {
+            case FrameMode::on_demand:
+                return requested_;
+            case FrameMode::fixed_rate:
+                return requested_ || now >= deadline_;
+            case FrameMode::continuous:
+                return true;
+        }
+        return false;
+    }
+
+    auto FrameScheduler::wait_timeout(Clock::time_point now) const -> Clock::duration {
+        if (due(now)) {
+            return Clock::duration::zero();
+        }
+        if (mode_ == FrameMode::fixed_rate) {
+            return deadline_ - now;
+        }
+        return Clock::duration::max();
+    }
+
+    auto FrameScheduler::advance_deadline(Clock::time_point now) -> void {
+        if (mode_ != FrameMode::fixed_rate) {
+            return;
+        }
+        // keep the cadence; if we fell behind, skip the missed slots instead of bursting
+        deadline_ += interval_;
+        if (deadline_ <= now) {
+            const auto missed = (now - deadline_) / interval_ + 1;
+            deadline_ += interval_ * missed;
+        }
+    }
+
+    auto FrameScheduler::frame_presented(Clock::time_point start, Clock::time_point rendered,
+                                         Clock::time_point presented) -> void {
+        if (has_presented_) {
+            stats_.record(rendered - start, presented - last_present_);
+        }
+        last_present_ = presented;
+        has_presented_ = true;
+    }
+}
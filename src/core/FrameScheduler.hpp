@@ -0,0 +1,151 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Trace.hpp"
+
+namespace borderless {
+
+    using FrameClockType = std::chrono::steady_clock;
+
+    struct FrameClock {
+        virtual ~FrameClock() = default;
+
+        virtual auto now() const -> FrameClockType::time_point = 0;
+    };
+
+    struct SteadyFrameClock : FrameClock {
+        auto now() const -> FrameClockType::time_point override { return FrameClockType::now(); }
+    };
+
+    // the swap chain side of a frame; on Windows backed by a frame latency waitable object
+    struct FramePresenter {
+        virtual ~FramePresenter() = default;
+
+        // true when the swap chain can take another frame, waiting at most timeout
+        virtual auto ready(FrameClockType::duration timeout) -> bool = 0;
+
+        virtual auto present() -> void = 0;
+    };
+
+    struct FrameSummary {
+        size_t frames = 0;
+        FrameClockType::duration cpu_p50{}, cpu_p90{}, cpu_p99{}, cpu_max{};
+        FrameClockType::duration interval_p50{}, interval_p90{}, interval_p99{}, interval_max{};
+    };
+
+    // per-frame CPU time and present-to-present intervals over the last `capacity` frames
+    class FrameStats {
+    public:
+        explicit FrameStats(size_t capacity = 1024) : capacity_(capacity == 0 ? 1 : capacity) {}
+
+        auto record(FrameClockType::duration cpu, FrameClockType::duration interval) -> void;
+
+        auto summary() const -> FrameSummary;
+
+        // frames whose interval exceeded 1.5x the expected one, since the last reset
+        auto late_frames() const -> uint64_t { return late_; }
+
+        auto set_expected_interval(FrameClockType::duration interval) -> void { expected_ = interval; }
+
+        auto total_frames() const -> uint64_t { return total_; }
+
+        auto reset() -> void;
+
+    private:
+        std::vector<FrameClockType::duration> cpu_;
+        std::vector<FrameClockType::duration> interval_;
+        size_t capacity_;
+        size_t next_ = 0;
+        uint64_t total_ = 0;
+        uint64_t late_ = 0;
+        FrameClockType::duration expected_ = std::chrono::microseconds(16'667);
+    };
+
+    enum class FrameMode {
+        on_demand,  // render only after request_frame()
+        fixed_rate, // render every interval, drift free
+        continuous, // render whenever the swap chain accepts a frame
+    };
+
+    /* Decides when to render and records frame timings. The message loop sleeps for
+     * wait_timeout() (also waking on the swap chain when waits_on_swap_chain()) and then calls
+     * tick(), which renders and presents if a frame is due and the swap chain is ready.
+     */
+    class FrameScheduler {
+    public:
+        using Clock = FrameClockType;
+
+        FrameScheduler(FrameClock &clock, FramePresenter &presenter);
+
+        auto set_mode(FrameMode mode) -> void;
+
+        auto mode() const -> FrameMode { return mode_; }
+
+        auto set_interval(Clock::duration interval) -> void;
+
+        auto interval() const -> Clock::duration { return interval_; }
+
+        auto request_frame() -> void { requested_ = true; }
+
+        auto due(Clock::time_point now) const -> bool;
+
+        // how long the message loop may sleep before a frame is due; duration::max() when idle
+        auto wait_timeout(Clock::time_point now) const -> Clock::duration;
+
+        // whether the loop should also wake on the swap chain's waitable object
+        auto waits_on_swap_chain(Clock::time_point now) const -> bool { return due(now) && !ready_held_; }
+
+        // render() draws a frame and returns false if there was nothing to present; a render thread
+        // passes a ready_timeout to block on the swap chain here instead of in a message wait
+        template<typename Render>
+        auto tick(Render &&render, Clock::duration ready_timeout = Clock::duration::zero()) -> bool {
+            const auto start = clock_.now();
+            if (!due(start)) {
+                return false;
+            }
+            if (!ready_held_ && !presenter_.ready(ready_timeout)) {
+                return false;
+            }
+            BORDERLESS_TRACE_SCOPE(trace::Event::frame, 0);
+            // the readiness was consumed; keep it if this tick ends up not presenting
+            ready_held_ = true;
+            requested_ = false;
+            advance_deadline(start);
+
+            // CPU time starts after a blocking wait for the swap chain
+            const auto render_start = ready_timeout == Clock::duration::zero() ? start : clock_.now();
+            if (!render()) {
+                return false;
+            }
+            const auto rendered = clock_.now();
+            presenter_.present();
+            ready_held_ = false;
+            frame_presented(render_start, rendered, clock_.now());
+            return true;
+        }
+
+        auto stats() const -> const FrameStats & { return stats_; }
+
+        auto stats() -> FrameStats & { return stats_; }
+
+    private:
+        auto advance_deadline(Clock::time_point now) -> void;
+
+        auto frame_presented(Clock::time_point start, Clock::time_point rendered, Clock::time_point presented) -> void;
+
+        FrameClock &clock_;
+        FramePresenter &presenter_;
+        FrameMode mode_ = FrameMode::on_demand;
+        Clock::duration interval_ = std::chrono::microseconds(16'667);
+        Clock::time_point deadline_{};
+        Clock::time_point last_present_{};
+        bool has_presented_ = false;
+        bool requested_ = true; // the first frame is always wanted
+        bool ready_held_ = false;
+        FrameStats stats_;
+    };
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Platform-neutral geometry shared by the portable core.
+// Rect has the same layout as a Win32 RECT so the shell can convert cheaply.
+namespace borderless {
+
+    struct Point {
+        int32_t x = 0;
+        int32_t y = 0;
+    };
+
+    struct Size {
+        int32_t width = 0;
+        int32_t height = 0;
+    };
+
+    struct Rect {
+        int32_t left = 0;
+        int32_t top = 0;
+        int32_t right = 0;
+        int32_t bottom = 0;
+
+        auto width() const -> int32_t { return right - left; }
+
+        auto height() const -> int32_t { return bottom - top; }
+
+        auto empty() const -> bool { return right <= left || bottom <= top; }
+
+        auto area() const -> int64_t {
+            return empty() ? 0 : static_cast<int64_t>(width()) * height();
+        }
+
+        auto contains(Point p) const -> bool {
+            return p.x >= left && p.x < right && p.y >= top && p.y < bottom;
+        }
+
+        auto offset(int32_t dx, int32_t dy) const -> Rect {
+            return {left + dx, top + dy, right + dx, bottom + dy};
+        }
+    };
+
+    inline auto operator==(Point a, Point b) -> bool {
+        return a.x == b.x && a.y == b.y;
+    }
+
+    inline auto operator!=(Point a, Point b) -> bool {
+        return !(a == b);
+    }
+
+    inline auto operator==(const Rect &a, const Rect &b) -> bool {
+        return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+    }
+
+    inline auto operator!=(const Rect &a, const Rect &b) -> bool {
+        return !(a == b);
+    }
+
+    inline auto intersect(const Rect &a, const Rect &b) -> Rect {
+        return {std::max(a.left, b.left), std::max(a.top, b.top),
+                std::min(a.right, b.right), std::min(a.bottom, b.bottom)};
+    }
+
+    inline auto intersects(const Rect &a, const Rect &b) -> bool {
+        return !intersect(a, b).empty();
+    }
+
+    // smallest rect containing both; empty rects are ignored
+    inline auto unite(const Rect &a, const Rect &b) -> Rect {
+        if (a.empty()) return b;
+        if (b.empty()) return a;
+        return {std::min(a.left, b.left), std::min(a.top, b.top),
+                std::max(a.right, b.right), std::max(a.bottom, b.bottom)};
+    }
+
+    struct PointF {
+        float x = 0.0f;
+        float y = 0.0f;
+    };
+
+    struct RectF {
+        float left = 0.0f;
+        float top = 0.0f;
+        float right = 0.0f;
+        float bottom = 0.0f;
+
+        auto width() const -> float { return right - left; }
+
+        auto height() const -> float { return bottom - top; }
+
+        auto empty() const -> bool { return right <= left || bottom <= top; }
+    };
+
+    // smallest pixel rect covering r
+    inline auto round_out(const RectF &r) -> Rect {
+        return {static_cast<int32_t>(std::floor(r.left)), static_cast<int32_t>(std::floor(r.top)),
+                static_cast<int32_t>(std::ceil(r.right)), static_cast<int32_t>(std::ceil(r.bottom))};
+    }
+
+    inline auto to_rectf(const Rect &r) -> RectF {
+        return {static_cast<float>(r.left), static_cast<float>(r.top),
+                static_cast<float>(r.right), static_cast<float>(r.bottom)};
+    }
+
+    /* 2D affine transform laid out like D2D1_MATRIX_3X2_F (row vectors),
+     * so a * b applies a first and then b.
+     */
+    struct Transform {
+        float m11 = 1.0f, m12 = 0.0f;
+        float m21 = 0.0f, m22 = 1.0f;
+        float dx = 0.0f, dy = 0.0f;
+
+        static auto translation(float x, float y) -> Transform { return {1.0f, 0.0f, 0.0f, 1.0f, x, y}; }
+
+        static auto scale(float sx, float sy) -> Transform { return {sx, 0.0f, 0.0f, sy, 0.0f, 0.0f}; }
+
+        auto apply(PointF p) const -> PointF {
+            return {p.x * m11 + p.y * m21 + dx, p.x * m12 + p.y * m22 + dy};
+        }
+
+        // axis-aligned bounds of the transformed rect
+        auto apply(const RectF &r) const -> RectF {
+            const PointF corners[4] = {apply(PointF{r.left, r.top}), apply(PointF{r.right, r.top}),
+                                       apply(PointF{r.left, r.bottom}), apply(PointF{r.right, r.bottom})};
+            RectF out{corners[0].x, corners[0].y, corners[0].x, corners[0].y};
+            for (const auto &c: corners) {
+                out.left = std::min(out.left, c.x);
+                out.top = std::min(out.top, c.y);
+                out.right = std::max(out.right, c.x);
+                out.bottom = std::max(out.bottom, c.y);
+            }
+            return out;
+        }
+
+        auto is_identity() const -> bool {
+            return m11 == 1.0f && m12 == 0.0f && m21 == 0.0f && m22 == 1.0f && dx == 0.0f && dy == 0.0f;
+        }
+    };
+
+    inline auto operator*(const Transform &a, const Transform &b) -> Transform {
+        return {a.m11 * b.m11 + a.m12 * b.m21, a.m11 * b.m12 + a.m12 * b.m22,
+                a.m21 * b.m11 + a.m22 * b.m21, a.m21 * b.m12 + a.m22 * b.m22,
+                a.dx * b.m11 + a.dy * b.m21 + b.dx, a.dx * b.m12 + a.dy * b.m22 + b.dy};
+    }
+
+    inline auto operator==(const Transform &a, const Transform &b) -> bool {
+        return a.m11 == b.m11 && a.m12 == b.m12 && a.m21 == b.m21 && a.m22 == b.m22 && a.dx == b.dx && a.dy == b.dy;
+    }
+
+    inline auto operator!=(const Transform &a, const Transform &b) -> bool {
+        return !(a == b);
+    }
+}
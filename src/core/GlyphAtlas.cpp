@@ -0,0 +1,255 @@
+#include "GlyphAtlas.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace borderless {
+
+    auto ShelfPacker::allocate(int32_t width, int32_t height) -> std::optional<Rect> {
+        if (width <= 0 || height <= 0 || width > width_ || height > height_) {
+            return std::nullopt;
+        }
+        const auto fits = [&](const Shelf &shelf) { return shelf.height >= height && width_ - shelf.next_x >= width; };
+        Shelf *best = nullptr;
+        for (auto &shelf: shelves_) {
+            if (fits(shelf) && (shelf.height - height) * 4 <= shelf.height &&
+                (!best || shelf.height < best->height)) {
+                best = &shelf;
+            }
+        }
+        if (!best && bottom_ + height <= height_) {
+            // a little headroom so the next glyph one or two pixels taller still fits
+            const auto shelf_height = std::min((height + 3) & ~3, height_ - bottom_);
+            shelves_.push_back({bottom_, shelf_height, 0});
+            bottom_ += shelf_height;
+            best = &shelves_.back();
+        }
+        if (!best) {
+            // the page is nearly full: any shelf with room will do
+            for (auto &shelf: shelves_) {
+                if (fits(shelf) && (!best || shelf.height < best->height)) {
+                    best = &shelf;
+                }
+            }
+            if (!best) {
+                return std::nullopt;
+            }
+        }
+        const Rect rect{best->next_x, best->top, best->next_x + width, best->top + height};
+        best->next_x += width;
+        used_ += static_cast<int64_t>(width) * height;
+        return rect;
+    }
+
+    auto ShelfPacker::reset() -> void {
+        shelves_.clear();
+        bottom_ = 0;
+        used_ = 0;
+    }
+
+    auto format_glyph_atlas_stats(const GlyphAtlasStats &stats) -> std::string {
+        const auto lookups = stats.hits + stats.misses;
+        char line[200];
+        std::snprintf(line, sizeof(line),
+                      "glyph atlas: %llu hits, %llu misses (%.1f%% hit rate), %llu pages evicted (%llu glyphs), "
+                      "%llu over budget\n",
+                      static_cast<unsigned long long>(stats.hits),
+                      static_cast<unsigned long long>(stats.misses),
+                      lookups ? 100.0 * double(stats.hits) / double(lookups) : 0.0,
+                      static_cast<unsigned long long>(stats.evicted_pages),
+                      static_cast<unsigned long long>(stats.evicted_glyphs),
+                      static_cast<unsigned long long>(stats.overruns));
+        return line;
+    }
+
+    GlyphAtlas::GlyphAtlas(Rasterizer rasterizer, const GlyphAtlasOptions &options) :
+            rasterizer_(std::move(rasterizer)),
+            options_(options) {
+        if (options_.page_size <= options_.padding || options_.padding < 0) {
+            throw std::invalid_argument("glyph atlas page size must exceed the padding");
+        }
+        options_.subpixel_steps = std::max<uint8_t>(options_.subpixel_steps, 1);
+    }
+
+    auto GlyphAtlas::begin_frame() -> void {
+        ++frame_;
+        while (bytes() > options_.budget_bytes) {
+            const auto coldest = coldest_page();
+            if (coldest == no_page) {
+                break;
+            }
+            evict(coldest, true);
+        }
+    }
+
+    auto GlyphAtlas::find(const GlyphKey &key) -> const AtlasGlyph * {
+        auto it = glyphs_.find(key);
+        if (it == glyphs_.end()) {
+            return insert(key);
+        }
+        ++stats_.hits;
+        if (it->second.page != no_page) {
+            pages_[it->second.page].last_used = frame_;
+        }
+        return &it->second;
+    }
+
+    auto GlyphAtlas::insert(const GlyphKey &key) -> const AtlasGlyph * {
+        ++stats_.misses;
+        scratch_.width = scratch_.height = scratch_.left = scratch_.top = 0;
+        scratch_.advance = 0.0f;
+        const auto offset_x = float(key.subpixel) / float(options_.subpixel_steps);
+        if (!rasterizer_(key, offset_x, scratch_)) {
+            ++stats_.failed;
+            return nullptr;
+        }
+
+        AtlasGlyph glyph{no_page, {}, scratch_.left, scratch_.top, scratch_.advance};
+        if (scratch_.width > 0 && scratch_.height > 0) {
+            const auto width = scratch_.width + options_.padding;
+            const auto height = scratch_.height + options_.padding;
+            if (width > options_.page_size || height > options_.page_size) {
+                ++stats_.oversized;
+                return nullptr;
+            }
+            const auto [index, rect] = allocate(width, height);
+            auto &page = pages_[index];
+            const auto stride = static_cast<size_t>(options_.page_size);
+            for (int32_t y = 0; y < scratch_.height; ++y) {
+                std::memcpy(page.pixels.data() + static_cast<size_t>(rect.top + y) * stride + rect.left,
+                            scratch_.pixels.data() + static_cast<size_t>(y) * scratch_.width,
+                            static_cast<size_t>(scratch_.width));
+            }
+            glyph.page = index;
+            glyph.source = {rect.left, rect.top, rect.left + scratch_.width, rect.top + scratch_.height};
+            page.glyphs.push_back(key);
+            page.last_used = frame_;
+            page.dirty = unite(page.dirty, glyph.source);
+        }
+        return &glyphs_.emplace(key, glyph).first->second;
+    }
+
+    auto GlyphAtlas::allocate(int32_t width, int32_t height) -> std::pair<uint32_t, Rect> {
+        if (current_ != no_page) {
+            if (auto rect = pages_[current_].packer.allocate(width, height)) {
+                return {current_, *rect};
+            }
+        }
+        // older pages still have gaps at the end of their shelves
+        for (uint32_t i = 0; i < pages_.size(); ++i) {
+            if (i == current_ || pages_[i].pixels.empty()) {
+                continue;
+            }
+            if (auto rect = pages_[i].packer.allocate(width, height)) {
+                return {i, *rect};
+            }
+        }
+
+        if ((live_pages_ + 1) * page_bytes() <= options_.budget_bytes || live_pages_ == 0) {
+            current_ = open_page();
+        } else if (const auto coldest = coldest_page(); coldest != no_page) {
+            evict(coldest, false);
+            current_ = coldest;
+        } else {
+            ++stats_.overruns;
+            current_ = open_page();
+        }
+        return {current_, *pages_[current_].packer.allocate(width, height)};
+    }
+
+    auto GlyphAtlas::open_page() -> uint32_t {
+        ++live_pages_;
+        for (uint32_t i = 0; i < pages_.size(); ++i) {
+            if (pages_[i].pixels.empty()) {
+                pages_[i].pixels.assign(page_bytes(), 0);
+                return i;
+            }
+        }
+        pages_.push_back({std::vector<uint8_t>(page_bytes(), 0),
+                          ShelfPacker(options_.page_size, options_.page_size), {}, 0, 0, {}});
+        return static_cast<uint32_t>(pages_.size() - 1);
+    }
+
+    auto GlyphAtlas::coldest_page() const -> uint32_t {
+        auto coldest = no_page;
+        for (uint32_t i = 0; i < pages_.size(); ++i) {
+            const auto &page = pages_[i];
+            if (!page.pixels.empty() && page.last_used < frame_ &&
+                (coldest == no_page || page.last_used < pages_[coldest].last_used)) {
+                coldest = i;
+            }
+        }
+        return coldest;
+    }
+
+    auto GlyphAtlas::evict(uint32_t index, bool release) -> void {
+        auto &page = pages_[index];
+        for (const auto &key: page.glyphs) {
+            glyphs_.erase(key);
+        }
+        ++stats_.evicted_pages;
+        stats_.evicted_glyphs += page.glyphs.size();
+        page.glyphs.clear();
+        page.packer.reset();
+        page.dirty = {};
+        ++page.generation;
+        if (release) {
+            std::vector<uint8_t>().swap(page.pixels);
+            --live_pages_;
+            if (current_ == index) {
+                current_ = no_page;
+            }
+        } else {
+            std::fill(page.pixels.begin(), page.pixels.end(), uint8_t{0});
+        }
+    }
+
+    auto GlyphAtlas::layout(const GlyphRun &run, std::vector<GlyphQuad> &quads) -> PointF {
+        auto pen = run.origin;
+        const auto baseline = static_cast<int32_t>(std::lround(pen.y));
+        for (size_t i = 0; i < run.count; ++i) {
+            const auto [x, subpixel] = snap(pen.x);
+            const auto glyph = find({run.font, run.glyphs[i], run.size, subpixel});
+            if (glyph && !glyph->source.empty()) {
+                quads.push_back({glyph->page, glyph->source, {x + glyph->left, baseline - glyph->top}});
+            }
+            pen.x += run.advances ? run.advances[i] : glyph ? glyph->advance : 0.0f;
+        }
+        return pen;
+    }
+
+    auto GlyphAtlas::snap(float pen_x) const -> std::pair<int32_t, uint8_t> {
+        const auto whole = std::floor(pen_x);
+        auto x = static_cast<int32_t>(whole);
+        auto phase = static_cast<int32_t>(std::lround((pen_x - whole) * options_.subpixel_steps));
+        if (phase >= options_.subpixel_steps) {
+            phase = 0;
+            ++x;
+        }
+        return {x, static_cast<uint8_t>(phase)};
+    }
+
+    auto GlyphAtlas::page(uint32_t index) const -> AlphaMask {
+        const auto &page = pages_[index];
+        if (page.pixels.empty()) {
+            return {};
+        }
+        return {page.pixels.data(), options_.page_size, options_.page_size, options_.page_size};
+    }
+
+    auto GlyphAtlas::take_dirty(uint32_t index) -> Rect {
+        auto dirty = pages_[index].dirty;
+        pages_[index].dirty = {};
+        return dirty;
+    }
+
+    auto GlyphAtlas::clear() -> void {
+        glyphs_.clear();
+        pages_.clear();
+        live_pages_ = 0;
+        current_ = no_page;
+    }
+}
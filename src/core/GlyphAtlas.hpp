@@ -0,0 +1,223 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Geometry.hpp"
+#include "Renderer.hpp"
+
+namespace borderless {
+
+    // one glyph at one size and horizontal subpixel phase; font ids are handed out by the caller
+    struct GlyphKey {
+        uint32_t font = 0;
+        uint32_t glyph = 0;
+        float size = 0.0f;    // em size in pixels
+        uint8_t subpixel = 0; // pen x phase in 1/subpixel_steps pixels
+    };
+
+    inline auto operator==(const GlyphKey &a, const GlyphKey &b) -> bool {
+        return a.font == b.font && a.glyph == b.glyph && a.size == b.size && a.subpixel == b.subpixel;
+    }
+
+    struct GlyphKeyHash {
+        auto operator()(const GlyphKey &key) const -> size_t {
+            size_t h = std::hash<uint32_t>{}(key.font);
+            h = detail::hash_combine(h, std::hash<uint32_t>{}(key.glyph));
+            h = detail::hash_combine(h, std::hash<float>{}(key.size));
+            return detail::hash_combine(h, key.subpixel);
+        }
+    };
+
+    // rasterizer output: coverage placed relative to the pen position on the baseline
+    struct GlyphBitmap {
+        int32_t width = 0;
+        int32_t height = 0;
+        int32_t left = 0; // pen x to the first column
+        int32_t top = 0;  // baseline to the first row, positive up
+        float advance = 0.0f;
+        std::vector<uint8_t> pixels; // width x height, stride == width
+    };
+
+    // a cached glyph; glyphs without coverage (spaces) have an empty source and no page
+    struct AtlasGlyph {
+        uint32_t page = 0;
+        Rect source;
+        int32_t left = 0;
+        int32_t top = 0;
+        float advance = 0.0f;
+    };
+
+    // one glyph to draw: a rect of an atlas page and the device pixel it lands on
+    struct GlyphQuad {
+        uint32_t page = 0;
+        Rect source;
+        Point origin;
+    };
+
+    // glyphs of one font and size laid out along a baseline
+    struct GlyphRun {
+        uint32_t font = 0;
+        float size = 0.0f;
+        PointF origin;                   // pen position on the baseline
+        const uint32_t *glyphs = nullptr;
+        const float *advances = nullptr; // optional, else the rasterizer's advances
+        size_t count = 0;
+    };
+
+    /* Shelf allocator for one atlas page. A rect goes on the existing shelf whose height fits it
+     * best, as long as no more than a quarter of that height is wasted; otherwise a new shelf opens
+     * below the last one. Glyph heights within a run cluster tightly, so shelves fill well and
+     * allocation is a scan over a few dozen shelves. Space is only reclaimed by reset().
+     */
+    class ShelfPacker {
+    public:
+        ShelfPacker(int32_t width, int32_t height) : width_(width), height_(height) {}
+
+        auto allocate(int32_t width, int32_t height) -> std::optional<Rect>;
+
+        auto reset() -> void;
+
+        auto width() const -> int32_t { return width_; }
+
+        auto height() const -> int32_t { return height_; }
+
+        // area handed out since the last reset
+        auto used_area() const -> int64_t { return used_; }
+
+        auto shelf_count() const -> size_t { return shelves_.size(); }
+
+    private:
+        struct Shelf {
+            int32_t top;
+            int32_t height;
+            int32_t next_x;
+        };
+
+        int32_t width_;
+        int32_t height_;
+        int32_t bottom_ = 0;
+        int64_t used_ = 0;
+        std::vector<Shelf> shelves_;
+    };
+
+    struct GlyphAtlasOptions {
+        int32_t page_size = 512;            // pages are square, one byte of coverage per pixel
+        size_t budget_bytes = size_t{4} << 20;
+        uint8_t subpixel_steps = 4;         // horizontal pen phases rasterized separately, 1 turns it off
+        int32_t padding = 1;                // empty pixels between glyphs so filtered sampling does not bleed
+    };
+
+    struct GlyphAtlasStats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;        // each one is a rasterization
+        uint64_t failed = 0;        // the rasterizer had no such glyph
+        uint64_t oversized = 0;     // larger than a page, not cached
+        uint64_t evicted_pages = 0;
+        uint64_t evicted_glyphs = 0;
+        uint64_t overruns = 0;      // pages added over budget because every page was in use this frame
+    };
+
+    auto format_glyph_atlas_stats(const GlyphAtlasStats &stats) -> std::string;
+
+    /* Glyph coverage rasterized once per (font, size, glyph, subpixel phase) and packed into pages
+     * of a fixed size. Pages are evicted whole, least recently used first, when a new page would
+     * exceed the memory budget; a page used since the last begin_frame() is never evicted, so the
+     * glyphs and quads of the current frame stay valid. If every page is in use the atlas grows
+     * past the budget and trims itself again at the next begin_frame().
+     * The pages are plain memory: the CPU renderer draws quads straight from them, a GPU backend
+     * uploads take_dirty() of each page into a texture and redraws after a generation change.
+     * Not thread-safe; one atlas per render thread.
+     */
+    class GlyphAtlas {
+    public:
+        // fills bitmap (its pixels are reused between calls) for key with the outline shifted right by
+        // offset_x pixels; false when the font has no such glyph
+        using Rasterizer = std::function<bool(const GlyphKey &key, float offset_x, GlyphBitmap &bitmap)>;
+
+        static constexpr uint32_t no_page = UINT32_MAX;
+
+        explicit GlyphAtlas(Rasterizer rasterizer, const GlyphAtlasOptions &options = {});
+
+        GlyphAtlas(const GlyphAtlas &) = delete;
+
+        auto operator=(const GlyphAtlas &) -> GlyphAtlas & = delete;
+
+        // starts a frame: unpins the pages used so far and trims the atlas back to its budget
+        auto begin_frame() -> void;
+
+        // the cached glyph, rasterized on a miss; nullptr if it failed or is larger than a page.
+        // Valid until the next begin_frame()
+        auto find(const GlyphKey &key) -> const AtlasGlyph *;
+
+        // appends a quad per glyph with coverage and returns the pen position after the run
+        auto layout(const GlyphRun &run, std::vector<GlyphQuad> &quads) -> PointF;
+
+        // splits a pen x into the whole pixel the glyph is placed at and the subpixel phase it is rasterized with
+        auto snap(float pen_x) const -> std::pair<int32_t, uint8_t>;
+
+        // the coverage of a page, stride == page_size
+        auto page(uint32_t index) const -> AlphaMask;
+
+        // changes whenever glyphs already on the page are replaced, i.e. on eviction
+        auto page_generation(uint32_t index) const -> uint64_t { return pages_[index].generation; }
+
+        // the area written since the last call, e.g. to update a texture copy of the page
+        auto take_dirty(uint32_t index) -> Rect;
+
+        auto clear() -> void;
+
+        auto page_count() const -> size_t { return pages_.size(); }
+
+        // bytes of page memory currently held
+        auto bytes() const -> size_t { return live_pages_ * page_bytes(); }
+
+        auto glyph_count() const -> size_t { return glyphs_.size(); }
+
+        auto options() const -> const GlyphAtlasOptions & { return options_; }
+
+        auto stats() const -> const GlyphAtlasStats & { return stats_; }
+
+        auto reset_stats() -> void { stats_ = {}; }
+
+    private:
+        struct Page {
+            std::vector<uint8_t> pixels; // empty once the page is trimmed
+            ShelfPacker packer;
+            std::vector<GlyphKey> glyphs;
+            uint64_t last_used = 0; // frame
+            uint64_t generation = 0;
+            Rect dirty;
+        };
+
+        auto page_bytes() const -> size_t {
+            return static_cast<size_t>(options_.page_size) * static_cast<size_t>(options_.page_size);
+        }
+
+        auto insert(const GlyphKey &key) -> const AtlasGlyph *;
+
+        // never fails for a rect that fits in a page: evicts or grows past the budget
+        auto allocate(int32_t width, int32_t height) -> std::pair<uint32_t, Rect>;
+
+        auto open_page() -> uint32_t;
+
+        auto coldest_page() const -> uint32_t;
+
+        auto evict(uint32_t index, bool release) -> void;
+
+        Rasterizer rasterizer_;
+        GlyphAtlasOptions options_;
+        std::vector<Page> pages_;
+        size_t live_pages_ = 0;
+        uint32_t current_ = no_page; // the page new glyphs go to first
+        std::unordered_map<GlyphKey, AtlasGlyph, GlyphKeyHash> glyphs_;
+        GlyphBitmap scratch_;
+        uint64_t frame_ = 1;
+        GlyphAtlasStats stats_;
+    };
+}
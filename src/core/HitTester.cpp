@@ -0,0 +1,135 @@
+#include "HitTester.hpp"
+
+#include <algorithm>
+
+namespace borderless {
+
+    auto HitTester::update(Point border, const Rect &window) -> void {
+        border_ = border;
+        window_ = window;
+        resolve_regions();
+        valid_ = true;
+    }
+
+    auto HitTester::add_region(const HitRegion &region) -> size_t {
+        regions_.push_back({next_id_, region});
+        resolved_.push_back(resolve(region));
+        return next_id_++;
+    }
+
+    auto HitTester::remove_region(size_t id) -> void {
+        auto it = std::find_if(regions_.begin(), regions_.end(), [id](const Entry &e) { return e.id == id; });
+        if (it == regions_.end()) {
+            return;
+        }
+        resolved_.erase(resolved_.begin() + (it - regions_.begin()));
+        regions_.erase(it);
+    }
+
+    auto HitTester::clear_regions() -> void {
+        regions_.clear();
+        resolved_.clear();
+    }
+
+    auto HitTester::resolve(const HitRegion &region) const -> Rect {
+        const auto &b = region.bounds;
+        Rect r{};
+
+        switch (region.anchor & (anchor_left | anchor_right)) {
+            case anchor_right:
+                r.left = window_.right + b.left;
+                r.right = window_.right + b.right;
+                break;
+            case anchor_left | anchor_right:
+                r.left = window_.left + b.left;
+                r.right = window_.right - b.right;
+                break;
+            default:
+                r.left = window_.left + b.left;
+                r.right = window_.left + b.right;
+                break;
+        }
+
+        switch (region.anchor & (anchor_top | anchor_bottom)) {
+            case anchor_bottom:
+                r.top = window_.bottom + b.top;
+                r.bottom = window_.bottom + b.bottom;
+                break;
+            case anchor_top | anchor_bottom:
+                r.top = window_.top + b.top;
+                r.bottom = window_.bottom - b.bottom;
+                break;
+            default:
+                r.top = window_.top + b.top;
+                r.bottom = window_.top + b.bottom;
+                break;
+        }
+        return r;
+    }
+
+    auto HitTester::resolve_regions() -> void {
+        for (size_t i = 0; i < regions_.size(); ++i) {
+            resolved_[i] = resolve(regions_[i].region);
+        }
+    }
+
+    auto HitTester::hit_test(Point cursor) const -> HitResult {
+        // identify borders and corners to allow resizing the window.
+        // Note: On Windows 10, windows behave differently and
+        // allow resizing outside the visible window frame.
+        // This implementation does not replicate that behavior.
+        if (!window_.contains(cursor)) {
+            return HitResult::nowhere;
+        }
+
+        enum region_mask {
+            client = 0b0000,
+            left = 0b0001,
+            right = 0b0010,
+            top = 0b0100,
+            bottom = 0b1000,
+        };
+
+        const auto result =
+                left * (cursor.x < (window_.left + border_.x)) |
+                right * (cursor.x >= (window_.right - border_.x)) |
+                top * (cursor.y < (window_.top + border_.y)) |
+                bottom * (cursor.y >= (window_.bottom - border_.y));
+
+        if (result != client && resizable_) {
+            switch (result) {
+                case left          :
+                    return HitResult::left;
+                case right         :
+                    return HitResult::right;
+                case top           :
+                    return HitResult::top;
+                case bottom        :
+                    return HitResult::bottom;
+                case top | left    :
+                    return HitResult::top_left;
+                case top | right   :
+                    return HitResult::top_right;
+                case bottom | left :
+                    return HitResult::bottom_left;
+                case bottom | right:
+                    return HitResult::bottom_right;
+                default            :
+                    return HitResult::nowhere;
+            }
+        }
+
+        // custom regions, most recently added first
+        for (size_t i = resolved_.size(); i-- > 0;) {
+            if (resolved_[i].contains(cursor)) {
+                const auto region = regions_[i].region.result;
+                if (region == HitResult::caption && !draggable_) {
+                    return HitResult::client;
+                }
+                return region;
+            }
+        }
+
+        return draggable_ ? HitResult::caption : HitResult::client;
+    }
+}
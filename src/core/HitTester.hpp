@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Geometry.hpp"
+
+namespace borderless {
+
+    // values match the Win32 HT* codes so the shell can cast straight to LRESULT
+    enum class HitResult : int32_t {
+        nowhere = 0,
+        client = 1,
+        caption = 2,
+        minimize_button = 8,
+        maximize_button = 9,
+        left = 10,
+        right = 11,
+        top = 12,
+        top_left = 13,
+        top_right = 14,
+        bottom = 15,
+        bottom_left = 16,
+        bottom_right = 17,
+        close_button = 20,
+    };
+
+    // Which window edges a region's offsets are measured from.
+    // anchor_left: bounds.left/right are offsets from the window's left edge
+    // anchor_right: bounds.left/right are offsets from the window's right edge
+    // anchor_left | anchor_right: stretch, bounds.left from the left edge, bounds.right from the right edge
+    // the vertical flags behave the same way for bounds.top/bottom
+    enum Anchor : uint8_t {
+        anchor_left = 0b0001,
+        anchor_right = 0b0010,
+        anchor_top = 0b0100,
+        anchor_bottom = 0b1000,
+    };
+
+    struct HitRegion {
+        Rect bounds;
+        HitResult result = HitResult::client;
+        uint8_t anchor = anchor_left | anchor_top;
+    };
+
+    /* Caches everything WM_NCHITTEST needs (frame border size, window rect and custom regions
+     * resolved into screen space) so a lookup is a handful of compares with no system calls.
+     * The owner calls update() whenever the cache is invalid, i.e. after invalidate() was
+     * called from WM_SIZE/WM_MOVE/WM_DPICHANGED/WM_SETTINGCHANGE.
+     */
+    class HitTester {
+    public:
+        auto update(Point border, const Rect &window) -> void;
+
+        auto invalidate() -> void { valid_ = false; }
+
+        auto valid() const -> bool { return valid_; }
+
+        auto set_resizable(bool enabled) -> void { resizable_ = enabled; }
+
+        auto resizable() const -> bool { return resizable_; }
+
+        auto set_draggable(bool enabled) -> void { draggable_ = enabled; }
+
+        auto draggable() const -> bool { return draggable_; }
+
+        // regions added later take precedence over earlier ones; returns an id for remove_region
+        auto add_region(const HitRegion &region) -> size_t;
+
+        auto remove_region(size_t id) -> void;
+
+        auto clear_regions() -> void;
+
+        auto hit_test(Point cursor) const -> HitResult;
+
+        auto border() const -> Point { return border_; }
+
+        auto window_rect() const -> const Rect & { return window_; }
+
+    private:
+        auto resolve(const HitRegion &region) const -> Rect;
+
+        auto resolve_regions() -> void;
+
+        struct Entry {
+            size_t id;
+            HitRegion region;
+        };
+
+        std::vector<Entry> regions_;
+        std::vector<Rect> resolved_; // regions_ in screen space, same order
+        size_t next_id_ = 0;
+
+        Point border_{};
+        Rect window_{};
+        bool valid_ = false;
+        bool resizable_ = true;
+        bool draggable_ = true;
+    };
+}
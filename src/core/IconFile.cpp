@@ -0,0 +1,85 @@
+#include "IconFile.hpp"
+
+#include <cstring>
+
+namespace borderless {
+
+    namespace {
+        auto read16(const uint8_t *p) -> uint16_t {
+            return static_cast<uint16_t>(p[0] | (p[1] << 8));
+        }
+
+        auto read32(const uint8_t *p) -> uint32_t {
+            return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+                   (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+        }
+
+        constexpr uint8_t png_signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        constexpr size_t header_size = 6;
+        constexpr size_t entry_size = 16;
+    }
+
+    auto parse_icon(ByteView bytes) -> std::optional<IconFile> {
+        if (bytes.size < header_size) {
+            return std::nullopt;
+        }
+        // ICONDIR: reserved (0), type (1 = icon), count
+        if (read16(bytes.data) != 0 || read16(bytes.data + 2) != 1) {
+            return std::nullopt;
+        }
+        const size_t count = read16(bytes.data + 4);
+        const auto entries = bytes.sub(header_size, count * entry_size);
+        if (entries.size != count * entry_size) {
+            return std::nullopt;
+        }
+
+        IconFile icon;
+        icon.images.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            // ICONDIRENTRY: width, height (0 = 256), colors, reserved, planes, bit count, size, offset
+            const uint8_t *e = entries.data + i * entry_size;
+            IconImage image{};
+            image.width = e[0] ? e[0] : 256;
+            image.height = e[1] ? e[1] : 256;
+            image.bit_count = read16(e + 6);
+            image.data = bytes.sub(read32(e + 12), read32(e + 8));
+            if (image.data.empty()) {
+                return std::nullopt;
+            }
+            image.png = image.data.size >= sizeof(png_signature) &&
+                        std::memcmp(image.data.data, png_signature, sizeof(png_signature)) == 0;
+            if (!image.png && image.bit_count == 0 && image.data.size >= 16) {
+                // some writers leave the directory's bit count empty; BITMAPINFOHEADER has it
+                image.bit_count = read16(image.data.data + 14);
+            }
+            icon.images.push_back(image);
+        }
+        return icon;
+    }
+
+    auto best_icon_image(const IconFile &icon, int32_t size) -> const IconImage * {
+        const IconImage *best = nullptr;
+        auto edge = [](const IconImage &image) { return image.width > image.height ? image.width : image.height; };
+        auto better = [&](const IconImage &candidate) {
+            if (!best) {
+                return true;
+            }
+            const auto c = edge(candidate), b = edge(*best);
+            const bool c_fits = c >= size, b_fits = b >= size;
+            if (c_fits != b_fits) {
+                return c_fits;
+            }
+            if (c != b) {
+                // both large enough: the closest; both too small: the largest
+                return c_fits ? c < b : c > b;
+            }
+            return candidate.bit_count > best->bit_count;
+        };
+        for (const auto &image: icon.images) {
+            if (better(image)) {
+                best = &image;
+            }
+        }
+        return best;
+    }
+}
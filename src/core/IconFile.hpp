@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "ByteView.hpp"
+
+namespace borderless {
+
+    // one image of an .ico file; data is what CreateIconFromResourceEx expects (a DIB or a PNG)
+    struct IconImage {
+        int32_t width;
+        int32_t height;
+        uint16_t bit_count;
+        bool png;
+        ByteView data;
+    };
+
+    struct IconFile {
+        std::vector<IconImage> images;
+    };
+
+    // parses the ICONDIR header and entries; images point into bytes, nothing is decoded
+    auto parse_icon(ByteView bytes) -> std::optional<IconFile>;
+
+    // the icon edge for a 96-DPI size at dpi, e.g. 32 at 144 DPI is 48
+    constexpr auto icon_size_for_dpi(int32_t size_at_96, uint32_t dpi) -> int32_t {
+        return static_cast<int32_t>((static_cast<int64_t>(size_at_96) * dpi + 48) / 96);
+    }
+
+    /* Picks the image to show at size x size pixels: the smallest one at least that large
+     * (downscaling looks better than upscaling), else the largest; ties go to the higher bit depth.
+     * Returns nullptr for an empty file.
+     */
+    auto best_icon_image(const IconFile &icon, int32_t size) -> const IconImage *;
+}
@@ -0,0 +1,311 @@
+#include "LayerPolicy.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+namespace borderless {
+
+    namespace {
+        auto seconds(FrameClockType::duration duration) -> double {
+            return std::chrono::duration<double>(duration).count();
+        }
+
+        // visual order of the groups: cached below, swap chain, cached above
+        auto group(LayerPlacement placement) -> int {
+            switch (placement) {
+                case LayerPlacement::below:
+                    return 0;
+                case LayerPlacement::swap_chain:
+                    return 1;
+                case LayerPlacement::above:
+                    return 2;
+            }
+            return 1;
+        }
+    }
+
+    auto format_layer_policy_stats(const LayerPolicyStats &stats) -> std::string {
+        char line[200];
+        std::snprintf(line, sizeof(line),
+                      "layer policy: %llu frames, %llu promotions, %llu demotions, %llu over budget, %llu blocked\n",
+                      static_cast<unsigned long long>(stats.frames),
+                      static_cast<unsigned long long>(stats.promotions),
+                      static_cast<unsigned long long>(stats.demotions),
+                      static_cast<unsigned long long>(stats.over_budget),
+                      static_cast<unsigned long long>(stats.blocked));
+        return line;
+    }
+
+    auto layer_samples(const Scene &scene, const LayerDamage &damage, std::vector<LayerSample> &samples) -> void {
+        samples.clear();
+        const Rect everything{INT_MIN, INT_MIN, INT_MAX, INT_MAX};
+        scene.paint(everything, [&](NodeId id, const NodeContent &, const Transform &) {
+            const auto layer = scene.layer(id);
+            if (samples.empty() || samples.back().layer != layer) {
+                const bool updated = layer < damage.size() && !damage[layer].empty();
+                samples.push_back({layer, {}, updated});
+            }
+            samples.back().bounds = unite(samples.back().bounds, scene.bounds(id));
+        });
+    }
+
+    LayerPolicy::LayerPolicy(const LayerPolicyOptions &options) : options_(options) {
+        if (options_.window.count() <= 0) {
+            throw std::invalid_argument("layer policy window must be positive");
+        }
+        if (options_.promote_below > options_.demote_above) {
+            throw std::invalid_argument("layer policy promotes above its demotion rate");
+        }
+    }
+
+    auto LayerPolicy::frame(Clock::time_point now, const std::vector<LayerSample> &samples)
+    -> const std::vector<LayerDecision> & {
+        decisions_.clear();
+        ++stats_.frames;
+        const auto window = seconds(options_.window);
+        const auto decay = started_ ? std::exp(-seconds(now - last_frame_) / window) : 1.0;
+        last_frame_ = now;
+        started_ = true;
+
+        for (auto &[id, layer]: layers_) {
+            layer.present = false;
+            layer.updated = false;
+            layer.bounds = {};
+            layer.runs.clear();
+        }
+        for (size_t i = 0; i < samples.size(); ++i) {
+            const auto &sample = samples[i];
+            if (sample.layer == 0) {
+                continue;
+            }
+            auto [it, added] = layers_.try_emplace(sample.layer);
+            auto &layer = it->second;
+            if (added) {
+                layer.rate = options_.demote_above;
+                layer.changed = now;
+            } else if (!layer.present) {
+                layer.rate *= decay;
+            }
+            layer.present = true;
+            layer.runs.push_back(i);
+            layer.updated = layer.updated || sample.updated;
+            layer.bounds = unite(layer.bounds, sample.bounds);
+        }
+
+        // what each layer wants on its own, cached layers first so the budget does not swap them out
+        std::vector<uint32_t> wanted;
+        for (auto it = layers_.begin(); it != layers_.end();) {
+            auto &[id, layer] = *it;
+            if (!layer.present) {
+                if (layer.placement != LayerPlacement::swap_chain) {
+                    decisions_.push_back({id, layer.placement, LayerPlacement::swap_chain});
+                    ++stats_.demotions;
+                }
+                it = layers_.erase(it);
+                continue;
+            }
+            if (layer.updated) {
+                layer.rate += 1.0 / window;
+            }
+            const bool cached = layer.placement != LayerPlacement::swap_chain;
+            const bool settled = now - layer.changed >= options_.min_dwell;
+            const bool wants = !settled ? cached
+                    : cached ? layer.rate <= options_.demote_above
+                    : layer.rate < options_.promote_below && layer.bounds.area() >= options_.min_area;
+            if (wants) {
+                wanted.push_back(id);
+            }
+            ++it;
+        }
+        std::sort(wanted.begin(), wanted.end(), [&](uint32_t a, uint32_t b) {
+            const auto &x = layers_.at(a), &y = layers_.at(b);
+            const bool x_cached = x.placement != LayerPlacement::swap_chain;
+            const bool y_cached = y.placement != LayerPlacement::swap_chain;
+            if (x_cached != y_cached) {
+                return x_cached;
+            }
+            if (x.rate != y.rate) {
+                return x.rate < y.rate;
+            }
+            if (x.bounds.area() != y.bounds.area()) {
+                return x.bounds.area() > y.bounds.area();
+            }
+            return a < b;
+        });
+        int64_t area = 0;
+        size_t kept = 0;
+        for (; kept < wanted.size() && kept < options_.max_layers; ++kept) {
+            const auto layer_area = layers_.at(wanted[kept]).bounds.area();
+            if (options_.max_area > 0 && area + layer_area > options_.max_area) {
+                break;
+            }
+            area += layer_area;
+        }
+        stats_.over_budget += wanted.size() - kept;
+        wanted.resize(kept);
+
+        const auto placed = place(wanted, samples);
+        stats_.blocked += wanted.size() - placed.size();
+        for (auto &[id, layer]: layers_) {
+            auto it = placed.find(id);
+            const auto to = it == placed.end() ? LayerPlacement::swap_chain : it->second;
+            if (to == layer.placement) {
+                continue;
+            }
+            if (layer.placement == LayerPlacement::swap_chain) {
+                ++stats_.promotions;
+            } else if (to == LayerPlacement::swap_chain) {
+                ++stats_.demotions;
+            }
+            decisions_.push_back({id, layer.placement, to});
+            layer.placement = to;
+            layer.changed = now;
+        }
+        return decisions_;
+    }
+
+    auto LayerPolicy::place(const std::vector<uint32_t> &wanted, const std::vector<LayerSample> &samples)
+    -> std::map<uint32_t, LayerPlacement> {
+        std::map<uint32_t, LayerPlacement> placed;
+        // per run: where its layer sits so far, and the first run of its layer
+        std::vector<LayerPlacement> run_at(samples.size(), LayerPlacement::swap_chain);
+        std::vector<size_t> first(samples.size());
+        for (size_t i = 0; i < samples.size(); ++i) {
+            first[i] = samples[i].layer == 0 ? i : layers_.at(samples[i].layer).runs.front();
+        }
+        // every run of layer that overlaps another layer's run has to stay on the same side of it;
+        // cached layers of a group are stacked in the order they first paint
+        auto fits = [&](const Layer &layer, uint32_t id, LayerPlacement at) {
+            for (auto i: layer.runs) {
+                for (size_t j = 0; j < samples.size(); ++j) {
+                    if (samples[j].layer == id || !intersects(samples[i].bounds, samples[j].bounds)) {
+                        continue;
+                    }
+                    const bool above = group(at) != group(run_at[j])
+                            ? group(at) > group(run_at[j])
+                            : first[i] > first[j];
+                    if (above != (i > j)) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        };
+
+        // each layer placed shrinks the swap chain, which may unblock others
+        auto pending = wanted;
+        for (bool progress = true; progress && !pending.empty();) {
+            progress = false;
+            for (auto it = pending.begin(); it != pending.end();) {
+                const auto &layer = layers_.at(*it);
+                LayerPlacement at = LayerPlacement::swap_chain;
+                if (layer.placement != LayerPlacement::swap_chain && fits(layer, *it, layer.placement)) {
+                    at = layer.placement;
+                } else if (fits(layer, *it, LayerPlacement::below)) {
+                    at = LayerPlacement::below;
+                } else if (fits(layer, *it, LayerPlacement::above)) {
+                    at = LayerPlacement::above;
+                }
+                if (at == LayerPlacement::swap_chain) {
+                    ++it;
+                    continue;
+                }
+                placed.emplace(*it, at);
+                for (auto run: layer.runs) {
+                    run_at[run] = at;
+                }
+                it = pending.erase(it);
+                progress = true;
+            }
+        }
+        return placed;
+    }
+
+    auto LayerPolicy::placement(uint32_t layer) const -> LayerPlacement {
+        auto it = layers_.find(layer);
+        return it == layers_.end() ? LayerPlacement::swap_chain : it->second.placement;
+    }
+
+    auto LayerPolicy::bounds(uint32_t layer) const -> Rect {
+        auto it = layers_.find(layer);
+        return it == layers_.end() ? Rect{} : it->second.bounds;
+    }
+
+    auto LayerPolicy::rate(uint32_t layer) const -> double {
+        auto it = layers_.find(layer);
+        return it == layers_.end() ? 0.0 : it->second.rate;
+    }
+
+    auto LayerPolicy::cached() const -> size_t {
+        return static_cast<size_t>(std::count_if(layers_.begin(), layers_.end(), [](const auto &entry) {
+            return entry.second.placement != LayerPlacement::swap_chain;
+        }));
+    }
+
+    auto LayerPolicy::stacking() const -> std::vector<uint32_t> {
+        std::vector<uint32_t> stack;
+        for (const auto &[id, layer]: layers_) {
+            if (layer.placement != LayerPlacement::swap_chain) {
+                stack.push_back(id);
+            }
+        }
+        std::sort(stack.begin(), stack.end(), [&](uint32_t a, uint32_t b) {
+            const auto &x = layers_.at(a), &y = layers_.at(b);
+            if (group(x.placement) != group(y.placement)) {
+                return group(x.placement) < group(y.placement);
+            }
+            return x.runs.front() < y.runs.front();
+        });
+        return stack;
+    }
+
+    auto LayerPolicy::reset() -> void {
+        layers_.clear();
+        decisions_.clear();
+        started_ = false;
+    }
+
+    auto layer_update_frames(const trace::Snapshot &snapshot) -> std::vector<LayerUpdateFrame> {
+        struct Mark {
+            uint64_t ticks;
+            bool frame;
+            uint32_t layer;
+        };
+        std::vector<Mark> marks;
+        for (const auto &thread: snapshot.threads) {
+            for (const auto &record: thread.records) {
+                const auto event = static_cast<trace::Event>(record.event);
+                if (event == trace::Event::render_scene && record.phase == trace::Phase::begin) {
+                    marks.push_back({record.ticks, true, 0});
+                } else if (event == trace::Event::layer_update) {
+                    marks.push_back({record.ticks, false, record.arg});
+                }
+            }
+        }
+        // a frame begins before the updates it reports, even within the same tick
+        std::stable_sort(marks.begin(), marks.end(), [](const Mark &a, const Mark &b) {
+            return a.ticks != b.ticks ? a.ticks < b.ticks : a.frame > b.frame;
+        });
+
+        std::vector<LayerUpdateFrame> frames;
+        uint64_t first = 0;
+        for (const auto &mark: marks) {
+            if (mark.frame) {
+                if (frames.empty()) {
+                    first = mark.ticks;
+                }
+                LayerUpdateFrame frame;
+                const auto elapsed = snapshot.ticks_per_second > 0.0
+                        ? double(mark.ticks - first) / snapshot.ticks_per_second : 0.0;
+                frame.at = std::chrono::duration_cast<FrameClockType::duration>(std::chrono::duration<double>(elapsed));
+                frames.push_back(std::move(frame));
+            } else if (!frames.empty()) {
+                frames.back().updated.push_back(mark.layer);
+            }
+        }
+        return frames;
+    }
+}
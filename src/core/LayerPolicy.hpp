@@ -0,0 +1,128 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "FrameScheduler.hpp"
+#include "Geometry.hpp"
+#include "Scene.hpp"
+#include "Trace.hpp"
+
+namespace borderless {
+
+    struct LayerPolicyOptions {
+        FrameClockType::duration window = std::chrono::seconds(1);           // time constant of the update rate
+        double promote_below = 2.0;                                          // updates per second
+        double demote_above = 8.0;
+        FrameClockType::duration min_dwell = std::chrono::milliseconds(500); // between two changes of a layer
+        int64_t min_area = 64 * 64;                                          // smaller layers stay in the swap chain
+        size_t max_layers = 8;
+        int64_t max_area = 0;                                                // of all cached layers, 0: no limit
+    };
+
+    // a run of consecutive leaves of one layer in paint order; a layer can have several runs
+    struct LayerSample {
+        uint32_t layer = 0;
+        Rect bounds{};
+        bool updated = false; // its content changed this frame
+    };
+
+    // where a layer's pixels come from: the swap chain, or a surface of its own under or over it
+    enum class LayerPlacement : uint8_t {
+        swap_chain,
+        below,
+        above,
+    };
+
+    struct LayerDecision {
+        uint32_t layer;
+        LayerPlacement from;
+        LayerPlacement to;
+    };
+
+    struct LayerPolicyStats {
+        uint64_t frames = 0;
+        uint64_t promotions = 0;
+        uint64_t demotions = 0;
+        uint64_t over_budget = 0; // layer frames a layer wanted a surface past max_layers or max_area
+        uint64_t blocked = 0;     // layer frames a layer wanted a surface but the paint order did not allow one
+    };
+
+    auto format_layer_policy_stats(const LayerPolicyStats &stats) -> std::string;
+
+    // the runs of the scene's visible leaves in paint order; updated from damage[layer]
+    auto layer_samples(const Scene &scene, const LayerDamage &damage, std::vector<LayerSample> &samples) -> void;
+
+    /* Decides which scene layers get a composition surface of their own. Each layer's update rate
+     * is an exponentially decaying average over options.window; a layer is cached once it updates
+     * less than promote_below times per second and goes back into the swap chain above
+     * demote_above, with min_dwell between two changes, so a layer near one threshold does not
+     * flap. New layers start at demote_above and have to settle first.
+     * A cached layer sits either below or above the whole swap chain, so it can only be cached if
+     * that keeps the paint order wherever it overlaps other content; otherwise it stays where it
+     * is. Layer 0 is the untagged content and always stays in the swap chain.
+     * Time only comes in through frame(), so recorded traces replay to the same decisions.
+     */
+    class LayerPolicy {
+    public:
+        using Clock = FrameClockType;
+
+        explicit LayerPolicy(const LayerPolicyOptions &options = {});
+
+        // samples in paint order, as from layer_samples(); returns the layers that change placement
+        auto frame(Clock::time_point now, const std::vector<LayerSample> &samples) -> const std::vector<LayerDecision> &;
+
+        auto placement(uint32_t layer) const -> LayerPlacement;
+
+        // union of the layer's runs in the last frame
+        auto bounds(uint32_t layer) const -> Rect;
+
+        // updates per second as of the last frame
+        auto rate(uint32_t layer) const -> double;
+
+        // layers with a surface of their own
+        auto cached() const -> size_t;
+
+        // the cached layers bottom to top; changes without a decision when the paint order does
+        auto stacking() const -> std::vector<uint32_t>;
+
+        // forgets every layer, e.g. after the device was lost; cached layers are not reported
+        auto reset() -> void;
+
+        auto stats() const -> const LayerPolicyStats & { return stats_; }
+
+    private:
+        struct Layer {
+            double rate = 0.0;
+            Clock::time_point changed{};
+            LayerPlacement placement = LayerPlacement::swap_chain;
+            Rect bounds{};
+            std::vector<size_t> runs; // sample indices, in paint order
+            bool present = false;
+            bool updated = false;
+        };
+
+        auto place(const std::vector<uint32_t> &wanted, const std::vector<LayerSample> &samples)
+        -> std::map<uint32_t, LayerPlacement>;
+
+        LayerPolicyOptions options_;
+        std::map<uint32_t, Layer> layers_;
+        std::vector<LayerDecision> decisions_;
+        Clock::time_point last_frame_{};
+        bool started_ = false;
+        LayerPolicyStats stats_;
+    };
+
+    // one rendered frame of a trace and the layers it reported updated
+    struct LayerUpdateFrame {
+        FrameClockType::duration at{}; // since the first frame
+        std::vector<uint32_t> updated;
+    };
+
+    // frames start at each render_scene begin and collect the layer_update events after it; all
+    // threads are merged, so a trace should come from a single window
+    auto layer_update_frames(const trace::Snapshot &snapshot) -> std::vector<LayerUpdateFrame>;
+}
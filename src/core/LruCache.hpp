@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace borderless {
+
+    struct CacheStats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+
+    /* Least-recently-used map with a fixed entry budget.
+     * Keys live once, inside the recency list; the index only points at them, so a hit
+     * (hash, compare, splice) does not allocate.
+     */
+    template<typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>>
+    class LruCache {
+    public:
+        explicit LruCache(size_t capacity) : capacity_(capacity == 0 ? 1 : capacity) {}
+
+        LruCache(const LruCache &) = delete;
+
+        auto operator=(const LruCache &) -> LruCache & = delete;
+
+        // returns nullptr on a miss; a hit marks the entry most recently used
+        auto find(const Key &key) -> Value * {
+            auto it = index_.find(&key);
+            if (it == index_.end()) {
+                ++stats_.misses;
+                return nullptr;
+            }
+            ++stats_.hits;
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return &it->second->second;
+        }
+
+        // inserts or replaces the entry for key and evicts the coldest entries over capacity
+        auto insert(const Key &key, Value value) -> Value & {
+            auto it = index_.find(&key);
+            if (it != index_.end()) {
+                it->second->second = std::move(value);
+                entries_.splice(entries_.begin(), entries_, it->second);
+                return it->second->second;
+            }
+            entries_.emplace_front(key, std::move(value));
+            index_.emplace(&entries_.front().first, entries_.begin());
+            while (entries_.size() > capacity_) {
+                evict_last();
+            }
+            return entries_.front().second;
+        }
+
+        template<typename Create>
+        auto get_or_create(const Key &key, Create &&create) -> Value & {
+            if (auto value = find(key)) {
+                return *value;
+            }
+            return insert(key, create());
+        }
+
+        auto erase(const Key &key) -> bool {
+            auto it = index_.find(&key);
+            if (it == index_.end()) {
+                return false;
+            }
+            auto entry = it->second;
+            index_.erase(it);
+            entries_.erase(entry);
+            return true;
+        }
+
+        auto clear() -> void {
+            index_.clear();
+            entries_.clear();
+        }
+
+        auto set_capacity(size_t capacity) -> void {
+            capacity_ = capacity == 0 ? 1 : capacity;
+            while (entries_.size() > capacity_) {
+                evict_last();
+            }
+        }
+
+        // visits entries from most to least recently used
+        template<typename Visit>
+        auto for_each(Visit &&visit) -> void {
+            for (auto &entry: entries_) {
+                visit(entry.first, entry.second);
+            }
+        }
+
+        auto size() const -> size_t { return entries_.size(); }
+
+        auto capacity() const -> size_t { return capacity_; }
+
+        auto stats() const -> const CacheStats & { return stats_; }
+
+        auto reset_stats() -> void { stats_ = {}; }
+
+    private:
+        auto evict_last() -> void {
+            index_.erase(&entries_.back().first);
+            entries_.pop_back();
+            ++stats_.evictions;
+        }
+
+        struct KeyPtrHash {
+            auto operator()(const Key *key) const -> size_t { return Hash{}(*key); }
+        };
+
+        struct KeyPtrEqual {
+            auto operator()(const Key *a, const Key *b) const -> bool { return Equal{}(*a, *b); }
+        };
+
+        using Entries = std::list<std::pair<Key, Value>>;
+
+        Entries entries_;
+        std::unordered_map<const Key *, typename Entries::iterator, KeyPtrHash, KeyPtrEqual> index_;
+        size_t capacity_;
+        CacheStats stats_;
+    };
+}
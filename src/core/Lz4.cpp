@@ -0,0 +1,165 @@
+#include "Lz4.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace borderless::lz4 {
+
+    namespace {
+        constexpr size_t min_match = 4;
+        constexpr size_t last_literals = 5; // the block always ends with at least 5 literals
+        constexpr size_t match_limit = 12;  // and no match starts in its last 12 bytes
+        constexpr size_t max_offset = 65535;
+        constexpr int hash_log = 12;
+        constexpr uint32_t no_position = UINT32_MAX;
+        constexpr size_t error = SIZE_MAX;
+
+        auto read32(const uint8_t *p) -> uint32_t {
+            uint32_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        auto hash(uint32_t sequence) -> uint32_t {
+            return (sequence * 2654435761u) >> (32 - hash_log);
+        }
+
+        auto write_length(std::vector<uint8_t> &out, size_t length) -> void {
+            while (length >= 255) {
+                out.push_back(255);
+                length -= 255;
+            }
+            out.push_back(static_cast<uint8_t>(length));
+        }
+
+        // match_length 0: the final, literal-only sequence
+        auto emit(std::vector<uint8_t> &out, const uint8_t *literals, size_t literal_count, size_t offset,
+                  size_t match_length) -> void {
+            const auto token_at = out.size();
+            out.push_back(0);
+            uint8_t token = static_cast<uint8_t>(std::min<size_t>(literal_count, 15) << 4);
+            if (literal_count >= 15) {
+                write_length(out, literal_count - 15);
+            }
+            out.insert(out.end(), literals, literals + literal_count);
+            if (match_length) {
+                out.push_back(static_cast<uint8_t>(offset & 0xFF));
+                out.push_back(static_cast<uint8_t>(offset >> 8));
+                const auto length = match_length - min_match;
+                token |= static_cast<uint8_t>(std::min<size_t>(length, 15));
+                if (length >= 15) {
+                    write_length(out, length - 15);
+                }
+            }
+            out[token_at] = token;
+        }
+
+        auto read_length(const uint8_t *&ip, const uint8_t *end, size_t &length) -> bool {
+            uint8_t byte;
+            do {
+                if (ip >= end) {
+                    return false;
+                }
+                byte = *ip++;
+                length += byte;
+            } while (byte == 255);
+            return true;
+        }
+    }
+
+    auto compress(ByteView input, std::vector<uint8_t> &out) -> size_t {
+        const auto start = out.size();
+        out.reserve(start + compress_bound(input.size));
+        const uint8_t *src = input.data;
+        const size_t n = input.size;
+        size_t anchor = 0;
+
+        if (n > match_limit) {
+            std::array<uint32_t, size_t{1} << hash_log> table;
+            table.fill(no_position);
+            size_t ip = 0;
+            size_t misses = 0;
+            while (ip + match_limit <= n) {
+                const auto sequence = read32(src + ip);
+                auto &slot = table[hash(sequence)];
+                size_t candidate = slot;
+                slot = static_cast<uint32_t>(ip);
+                if (candidate == no_position || ip - candidate > max_offset || read32(src + candidate) != sequence) {
+                    // step faster through data that does not compress
+                    ip += 1 + (misses++ >> 6);
+                    continue;
+                }
+                while (ip > anchor && candidate > 0 && src[ip - 1] == src[candidate - 1]) {
+                    --ip;
+                    --candidate;
+                }
+                size_t length = min_match;
+                while (ip + length < n - last_literals && src[candidate + length] == src[ip + length]) {
+                    ++length;
+                }
+                emit(out, src + anchor, ip - anchor, ip - candidate, length);
+                ip += length;
+                anchor = ip;
+                misses = 0;
+            }
+        }
+        emit(out, src + anchor, n - anchor, 0, 0);
+        return out.size() - start;
+    }
+
+    auto decompress(ByteView input, uint8_t *output, size_t capacity) -> size_t {
+        const uint8_t *ip = input.data;
+        const uint8_t *end = input.data + input.size;
+        size_t op = 0;
+        while (ip < end) {
+            const unsigned token = *ip++;
+
+            size_t literals = token >> 4;
+            if (literals == 15 && !read_length(ip, end, literals)) {
+                return error;
+            }
+            if (literals > static_cast<size_t>(end - ip) || literals > capacity - op) {
+                return error;
+            }
+            std::memcpy(output + op, ip, literals);
+            ip += literals;
+            op += literals;
+            if (ip == end) {
+                return op; // the last sequence has no match
+            }
+
+            if (end - ip < 2) {
+                return error;
+            }
+            const size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+            ip += 2;
+            if (offset == 0 || offset > op) {
+                return error;
+            }
+            size_t length = token & 15;
+            if (length == 15 && !read_length(ip, end, length)) {
+                return error;
+            }
+            length += min_match;
+            if (length > capacity - op) {
+                return error;
+            }
+
+            uint8_t *dst = output + op;
+            const uint8_t *from = dst - offset;
+            if (offset == 1) {
+                std::memset(dst, *from, length);
+            } else {
+                // overlapping matches repeat the last offset bytes; copy in non-overlapping chunks
+                for (size_t copied = 0; copied < length;) {
+                    const auto chunk = std::min(offset, length - copied);
+                    std::memcpy(dst + copied, from + copied, chunk);
+                    copied += chunk;
+                }
+            }
+            op += length;
+        }
+        return error; // empty input, or a block that ends after a match
+    }
+}
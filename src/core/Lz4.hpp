@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ByteView.hpp"
+
+// LZ4 block format (no frame header, no checksums), compatible with LZ4_compress_default and
+// LZ4_decompress_safe. Written for the asset pack, where entries are compressed once at build
+// time and decoded at startup, so decoding is bounds checked and compression stays simple.
+namespace borderless::lz4 {
+
+    // worst-case compressed size for size input bytes
+    constexpr auto compress_bound(size_t size) -> size_t { return size + size / 255 + 16; }
+
+    // appends the compressed block to out and returns its size
+    auto compress(ByteView input, std::vector<uint8_t> &out) -> size_t;
+
+    // decodes into output[0, capacity); returns the decoded size, or SIZE_MAX for malformed input
+    // or when the output does not fit
+    auto decompress(ByteView input, uint8_t *output, size_t capacity) -> size_t;
+}
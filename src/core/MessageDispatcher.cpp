@@ -0,0 +1,79 @@
+#include "MessageDispatcher.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace borderless {
+
+    auto LatencyHistogram::bucket(uint64_t nanoseconds) -> size_t {
+        if (nanoseconds == 0) {
+            return 0;
+        }
+#if defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64)
+        unsigned long bit;
+        _BitScanReverse64(&bit, nanoseconds);
+        const auto log2 = static_cast<size_t>(bit);
+#elif defined(__GNUC__) || defined(__clang__)
+        const auto log2 = static_cast<size_t>(63 - __builtin_clzll(nanoseconds));
+#else
+        size_t log2 = 0;
+        while (nanoseconds >>= 1) {
+            ++log2;
+        }
+#endif
+        return std::min(log2, bucket_count - 1);
+    }
+
+    auto LatencyHistogram::count() const -> uint64_t {
+        uint64_t total = 0;
+        for (const auto n: buckets_) {
+            total += n;
+        }
+        return total;
+    }
+
+    auto LatencyHistogram::percentile(double p) const -> uint64_t {
+        const auto total = count();
+        if (total == 0) {
+            return 0;
+        }
+        const auto rank = static_cast<uint64_t>(p * static_cast<double>(total - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t b = 0; b < bucket_count; ++b) {
+            seen += buckets_[b];
+            if (seen >= rank) {
+                return (uint64_t{2} << b) - 1;
+            }
+        }
+        return UINT64_MAX;
+    }
+
+    auto format_message_stats(const std::vector<MessageStats> &stats) -> std::string {
+        auto sorted = stats;
+        std::sort(sorted.begin(), sorted.end(), [](const MessageStats &a, const MessageStats &b) {
+            return a.count > b.count;
+        });
+
+        std::string out;
+        char line[160];
+        std::snprintf(line, sizeof(line), "%-20s %10s %10s %9s %9s %9s %9s\n",
+                      "message", "count", "handled", "mean ns", "p50 ns", "p99 ns", "max ns");
+        out += line;
+        for (const auto &s: sorted) {
+            std::snprintf(line, sizeof(line), "%-20s %10llu %10llu %9llu %9llu %9llu %9llu\n",
+                          s.name ? s.name : "(no handler)",
+                          static_cast<unsigned long long>(s.count),
+                          static_cast<unsigned long long>(s.handled),
+                          static_cast<unsigned long long>(s.count ? s.total_ns / s.count : 0),
+                          static_cast<unsigned long long>(s.latency.percentile(0.50)),
+                          static_cast<unsigned long long>(s.latency.percentile(0.99)),
+                          static_cast<unsigned long long>(s.max_ns));
+            out += line;
+        }
+        return out;
+    }
+}
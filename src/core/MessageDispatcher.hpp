@@ -0,0 +1,189 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// 0 compiles the per-message counters and latency histograms out of every MessageDispatcher
+#ifndef BORDERLESS_MESSAGE_STATS
+#define BORDERLESS_MESSAGE_STATS 1
+#endif
+
+namespace borderless {
+
+    inline constexpr bool message_stats_enabled = BORDERLESS_MESSAGE_STATS != 0;
+
+    // a window message without the HWND; the types match UINT, WPARAM and LPARAM/LRESULT
+    struct Message {
+        uint32_t id;
+        uintptr_t wparam;
+        intptr_t lparam;
+    };
+
+    // log2 buckets of nanoseconds: bucket b holds samples in [2^b, 2^(b+1)), bucket 0 also holds 0
+    class LatencyHistogram {
+    public:
+        static constexpr size_t bucket_count = 40;
+
+        auto record(uint64_t nanoseconds) -> void { ++buckets_[bucket(nanoseconds)]; }
+
+        auto count() const -> uint64_t;
+
+        // upper bound of the bucket holding the p-th sample, in nanoseconds
+        auto percentile(double p) const -> uint64_t;
+
+        auto buckets() const -> const std::array<uint64_t, bucket_count> & { return buckets_; }
+
+        auto reset() -> void { buckets_.fill(0); }
+
+        static auto bucket(uint64_t nanoseconds) -> size_t;
+
+    private:
+        std::array<uint64_t, bucket_count> buckets_{};
+    };
+
+    struct MessageStats {
+        uint32_t id = 0;
+        const char *name = nullptr; // nullptr for the "everything without a handler" entry
+        uint64_t count = 0;
+        uint64_t handled = 0; // the handler returned a result instead of falling back
+        uint64_t total_ns = 0;
+        uint64_t max_ns = 0;
+        LatencyHistogram latency;
+
+        auto record(uint64_t nanoseconds, bool was_handled) -> void {
+            ++count;
+            handled += was_handled;
+            total_ns += nanoseconds;
+            max_ns = nanoseconds > max_ns ? nanoseconds : max_ns;
+            latency.record(nanoseconds);
+        }
+    };
+
+    // one line per message type that was seen, busiest first
+    auto format_message_stats(const std::vector<MessageStats> &stats) -> std::string;
+
+    /* Table-driven replacement for a WndProc switch. Handlers are plain function pointers registered
+     * per message ID and return std::nullopt to fall through to the default processing (usually
+     * DefWindowProc). IDs below table_size are looked up in a flat table, the rest (WM_USER and up)
+     * in a short list. With Instrumented, every dispatch is counted and timed per message type,
+     * default processing included.
+     */
+    template<typename Context, bool Instrumented = message_stats_enabled>
+    class MessageDispatcher {
+    public:
+        using Handler = auto (*)(Context &, const Message &) -> std::optional<intptr_t>;
+        using Clock = std::chrono::steady_clock;
+
+        static constexpr uint32_t table_size = 0x400; // WM_USER
+
+        MessageDispatcher() {
+            entries_.emplace_back(); // index 0: messages without a handler
+        }
+
+        // registers or replaces the handler for id; name shows up in the stats
+        auto on(uint32_t id, const char *name, Handler handler) -> MessageDispatcher & {
+            if (const auto existing = index(id)) {
+                entries_[existing].handler = handler;
+                return *this;
+            }
+            const auto slot = static_cast<uint16_t>(entries_.size());
+            Entry entry;
+            entry.handler = handler;
+            entry.stats.id = id;
+            entry.stats.name = name;
+            entries_.push_back(entry);
+            if (id < table_size) {
+                table_[id] = slot;
+            } else {
+                overflow_.emplace_back(id, slot);
+            }
+            return *this;
+        }
+
+        auto handles(uint32_t id) const -> bool { return index(id) != 0; }
+
+        // runs the handler for message, or fallback() when there is none or it declined
+        template<typename Fallback>
+        auto dispatch(Context &context, const Message &message, Fallback &&fallback) -> intptr_t {
+            auto &entry = entries_[index(message.id)];
+            if constexpr (Instrumented) {
+                if (instrumentation_) {
+                    bool handled = false;
+                    const auto start = Clock::now();
+                    const auto result = invoke(entry, context, message, fallback, handled);
+                    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+                    entry.stats.record(static_cast<uint64_t>(elapsed.count()), handled);
+                    return result;
+                }
+            }
+            bool handled = false;
+            return invoke(entry, context, message, fallback, handled);
+        }
+
+        // runtime switch on top of the compile-time one; off skips the clock reads
+        auto set_instrumentation(bool enabled) -> void { instrumentation_ = enabled; }
+
+        static constexpr auto instrumented() -> bool { return Instrumented; }
+
+        auto stats() const -> std::vector<MessageStats> {
+            std::vector<MessageStats> result;
+            for (const auto &entry: entries_) {
+                if (entry.stats.count) {
+                    result.push_back(entry.stats);
+                }
+            }
+            return result;
+        }
+
+        auto reset_stats() -> void {
+            for (auto &entry: entries_) {
+                const auto id = entry.stats.id;
+                const auto name = entry.stats.name;
+                entry.stats = {};
+                entry.stats.id = id;
+                entry.stats.name = name;
+            }
+        }
+
+    private:
+        struct Entry {
+            Handler handler = nullptr;
+            MessageStats stats;
+        };
+
+        auto index(uint32_t id) const -> uint16_t {
+            if (id < table_size) {
+                return table_[id];
+            }
+            for (const auto &[overflow_id, slot]: overflow_) {
+                if (overflow_id == id) {
+                    return slot;
+                }
+            }
+            return 0;
+        }
+
+        template<typename Fallback>
+        static auto invoke(const Entry &entry, Context &context, const Message &message, Fallback &fallback,
+                           bool &handled) -> intptr_t {
+            if (entry.handler) {
+                if (const auto result = entry.handler(context, message)) {
+                    handled = true;
+                    return *result;
+                }
+            }
+            return fallback();
+        }
+
+        std::array<uint16_t, table_size> table_{};
+        std::vector<std::pair<uint32_t, uint16_t>> overflow_;
+        std::vector<Entry> entries_;
+        bool instrumentation_ = true;
+    };
+}
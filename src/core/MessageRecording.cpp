@@ -0,0 +1,203 @@
+#include "MessageRecording.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+namespace borderless {
+
+    namespace {
+        constexpr char file_magic[4] = {'B', 'M', 'S', 'G'};
+        constexpr uint32_t file_version = 1;
+
+        constexpr uint8_t flag_rect = 0x01;
+        constexpr uint8_t flag_window = 0x02; // a window index follows, otherwise it is 0
+
+        auto put_varint(std::vector<uint8_t> &out, uint64_t value) -> void {
+            while (value >= 0x80) {
+                out.push_back(static_cast<uint8_t>(value | 0x80));
+                value >>= 7;
+            }
+            out.push_back(static_cast<uint8_t>(value));
+        }
+
+        auto zigzag(int64_t value) -> uint64_t {
+            return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+        }
+
+        auto unzigzag(uint64_t value) -> int64_t {
+            return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+        }
+
+        struct Reader {
+            const uint8_t *at;
+            const uint8_t *end;
+
+            auto varint(uint64_t &value) -> bool {
+                value = 0;
+                for (int shift = 0; shift < 64; shift += 7) {
+                    if (at == end) {
+                        return false;
+                    }
+                    const auto byte = *at++;
+                    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                    if (!(byte & 0x80)) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            auto signed_varint(int64_t &value) -> bool {
+                uint64_t raw;
+                if (!varint(raw)) {
+                    return false;
+                }
+                value = unzigzag(raw);
+                return true;
+            }
+        };
+
+        template<typename T>
+        auto write(std::FILE *file, const T &value) -> bool {
+            return std::fwrite(&value, sizeof(T), 1, file) == 1;
+        }
+
+        template<typename T>
+        auto read(std::FILE *file, T &value) -> bool {
+            return std::fread(&value, sizeof(T), 1, file) == 1;
+        }
+    }
+
+    auto MessageRecorder::record(Clock::time_point now, uint16_t window, const Message &message, const Rect *rect)
+            -> void {
+        if (count_ == 0) {
+            start_ = now;
+        }
+        RecordedMessage recorded;
+        recorded.time_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                now - start_).count());
+        recorded.window = window;
+        recorded.message = message;
+        if (rect) {
+            recorded.has_rect = true;
+            recorded.rect = *rect;
+            recorded.message.lparam = 0;
+        }
+        record(recorded);
+    }
+
+    auto MessageRecorder::record(const RecordedMessage &m) -> void {
+        // a clock that went backwards would not survive the unsigned delta
+        const auto time = m.time_ns < last_ns_ ? last_ns_ : m.time_ns;
+        put_varint(bytes_, time - last_ns_);
+        last_ns_ = time;
+
+        bytes_.push_back(static_cast<uint8_t>((m.has_rect ? flag_rect : 0) | (m.window ? flag_window : 0)));
+        if (m.window) {
+            put_varint(bytes_, m.window);
+        }
+        put_varint(bytes_, m.message.id);
+        put_varint(bytes_, m.message.wparam);
+        auto &last = m.message.id < last_lparam_.size() ? last_lparam_[m.message.id] : last_user_lparam_;
+        // wrapping, lparam can be an address
+        const auto change = static_cast<uint64_t>(m.message.lparam) - static_cast<uint64_t>(last);
+        put_varint(bytes_, zigzag(static_cast<int64_t>(change)));
+        last = m.message.lparam;
+        if (m.has_rect) {
+            for (const auto value: {m.rect.left, m.rect.top, m.rect.right, m.rect.bottom}) {
+                put_varint(bytes_, zigzag(value));
+            }
+        }
+        ++count_;
+    }
+
+    auto MessageRecorder::clear() -> void {
+        bytes_.clear();
+        count_ = 0;
+        last_ns_ = 0;
+        last_lparam_.fill(0);
+        last_user_lparam_ = 0;
+    }
+
+    auto MessageRecorder::save(const std::string &path) const -> bool {
+        std::FILE *file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            return false;
+        }
+        const bool ok = std::fwrite(file_magic, sizeof(file_magic), 1, file) == 1 &&
+                        write(file, file_version) &&
+                        write(file, count_) &&
+                        write(file, static_cast<uint64_t>(bytes_.size())) &&
+                        std::fwrite(bytes_.data(), 1, bytes_.size(), file) == bytes_.size();
+        return std::fclose(file) == 0 && ok;
+    }
+
+    auto decode_messages(ByteView bytes, uint64_t count, std::vector<RecordedMessage> &messages) -> bool {
+        messages.clear();
+        // every message takes at least five bytes, so a corrupt count cannot reserve much
+        messages.reserve(static_cast<size_t>(count < bytes.size / 5 ? count : bytes.size / 5));
+        std::array<intptr_t, 0x400> last_lparam{};
+        intptr_t last_user_lparam = 0;
+        Reader in{bytes.begin(), bytes.end()};
+        uint64_t time = 0;
+        for (uint64_t i = 0; i < count; ++i) {
+            RecordedMessage m;
+            uint64_t delta, id, wparam, window = 0;
+            int64_t lparam;
+            if (!in.varint(delta) || in.at == in.end) {
+                return false;
+            }
+            const auto flags = *in.at++;
+            if ((flags & flag_window) && !in.varint(window)) {
+                return false;
+            }
+            if (!in.varint(id) || !in.varint(wparam) || !in.signed_varint(lparam) ||
+                id > UINT32_MAX || window > UINT16_MAX) {
+                return false;
+            }
+            time += delta;
+            m.time_ns = time;
+            m.window = static_cast<uint16_t>(window);
+            auto &last = id < last_lparam.size() ? last_lparam[id] : last_user_lparam;
+            m.message = {static_cast<uint32_t>(id), static_cast<uintptr_t>(wparam),
+                         static_cast<intptr_t>(static_cast<uint64_t>(last) + static_cast<uint64_t>(lparam))};
+            last = m.message.lparam;
+            if (flags & flag_rect) {
+                int64_t values[4];
+                for (auto &value: values) {
+                    if (!in.signed_varint(value)) {
+                        return false;
+                    }
+                }
+                m.has_rect = true;
+                m.rect = {static_cast<int32_t>(values[0]), static_cast<int32_t>(values[1]),
+                          static_cast<int32_t>(values[2]), static_cast<int32_t>(values[3])};
+            }
+            messages.push_back(m);
+        }
+        return in.at == in.end;
+    }
+
+    auto load_messages(const std::string &path, std::vector<RecordedMessage> &messages) -> bool {
+        std::FILE *file = std::fopen(path.c_str(), "rb");
+        if (!file) {
+            return false;
+        }
+        char magic[4];
+        uint32_t version = 0;
+        uint64_t count = 0;
+        uint64_t size = 0;
+        std::vector<uint8_t> bytes;
+        bool ok = std::fread(magic, sizeof(magic), 1, file) == 1 &&
+                  std::memcmp(magic, file_magic, sizeof(magic)) == 0 &&
+                  read(file, version) && version == file_version &&
+                  read(file, count) &&
+                  read(file, size) && size < (uint64_t{1} << 32);
+        if (ok) {
+            bytes.resize(static_cast<size_t>(size));
+            ok = std::fread(bytes.data(), 1, bytes.size(), file) == bytes.size();
+        }
+        std::fclose(file);
+        return ok && decode_messages(view(bytes), count, messages);
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ByteView.hpp"
+#include "Geometry.hpp"
+#include "MessageDispatcher.hpp"
+
+namespace borderless {
+
+    struct RecordedMessage {
+        uint64_t time_ns = 0;   // since the first recorded message
+        uint16_t window = 0;    // which of the recorded windows received it
+        Message message{};
+        // lparam pointed at a RECT (WM_NCCALCSIZE, WM_DPICHANGED), which is recorded instead of the
+        // address; other pointers are recorded as they are and mean nothing on replay
+        bool has_rect = false;
+        Rect rect;
+    };
+
+    /* Window messages as they reached a WndProc, appended to a compact byte stream while the app
+     * runs. Per message: the time since the previous one, the window, the id, wparam and the change
+     * of lparam against the previous message with the same id (a mouse move is a few bytes), all as
+     * LEB128 varints. record() does not allocate once the buffer has grown; UI thread only.
+     */
+    class MessageRecorder {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        auto record(Clock::time_point now, uint16_t window, const Message &message, const Rect *rect = nullptr)
+                -> void;
+
+        // with the time already relative to the start, e.g. to re-encode a loaded recording
+        auto record(const RecordedMessage &message) -> void;
+
+        auto count() const -> uint64_t { return count_; }
+
+        auto bytes() const -> const std::vector<uint8_t> & { return bytes_; }
+
+        auto clear() -> void;
+
+        auto save(const std::string &path) const -> bool;
+
+    private:
+        std::vector<uint8_t> bytes_;
+        uint64_t count_ = 0;
+        Clock::time_point start_{};
+        uint64_t last_ns_ = 0;
+        std::array<intptr_t, 0x400> last_lparam_{}; // per id below WM_USER, as the dispatcher's table
+        intptr_t last_user_lparam_ = 0;              // one for every id above
+    };
+
+    // false on truncated or corrupt input; messages is cleared first
+    auto decode_messages(ByteView bytes, uint64_t count, std::vector<RecordedMessage> &messages) -> bool;
+
+    auto load_messages(const std::string &path, std::vector<RecordedMessage> &messages) -> bool;
+}
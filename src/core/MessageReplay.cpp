@@ -0,0 +1,182 @@
+#include "MessageReplay.hpp"
+
+#include <cstdio>
+#include <thread>
+
+namespace borderless {
+
+    namespace {
+        // what ResizeCoalescer and the timeline see as the recording's start; far enough from the
+        // clock's epoch that the first resize is not held back by a resize at time zero
+        const auto replay_epoch = FrameClockType::time_point{} + std::chrono::hours(1);
+
+        auto mix(uint64_t seed, uint64_t value) -> uint64_t {
+            seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+            return seed * 0xff51afd7ed558ccdull;
+        }
+    }
+
+    auto format_replay_report(const ReplayReport &report) -> std::string {
+        char line[200];
+        std::snprintf(line, sizeof(line),
+                      "replay: %llu messages to %zu windows, %.1f ms recorded, %.1f ms replayed, %llu frames, "
+                      "%llu resizes, checksum %016llx\n",
+                      static_cast<unsigned long long>(report.messages), report.windows,
+                      double(report.recorded_ns) / 1e6, double(report.wall_ns) / 1e6,
+                      static_cast<unsigned long long>(report.frames),
+                      static_cast<unsigned long long>(report.resizes),
+                      static_cast<unsigned long long>(report.checksum));
+        return line;
+    }
+
+    ReplayWindow::ReplayWindow(const ReplayOptions &options) :
+            options_(options),
+            dpi_(options.monitor.dpi) {
+        clock_.time = replay_epoch;
+        monitors_.update({options.monitor});
+    }
+
+    auto ReplayWindow::deliver(const RecordedMessage &message) -> intptr_t {
+        clock_.time = replay_epoch + std::chrono::nanoseconds(message.time_ns);
+        current_ = &message;
+        const auto result = dispatcher().dispatch(*this, message.message, [] { return intptr_t{0}; });
+        current_ = nullptr;
+
+        // what the message loop does between messages
+        if (animations_.due(clock_.time)) {
+            property_changes_.clear();
+            animations_.tick(clock_.time, property_changes_);
+        }
+        scheduler_.tick([] { return true; });
+        return result;
+    }
+
+    auto ReplayWindow::hit_test(Point cursor) -> HitResult {
+        if (!hit_tester_.valid()) {
+            hit_tester_.update({dpi_.to_pixels(options_.frame.x), dpi_.to_pixels(options_.frame.y)}, window_);
+        }
+        return hit_tester_.hit_test(cursor);
+    }
+
+    auto ReplayWindow::apply_pending_resize(bool flush) -> void {
+        auto resize = [this](Size) { scheduler_.request_frame(); };
+        if (flush) {
+            resizer_.flush(clock_.time, resize);
+        } else {
+            resizer_.apply(clock_.time, resize);
+        }
+    }
+
+    auto ReplayWindow::checksum(uint64_t seed) const -> uint64_t {
+        for (const auto value: {window_.left, window_.top, window_.right, window_.bottom}) {
+            seed = mix(seed, static_cast<uint32_t>(value));
+        }
+        seed = mix(seed, uint64_t{borderless_} | uint64_t{shadow_} << 1 | uint64_t{maximized_} << 2 |
+                         uint64_t{hit_tester_.draggable()} << 3 | uint64_t{hit_tester_.resizable()} << 4 |
+                         uint64_t{closed_} << 5);
+        seed = mix(seed, dpi_.dpi());
+        seed = mix(seed, static_cast<uint64_t>(tray_.state()) | uint64_t{capability_refreshes_} << 8);
+        return mix(seed, resizer_.stats().applied);
+    }
+
+    auto ReplayWindow::fit_client_area(const Message &) -> void {
+        const auto &message = *current_;
+        if (maximized_ && message.has_rect) {
+            // adjust_maximized_client_rect: the client area becomes the monitor's work area
+            if (const auto monitor = monitors_.from_rect(message.rect, MonitorFallback::none)) {
+                window_ = monitor->work;
+            }
+        }
+    }
+
+    auto ReplayWindow::resize_client(Size size, bool maximized) -> void {
+        maximized_ = maximized;
+        // the client area is the whole window once the frame is gone
+        window_.right = window_.left + size.width;
+        window_.bottom = window_.top + size.height;
+        resizer_.request(size);
+        apply_pending_resize(false);
+    }
+
+    auto ReplayWindow::moved(Point origin) -> void {
+        window_ = window_.offset(origin.x - window_.left, origin.y - window_.top);
+    }
+
+    auto ReplayWindow::change_dpi(uint32_t dpi, const Message &) -> void {
+        dpi_.set_dpi(dpi);
+        // the shell's DPI subscription
+        hit_tester_.invalidate();
+        const auto &message = *current_;
+        if (message.has_rect) {
+            // SetWindowPos to the suggested rect, whose WM_SIZE is flushed right away
+            window_ = message.rect;
+            resizer_.request({message.rect.width(), message.rect.height()});
+            apply_pending_resize(true);
+        }
+    }
+
+    auto ReplayWindow::set_opacity(float to) -> void {
+        animations_.add(tween(0, AnimatedProperty::opacity, opacity_, to, std::chrono::milliseconds(250)));
+        opacity_ = to;
+    }
+
+    auto ReplayWindow::show_tray_popup() -> void {
+        if (tray_.show(clock_.time)) {
+            tray_.created();
+        }
+        tray_.visible(clock_.time);
+    }
+
+    auto ReplayWindow::prewarm_tray_popup() -> void {
+        if (tray_.prewarm()) {
+            tray_.created();
+        }
+    }
+
+    auto ReplayWindow::destroyed() -> void {
+        // deleting the TrayWindow destroys the popup
+        tray_.destroyed();
+        closed_ = true;
+    }
+
+    auto ReplayWindow::dispatcher() -> Dispatcher & {
+        static Dispatcher table = [] {
+            Dispatcher d;
+            WindowMessages<ReplayWindow>::register_handlers(d);
+            return d;
+        }();
+        return table;
+    }
+
+    auto replay(const std::vector<RecordedMessage> &messages, const ReplayOptions &options) -> ReplayReport {
+        using Clock = std::chrono::steady_clock;
+
+        ReplayWindow::dispatcher().reset_stats();
+        std::vector<std::unique_ptr<ReplayWindow>> windows;
+        ReplayReport report;
+        uint64_t checksum = 0;
+        const auto start = Clock::now();
+        for (const auto &message: messages) {
+            while (windows.size() <= message.window) {
+                windows.push_back(std::make_unique<ReplayWindow>(options));
+            }
+            if (options.recorded_pace) {
+                std::this_thread::sleep_until(start + std::chrono::nanoseconds(message.time_ns));
+            }
+            checksum = mix(checksum, static_cast<uint64_t>(windows[message.window]->deliver(message)));
+        }
+        report.wall_ns = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+
+        report.messages = messages.size();
+        report.windows = windows.size();
+        report.recorded_ns = messages.empty() ? 0 : messages.back().time_ns - messages.front().time_ns;
+        for (const auto &window: windows) {
+            report.frames += window->frames();
+            report.resizes += window->resizes();
+            checksum = window->checksum(checksum);
+        }
+        report.checksum = checksum;
+        return report;
+    }
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Animation.hpp"
+#include "Dpi.hpp"
+#include "FrameScheduler.hpp"
+#include "HitTester.hpp"
+#include "MessageDispatcher.hpp"
+#include "MessageRecording.hpp"
+#include "MonitorTopology.hpp"
+#include "ResizeCoalescer.hpp"
+#include "TrayPopup.hpp"
+#include "WindowMessages.hpp"
+
+namespace borderless {
+
+    struct ReplayOptions {
+        // sleep until each message is due, as it arrived; otherwise replay as fast as possible
+        bool recorded_pace = false;
+        // the recording does not hold the monitors; maximized windows snap to this one's work area
+        Monitor monitor{0, {0, 0, 1920, 1080}, {0, 0, 1920, 1040}, 96, true};
+        Point frame{8, 8}; // resize border in DIPs
+        bool composition = true; // DWM composition, as WM_NCACTIVATE sees it
+    };
+
+    struct ReplayReport {
+        uint64_t messages = 0;
+        size_t windows = 0;
+        uint64_t recorded_ns = 0; // first to last message
+        uint64_t wall_ns = 0;     // the replay, pacing included
+        uint64_t frames = 0;
+        uint64_t resizes = 0;
+        uint64_t checksum = 0;    // of every result and the final state; equal runs, equal behaviour
+    };
+
+    auto format_replay_report(const ReplayReport &report) -> std::string;
+
+    /* BorderlessWindow's message handlers, the shell's own through WindowMessages, driven by recorded
+     * messages instead of a real window: hit-testing, the F7-F11 toggles, resize coalescing, DPI
+     * changes, the tray popup lifecycle and frame scheduling, all on the recorded timeline, so a replay
+     * does the same work however fast it runs. What the handlers ask of a real window is answered from
+     * the recording (the rects of WM_NCCALCSIZE and WM_DPICHANGED) or by the state the shell would
+     * keep; calls that only the system can answer (DefWindowProc, presenting) return at once.
+     */
+    class ReplayWindow {
+    public:
+        using Dispatcher = MessageDispatcher<ReplayWindow>;
+        using Clock = FrameClockType;
+
+        explicit ReplayWindow(const ReplayOptions &options = {});
+
+        ReplayWindow(const ReplayWindow &) = delete;
+
+        auto operator=(const ReplayWindow &) -> ReplayWindow & = delete;
+
+        // dispatches message at its recorded time, then runs what the message loop would run
+        // before the next one: animations and a frame if one is due
+        auto deliver(const RecordedMessage &message) -> intptr_t;
+
+        static auto dispatcher() -> Dispatcher &;
+
+        auto frames() const -> uint64_t { return presenter_.presents; }
+
+        auto resizes() const -> uint64_t { return resizer_.stats().applied; }
+
+        auto window_rect() const -> const Rect & { return window_; }
+
+        auto borderless() const -> bool { return borderless_; }
+
+        auto hit_tester() const -> const HitTester & { return hit_tester_; }
+
+        auto closed() const -> bool { return closed_; }
+
+        // folds the state a build could diverge on into seed
+        auto checksum(uint64_t seed) const -> uint64_t;
+
+    private:
+        struct ReplayClock : FrameClock {
+            auto now() const -> Clock::time_point override { return time; }
+
+            Clock::time_point time{};
+        };
+
+        struct ReplayPresenter : FramePresenter {
+            auto ready(Clock::duration) -> bool override { return true; }
+
+            auto present() -> void override { ++presents; }
+
+            uint64_t presents = 0;
+        };
+
+        friend struct WindowMessages<ReplayWindow>;
+
+        // what WindowMessages asks of the window
+        auto is_borderless() const -> bool { return borderless_; }
+
+        auto has_composition() const -> bool { return options_.composition; }
+
+        auto has_shadow() const -> bool { return shadow_; }
+
+        auto target_opacity() const -> float { return opacity_; }
+
+        auto hit_tests() -> HitTester & { return hit_tester_; }
+
+        auto hit_test(Point cursor) -> HitResult;
+
+        auto fit_client_area(const Message &message) -> void;
+
+        auto resize_client(Size size, bool maximized) -> void;
+
+        auto flush_resize() -> void { apply_pending_resize(true); }
+
+        auto moved(Point origin) -> void;
+
+        auto change_dpi(uint32_t dpi, const Message &message) -> void;
+
+        // options.monitor does not change
+        auto invalidate_monitors() -> void {}
+
+        auto refresh_capabilities(uint8_t changed) -> void { capability_refreshes_ |= changed; }
+
+        auto set_borderless(bool enabled) -> void { borderless_ = enabled; }
+
+        auto set_borderless_shadow(bool enabled) -> void { shadow_ = enabled; }
+
+        auto set_opacity(float to) -> void;
+
+        auto show_tray_popup() -> void;
+
+        auto prewarm_tray_popup() -> void;
+
+        auto restore() -> void {}
+
+        // DestroyWindow: the WM_DESTROY it sends is the recording's next message
+        auto close() -> void {}
+
+        auto destroyed() -> void;
+
+        auto apply_pending_resize(bool flush) -> void;
+
+        ReplayOptions options_;
+        ReplayClock clock_;
+        ReplayPresenter presenter_;
+        FrameScheduler scheduler_{clock_, presenter_};
+        const RecordedMessage *current_ = nullptr;
+        Rect window_{};
+        bool maximized_ = false;
+        bool borderless_ = true;
+        bool shadow_ = true;
+        bool closed_ = false;
+        float opacity_ = 1.0f;
+        uint8_t capability_refreshes_ = 0; // capability_* the handlers asked to re-query
+        HitTester hit_tester_;
+        DpiContext dpi_;
+        MonitorTopology monitors_;
+        ResizeCoalescer resizer_;
+        Timeline animations_;
+        PropertyBatch property_changes_;
+        TrayPopupState tray_;
+    };
+
+    // replays messages into one ReplayWindow per recorded window; the dispatcher's stats are reset
+    // first and hold the per-message cost afterwards
+    auto replay(const std::vector<RecordedMessage> &messages, const ReplayOptions &options = {}) -> ReplayReport;
+}
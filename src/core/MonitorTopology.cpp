@@ -0,0 +1,168 @@
+#include "MonitorTopology.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+namespace borderless {
+
+    namespace {
+        auto distinct_sorted(std::vector<int32_t> &values) -> void {
+            std::sort(values.begin(), values.end());
+            values.erase(std::unique(values.begin(), values.end()), values.end());
+        }
+
+        // index of the slab [edges[i], edges[i + 1]) holding value, or -1
+        auto slab(const std::vector<int32_t> &edges, int32_t value) -> ptrdiff_t {
+            const auto it = std::upper_bound(edges.begin(), edges.end(), value);
+            if (it == edges.begin() || it == edges.end()) {
+                return -1;
+            }
+            return it - edges.begin() - 1;
+        }
+
+        auto distance_squared(const Rect &rect, Point point) -> int64_t {
+            const int64_t dx = point.x < rect.left ? rect.left - point.x
+                    : point.x >= rect.right ? point.x - (rect.right - 1) : 0;
+            const int64_t dy = point.y < rect.top ? rect.top - point.y
+                    : point.y >= rect.bottom ? point.y - (rect.bottom - 1) : 0;
+            return dx * dx + dy * dy;
+        }
+    }
+
+    auto format_monitor_topology_stats(const MonitorTopologyStats &stats) -> std::string {
+        char line[200];
+        std::snprintf(line, sizeof(line),
+                      "monitor topology: %llu updates, %llu lookups (%llu on the last monitor), %llu outside every monitor\n",
+                      static_cast<unsigned long long>(stats.updates),
+                      static_cast<unsigned long long>(stats.lookups),
+                      static_cast<unsigned long long>(stats.last_hits),
+                      static_cast<unsigned long long>(stats.misses));
+        return line;
+    }
+
+    auto MonitorTopology::update(std::vector<Monitor> monitors) -> void {
+        if (monitors.size() >= no_monitor) {
+            throw std::invalid_argument("too many monitors");
+        }
+        monitors_ = std::move(monitors);
+        xs_.clear();
+        ys_.clear();
+        bounds_ = {};
+        primary_ = 0;
+        last_ = 0;
+        for (size_t i = 0; i < monitors_.size(); ++i) {
+            const auto &monitor = monitors_[i];
+            if (monitor.bounds.empty()) {
+                continue;
+            }
+            xs_.push_back(monitor.bounds.left);
+            xs_.push_back(monitor.bounds.right);
+            ys_.push_back(monitor.bounds.top);
+            ys_.push_back(monitor.bounds.bottom);
+            bounds_ = unite(bounds_, monitor.bounds);
+            if (monitor.primary && !monitors_[primary_].primary) {
+                primary_ = i;
+            }
+        }
+        distinct_sorted(xs_);
+        distinct_sorted(ys_);
+
+        const auto columns = xs_.empty() ? size_t{0} : xs_.size() - 1;
+        const auto rows = ys_.empty() ? size_t{0} : ys_.size() - 1;
+        cells_.assign(columns * rows, no_monitor);
+        // monitors do not overlap, except mirrored ones, where the first one wins
+        for (size_t i = 0; i < monitors_.size(); ++i) {
+            const auto &b = monitors_[i].bounds;
+            if (b.empty()) {
+                continue;
+            }
+            const auto x0 = std::lower_bound(xs_.begin(), xs_.end(), b.left) - xs_.begin();
+            const auto x1 = std::lower_bound(xs_.begin(), xs_.end(), b.right) - xs_.begin();
+            const auto y0 = std::lower_bound(ys_.begin(), ys_.end(), b.top) - ys_.begin();
+            const auto y1 = std::lower_bound(ys_.begin(), ys_.end(), b.bottom) - ys_.begin();
+            for (auto y = y0; y < y1; ++y) {
+                for (auto x = x0; x < x1; ++x) {
+                    auto &cell = cells_[static_cast<size_t>(y) * columns + static_cast<size_t>(x)];
+                    if (cell == no_monitor) {
+                        cell = static_cast<uint16_t>(i);
+                    }
+                }
+            }
+        }
+        ++generation_;
+        ++stats_.updates;
+        valid_ = true;
+    }
+
+    auto MonitorTopology::locate(Point point, MonitorFallback fallback) const -> const Monitor * {
+        const auto x = slab(xs_, point.x);
+        const auto y = slab(ys_, point.y);
+        if (x >= 0 && y >= 0) {
+            const auto cell = cells_[static_cast<size_t>(y) * (xs_.size() - 1) + static_cast<size_t>(x)];
+            if (cell != no_monitor) {
+                last_ = cell;
+                return &monitors_[cell];
+            }
+        }
+        ++stats_.misses;
+        return fallback_for(point, fallback);
+    }
+
+    auto MonitorTopology::locate(const Rect &rect, MonitorFallback fallback) const -> const Monitor * {
+        // inside a single monitor if all four corners are
+        const auto corner = [&](int32_t x, int32_t y) -> ptrdiff_t {
+            const auto cx = slab(xs_, x), cy = slab(ys_, y);
+            if (cx < 0 || cy < 0) {
+                return -1;
+            }
+            const auto cell = cells_[static_cast<size_t>(cy) * (xs_.size() - 1) + static_cast<size_t>(cx)];
+            return cell == no_monitor ? -1 : cell;
+        };
+        const auto first = corner(rect.left, rect.top);
+        if (first >= 0 && first == corner(rect.right - 1, rect.bottom - 1) &&
+            first == corner(rect.right - 1, rect.top) && first == corner(rect.left, rect.bottom - 1)) {
+            last_ = static_cast<size_t>(first);
+            return &monitors_[last_];
+        }
+
+        const Monitor *best = nullptr;
+        int64_t best_area = 0;
+        for (const auto &monitor: monitors_) {
+            const auto area = intersect(monitor.bounds, rect).area();
+            if (area > best_area) {
+                best = &monitor;
+                best_area = area;
+            }
+        }
+        if (best) {
+            return best;
+        }
+        ++stats_.misses;
+        return fallback_for({rect.left + rect.width() / 2, rect.top + rect.height() / 2}, fallback);
+    }
+
+    auto MonitorTopology::fallback_for(Point point, MonitorFallback fallback) const -> const Monitor * {
+        if (monitors_.empty()) {
+            return nullptr;
+        }
+        switch (fallback) {
+            case MonitorFallback::none:
+                return nullptr;
+            case MonitorFallback::primary:
+                return &monitors_[primary_];
+            case MonitorFallback::nearest:
+                break;
+        }
+        const Monitor *best = &monitors_.front();
+        auto best_distance = distance_squared(best->bounds, point);
+        for (const auto &monitor: monitors_) {
+            const auto distance = distance_squared(monitor.bounds, point);
+            if (distance < best_distance) {
+                best = &monitor;
+                best_distance = distance;
+            }
+        }
+        return best;
+    }
+}
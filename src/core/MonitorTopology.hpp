@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Geometry.hpp"
+
+namespace borderless {
+
+    struct Monitor {
+        uintptr_t handle = 0; // HMONITOR on Windows, opaque to the core
+        Rect bounds{};        // in virtual screen pixels
+        Rect work{};          // bounds without the task bar and app bars
+        uint32_t dpi = 96;
+        bool primary = false;
+    };
+
+    // what a lookup outside every monitor returns, as the MONITOR_DEFAULTTO* flags
+    enum class MonitorFallback : uint8_t {
+        none,
+        primary,
+        nearest,
+    };
+
+    struct MonitorTopologyStats {
+        uint64_t updates = 0;
+        uint64_t lookups = 0;
+        uint64_t last_hits = 0; // answered by the monitor of the previous lookup
+        uint64_t misses = 0;    // lookups outside every monitor
+    };
+
+    auto format_monitor_topology_stats(const MonitorTopologyStats &stats) -> std::string;
+
+    /* Caches the monitor layout (bounds, work areas, DPI) so WM_NCCALCSIZE and friends need no
+     * system calls. update() cuts the virtual screen into a grid along every monitor edge and
+     * records which monitor owns each cell, so a point lookup is two binary searches and a table
+     * read; rect lookups pick the monitor with the largest overlap, like MonitorFromRect. Lookups
+     * during a drag keep hitting the same monitor, so the last hit is tried first.
+     * The owner calls update() whenever the cache is invalid, i.e. after invalidate() was called
+     * from WM_DISPLAYCHANGE/WM_SETTINGCHANGE/WM_DPICHANGED.
+     */
+    class MonitorTopology {
+    public:
+        auto update(std::vector<Monitor> monitors) -> void;
+
+        auto invalidate() -> void { valid_ = false; }
+
+        auto valid() const -> bool { return valid_; }
+
+        // bumped by every update()
+        auto generation() const -> uint64_t { return generation_; }
+
+        auto monitors() const -> const std::vector<Monitor> & { return monitors_; }
+
+        // union of all monitors
+        auto bounds() const -> const Rect & { return bounds_; }
+
+        // nullptr for no monitors, or outside all of them with MonitorFallback::none
+        auto from_point(Point point, MonitorFallback fallback = MonitorFallback::nearest) const -> const Monitor * {
+            ++stats_.lookups;
+            // a mirrored monitor never becomes last_, so this agrees with the grid
+            if (last_ < monitors_.size() && monitors_[last_].bounds.contains(point)) {
+                ++stats_.last_hits;
+                return &monitors_[last_];
+            }
+            return locate(point, fallback);
+        }
+
+        // the monitor with the largest overlap, the first one on a tie
+        auto from_rect(const Rect &rect, MonitorFallback fallback = MonitorFallback::nearest) const -> const Monitor * {
+            if (rect.empty()) {
+                return from_point({rect.left, rect.top}, fallback);
+            }
+            ++stats_.lookups;
+            // the usual case, a window well inside one monitor, needs no area comparison
+            if (last_ < monitors_.size() && intersect(monitors_[last_].bounds, rect) == rect) {
+                ++stats_.last_hits;
+                return &monitors_[last_];
+            }
+            return locate(rect, fallback);
+        }
+
+        auto stats() const -> const MonitorTopologyStats & { return stats_; }
+
+    private:
+        static constexpr uint16_t no_monitor = UINT16_MAX;
+
+        auto locate(Point point, MonitorFallback fallback) const -> const Monitor *;
+
+        auto locate(const Rect &rect, MonitorFallback fallback) const -> const Monitor *;
+
+        auto fallback_for(Point point, MonitorFallback fallback) const -> const Monitor *;
+
+        std::vector<Monitor> monitors_;
+        std::vector<int32_t> xs_;       // sorted distinct vertical monitor edges
+        std::vector<int32_t> ys_;       // sorted distinct horizontal monitor edges
+        std::vector<uint16_t> cells_;   // (xs_.size() - 1) x (ys_.size() - 1), row major, monitor index
+        Rect bounds_{};
+        size_t primary_ = 0;
+        mutable size_t last_ = 0; // monitor of the last hit
+        uint64_t generation_ = 0;
+        bool valid_ = false;
+        mutable MonitorTopologyStats stats_;
+    };
+}
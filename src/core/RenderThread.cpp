@@ -0,0 +1,19 @@
+#include "RenderThread.hpp"
+
+namespace borderless {
+
+    auto Wakeup::notify_if_sleeping() -> void {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_relaxed)) {
+            notify();
+        }
+    }
+
+    auto Wakeup::notify() -> void {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            signaled_ = true;
+        }
+        condition_.notify_one();
+    }
+}
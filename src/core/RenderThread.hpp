@@ -0,0 +1,198 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "SpscQueue.hpp"
+#include "Trace.hpp"
+
+namespace borderless {
+
+    /* Lets a consumer sleep until a producer has something for it. The producer side is a single
+     * load while the consumer is awake; the mutex is only taken when the consumer actually sleeps.
+     */
+    class Wakeup {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // consumer: sleeps up to timeout (duration::max() = until notified) unless ready() holds
+        template<typename Ready>
+        auto wait(Clock::duration timeout, Ready &&ready) -> bool {
+            std::unique_lock<std::mutex> lock(mutex_);
+            sleeping_.store(true, std::memory_order_relaxed);
+            // pairs with the fence in notify_if_sleeping: either we see the producer's work or it sees us
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto wakeable = [&] { return signaled_ || ready(); };
+            bool woken;
+            if (timeout == Clock::duration::max()) {
+                condition_.wait(lock, wakeable);
+                woken = true;
+            } else {
+                woken = condition_.wait_for(lock, timeout, wakeable);
+            }
+            sleeping_.store(false, std::memory_order_relaxed);
+            signaled_ = false;
+            return woken;
+        }
+
+        // producer: call after publishing work
+        auto notify_if_sleeping() -> void;
+
+        // any thread: wakes the consumer even if it has not gone to sleep yet
+        auto notify() -> void;
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable condition_;
+        std::atomic<bool> sleeping_{false};
+        bool signaled_ = false;
+    };
+
+    struct RenderThreadStats {
+        uint64_t posted = 0;
+        uint64_t executed = 0;
+        uint64_t full_waits = 0; // post() found the queue full and had to wait for the render thread
+        uint64_t wakeups = 0;
+        uint64_t iterations = 0;
+    };
+
+    /* A thread that owns the rendering state. The owning (UI) thread posts commands through a
+     * lock-free SPSC queue; the render thread drains them, calls frame() and sleeps for as long as
+     * frame() returns or until the next command arrives. post() must only be called from one thread.
+     * An exception thrown by a hook ends the thread; failed() is invoked on the render thread and
+     * rethrow_if_failed() rethrows it on the owner's.
+     */
+    template<typename Command>
+    class RenderThread {
+    public:
+        using Clock = Wakeup::Clock;
+
+        struct Hooks {
+            std::function<void(Command &)> execute;
+            // renders if a frame is due; returns how long to sleep, duration::max() until the next command
+            std::function<Clock::duration()> frame;
+            std::function<void()> failed;
+        };
+
+        explicit RenderThread(Hooks hooks, size_t capacity = 256) :
+                hooks_(std::move(hooks)),
+                queue_(capacity),
+                thread_([this] { run(); }) {}
+
+        ~RenderThread() { stop(); }
+
+        RenderThread(const RenderThread &) = delete;
+
+        auto operator=(const RenderThread &) -> RenderThread & = delete;
+
+        // blocks (yielding) while the queue is full, so commands are never dropped
+        template<typename C>
+        auto post(C &&command) -> void {
+            if (!queue_.try_push(std::forward<C>(command))) {
+                ++full_waits_;
+                wakeup_.notify();
+                // try_push only moves from command when it succeeds
+                while (!queue_.try_push(std::forward<C>(command))) {
+                    if (failed_.load(std::memory_order_acquire)) {
+                        return;
+                    }
+                    std::this_thread::yield();
+                }
+            }
+            ++posted_;
+            wakeup_.notify_if_sleeping();
+        }
+
+        // wakes the render thread to call frame() again, e.g. after a frame was requested
+        auto wake() -> void { wakeup_.notify(); }
+
+        // executes what is still queued, then joins
+        auto stop() -> void {
+            if (!thread_.joinable()) {
+                return;
+            }
+            stopping_.store(true, std::memory_order_release);
+            wakeup_.notify();
+            thread_.join();
+        }
+
+        auto rethrow_if_failed() -> void {
+            if (failed_.load(std::memory_order_acquire) && error_) {
+                std::rethrow_exception(std::exchange(error_, nullptr));
+            }
+        }
+
+        auto stats() const -> RenderThreadStats {
+            RenderThreadStats s;
+            s.posted = posted_;
+            s.full_waits = full_waits_;
+            s.executed = executed_.load(std::memory_order_relaxed);
+            s.wakeups = wakeups_.load(std::memory_order_relaxed);
+            s.iterations = iterations_.load(std::memory_order_relaxed);
+            return s;
+        }
+
+        auto queue_capacity() const -> size_t { return queue_.capacity(); }
+
+    private:
+        auto run() -> void {
+            if (trace::enabled()) {
+                trace::set_thread_name("render");
+            }
+            try {
+                while (!stopping_.load(std::memory_order_acquire)) {
+                    drain();
+                    const auto sleep = hooks_.frame ? hooks_.frame() : Clock::duration::max();
+                    iterations_.fetch_add(1, std::memory_order_relaxed);
+                    if (sleep > Clock::duration::zero()) {
+                        wakeup_.wait(sleep, [this] {
+                            return !queue_.empty() || stopping_.load(std::memory_order_acquire);
+                        });
+                        wakeups_.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+                drain();
+            }
+            catch (...) {
+                error_ = std::current_exception();
+                failed_.store(true, std::memory_order_release);
+                if (hooks_.failed) {
+                    hooks_.failed();
+                }
+            }
+        }
+
+        auto drain() -> void {
+            uint64_t executed = 0;
+            while (queue_.try_pop(command_)) {
+                BORDERLESS_TRACE_SCOPE(trace::Event::render_command, 0);
+                hooks_.execute(command_);
+                ++executed;
+            }
+            executed_.fetch_add(executed, std::memory_order_relaxed);
+        }
+
+        Hooks hooks_;
+        SpscQueue<Command> queue_;
+        Wakeup wakeup_;
+        Command command_{}; // render thread only, reused so draining does not construct per command
+        std::atomic<bool> stopping_{false};
+        std::atomic<bool> failed_{false};
+        std::exception_ptr error_;
+
+        uint64_t posted_ = 0;     // owner thread
+        uint64_t full_waits_ = 0; // owner thread
+        std::atomic<uint64_t> executed_{0};
+        std::atomic<uint64_t> wakeups_{0};
+        std::atomic<uint64_t> iterations_{0};
+
+        std::thread thread_; // last, so everything above exists when run() starts
+    };
+}
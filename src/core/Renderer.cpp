@@ -0,0 +1,34 @@
+#include "Renderer.hpp"
+
+#include "Scene.hpp"
+
+namespace borderless {
+
+    auto paint(const Scene &scene, const DamageRegion &region, Renderer &renderer) -> void {
+        paint(scene, region, renderer, nullptr);
+    }
+
+    auto paint(const Scene &scene, const DamageRegion &region, Renderer &renderer,
+               const std::function<bool(uint32_t)> &include) -> void {
+        auto included = [&](uint32_t layer) { return !include || include(layer); };
+        for (const auto &rect: region.rects()) {
+            renderer.set_transform({});
+            renderer.push_clip(rect);
+            renderer.clear({0.0f, 0.0f, 0.0f, 0.0f});
+
+            scene.paint(rect, included, [&](NodeId, const NodeContent &content, const Transform &world) {
+                renderer.set_transform(world);
+                if (auto e = std::get_if<EllipseNode>(&content)) {
+                    renderer.fill_ellipse(e->center, e->radius_x, e->radius_y, e->color);
+                } else if (auto t = std::get_if<TextNode>(&content)) {
+                    renderer.draw_text(t->layout, t->origin, t->color);
+                } else if (auto i = std::get_if<ImageNode>(&content)) {
+                    renderer.draw_image(i->image, i->destination, i->opacity);
+                }
+            });
+
+            renderer.set_transform({});
+            renderer.pop_clip();
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include "Color.hpp"
+#include "Damage.hpp"
+#include "Geometry.hpp"
+#include "TextCache.hpp"
+
+namespace borderless {
+
+    class Scene;
+
+    // 8-bit coverage, e.g. a rasterized glyph run
+    struct AlphaMask {
+        const uint8_t *pixels = nullptr;
+        int32_t width = 0;
+        int32_t height = 0;
+        int32_t stride = 0; // bytes per row
+    };
+
+    /* Immediate-mode drawing interface implemented by the Direct2D backend and the CPU backend.
+     * Coordinates are device pixels transformed by the current transform; clips are device-space
+     * rects and nest.
+     */
+    class Renderer {
+    public:
+        virtual ~Renderer() = default;
+
+        virtual auto begin_frame() -> void = 0;
+
+        virtual auto end_frame() -> void = 0;
+
+        virtual auto push_clip(const Rect &clip) -> void = 0;
+
+        virtual auto pop_clip() -> void = 0;
+
+        virtual auto set_transform(const Transform &transform) -> void = 0;
+
+        // replaces every pixel inside the current clip
+        virtual auto clear(const Color &color) -> void = 0;
+
+        virtual auto fill_rect(const RectF &rect, const Color &color) -> void = 0;
+
+        virtual auto fill_ellipse(PointF center, float radius_x, float radius_y, const Color &color) -> void = 0;
+
+        // blends color through mask with its top left corner at origin (device pixels, untransformed)
+        virtual auto draw_mask(const AlphaMask &mask, Point origin, const Color &color) -> void = 0;
+
+        // clipped to the layout box at origin, so glyphs overhanging it never reach pixels outside the
+        // bounds a scene or display list reports for the text
+        virtual auto draw_text(const TextLayoutKey &layout, PointF origin, const Color &color) -> void = 0;
+
+        // image ids are handed out by the backend
+        virtual auto draw_image(uint32_t image, const RectF &destination, float opacity) -> void = 0;
+    };
+
+    // repaints every rect of region from scene: clip, clear to transparent, draw the nodes inside
+    auto paint(const Scene &scene, const DamageRegion &region, Renderer &renderer) -> void;
+
+    // the same, drawing only the nodes of layers for which include(layer) is true
+    auto paint(const Scene &scene, const DamageRegion &region, Renderer &renderer,
+               const std::function<bool(uint32_t)> &include) -> void;
+}
@@ -0,0 +1,29 @@
+#include "ResizeCoalescer.hpp"
+
+namespace borderless {
+
+    auto ResizeCoalescer::request(Size size) -> void {
+        ++stats_.requests;
+        // a minimized window reports 0x0, the swap chain keeps its last size
+        if (size.width <= 0 || size.height <= 0) {
+            ++stats_.redundant;
+            return;
+        }
+        if (pending_) {
+            ++stats_.coalesced;
+        }
+        if (size.width == current_.width && size.height == current_.height) {
+            // dragged back to the size we already have
+            pending_ = false;
+            ++stats_.redundant;
+            return;
+        }
+        target_ = size;
+        pending_ = true;
+    }
+
+    auto ResizeCoalescer::wait_time(Clock::time_point now) const -> Clock::duration {
+        const auto elapsed = now - last_applied_;
+        return elapsed >= interval_ ? Clock::duration::zero() : interval_ - elapsed;
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "Geometry.hpp"
+
+namespace borderless {
+
+    struct ResizeStats {
+        uint64_t requests = 0;
+        uint64_t applied = 0;
+        uint64_t coalesced = 0; // requests superseded before they were applied
+        uint64_t redundant = 0; // requests for the size the swap chain already has
+    };
+
+    /* Collapses bursts of WM_SIZE into at most one swap chain resize per interval (one vblank).
+     * request() only records the latest size; apply() performs it when the interval since the
+     * previous resize has passed, and flush() performs it unconditionally, e.g. on
+     * WM_EXITSIZEMOVE. Time is passed in so the policy can run against a simulated clock.
+     */
+    class ResizeCoalescer {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        explicit ResizeCoalescer(Clock::duration interval = std::chrono::microseconds(16'667)) :
+                interval_(interval) {}
+
+        // size of the swap chain as created, without resizing it
+        auto reset(Size size) -> void {
+            current_ = size;
+            pending_ = false;
+        }
+
+        auto set_interval(Clock::duration interval) -> void { interval_ = interval; }
+
+        auto interval() const -> Clock::duration { return interval_; }
+
+        auto request(Size size) -> void;
+
+        auto pending() const -> bool { return pending_; }
+
+        auto current() const -> Size { return current_; }
+
+        // time until a pending resize may be applied, zero when it is due now
+        auto wait_time(Clock::time_point now) const -> Clock::duration;
+
+        // resize(Size) is called at most once, when a resize is pending and due
+        template<typename Resize>
+        auto apply(Clock::time_point now, Resize &&resize) -> bool {
+            if (!pending_ || wait_time(now) > Clock::duration::zero()) {
+                return false;
+            }
+            return flush(now, resize);
+        }
+
+        template<typename Resize>
+        auto flush(Clock::time_point now, Resize &&resize) -> bool {
+            if (!pending_) {
+                return false;
+            }
+            pending_ = false;
+            current_ = target_;
+            last_applied_ = now;
+            ++stats_.applied;
+            resize(current_);
+            return true;
+        }
+
+        auto stats() const -> const ResizeStats & { return stats_; }
+
+    private:
+        Clock::duration interval_;
+        Clock::time_point last_applied_{};
+        Size current_{};
+        Size target_{};
+        bool pending_ = false;
+        ResizeStats stats_;
+    };
+}
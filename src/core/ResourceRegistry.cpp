@@ -0,0 +1,159 @@
+#include "ResourceRegistry.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace borderless {
+
+    auto format_resource_stats(const ResourceStats &stats) -> std::string {
+        char line[200];
+        std::snprintf(line, sizeof(line),
+                      "resources: %zu declared, %zu materialized, %llu builds, %llu rebuilds (%llu failed)\n",
+                      stats.declared, stats.materialized,
+                      static_cast<unsigned long long>(stats.builds),
+                      static_cast<unsigned long long>(stats.rebuilds),
+                      static_cast<unsigned long long>(stats.failed_rebuilds));
+        return line;
+    }
+
+    auto ResourceRegistry::declare_erased(Create create, std::initializer_list<ResourceId> depends_on) -> ResourceId {
+        std::vector<uint32_t> dependencies;
+        for (const auto dependency: depends_on) {
+            if (!contains(dependency)) {
+                throw std::invalid_argument("dependency is not a live resource");
+            }
+            dependencies.push_back(dependency.index);
+        }
+
+        uint32_t index;
+        if (!free_.empty()) {
+            index = free_.back();
+            free_.pop_back();
+        } else {
+            index = static_cast<uint32_t>(slots_.size());
+            slots_.emplace_back();
+        }
+        auto &s = slots_[index];
+        s.alive = true;
+        s.create = std::move(create);
+        s.object.reset();
+        s.depends_on = std::move(dependencies);
+        order_.push_back(index);
+        return {index, s.generation};
+    }
+
+    auto ResourceRegistry::contains(ResourceId id) const -> bool {
+        return id.index < slots_.size() && slots_[id.index].alive && slots_[id.index].generation == id.generation;
+    }
+
+    auto ResourceRegistry::object(ResourceId id) const -> void * {
+        return contains(id) ? slots_[id.index].object.get() : nullptr;
+    }
+
+    auto ResourceRegistry::slot(ResourceId id) -> Slot & {
+        if (!contains(id)) {
+            throw std::invalid_argument("stale resource handle");
+        }
+        return slots_[id.index];
+    }
+
+    auto ResourceRegistry::materialize(ResourceId id) -> void {
+        auto &s = slot(id);
+        if (s.object) {
+            return;
+        }
+        for (const auto dependency: s.depends_on) {
+            if (!slots_[dependency].object) {
+                throw std::logic_error("a dependency is not materialized");
+            }
+        }
+        s.object = s.create();
+        ++s.builds;
+    }
+
+    auto ResourceRegistry::materialize_all() -> void {
+        try {
+            for (const auto index: order_) {
+                auto &s = slots_[index];
+                if (!s.object) {
+                    s.object = s.create();
+                    ++s.builds;
+                }
+            }
+        } catch (...) {
+            release_all();
+            throw;
+        }
+    }
+
+    auto ResourceRegistry::dependents(uint32_t index) const -> std::vector<size_t> {
+        // dependents are always declared later, so one pass in declaration order finds them all
+        std::vector<size_t> positions;
+        std::vector<bool> affected(slots_.size());
+        affected[index] = true;
+        for (size_t i = 0; i < order_.size(); ++i) {
+            const auto &s = slots_[order_[i]];
+            if (!affected[order_[i]] &&
+                std::any_of(s.depends_on.begin(), s.depends_on.end(), [&](uint32_t d) { return affected[d]; })) {
+                affected[order_[i]] = true;
+            }
+            if (affected[order_[i]]) {
+                positions.push_back(i);
+            }
+        }
+        return positions;
+    }
+
+    auto ResourceRegistry::release(ResourceId id) -> void {
+        slot(id);
+        const auto positions = dependents(id.index);
+        for (auto it = positions.rbegin(); it != positions.rend(); ++it) {
+            slots_[order_[*it]].object.reset();
+        }
+    }
+
+    auto ResourceRegistry::release_all() -> void {
+        for (auto it = order_.rbegin(); it != order_.rend(); ++it) {
+            slots_[*it].object.reset();
+        }
+    }
+
+    auto ResourceRegistry::rebuild() -> void {
+        release_all();
+        ++rebuilds_;
+        try {
+            materialize_all();
+        } catch (...) {
+            ++failed_rebuilds_;
+            throw;
+        }
+    }
+
+    auto ResourceRegistry::remove(ResourceId id) -> void {
+        slot(id);
+        const auto positions = dependents(id.index);
+        for (auto it = positions.rbegin(); it != positions.rend(); ++it) {
+            const auto index = order_[*it];
+            auto &s = slots_[index];
+            s.object.reset();
+            s.create = nullptr;
+            s.depends_on.clear();
+            s.alive = false;
+            ++s.generation;
+            free_.push_back(index);
+            order_.erase(order_.begin() + static_cast<ptrdiff_t>(*it));
+        }
+    }
+
+    auto ResourceRegistry::stats() const -> ResourceStats {
+        ResourceStats stats;
+        stats.declared = order_.size();
+        for (const auto &s: slots_) {
+            stats.materialized += s.alive && s.object ? 1 : 0;
+            stats.builds += s.builds;
+        }
+        stats.rebuilds = rebuilds_;
+        stats.failed_rebuilds = failed_rebuilds_;
+        return stats;
+    }
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace borderless {
+
+    // a slot and the generation it had when the resource was declared; stale once it is removed
+    struct ResourceId {
+        uint32_t index = UINT32_MAX;
+        uint32_t generation = 0;
+    };
+
+    inline auto operator==(ResourceId a, ResourceId b) -> bool {
+        return a.index == b.index && a.generation == b.generation;
+    }
+
+    inline auto operator!=(ResourceId a, ResourceId b) -> bool {
+        return !(a == b);
+    }
+
+    // typed handle; converts to ResourceId for dependency lists
+    template<typename T>
+    struct Resource {
+        ResourceId id;
+
+        operator ResourceId() const { return id; }
+    };
+
+    struct ResourceStats {
+        size_t declared = 0;
+        size_t materialized = 0;
+        uint64_t builds = 0;        // objects created, the first time or again
+        uint64_t rebuilds = 0;
+        uint64_t failed_rebuilds = 0;
+    };
+
+    auto format_resource_stats(const ResourceStats &stats) -> std::string;
+
+    /* Device-dependent resources behind generation-tagged handles, each with the recipe that
+     * creates it and the resources it is created from. Since a recipe can run again, a lost device
+     * is survived by rebuild(): every object is released, dependents first, and recreated in
+     * declaration order, which puts dependencies before what depends on them. Handles stay valid
+     * across rebuilds; only remove() makes them stale.
+     *
+     * declare() records a recipe without running it, so startup can declare everything on one thread
+     * and then materialize() different resources on different threads, each once its dependencies
+     * are there. Everything else must not run concurrently with anything.
+     */
+    class ResourceRegistry {
+    public:
+        ResourceRegistry() = default;
+
+        // releases like release_all(), so what was created from something goes first
+        ~ResourceRegistry() { release_all(); }
+
+        ResourceRegistry(const ResourceRegistry &) = delete;
+
+        auto operator=(const ResourceRegistry &) -> ResourceRegistry & = delete;
+
+        template<typename T>
+        auto declare(std::function<T()> create, std::initializer_list<ResourceId> depends_on = {}) -> Resource<T> {
+            return {declare_erased([create = std::move(create)]() -> std::shared_ptr<void> {
+                return std::make_shared<T>(create());
+            }, depends_on)};
+        }
+
+        // declares and materializes
+        template<typename T>
+        auto add(std::function<T()> create, std::initializer_list<ResourceId> depends_on = {}) -> Resource<T> {
+            const auto resource = declare<T>(std::move(create), depends_on);
+            materialize(resource);
+            return resource;
+        }
+
+        // nullptr for a stale handle or a released object
+        template<typename T>
+        auto find(Resource<T> resource) const -> T * {
+            return static_cast<T *>(object(resource.id));
+        }
+
+        template<typename T>
+        auto get(Resource<T> resource) const -> T & {
+            const auto found = find(resource);
+            if (!found) {
+                throw std::logic_error("resource is not materialized");
+            }
+            return *found;
+        }
+
+        auto contains(ResourceId id) const -> bool;
+
+        auto materialized(ResourceId id) const -> bool { return object(id) != nullptr; }
+
+        // runs the recipe unless the object exists; its dependencies must exist
+        auto materialize(ResourceId id) -> void;
+
+        // creates every released object in declaration order; if a recipe throws, everything is
+        // released again and the exception propagates, so a retry starts from scratch
+        auto materialize_all() -> void;
+
+        // releases the object and every object created from it, latest first; recipes are kept
+        auto release(ResourceId id) -> void;
+
+        auto release_all() -> void;
+
+        // release_all() and materialize_all(), e.g. after the device was lost
+        auto rebuild() -> void;
+
+        // forgets the resource and everything that depends on it; their handles become stale
+        auto remove(ResourceId id) -> void;
+
+        auto size() const -> size_t { return order_.size(); }
+
+        auto stats() const -> ResourceStats;
+
+    private:
+        using Create = std::function<std::shared_ptr<void>()>;
+
+        struct Slot {
+            uint32_t generation = 0;
+            bool alive = false;
+            Create create;
+            std::shared_ptr<void> object;
+            std::vector<uint32_t> depends_on;
+            uint64_t builds = 0; // per slot, so materialize() on different slots needs no lock
+        };
+
+        auto declare_erased(Create create, std::initializer_list<ResourceId> depends_on) -> ResourceId;
+
+        auto object(ResourceId id) const -> void *;
+
+        auto slot(ResourceId id) -> Slot &;
+
+        // positions in order_ of the resource at index and everything created from it
+        auto dependents(uint32_t index) const -> std::vector<size_t>;
+
+        std::vector<Slot> slots_;
+        std::vector<uint32_t> free_;
+        std::vector<uint32_t> order_; // live slots in declaration order
+        uint64_t rebuilds_ = 0;
+        uint64_t failed_rebuilds_ = 0;
+    };
+}
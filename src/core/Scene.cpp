@@ -0,0 +1,207 @@
+#include "Scene.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace borderless {
+
+    namespace {
+        // anti-aliased edges touch one pixel beyond the geometry
+        constexpr int32_t aa_margin = 1;
+    }
+
+    Scene::Scene() {
+        nodes_.emplace_back();
+        nodes_.front().content = GroupNode{};
+    }
+
+    auto Scene::add(NodeId parent, NodeContent content, const Transform &transform) -> NodeId {
+        NodeId id;
+        if (!free_.empty()) {
+            id = free_.back();
+            free_.pop_back();
+            nodes_[id] = Node{};
+        } else {
+            id = static_cast<NodeId>(nodes_.size());
+            nodes_.emplace_back();
+        }
+
+        auto &node = nodes_[id];
+        node.content = std::move(content);
+        node.local = transform;
+        node.parent = parent;
+        nodes_[parent].children.push_back(id);
+        mark_dirty(id);
+        return id;
+    }
+
+    auto Scene::remove(NodeId id) -> void {
+        if (id == root() || !nodes_[id].alive) {
+            return;
+        }
+        collect_bounds(id, removed_);
+
+        auto &siblings = nodes_[nodes_[id].parent].children;
+        siblings.erase(std::find(siblings.begin(), siblings.end(), id));
+        free_subtree(id);
+    }
+
+    auto Scene::set_content(NodeId id, NodeContent content) -> void {
+        nodes_[id].content = std::move(content);
+        mark_dirty(id);
+    }
+
+    auto Scene::set_transform(NodeId id, const Transform &transform) -> void {
+        if (nodes_[id].local != transform) {
+            nodes_[id].local = transform;
+            mark_dirty(id);
+        }
+    }
+
+    auto Scene::set_visible(NodeId id, bool visible) -> void {
+        if (nodes_[id].visible != visible) {
+            nodes_[id].visible = visible;
+            mark_dirty(id);
+        }
+    }
+
+    auto Scene::set_layer(NodeId id, uint32_t layer) -> void {
+        if (nodes_[id].layer != layer) {
+            nodes_[id].layer = layer;
+            mark_dirty(id);
+        }
+    }
+
+    auto Scene::subtree_bounds(NodeId id) const -> Rect {
+        const auto &node = nodes_[id];
+        auto bounds = node.bounds;
+        for (auto child: node.children) {
+            bounds = unite(bounds, subtree_bounds(child));
+        }
+        return bounds;
+    }
+
+    auto Scene::update(DamageRegion &damage) -> void {
+        update(DamageSink{&damage, nullptr});
+    }
+
+    auto Scene::update(LayerDamage &damage) -> void {
+        if (damage.empty()) {
+            damage.emplace_back();
+        }
+        update(DamageSink{nullptr, &damage});
+    }
+
+    auto Scene::DamageSink::add(uint32_t layer, const Rect &rect) const -> void {
+        if (all) {
+            all->add(rect);
+            return;
+        }
+        if (layer >= layers->size()) {
+            const auto surface = layers->front().surface();
+            layers->resize(size_t{layer} + 1);
+            for (auto &region: *layers) {
+                region.set_surface(surface);
+            }
+        }
+        (*layers)[layer].add(rect);
+    }
+
+    auto Scene::update(const DamageSink &sink) -> void {
+        for (const auto &removed: removed_) {
+            sink.add(removed.layer, removed.bounds);
+        }
+        removed_.clear();
+
+        update_node(root(), {}, true, 0, false, sink);
+    }
+
+    auto Scene::mark_dirty(NodeId id) -> void {
+        nodes_[id].dirty = true;
+        // flag the path to the root so update() can skip clean subtrees
+        while (id != root()) {
+            id = nodes_[id].parent;
+            if (nodes_[id].children_dirty) {
+                break;
+            }
+            nodes_[id].children_dirty = true;
+        }
+    }
+
+    auto Scene::update_node(NodeId id, const Transform &parent_world, bool parent_visible, uint32_t parent_layer,
+                            bool force, const DamageSink &sink) -> void {
+        auto &node = nodes_[id];
+        if (!force && !node.dirty && !node.children_dirty) {
+            return;
+        }
+
+        const bool recompute = force || node.dirty;
+        if (recompute) {
+            const auto world = node.local * parent_world;
+            const bool visible = parent_visible && node.visible;
+            const auto layer = node.layer == inherit_layer ? parent_layer : node.layer;
+
+            Rect bounds{};
+            if (visible && !std::holds_alternative<GroupNode>(node.content)) {
+                const auto r = round_out(world.apply(local_bounds(node)));
+                bounds = {r.left - aa_margin, r.top - aa_margin, r.right + aa_margin, r.bottom + aa_margin};
+            }
+
+            if (node.dirty || world != node.world || visible != node.effective_visible ||
+                layer != node.effective_layer) {
+                // a node moving between layers leaves damage in the old one
+                sink.add(node.effective_layer, node.bounds);
+                sink.add(layer, bounds);
+            }
+            node.world = world;
+            node.effective_visible = visible;
+            node.effective_layer = layer;
+            node.bounds = bounds;
+        }
+
+        for (auto child: node.children) {
+            update_node(child, node.world, node.effective_visible, node.effective_layer, recompute, sink);
+        }
+        node.dirty = false;
+        node.children_dirty = false;
+    }
+
+    auto Scene::collect_bounds(NodeId id, std::vector<RemovedBounds> &out) const -> void {
+        const auto &node = nodes_[id];
+        if (!node.bounds.empty()) {
+            out.push_back({node.effective_layer, node.bounds});
+        }
+        for (auto child: node.children) {
+            collect_bounds(child, out);
+        }
+    }
+
+    auto Scene::free_subtree(NodeId id) -> void {
+        auto &node = nodes_[id];
+        for (auto child: node.children) {
+            free_subtree(child);
+        }
+        node.children.clear();
+        node.alive = false;
+        node.effective_visible = false;
+        free_.push_back(id);
+    }
+
+    auto Scene::local_bounds(const Node &node) const -> RectF {
+        struct {
+            auto operator()(const GroupNode &) const -> RectF { return {}; }
+
+            auto operator()(const EllipseNode &e) const -> RectF {
+                return {e.center.x - e.radius_x, e.center.y - e.radius_y,
+                        e.center.x + e.radius_x, e.center.y + e.radius_y};
+            }
+
+            auto operator()(const TextNode &t) const -> RectF {
+                return {t.origin.x, t.origin.y, t.origin.x + t.layout.max_width, t.origin.y + t.layout.max_height};
+            }
+
+            auto operator()(const ImageNode &i) const -> RectF { return i.destination; }
+        } visitor;
+        return std::visit(visitor, node.content);
+    }
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstdint>
+#include <variant>
+#include <vector>
+
+#include "Color.hpp"
+#include "Damage.hpp"
+#include "Geometry.hpp"
+#include "TextCache.hpp"
+
+namespace borderless {
+
+    using NodeId = uint32_t;
+
+    struct GroupNode {
+    };
+
+    struct EllipseNode {
+        PointF center;
+        float radius_x = 0.0f;
+        float radius_y = 0.0f;
+        Color color;
+    };
+
+    struct TextNode {
+        TextLayoutKey layout; // layout box is max_width x max_height at origin; drawing is clipped to it
+        PointF origin;
+        Color color;
+    };
+
+    struct ImageNode {
+        uint32_t image = 0; // renderer-defined image id
+        RectF destination;
+        float opacity = 1.0f;
+    };
+
+    using NodeContent = std::variant<GroupNode, EllipseNode, TextNode, ImageNode>;
+
+    // damage per layer id, see Scene::set_layer
+    using LayerDamage = std::vector<DamageRegion>;
+
+    /* Retained scene graph with damage tracking.
+     * Mutators only flag nodes; update() recomputes world transforms and pixel bounds of the
+     * flagged subtrees and adds the old and new bounds of every changed node to a DamageRegion.
+     * Paint order is depth first, children in insertion order.
+     * Subtrees can be tagged with a layer id; damage is then also reported per layer and painting
+     * can be limited to some layers, so a shell can cache a layer in a surface of its own.
+     */
+    class Scene {
+    public:
+        Scene();
+
+        auto root() const -> NodeId { return 0; }
+
+        auto add(NodeId parent, NodeContent content, const Transform &transform = {}) -> NodeId;
+
+        // removes the node and its subtree
+        auto remove(NodeId id) -> void;
+
+        auto set_content(NodeId id, NodeContent content) -> void;
+
+        auto set_transform(NodeId id, const Transform &transform) -> void;
+
+        auto set_visible(NodeId id, bool visible) -> void;
+
+        // the subtree at id belongs to layer, unless a node below sets its own; everything else is
+        // in layer 0
+        auto set_layer(NodeId id, uint32_t layer) -> void;
+
+        // the layer from the last update()
+        auto layer(NodeId id) const -> uint32_t { return nodes_[id].effective_layer; }
+
+        auto content(NodeId id) const -> const NodeContent & { return nodes_[id].content; }
+
+        auto transform(NodeId id) const -> const Transform & { return nodes_[id].local; }
+
+        auto world_transform(NodeId id) const -> const Transform & { return nodes_[id].world; }
+
+        // pixel bounds from the last update(), empty for groups and hidden nodes
+        auto bounds(NodeId id) const -> const Rect & { return nodes_[id].bounds; }
+
+        auto node_count() const -> size_t { return nodes_.size() - free_.size(); }
+
+        // union of the bounds in the subtree at id
+        auto subtree_bounds(NodeId id) const -> Rect;
+
+        auto update(DamageRegion &damage) -> void;
+
+        // damage[layer] gets the damage of each layer; the vector grows to the highest layer id, new
+        // regions take the surface of damage[0]
+        auto update(LayerDamage &damage) -> void;
+
+        // calls visit(id, content, world_transform) for every visible leaf whose bounds touch clip
+        template<typename Visit>
+        auto paint(const Rect &clip, Visit &&visit) const -> void {
+            auto all = [](uint32_t) { return true; };
+            paint_node(root(), clip, all, visit);
+        }
+
+        // the same for leaves in a layer for which include(layer) is true
+        template<typename Include, typename Visit>
+        auto paint(const Rect &clip, Include &&include, Visit &&visit) const -> void {
+            paint_node(root(), clip, include, visit);
+        }
+
+    private:
+        struct Node {
+            NodeContent content;
+            Transform local;
+            Transform world;
+            Rect bounds{};
+            NodeId parent = 0;
+            std::vector<NodeId> children;
+            uint32_t layer = inherit_layer;
+            uint32_t effective_layer = 0;
+            bool alive = true;
+            bool visible = true;
+            bool effective_visible = true;
+            bool dirty = true;            // own content, transform or visibility changed
+            bool children_dirty = false;  // something below needs an update
+        };
+
+        static constexpr uint32_t inherit_layer = UINT32_MAX;
+
+        // where update() reports damage: one region for everything, or one per layer
+        struct DamageSink {
+            DamageRegion *all = nullptr;
+            LayerDamage *layers = nullptr;
+
+            auto add(uint32_t layer, const Rect &rect) const -> void;
+        };
+
+        auto mark_dirty(NodeId id) -> void;
+
+        auto update(const DamageSink &sink) -> void;
+
+        auto update_node(NodeId id, const Transform &parent_world, bool parent_visible, uint32_t parent_layer,
+                         bool force, const DamageSink &sink) -> void;
+
+        struct RemovedBounds {
+            uint32_t layer;
+            Rect bounds;
+        };
+
+        auto collect_bounds(NodeId id, std::vector<RemovedBounds> &out) const -> void;
+
+        auto free_subtree(NodeId id) -> void;
+
+        auto local_bounds(const Node &node) const -> RectF;
+
+        template<typename Include, typename Visit>
+        auto paint_node(NodeId id, const Rect &clip, Include &include, Visit &visit) const -> void {
+            const auto &node = nodes_[id];
+            if (!node.effective_visible) {
+                return;
+            }
+            if (std::holds_alternative<GroupNode>(node.content)) {
+                for (auto child: node.children) {
+                    paint_node(child, clip, include, visit);
+                }
+            } else if (intersects(node.bounds, clip) && include(node.effective_layer)) {
+                visit(id, node.content, node.world);
+            }
+        }
+
+        std::vector<Node> nodes_;
+        std::vector<NodeId> free_;
+        std::vector<RemovedBounds> removed_; // bounds of nodes removed since the last update
+    };
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace borderless {
+
+    struct SharedPoolStats {
+        uint64_t created = 0;
+        uint64_t destroyed = 0;
+        uint64_t acquired = 0;
+        uint64_t reused = 0; // acquire() found the resources alive
+        uint64_t invalidated = 0;
+        size_t peak_users = 0;
+    };
+
+    /* One set of expensive, process-wide resources (devices and factories) shared by everything
+     * that acquires it. The first acquire() creates them, later ones share them, and they are
+     * destroyed when the last holder lets go, unless the pool retains them. invalidate() (a lost
+     * device) makes the next acquire() create a fresh set while current holders keep theirs until
+     * they re-acquire.
+     *
+     * acquire() may be called from any thread; creation happens under the pool's lock, so concurrent
+     * callers wait for one set instead of creating several. Holders may outlive the pool.
+     */
+    template<typename Resources>
+    class SharedPool {
+    public:
+        // returns the resources or throws
+        using Factory = std::function<std::unique_ptr<Resources>()>;
+
+        explicit SharedPool(Factory create) : state_(std::make_shared<State>()) {
+            state_->create = std::move(create);
+        }
+
+        SharedPool(const SharedPool &) = delete;
+
+        auto operator=(const SharedPool &) -> SharedPool & = delete;
+
+        auto acquire() -> std::shared_ptr<Resources> {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            ++state_->stats.acquired;
+            auto resources = state_->current.lock();
+            if (resources) {
+                ++state_->stats.reused;
+            } else {
+                resources = std::shared_ptr<Resources>(state_->create().release(), [state = state_](Resources *r) {
+                    delete r;
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    ++state->stats.destroyed;
+                });
+                ++state_->stats.created;
+                state_->current = resources;
+                if (state_->retain) {
+                    state_->retained = resources;
+                }
+            }
+            const auto holders = users_locked();
+            state_->stats.peak_users = holders > state_->stats.peak_users ? holders : state_->stats.peak_users;
+            return resources;
+        }
+
+        // keeps the resources alive while nobody holds them, e.g. between closing one window and
+        // opening the next
+        auto set_retain(bool retain) -> void {
+            std::shared_ptr<Resources> released;
+            {
+                std::lock_guard<std::mutex> lock(state_->mutex);
+                state_->retain = retain;
+                if (retain) {
+                    state_->retained = state_->current.lock();
+                } else {
+                    released = std::move(state_->retained);
+                }
+            }
+            // the last reference may go here, and its deleter takes the lock
+        }
+
+        auto invalidate() -> void {
+            std::shared_ptr<Resources> released;
+            {
+                std::lock_guard<std::mutex> lock(state_->mutex);
+                ++state_->stats.invalidated;
+                ++state_->generation;
+                state_->current.reset();
+                released = std::move(state_->retained);
+            }
+        }
+
+        // holders of the current resources, not counting the pool's own retained reference
+        auto users() const -> size_t {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            return users_locked();
+        }
+
+        // bumped by invalidate(); holders compare it to notice they have a stale set
+        auto generation() const -> uint64_t {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            return state_->generation;
+        }
+
+        auto stats() const -> SharedPoolStats {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            return state_->stats;
+        }
+
+    private:
+        // shared with the deleters, so resources released after the pool is gone still have it
+        struct State {
+            mutable std::mutex mutex;
+            Factory create;
+            std::weak_ptr<Resources> current;
+            std::shared_ptr<Resources> retained;
+            bool retain = false;
+            uint64_t generation = 0;
+            SharedPoolStats stats;
+        };
+
+        auto users_locked() const -> size_t {
+            const auto count = static_cast<size_t>(state_->current.use_count());
+            return count - (state_->retained && count ? 1 : 0);
+        }
+
+        std::shared_ptr<State> state_;
+    };
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace borderless {
+
+    /* Bounded lock-free ring buffer for exactly one producer thread and one consumer thread.
+     * Each side keeps a private copy of the other side's index and only reloads it when the ring
+     * looks full (producer) or empty (consumer), so the shared cache lines are touched about once
+     * per batch instead of once per element. Capacity is rounded up to a power of two.
+     * Slots are reused, not destroyed: T must be default constructible and move assignable.
+     */
+    template<typename T>
+    class SpscQueue {
+        static_assert(std::is_default_constructible_v<T>, "SpscQueue slots are default constructed");
+        static_assert(std::is_move_assignable_v<T>, "SpscQueue moves values in and out of slots");
+
+    public:
+        explicit SpscQueue(size_t capacity) :
+                capacity_(round_up(capacity)),
+                mask_(capacity_ - 1),
+                slots_(std::make_unique<T[]>(capacity_)) {}
+
+        SpscQueue(const SpscQueue &) = delete;
+
+        auto operator=(const SpscQueue &) -> SpscQueue & = delete;
+
+        // producer only; false when the ring is full
+        template<typename U>
+        auto try_push(U &&value) -> bool {
+            const auto tail = tail_.load(std::memory_order_relaxed);
+            if (tail - head_cache_ == capacity_) {
+                head_cache_ = head_.load(std::memory_order_acquire);
+                if (tail - head_cache_ == capacity_) {
+                    return false;
+                }
+            }
+            slots_[tail & mask_] = std::forward<U>(value);
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // consumer only; false when the ring is empty
+        auto try_pop(T &out) -> bool {
+            const auto head = head_.load(std::memory_order_relaxed);
+            if (head == tail_cache_) {
+                tail_cache_ = tail_.load(std::memory_order_acquire);
+                if (head == tail_cache_) {
+                    return false;
+                }
+            }
+            out = std::move(slots_[head & mask_]);
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // a snapshot; the other side may change it right after
+        auto empty() const -> bool {
+            return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+        }
+
+        auto size() const -> size_t {
+            return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+        }
+
+        auto capacity() const -> size_t { return capacity_; }
+
+    private:
+        static constexpr size_t cache_line = 64;
+
+        static auto round_up(size_t capacity) -> size_t {
+            size_t result = 2;
+            while (result < capacity) {
+                result *= 2;
+            }
+            return result;
+        }
+
+        const size_t capacity_;
+        const size_t mask_;
+        std::unique_ptr<T[]> slots_;
+
+        // padding instead of alignas keeps MSVC's C4324 quiet and still separates the lines
+        char pad0_[cache_line]{};
+        std::atomic<size_t> tail_{0}; // written by the producer
+        size_t head_cache_ = 0;       // producer's view of head_
+        char pad1_[cache_line]{};
+        std::atomic<size_t> head_{0}; // written by the consumer
+        size_t tail_cache_ = 0;       // consumer's view of tail_
+        char pad2_[cache_line]{};
+    };
+}
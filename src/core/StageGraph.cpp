@@ -0,0 +1,210 @@
+#include "StageGraph.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "Trace.hpp"
+
+namespace borderless {
+
+    auto StageReport::finished(const std::string &name) const -> std::chrono::nanoseconds {
+        for (const auto &stage: stages) {
+            if (stage.name == name) {
+                return stage.end;
+            }
+        }
+        return {};
+    }
+
+    auto format_stage_report(const StageReport &report) -> std::string {
+        auto ms = [](std::chrono::nanoseconds t) { return std::chrono::duration<double, std::milli>(t).count(); };
+
+        std::string out;
+        char line[160];
+        std::snprintf(line, sizeof(line), "  %-22s %6s %9s %9s %9s %9s\n",
+                      "stage", "thread", "ready ms", "start ms", "end ms", "took ms");
+        out += line;
+        for (size_t i = 0; i < report.stages.size(); ++i) {
+            const auto &stage = report.stages[i];
+            const bool critical = std::find(report.critical_stages.begin(), report.critical_stages.end(),
+                                            static_cast<StageId>(i)) != report.critical_stages.end();
+            if (!stage.ran) {
+                std::snprintf(line, sizeof(line), "  %-22s %6s\n", stage.name.c_str(), "skip");
+            } else {
+                std::snprintf(line, sizeof(line), "%c %-22s %6u %9.3f %9.3f %9.3f %9.3f\n",
+                              critical ? '*' : ' ', stage.name.c_str(), stage.thread, ms(stage.ready),
+                              ms(stage.start), ms(stage.end), ms(stage.duration()));
+            }
+            out += line;
+        }
+        std::snprintf(line, sizeof(line), "total %.3f ms, serial %.3f ms, critical path (*) %.3f ms\n",
+                      ms(report.total), ms(report.serial), ms(report.critical_path));
+        out += line;
+        return out;
+    }
+
+    auto StageGraph::add(std::string name, std::function<void()> run, std::initializer_list<StageId> after,
+                         StageAffinity affinity) -> StageId {
+        const auto id = static_cast<StageId>(stages_.size());
+        for (const auto dependency: after) {
+            if (dependency >= id) {
+                throw std::invalid_argument("stage " + name + " depends on a stage added after it");
+            }
+        }
+        stages_.push_back({std::move(name), std::move(run), after, affinity});
+        return id;
+    }
+
+    auto StageGraph::run(uint32_t workers) -> StageReport {
+        enum class State : uint8_t { waiting, running, done, skipped };
+        constexpr auto none = static_cast<StageId>(-1);
+
+        const auto n = stages_.size();
+        const auto start = Clock::now();
+        auto since_start = [start] {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+        };
+
+        StageReport report;
+        report.stages.resize(n);
+        std::vector<State> state(n, State::waiting);
+        std::vector<size_t> pending(n);
+        std::vector<std::vector<StageId>> dependents(n);
+        for (StageId i = 0; i < n; ++i) {
+            report.stages[i].name = stages_[i].name;
+            report.stages[i].affinity = stages_[i].affinity;
+            pending[i] = stages_[i].after.size();
+            for (const auto dependency: stages_[i].after) {
+                dependents[dependency].push_back(i);
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable changed;
+        size_t finished = 0;
+        std::exception_ptr error;
+
+        // the first ready stage the thread may take; called with the lock held
+        auto next = [&](bool caller) -> StageId {
+            for (StageId i = 0; i < n; ++i) {
+                if (state[i] != State::waiting || pending[i] != 0) {
+                    continue;
+                }
+                const bool any = stages_[i].affinity == StageAffinity::any;
+                // the caller leaves worker stages to the workers so it is free for its own
+                if (any ? !caller || workers == 0 : caller) {
+                    return i;
+                }
+            }
+            return none;
+        };
+
+        // called with the lock held
+        auto complete = [&](StageId id, bool ok) {
+            state[id] = ok ? State::done : State::skipped;
+            ++finished;
+            std::vector<StageId> skip;
+            for (const auto dependent: dependents[id]) {
+                if (!ok) {
+                    skip.push_back(dependent);
+                } else if (--pending[dependent] == 0) {
+                    report.stages[dependent].ready = since_start();
+                }
+            }
+            while (!skip.empty()) {
+                const auto stage = skip.back();
+                skip.pop_back();
+                if (state[stage] == State::waiting) {
+                    state[stage] = State::skipped;
+                    ++finished;
+                    skip.insert(skip.end(), dependents[stage].begin(), dependents[stage].end());
+                }
+            }
+            changed.notify_all();
+        };
+
+        auto work = [&](uint32_t thread, bool caller) {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (finished < n) {
+                const auto id = next(caller);
+                if (id == none) {
+                    changed.wait(lock);
+                    continue;
+                }
+                state[id] = State::running;
+                lock.unlock();
+
+                auto &timing = report.stages[id];
+                timing.thread = thread;
+                timing.start = since_start();
+                std::exception_ptr failure;
+                {
+                    BORDERLESS_TRACE_SCOPE(trace::Event::startup_stage, id);
+                    try {
+                        stages_[id].run();
+                    } catch (...) {
+                        failure = std::current_exception();
+                    }
+                }
+                timing.end = since_start();
+                timing.ran = true;
+
+                lock.lock();
+                if (failure && !error) {
+                    error = failure;
+                }
+                complete(id, !failure);
+            }
+        };
+
+        const auto worker_stages = static_cast<uint32_t>(std::count_if(stages_.begin(), stages_.end(), [](const Stage &s) {
+            return s.affinity == StageAffinity::any;
+        }));
+        std::vector<std::thread> threads;
+        for (uint32_t i = 0; i < std::min(workers, worker_stages); ++i) {
+            threads.emplace_back([&work, i] {
+                if (trace::enabled()) {
+                    trace::set_thread_name("startup");
+                }
+                work(i + 1, false);
+            });
+        }
+        work(0, true);
+        for (auto &thread: threads) {
+            thread.join();
+        }
+        report.total = since_start();
+
+        // longest chain through the dependencies, by the time each stage took
+        std::vector<std::chrono::nanoseconds> path(n);
+        std::vector<StageId> previous(n, none);
+        StageId last = none;
+        for (StageId i = 0; i < n; ++i) {
+            report.serial += report.stages[i].duration();
+            for (const auto dependency: stages_[i].after) {
+                if (path[dependency] > path[i] || previous[i] == none) {
+                    path[i] = path[dependency];
+                    previous[i] = dependency;
+                }
+            }
+            path[i] += report.stages[i].duration();
+            if (last == none || path[i] > path[last]) {
+                last = i;
+            }
+        }
+        for (auto i = last; i != none; i = previous[i]) {
+            report.critical_stages.insert(report.critical_stages.begin(), i);
+        }
+        report.critical_path = last == none ? std::chrono::nanoseconds{} : path[last];
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return report;
+    }
+}
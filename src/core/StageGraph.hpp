@@ -0,0 +1,77 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+namespace borderless {
+
+    using StageId = uint32_t;
+
+    enum class StageAffinity : uint8_t {
+        any,    // may run on a worker thread
+        caller, // must run on the thread that calls run(), e.g. anything that creates or shows a window
+    };
+
+    // times are relative to the start of StageGraph::run()
+    struct StageTiming {
+        std::string name;
+        StageAffinity affinity;
+        bool ran;        // false when skipped because a dependency failed
+        uint32_t thread; // 0 for the calling thread, 1... for workers
+        std::chrono::nanoseconds ready; // the last dependency finished
+        std::chrono::nanoseconds start;
+        std::chrono::nanoseconds end;
+
+        auto duration() const -> std::chrono::nanoseconds { return end - start; }
+    };
+
+    struct StageReport {
+        std::vector<StageTiming> stages; // in add() order
+        std::chrono::nanoseconds total{};
+        std::chrono::nanoseconds serial{};        // the sum of all stage durations
+        std::chrono::nanoseconds critical_path{}; // the longest dependency chain, by stage duration
+        std::vector<StageId> critical_stages;     // that chain, first stage first
+
+        // the finish time of a stage, zero if there is none by that name
+        auto finished(const std::string &name) const -> std::chrono::nanoseconds;
+    };
+
+    auto format_stage_report(const StageReport &report) -> std::string;
+
+    /* Runs a set of one-shot stages, each after the stages it depends on, on the calling thread and
+     * a few workers. Built for startup: independent initialization (devices, factories, asset
+     * decoding) overlaps, while stages that touch the window keep to the thread that owns it.
+     *
+     * Dependencies are passed as ids returned by earlier add() calls, so the graph cannot have
+     * cycles. Among ready stages the one added first runs first. With zero workers everything runs
+     * on the calling thread in add() order, the serial baseline.
+     *
+     * When a stage throws, stages that depend on it are skipped, the ones already running finish,
+     * and run() rethrows the first exception.
+     */
+    class StageGraph {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        auto add(std::string name, std::function<void()> run, std::initializer_list<StageId> after = {},
+                 StageAffinity affinity = StageAffinity::any) -> StageId;
+
+        auto size() const -> size_t { return stages_.size(); }
+
+        // runs every stage once; the graph can be run again
+        auto run(uint32_t workers) -> StageReport;
+
+    private:
+        struct Stage {
+            std::string name;
+            std::function<void()> run;
+            std::vector<StageId> after;
+            StageAffinity affinity;
+        };
+        std::vector<Stage> stages_;
+    };
+}
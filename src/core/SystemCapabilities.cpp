@@ -0,0 +1,81 @@
+#include "SystemCapabilities.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <cstdio>
+
+namespace borderless {
+
+    auto Capabilities::diff(const Capabilities &other) const -> uint8_t {
+        uint8_t changed = 0;
+        if (composition != other.composition) {
+            changed |= capability_composition;
+        }
+        if (frame != other.frame) {
+            changed |= capability_frame;
+        }
+        if (color_depth != other.color_depth) {
+            changed |= capability_color_depth;
+        }
+        if (high_contrast != other.high_contrast) {
+            changed |= capability_high_contrast;
+        }
+        if (reduced_motion != other.reduced_motion) {
+            changed |= capability_reduced_motion;
+        }
+        return changed;
+    }
+
+    auto format_capability_stats(const CapabilityStats &stats) -> std::string {
+        char line[200];
+        std::snprintf(line, sizeof(line),
+                      "system capabilities: %llu refreshes, %llu queries, %llu changes, %llu notifications\n",
+                      static_cast<unsigned long long>(stats.refreshes),
+                      static_cast<unsigned long long>(stats.queries),
+                      static_cast<unsigned long long>(stats.changes),
+                      static_cast<unsigned long long>(stats.notifications));
+        return line;
+    }
+
+    SystemCapabilities::SystemCapabilities(CapabilityProvider &provider) : provider_(provider) {
+        provider_.query(capability_all, current_);
+        stats_.queries += std::bitset<8>(capability_all).count();
+    }
+
+    auto SystemCapabilities::refresh(uint8_t which) -> uint8_t {
+        which &= capability_all;
+        ++stats_.refreshes;
+        if (which == 0) {
+            return 0;
+        }
+        auto next = current_;
+        provider_.query(which, next);
+        stats_.queries += std::bitset<8>(which).count();
+
+        const auto changed = static_cast<uint8_t>(next.diff(current_) & which);
+        if (changed == 0) {
+            return 0;
+        }
+        const auto before = current_;
+        current_ = next;
+        ++stats_.changes;
+        const CapabilityChange change{before, current_, changed};
+        for (const auto &entry: listeners_) {
+            entry.listener(change);
+            ++stats_.notifications;
+        }
+        return changed;
+    }
+
+    auto SystemCapabilities::subscribe(Listener listener) -> size_t {
+        listeners_.push_back({next_id_, std::move(listener)});
+        return next_id_++;
+    }
+
+    auto SystemCapabilities::unsubscribe(size_t id) -> void {
+        auto it = std::find_if(listeners_.begin(), listeners_.end(), [id](const Entry &e) { return e.id == id; });
+        if (it != listeners_.end()) {
+            listeners_.erase(it);
+        }
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Geometry.hpp"
+
+namespace borderless {
+
+    // the parts of a Capabilities snapshot, as a bit mask of what to refresh or what changed
+    enum Capability : uint8_t {
+        capability_composition = 0b00001,
+        capability_frame = 0b00010,
+        capability_color_depth = 0b00100,
+        capability_high_contrast = 0b01000,
+        capability_reduced_motion = 0b10000,
+        capability_all = 0b11111,
+    };
+
+    struct Capabilities {
+        bool composition = true;     // DWM composition, i.e. aero style and shadows
+        Point frame{};               // resize border (SM_CXFRAME + SM_CXPADDEDBORDER) in DIPs
+        uint32_t color_depth = 32;   // bits per pixel of the display
+        bool high_contrast = false;
+        bool reduced_motion = false; // client area animations are turned off
+
+        // bit mask of the parts that differ from other
+        auto diff(const Capabilities &other) const -> uint8_t;
+    };
+
+    // where the snapshot comes from: the system calls on Windows, a fake in the benchmarks
+    class CapabilityProvider {
+    public:
+        virtual ~CapabilityProvider() = default;
+
+        // fills only the parts in which
+        virtual auto query(uint8_t which, Capabilities &into) -> void = 0;
+    };
+
+    struct CapabilityChange {
+        const Capabilities &before;
+        const Capabilities &after;
+        uint8_t changed; // Capability bits
+    };
+
+    struct CapabilityStats {
+        uint64_t refreshes = 0;
+        uint64_t queries = 0;       // parts asked from the provider
+        uint64_t changes = 0;       // refreshes that changed something
+        uint64_t notifications = 0; // listener calls
+    };
+
+    auto format_capability_stats(const CapabilityStats &stats) -> std::string;
+
+    /* A snapshot of the system settings the window looks at all the time, so WM_NCACTIVATE and
+     * friends read a struct instead of calling DwmIsCompositionEnabled or SystemParametersInfo.
+     * The shell calls refresh() with the parts a broadcast message may have changed
+     * (WM_DWMCOMPOSITIONCHANGED, WM_SETTINGCHANGE, WM_DISPLAYCHANGE, WM_THEMECHANGED); only those are
+     * queried, and listeners hear about the ones that actually changed.
+     */
+    class SystemCapabilities {
+    public:
+        using Listener = std::function<void(const CapabilityChange &)>;
+
+        // queries everything once
+        explicit SystemCapabilities(CapabilityProvider &provider);
+
+        auto snapshot() const -> const Capabilities & { return current_; }
+
+        // re-queries the parts in which; returns the ones that changed
+        auto refresh(uint8_t which = capability_all) -> uint8_t;
+
+        // returns an id for unsubscribe
+        auto subscribe(Listener listener) -> size_t;
+
+        auto unsubscribe(size_t id) -> void;
+
+        auto stats() const -> const CapabilityStats & { return stats_; }
+
+    private:
+        struct Entry {
+            size_t id;
+            Listener listener;
+        };
+
+        CapabilityProvider &provider_;
+        Capabilities current_;
+        std::vector<Entry> listeners_;
+        size_t next_id_ = 0;
+        CapabilityStats stats_;
+    };
+}
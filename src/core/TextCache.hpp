@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "LruCache.hpp"
+
+namespace borderless {
+
+    struct TextFormatKey {
+        std::wstring family;
+        uint16_t weight = 400; // same scale as DWRITE_FONT_WEIGHT
+        float size = 12.0f;
+        std::wstring locale = L"en-us";
+    };
+
+    // a layout is the formatted string laid out in a max_width x max_height box
+    struct TextLayoutKey {
+        TextFormatKey format;
+        std::wstring text;
+        float max_width = 0.0f;
+        float max_height = 0.0f;
+    };
+
+    inline auto operator==(const TextFormatKey &a, const TextFormatKey &b) -> bool {
+        return a.weight == b.weight && a.size == b.size && a.family == b.family && a.locale == b.locale;
+    }
+
+    inline auto operator==(const TextLayoutKey &a, const TextLayoutKey &b) -> bool {
+        return a.max_width == b.max_width && a.max_height == b.max_height &&
+               a.format == b.format && a.text == b.text;
+    }
+
+    namespace detail {
+        inline auto hash_combine(size_t seed, size_t value) -> size_t {
+            return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+        }
+    }
+
+    struct TextFormatKeyHash {
+        auto operator()(const TextFormatKey &key) const -> size_t {
+            size_t h = std::hash<std::wstring>{}(key.family);
+            h = detail::hash_combine(h, std::hash<uint16_t>{}(key.weight));
+            h = detail::hash_combine(h, std::hash<float>{}(key.size));
+            return detail::hash_combine(h, std::hash<std::wstring>{}(key.locale));
+        }
+    };
+
+    struct TextLayoutKeyHash {
+        auto operator()(const TextLayoutKey &key) const -> size_t {
+            size_t h = TextFormatKeyHash{}(key.format);
+            h = detail::hash_combine(h, std::hash<std::wstring>{}(key.text));
+            h = detail::hash_combine(h, std::hash<float>{}(key.max_width));
+            return detail::hash_combine(h, std::hash<float>{}(key.max_height));
+        }
+    };
+
+    /* Keyed cache of text formats and immutable text layouts.
+     * Backend supplies the platform objects:
+     *   using Format = ...; using Layout = ...;
+     *   auto create_format(const TextFormatKey &) -> Format;
+     *   auto create_layout(const Format &, const TextLayoutKey &) -> Layout;
+     * Callers keep their keys around between frames, so a steady-state lookup is a hash and a
+     * compare with no allocation.
+     */
+    template<typename Backend>
+    class TextCache {
+    public:
+        using Format = typename Backend::Format;
+        using Layout = typename Backend::Layout;
+
+        explicit TextCache(Backend backend, size_t format_capacity = 32, size_t layout_capacity = 256) :
+                backend_(std::move(backend)),
+                formats_(format_capacity),
+                layouts_(layout_capacity) {}
+
+        auto format(const TextFormatKey &key) -> const Format & {
+            return formats_.get_or_create(key, [&] { return backend_.create_format(key); });
+        }
+
+        auto layout(const TextLayoutKey &key) -> const Layout & {
+            if (auto layout = layouts_.find(key)) {
+                return *layout;
+            }
+            const auto &text_format = format(key.format);
+            return layouts_.insert(key, backend_.create_layout(text_format, key));
+        }
+
+        // drops every cached object, e.g. after a DPI change or device loss
+        auto clear() -> void {
+            layouts_.clear();
+            formats_.clear();
+        }
+
+        auto format_stats() const -> const CacheStats & { return formats_.stats(); }
+
+        auto layout_stats() const -> const CacheStats & { return layouts_.stats(); }
+
+        auto format_count() const -> size_t { return formats_.size(); }
+
+        auto layout_count() const -> size_t { return layouts_.size(); }
+
+        auto backend() -> Backend & { return backend_; }
+
+    private:
+        Backend backend_;
+        LruCache<TextFormatKey, Format, TextFormatKeyHash> formats_;
+        LruCache<TextLayoutKey, Layout, TextLayoutKeyHash> layouts_;
+    };
+}
@@ -0,0 +1,279 @@
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <thread>
+
+namespace borderless::trace {
+
+    namespace {
+        constexpr const char *event_names[] = {
+                "window_message",
+                "frame",
+                "render_scene",
+                "present",
+                "resize_swap_chain",
+                "render_command",
+                "tray_popup",
+                "startup_stage",
+                "animation_tick",
+                "composition_commit",
+                "layer_update",
+                "layer_change",
+                "device_rebuild",
+        };
+        static_assert(std::size(event_names) == static_cast<size_t>(Event::count), "a name for every event");
+
+        constexpr char file_magic[4] = {'B', 'T', 'R', 'C'};
+        constexpr uint32_t file_version = 1;
+
+        struct Registry {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+            size_t capacity = size_t{1} << 16;
+        };
+
+        auto registry() -> Registry & {
+            static Registry instance;
+            return instance;
+        }
+
+        auto round_up(size_t capacity) -> size_t {
+            size_t result = 2;
+            while (result < capacity) {
+                result *= 2;
+            }
+            return result;
+        }
+
+        template<typename T>
+        auto write(std::FILE *file, const T &value) -> bool {
+            return std::fwrite(&value, sizeof(T), 1, file) == 1;
+        }
+
+        template<typename T>
+        auto read(std::FILE *file, T &value) -> bool {
+            return std::fread(&value, sizeof(T), 1, file) == 1;
+        }
+
+        auto append_escaped(std::string &out, const std::string &text) -> void {
+            for (const char c: text) {
+                if (c == '"' || c == '\\') {
+                    out += '\\';
+                }
+                if (static_cast<unsigned char>(c) >= 0x20) {
+                    out += c;
+                }
+            }
+        }
+    }
+
+    auto event_name(Event event) -> const char * {
+        const auto index = static_cast<size_t>(event);
+        return index < std::size(event_names) ? event_names[index] : "unknown";
+    }
+
+    ThreadBuffer::ThreadBuffer(uint32_t id, size_t capacity) :
+            thread_id(id),
+            mask(round_up(capacity) - 1),
+            records(std::make_unique<Record[]>(mask + 1)) {}
+
+    auto ticks_per_second() -> double {
+#if defined(BORDERLESS_TRACE_TSC)
+        // measured once against steady_clock; 20 ms keep the error well below 0.1%
+        static const double rate = [] {
+            using Clock = std::chrono::steady_clock;
+            const auto start = Clock::now();
+            const auto start_ticks = ticks();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            const auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            return static_cast<double>(ticks() - start_ticks) / elapsed;
+        }();
+        return rate;
+#else
+        return static_cast<double>(std::chrono::steady_clock::period::den) /
+               static_cast<double>(std::chrono::steady_clock::period::num);
+#endif
+    }
+
+    auto detail::register_thread() -> ThreadBuffer * {
+        auto &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.buffers.push_back(std::make_unique<ThreadBuffer>(static_cast<uint32_t>(r.buffers.size() + 1), r.capacity));
+        buffer = r.buffers.back().get();
+        return buffer;
+    }
+
+    auto set_enabled(bool enabled) -> void {
+        if (enabled) {
+            ticks_per_second(); // calibrate now rather than inside the first dump
+        }
+        detail::enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    auto set_buffer_capacity(size_t records) -> void {
+        auto &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.capacity = records;
+    }
+
+    auto set_thread_name(const char *name) -> void {
+        auto buffer = detail::buffer ? detail::buffer : detail::register_thread();
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        buffer->name = name;
+    }
+
+    auto snapshot() -> Snapshot {
+        Snapshot result;
+        result.ticks_per_second = ticks_per_second();
+        auto &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (const auto &buffer: r.buffers) {
+            ThreadTrace thread;
+            thread.thread_id = buffer->thread_id;
+            thread.name = buffer->name;
+            const auto head = buffer->head.load(std::memory_order_acquire);
+            const auto capacity = static_cast<uint64_t>(buffer->mask) + 1;
+            const auto first = head > capacity ? head - capacity : 0;
+            thread.dropped = first;
+            thread.records.reserve(static_cast<size_t>(head - first));
+            for (auto i = first; i < head; ++i) {
+                thread.records.push_back(buffer->records[i & buffer->mask]);
+            }
+            result.threads.push_back(std::move(thread));
+        }
+        return result;
+    }
+
+    auto clear() -> void {
+        auto &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (auto &buffer: r.buffers) {
+            buffer->head.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    auto save(const Snapshot &snapshot, const std::string &path) -> bool {
+        std::FILE *file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            return false;
+        }
+        bool ok = std::fwrite(file_magic, sizeof(file_magic), 1, file) == 1 &&
+                  write(file, file_version) &&
+                  write(file, snapshot.ticks_per_second) &&
+                  write(file, static_cast<uint32_t>(snapshot.threads.size()));
+        for (const auto &thread: snapshot.threads) {
+            if (!ok) {
+                break;
+            }
+            ok = write(file, thread.thread_id) &&
+                 write(file, static_cast<uint32_t>(thread.name.size())) &&
+                 std::fwrite(thread.name.data(), 1, thread.name.size(), file) == thread.name.size() &&
+                 write(file, thread.dropped) &&
+                 write(file, static_cast<uint64_t>(thread.records.size())) &&
+                 std::fwrite(thread.records.data(), sizeof(Record), thread.records.size(), file) ==
+                 thread.records.size();
+        }
+        return std::fclose(file) == 0 && ok;
+    }
+
+    auto load(const std::string &path, Snapshot &snapshot) -> bool {
+        std::FILE *file = std::fopen(path.c_str(), "rb");
+        if (!file) {
+            return false;
+        }
+        char magic[4];
+        uint32_t version = 0;
+        uint32_t threads = 0;
+        bool ok = std::fread(magic, sizeof(magic), 1, file) == 1 &&
+                  std::memcmp(magic, file_magic, sizeof(magic)) == 0 &&
+                  read(file, version) && version == file_version &&
+                  read(file, snapshot.ticks_per_second) &&
+                  read(file, threads);
+        snapshot.threads.clear();
+        for (uint32_t t = 0; ok && t < threads; ++t) {
+            ThreadTrace thread;
+            uint32_t name_size = 0;
+            uint64_t count = 0;
+            ok = read(file, thread.thread_id) && read(file, name_size) && name_size < 4096;
+            if (ok) {
+                thread.name.resize(name_size);
+                ok = std::fread(thread.name.data(), 1, name_size, file) == name_size &&
+                     read(file, thread.dropped) && read(file, count) && count < (uint64_t{1} << 32);
+            }
+            if (ok) {
+                thread.records.resize(static_cast<size_t>(count));
+                ok = std::fread(thread.records.data(), sizeof(Record), thread.records.size(), file) ==
+                     thread.records.size();
+            }
+            snapshot.threads.push_back(std::move(thread));
+        }
+        std::fclose(file);
+        return ok;
+    }
+
+    auto to_chrome_json(const Snapshot &snapshot) -> std::string {
+        uint64_t origin = UINT64_MAX;
+        for (const auto &thread: snapshot.threads) {
+            for (const auto &record: thread.records) {
+                origin = std::min(origin, record.ticks);
+            }
+        }
+        const double us_per_tick = snapshot.ticks_per_second > 0.0 ? 1e6 / snapshot.ticks_per_second : 0.0;
+
+        std::string out = "{\"traceEvents\":[\n";
+        bool first = true;
+        char line[256];
+        auto separator = [&] {
+            if (!first) {
+                out += ",\n";
+            }
+            first = false;
+        };
+        for (const auto &thread: snapshot.threads) {
+            if (!thread.name.empty()) {
+                separator();
+                std::snprintf(line, sizeof(line),
+                              R"({"name":"thread_name","ph":"M","pid":1,"tid":%u,"args":{"name":")",
+                              thread.thread_id);
+                out += line;
+                append_escaped(out, thread.name);
+                out += "\"}}";
+            }
+            for (const auto &record: thread.records) {
+                const auto ts = static_cast<double>(record.ticks - origin) * us_per_tick;
+                const auto name = event_name(static_cast<Event>(record.event));
+                separator();
+                switch (record.phase) {
+                    case Phase::begin:
+                        std::snprintf(line, sizeof(line),
+                                      R"({"name":"%s","ph":"B","ts":%.3f,"pid":1,"tid":%u,"args":{"arg":%u}})",
+                                      name, ts, thread.thread_id, record.arg);
+                        break;
+                    case Phase::end:
+                        std::snprintf(line, sizeof(line), R"({"name":"%s","ph":"E","ts":%.3f,"pid":1,"tid":%u})",
+                                      name, ts, thread.thread_id);
+                        break;
+                    case Phase::counter:
+                        std::snprintf(line, sizeof(line),
+                                      R"({"name":"%s","ph":"C","ts":%.3f,"pid":1,"tid":%u,"args":{"value":%u}})",
+                                      name, ts, thread.thread_id, record.arg);
+                        break;
+                    case Phase::instant:
+                    default:
+                        std::snprintf(line, sizeof(line),
+                                      R"({"name":"%s","ph":"i","s":"t","ts":%.3f,"pid":1,"tid":%u,"args":{"arg":%u}})",
+                                      name, ts, thread.thread_id, record.arg);
+                        break;
+                }
+                out += line;
+            }
+        }
+        out += "\n]}\n";
+        return out;
+    }
+}
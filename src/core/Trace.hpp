@@ -0,0 +1,187 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 0 compiles every BORDERLESS_TRACE_* macro to nothing
+#ifndef BORDERLESS_TRACE
+#define BORDERLESS_TRACE 1
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define BORDERLESS_TRACE_TSC 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#include <chrono>
+#endif
+
+namespace borderless::trace {
+
+    // compile-time event IDs; append only, the binary trace format stores the numbers
+    enum class Event : uint16_t {
+        window_message,     // arg: message id
+        frame,              // a scheduler tick that rendered and presented
+        render_scene,
+        present,            // arg: dirty rect count, 0 for a full present
+        resize_swap_chain,  // arg: width << 16 | height
+        render_command,     // a command executed on the render thread
+        tray_popup,
+        startup_stage,      // arg: stage id
+        animation_tick,     // arg: running animations
+        composition_commit, // arg: windows with property or layer changes
+        layer_update,       // arg: layer id, its content changed this frame
+        layer_change,       // arg: layer id << 2 | LayerPlacement
+        device_rebuild,     // arg: resources declared
+        count
+    };
+
+    auto event_name(Event event) -> const char *;
+
+    enum class Phase : uint8_t {
+        instant,
+        begin,
+        end,
+        counter,
+    };
+
+    struct Record {
+        uint64_t ticks;
+        uint16_t event;
+        Phase phase;
+        uint8_t reserved;
+        uint32_t arg;
+    };
+    static_assert(sizeof(Record) == 16, "four records per cache line");
+
+    // one per thread that ever emitted; only its own thread writes, and it is never freed
+    struct ThreadBuffer {
+        explicit ThreadBuffer(uint32_t id, size_t capacity);
+
+        uint32_t thread_id;
+        std::string name;
+        size_t mask;
+        std::unique_ptr<Record[]> records;
+        std::atomic<uint64_t> head{0}; // records written so far, wraps over the oldest
+    };
+
+    // invariant TSC on x86 (calibrated against steady_clock for the dump), steady_clock elsewhere
+    inline auto ticks() -> uint64_t {
+#if defined(BORDERLESS_TRACE_TSC)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    auto ticks_per_second() -> double;
+
+    namespace detail {
+        inline std::atomic<bool> enabled{false};
+        inline thread_local ThreadBuffer *buffer = nullptr;
+
+        auto register_thread() -> ThreadBuffer *;
+    }
+
+    inline auto enabled() -> bool { return detail::enabled.load(std::memory_order_relaxed); }
+
+    auto set_enabled(bool enabled) -> void;
+
+    // records per thread buffer for threads that register after this call; 2^16 by default
+    auto set_buffer_capacity(size_t records) -> void;
+
+    // names the calling thread in the dump
+    auto set_thread_name(const char *name) -> void;
+
+    inline auto emit(Event event, Phase phase, uint32_t arg = 0) -> void {
+        auto buffer = detail::buffer;
+        if (!buffer) {
+            buffer = detail::register_thread();
+        }
+        const auto head = buffer->head.load(std::memory_order_relaxed);
+        buffer->records[head & buffer->mask] = {ticks(), static_cast<uint16_t>(event), phase, 0, arg};
+        buffer->head.store(head + 1, std::memory_order_release);
+    }
+
+    class Scope {
+    public:
+        Scope(Event event, uint32_t arg) : event_(event), active_(enabled()) {
+            if (active_) {
+                emit(event, Phase::begin, arg);
+            }
+        }
+
+        ~Scope() {
+            if (active_) {
+                emit(event_, Phase::end);
+            }
+        }
+
+        Scope(const Scope &) = delete;
+
+        auto operator=(const Scope &) -> Scope & = delete;
+
+    private:
+        Event event_;
+        bool active_;
+    };
+
+    struct ThreadTrace {
+        uint32_t thread_id = 0;
+        std::string name;
+        uint64_t dropped = 0; // overwritten before the snapshot
+        std::vector<Record> records;
+    };
+
+    struct Snapshot {
+        double ticks_per_second = 0.0;
+        std::vector<ThreadTrace> threads;
+    };
+
+    // copies every thread's ring, oldest first; records a thread writes meanwhile may be torn
+    auto snapshot() -> Snapshot;
+
+    // forgets recorded events on every thread; only call while no thread is emitting
+    auto clear() -> void;
+
+    // compact binary dump, converted offline by tools/trace_dump
+    auto save(const Snapshot &snapshot, const std::string &path) -> bool;
+
+    auto load(const std::string &path, Snapshot &snapshot) -> bool;
+
+    // Chrome trace-event JSON (chrome://tracing, Perfetto); timestamps relative to the first record
+    auto to_chrome_json(const Snapshot &snapshot) -> std::string;
+}
+
+#define BORDERLESS_TRACE_CONCAT_(a, b) a##b
+#define BORDERLESS_TRACE_CONCAT(a, b) BORDERLESS_TRACE_CONCAT_(a, b)
+
+#if BORDERLESS_TRACE
+#define BORDERLESS_TRACE_INSTANT(event, arg)                                                       \
+    do {                                                                                           \
+        if (::borderless::trace::enabled()) {                                                      \
+            ::borderless::trace::emit(event, ::borderless::trace::Phase::instant,                  \
+                                      static_cast<uint32_t>(arg));                                 \
+        }                                                                                          \
+    } while (0)
+#define BORDERLESS_TRACE_COUNTER(event, value)                                                     \
+    do {                                                                                           \
+        if (::borderless::trace::enabled()) {                                                      \
+            ::borderless::trace::emit(event, ::borderless::trace::Phase::counter,                  \
+                                      static_cast<uint32_t>(value));                               \
+        }                                                                                          \
+    } while (0)
+#define BORDERLESS_TRACE_SCOPE(event, arg)                                                         \
+    ::borderless::trace::Scope BORDERLESS_TRACE_CONCAT(trace_scope_, __LINE__)(event, static_cast<uint32_t>(arg))
+#else
+#define BORDERLESS_TRACE_INSTANT(event, arg) ((void)0)
+#define BORDERLESS_TRACE_COUNTER(event, value) ((void)0)
+#define BORDERLESS_TRACE_SCOPE(event, arg) ((void)0)
+#endif
@@ -0,0 +1,88 @@
+#include "TrayPopup.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace borderless {
+
+    auto format_tray_popup_stats(const TrayPopupStats &stats) -> std::string {
+        char line[200];
+        std::snprintf(line, sizeof(line),
+                      "tray popup: %llu created (%llu on hover), %llu shown (%llu reused), %llu hidden, "
+                      "click to visible p50 %llu us, p99 %llu us\n",
+                      static_cast<unsigned long long>(stats.created),
+                      static_cast<unsigned long long>(stats.prewarmed),
+                      static_cast<unsigned long long>(stats.shown),
+                      static_cast<unsigned long long>(stats.reused),
+                      static_cast<unsigned long long>(stats.hidden),
+                      static_cast<unsigned long long>(stats.click_to_visible.percentile(0.50) / 1000),
+                      static_cast<unsigned long long>(stats.click_to_visible.percentile(0.99) / 1000));
+        return line;
+    }
+
+    auto popup_origin(Point anchor, Size popup, Rect work_area) -> Point {
+        Point origin{anchor.x - popup.width / 2, anchor.y - popup.height};
+        if (origin.y < work_area.top) {
+            origin.y = anchor.y;
+        }
+        // the left/top edge wins when the popup is larger than the work area
+        origin.x = std::max(std::min(origin.x, work_area.right - popup.width), work_area.left);
+        origin.y = std::max(std::min(origin.y, work_area.bottom - popup.height), work_area.top);
+        return origin;
+    }
+
+    auto TrayPopupState::created() -> void {
+        if (state_ != PopupState::absent) {
+            return;
+        }
+        ++stats_.created;
+        if (pending_click_) {
+            state_ = PopupState::showing;
+        } else {
+            ++stats_.prewarmed;
+            state_ = PopupState::hidden;
+        }
+    }
+
+    auto TrayPopupState::show(Clock::time_point clicked) -> bool {
+        ++stats_.shown;
+        pending_click_ = clicked;
+        if (state_ == PopupState::absent) {
+            return true;
+        }
+        ++stats_.reused;
+        // a click while it is up just moves it
+        state_ = PopupState::showing;
+        return false;
+    }
+
+    auto TrayPopupState::visible(Clock::time_point now) -> void {
+        if (state_ != PopupState::showing) {
+            return;
+        }
+        if (pending_click_) {
+            const auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(now - *pending_click_);
+            stats_.click_to_visible.record(static_cast<uint64_t>(std::max<int64_t>(latency.count(), 0)));
+            pending_click_.reset();
+        }
+        state_ = PopupState::visible;
+    }
+
+    auto TrayPopupState::hide() -> bool {
+        if (state_ != PopupState::showing && state_ != PopupState::visible) {
+            return false;
+        }
+        ++stats_.hidden;
+        pending_click_.reset();
+        state_ = PopupState::hidden;
+        return true;
+    }
+
+    auto TrayPopupState::destroyed() -> void {
+        if (state_ != PopupState::absent) {
+            ++stats_.destroyed;
+        }
+        pending_click_.reset();
+        state_ = PopupState::absent;
+    }
+}
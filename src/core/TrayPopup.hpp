@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "Geometry.hpp"
+#include "MessageDispatcher.hpp"
+
+namespace borderless {
+
+    enum class PopupState : uint8_t {
+        absent,  // no window yet, or it was destroyed
+        hidden,
+        showing, // a click asked for it, not on screen yet
+        visible,
+    };
+
+    struct TrayPopupStats {
+        uint64_t created = 0;
+        uint64_t prewarmed = 0; // created on hover, ahead of a click
+        uint64_t shown = 0;
+        uint64_t reused = 0;    // shown without creating a window first
+        uint64_t hidden = 0;
+        uint64_t destroyed = 0;
+        LatencyHistogram click_to_visible;
+    };
+
+    auto format_tray_popup_stats(const TrayPopupStats &stats) -> std::string;
+
+    // centred above the anchor (the click on a bottom task bar), below it when there is no room
+    // above, and moved inside the work area
+    auto popup_origin(Point anchor, Size popup, Rect work_area) -> Point;
+
+    /* The lifecycle of the tray popup, without the window: it is created at most once, on hover or
+     * on the first click, and is then only shown and hidden. The shell reports what happened and is
+     * told when to create the window; each click is timed until the popup is visible.
+     */
+    class TrayPopupState {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        auto state() const -> PopupState { return state_; }
+
+        // the cursor is over the tray icon; true when the window should be created now
+        auto prewarm() -> bool { return state_ == PopupState::absent && !pending_click_; }
+
+        // the window exists; shows it if a click is waiting for it
+        auto created() -> void;
+
+        // a click at clicked; true when the window has to be created first
+        auto show(Clock::time_point clicked) -> bool;
+
+        // the window is on screen
+        auto visible(Clock::time_point now) -> void;
+
+        // true when the window was shown and should be hidden now
+        auto hide() -> bool;
+
+        auto destroyed() -> void;
+
+        auto stats() const -> const TrayPopupStats & { return stats_; }
+
+    private:
+        PopupState state_ = PopupState::absent;
+        std::optional<Clock::time_point> pending_click_;
+        TrayPopupStats stats_;
+    };
+}
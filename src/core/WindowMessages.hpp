@@ -0,0 +1,217 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include "Geometry.hpp"
+#include "MessageDispatcher.hpp"
+#include "SystemCapabilities.hpp"
+
+namespace borderless {
+
+    // the Win32 ids and codes the handlers use; the shell checks them against windows.h
+    namespace wm {
+        constexpr uint32_t move = 0x0003;
+        constexpr uint32_t size = 0x0005;
+        constexpr uint32_t close = 0x0010;
+        constexpr uint32_t destroy = 0x0002;
+        constexpr uint32_t setting_change = 0x001A;
+        constexpr uint32_t display_change = 0x007E;
+        constexpr uint32_t nccalcsize = 0x0083;
+        constexpr uint32_t nchittest = 0x0084;
+        constexpr uint32_t ncactivate = 0x0086;
+        constexpr uint32_t keydown = 0x0100;
+        constexpr uint32_t syskeydown = 0x0104;
+        constexpr uint32_t timer = 0x0113;
+        constexpr uint32_t mousemove = 0x0200;
+        constexpr uint32_t lbuttondblclk = 0x0203;
+        constexpr uint32_t rbuttondown = 0x0204;
+        constexpr uint32_t exitsizemove = 0x0232;
+        constexpr uint32_t dpichanged = 0x02E0;
+        constexpr uint32_t themechanged = 0x031A;
+        constexpr uint32_t dwmcompositionchanged = 0x031E;
+        constexpr uint32_t tray_icon = 0x0401; // WM_USER + 1
+
+        constexpr uintptr_t size_minimized = 1;
+        constexpr uintptr_t size_maximized = 2;
+        constexpr uintptr_t resize_timer = 1;
+
+        constexpr uintptr_t vk_f7 = 0x76;
+        constexpr uintptr_t vk_f8 = 0x77;
+        constexpr uintptr_t vk_f9 = 0x78;
+        constexpr uintptr_t vk_f10 = 0x79;
+        constexpr uintptr_t vk_f11 = 0x7A;
+
+        constexpr uintptr_t spi_set_nonclient_metrics = 0x002A;
+        constexpr uintptr_t spi_set_high_contrast = 0x0043;
+        constexpr uintptr_t spi_set_client_area_animation = 0x1043;
+
+        inline auto x_of(intptr_t lparam) -> int32_t { return static_cast<int16_t>(lparam & 0xFFFF); }
+
+        inline auto y_of(intptr_t lparam) -> int32_t { return static_cast<int16_t>((lparam >> 16) & 0xFFFF); }
+
+        inline auto low_word(uint64_t value) -> uint32_t { return static_cast<uint32_t>(value & 0xFFFF); }
+
+        inline auto high_word(uint64_t value) -> uint32_t { return static_cast<uint32_t>((value >> 16) & 0xFFFF); }
+    }
+
+    // the parts of the capability snapshot a WM_SETTINGCHANGE with this SPI_SET* action may have changed
+    inline auto capabilities_changed_by_setting(uintptr_t action) -> uint8_t {
+        switch (action) {
+            case wm::spi_set_nonclient_metrics:
+                return capability_frame;
+            case wm::spi_set_high_contrast:
+                return capability_high_contrast;
+            case wm::spi_set_client_area_animation:
+                return capability_reduced_motion;
+            case 0:
+                // policy, locale or theme changes name no action
+                return capability_frame | capability_high_contrast | capability_reduced_motion;
+            default:
+                return 0;
+        }
+    }
+
+    /* The message handlers of a borderless window, registered by the shell's BorderlessWindow and by
+     * the headless ReplayWindow alike, so a replay runs the shell's own decisions. What needs a real
+     * window is left to Window, which befriends WindowMessages<Window> and provides:
+     *   is_borderless(), has_composition(), has_shadow(), target_opacity()  current state
+     *   hit_tests() -> HitTester &, hit_test(Point) -> integer HT* code
+     *   fit_client_area(message)        WM_NCCALCSIZE of a borderless window, the client takes it all
+     *   resize_client(size, maximized)  after WM_SIZE; flush_resize() applies a pending one now
+     *   moved(origin), change_dpi(dpi, message), invalidate_monitors(), refresh_capabilities(changed)
+     *   set_borderless(bool), set_borderless_shadow(bool), set_opacity(float)
+     *   show_tray_popup(), prewarm_tray_popup(), restore(), close(), destroyed()
+     */
+    template<typename Window>
+    struct WindowMessages {
+        using Dispatcher = MessageDispatcher<Window>;
+        using Result = std::optional<intptr_t>;
+
+        static auto register_handlers(Dispatcher &d) -> void {
+            d.on(wm::tray_icon, "WM_TRAY_ICON", [](Window &window, const Message &m) -> Result {
+                switch (wm::low_word(static_cast<uint64_t>(m.lparam))) {
+                    case wm::rbuttondown:
+                        window.show_tray_popup();
+                        return 0;
+                    case wm::lbuttondblclk:
+                        window.restore();
+                        return 0;
+                    case wm::mousemove:
+                        // hovering the icon usually comes before a click; have the popup ready by then
+                        window.prewarm_tray_popup();
+                        return std::nullopt;
+                }
+                return std::nullopt;
+            });
+            d.on(wm::nccalcsize, "WM_NCCALCSIZE", [](Window &window, const Message &m) -> Result {
+                if (m.wparam && window.is_borderless()) {
+                    window.fit_client_area(m);
+                    return 0;
+                }
+                return std::nullopt;
+            });
+            d.on(wm::nchittest, "WM_NCHITTEST", [](Window &window, const Message &m) -> Result {
+                // When we have no border or title bar, we need to perform our
+                // own hit testing to allow resizing and moving.
+                if (window.is_borderless()) {
+                    return static_cast<intptr_t>(window.hit_test({wm::x_of(m.lparam), wm::y_of(m.lparam)}));
+                }
+                return std::nullopt;
+            });
+            d.on(wm::size, "WM_SIZE", [](Window &window, const Message &m) -> Result {
+                window.hit_tests().invalidate();
+                if (m.wparam != wm::size_minimized) {
+                    const auto lparam = static_cast<uint64_t>(m.lparam);
+                    window.resize_client({static_cast<int32_t>(wm::low_word(lparam)),
+                                          static_cast<int32_t>(wm::high_word(lparam))},
+                                         m.wparam == wm::size_maximized);
+                }
+                return std::nullopt;
+            });
+            d.on(wm::exitsizemove, "WM_EXITSIZEMOVE", [](Window &window, const Message &) -> Result {
+                window.flush_resize();
+                return std::nullopt;
+            });
+            d.on(wm::timer, "WM_TIMER", [](Window &window, const Message &m) -> Result {
+                if (m.wparam == wm::resize_timer) {
+                    window.flush_resize();
+                    return 0;
+                }
+                return std::nullopt;
+            });
+            // window geometry or frame metrics changed, re-query on the next WM_NCHITTEST
+            d.on(wm::move, "WM_MOVE", [](Window &window, const Message &m) -> Result {
+                window.hit_tests().invalidate();
+                window.moved({wm::x_of(m.lparam), wm::y_of(m.lparam)});
+                return std::nullopt;
+            });
+            d.on(wm::dpichanged, "WM_DPICHANGED", [](Window &window, const Message &m) -> Result {
+                window.invalidate_monitors();
+                window.change_dpi(wm::low_word(m.wparam), m);
+                return 0;
+            });
+            // and so may the monitors (resolution, work area) and the system settings in the snapshot
+            d.on(wm::setting_change, "WM_SETTINGCHANGE", [](Window &window, const Message &m) -> Result {
+                window.invalidate_monitors();
+                window.hit_tests().invalidate();
+                window.refresh_capabilities(capabilities_changed_by_setting(m.wparam));
+                return std::nullopt;
+            });
+            d.on(wm::display_change, "WM_DISPLAYCHANGE", [](Window &window, const Message &) -> Result {
+                window.invalidate_monitors();
+                window.hit_tests().invalidate();
+                window.refresh_capabilities(capability_color_depth);
+                return std::nullopt;
+            });
+            d.on(wm::dwmcompositionchanged, "WM_DWMCOMPOSITIONCHANGED", [](Window &window, const Message &) -> Result {
+                window.refresh_capabilities(capability_composition);
+                return std::nullopt;
+            });
+            d.on(wm::themechanged, "WM_THEMECHANGED", [](Window &window, const Message &) -> Result {
+                window.refresh_capabilities(capability_frame | capability_high_contrast);
+                return std::nullopt;
+            });
+            d.on(wm::ncactivate, "WM_NCACTIVATE", [](Window &window, const Message &) -> Result {
+                if (!window.has_composition()) {
+                    // Prevents window frame reappearing on window activation
+                    // in "basic" theme, where no aero shadow is present.
+                    return 1;
+                }
+                return std::nullopt;
+            });
+            d.on(wm::close, "WM_CLOSE", [](Window &window, const Message &) -> Result {
+                window.close();
+                return 0;
+            });
+            d.on(wm::destroy, "WM_DESTROY", [](Window &window, const Message &) -> Result {
+                window.destroyed();
+                return 0;
+            });
+            auto key_down = [](Window &window, const Message &m) -> Result {
+                auto &hit_tests = window.hit_tests();
+                switch (m.wparam) {
+                    case wm::vk_f8:
+                        hit_tests.set_draggable(!hit_tests.draggable());
+                        return 0;
+                    case wm::vk_f9:
+                        hit_tests.set_resizable(!hit_tests.resizable());
+                        return 0;
+                    case wm::vk_f10:
+                        window.set_borderless(!window.is_borderless());
+                        return 0;
+                    case wm::vk_f11:
+                        window.set_borderless_shadow(!window.has_shadow());
+                        return 0;
+                    case wm::vk_f7:
+                        window.set_opacity(window.target_opacity() < 1.0f ? 1.0f : 0.5f);
+                        return 0;
+                    default:
+                        return std::nullopt;
+                }
+            };
+            d.on(wm::keydown, "WM_KEYDOWN", key_down);
+            d.on(wm::syskeydown, "WM_SYSKEYDOWN", key_down);
+        }
+    };
+}
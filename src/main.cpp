@@ -1,11 +1,45 @@
-#include "pch.h"
+﻿#include "pch.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string_view>
 
 #include "BorderlessWindow.hpp"
+#include "core/MessageRecording.hpp"
+#include "core/Trace.hpp"
 
-int main() {
+int main(int argc, char **argv) {
     try {
+        // render at the DPI of whichever monitor a window is on instead of letting DWM stretch it;
+        // must come before the first window
+        ::SetProcessDpiAwarenessContext(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2);
+        bool render_thread = false;
+        bool trace = false;
+        bool record = false;
+        int windows = 1;
+        for (int i = 1; i < argc; ++i) {
+            render_thread |= std::string_view(argv[i]) == "--render-thread";
+            trace |= std::string_view(argv[i]) == "--trace";
+            record |= std::string_view(argv[i]) == "--record";
+            if (std::string_view(argv[i]) == "--windows" && i + 1 < argc) {
+                windows = std::max(1, std::atoi(argv[++i]));
+            }
+        }
+        if (trace) {
+            borderless::trace::set_thread_name("ui");
+            borderless::trace::set_enabled(true);
+        }
 //        BorderlessWindow window;
-        BorderlessWindow::RunApp();
+        borderless::MessageRecorder recorder;
+        BorderlessWindow::RunApp(render_thread, windows, record ? &recorder : nullptr);
+        if (trace) {
+            // tools/trace_dump turns this into Chrome trace-event JSON
+            borderless::trace::save(borderless::trace::snapshot(), "borderless.trace");
+        }
+        if (record) {
+            // tools/message_replay replays this headless
+            recorder.save("borderless.messages");
+        }
     }
     catch (const std::exception &e) {
         ::MessageBoxA(nullptr, e.what(), "Unhandled Exception", MB_OK | MB_ICONERROR);
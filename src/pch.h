@@ -18,12 +18,14 @@
 #include <d2d1_2.h>
 #include <d2d1_2helper.h>
 #include <dcomp.h>
+#include <shellscalingapi.h>
 #include <dwrite.h>
 #include <wincodec.h>
 #pragma comment(lib, "dxgi")
 #pragma comment(lib, "d3d11")
 #pragma comment(lib, "d2d1")
 #pragma comment(lib, "dcomp")
+#pragma comment(lib, "shcore")
 
 using namespace Microsoft::WRL;
 
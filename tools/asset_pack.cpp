@@ -0,0 +1,65 @@
+// Builds an asset pack (see src/core/AssetPack.hpp) from loose files; the build runs it to turn
+// assets/ into assets.pack next to the executable. Entries are named after the file name.
+//
+//   asset_pack assets.pack [--store] penguin.ico ...
+//
+// --store keeps the files that follow it uncompressed.
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "core/AssetPack.hpp"
+
+using namespace borderless;
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        std::fprintf(stderr, "usage: asset_pack <output.pack> [--store] <files...>\n");
+        return 2;
+    }
+    const std::filesystem::path output = argv[1];
+
+    AssetPackWriter writer;
+    bool compress = true;
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--store") {
+            compress = false;
+            continue;
+        }
+        const std::filesystem::path path = arg;
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            std::fprintf(stderr, "asset_pack: cannot read %s\n", arg.c_str());
+            return 1;
+        }
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::printf("  %-24s %10zu bytes\n", path.filename().string().c_str(), data.size());
+        writer.add(path.filename().string(), std::move(data), compress);
+    }
+
+    if (!writer.write(output)) {
+        std::fprintf(stderr, "asset_pack: cannot write %s\n", output.string().c_str());
+        return 1;
+    }
+
+    // read it back, catching a broken writer at build time rather than at startup
+    AssetPack pack;
+    if (!pack.open(output)) {
+        std::fprintf(stderr, "asset_pack: %s: %s\n", output.string().c_str(), pack.error().c_str());
+        return 1;
+    }
+    for (const auto name: pack.names()) {
+        if (!pack.get(name)) {
+            std::fprintf(stderr, "asset_pack: %.*s does not decode\n", static_cast<int>(name.size()), name.data());
+            return 1;
+        }
+    }
+    std::printf("wrote %s, %zu assets, %llu bytes\n", output.string().c_str(), pack.size(),
+                static_cast<unsigned long long>(std::filesystem::file_size(output)));
+    return 0;
+}
@@ -0,0 +1,45 @@
+// Replays window messages saved with --record through the window's own message handlers, headless,
+// and prints the run and what each message type cost.
+//
+//   message_replay borderless.messages [--recorded-pace]
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "core/MessageReplay.hpp"
+
+using namespace borderless;
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: message_replay <input.messages> [--recorded-pace]\n");
+        return 2;
+    }
+    const std::string input = argv[1];
+    ReplayOptions options;
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--recorded-pace") == 0) {
+            options.recorded_pace = true;
+        } else {
+            std::fprintf(stderr, "message_replay: unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    std::vector<RecordedMessage> messages;
+    if (!load_messages(input, messages)) {
+        std::fprintf(stderr, "message_replay: cannot read %s\n", input.c_str());
+        return 1;
+    }
+
+    const auto report = replay(messages, options);
+    std::printf("%s", format_replay_report(report).c_str());
+    if (!ReplayWindow::Dispatcher::instrumented()) {
+        std::printf("built without BORDERLESS_MESSAGE_STATS, no per-message costs\n");
+        return 0;
+    }
+    std::printf("%s", format_message_stats(ReplayWindow::dispatcher().stats()).c_str());
+    return 0;
+}
@@ -0,0 +1,59 @@
+// Converts a binary trace written by borderless::trace::save into Chrome trace-event JSON
+// (load it in chrome://tracing or ui.perfetto.dev) and prints per-event totals.
+//
+//   trace_dump borderless.trace [borderless.json]
+
+#include <cstdio>
+#include <map>
+#include <string>
+
+#include "core/Trace.hpp"
+
+using namespace borderless;
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: trace_dump <input.trace> [output.json]\n");
+        return 2;
+    }
+    const std::string input = argv[1];
+    std::string output = argc > 2 ? argv[2] : input;
+    if (argc <= 2) {
+        const auto dot = output.find_last_of('.');
+        output = (dot == std::string::npos ? output : output.substr(0, dot)) + ".json";
+    }
+
+    trace::Snapshot snapshot;
+    if (!trace::load(input, snapshot)) {
+        std::fprintf(stderr, "trace_dump: cannot read %s\n", input.c_str());
+        return 1;
+    }
+
+    std::map<std::string, uint64_t> per_event;
+    for (const auto &thread: snapshot.threads) {
+        std::printf("thread %u %-12s %10zu events %10llu dropped\n", thread.thread_id,
+                    thread.name.empty() ? "-" : thread.name.c_str(), thread.records.size(),
+                    static_cast<unsigned long long>(thread.dropped));
+        for (const auto &record: thread.records) {
+            if (record.phase != trace::Phase::end) {
+                ++per_event[trace::event_name(static_cast<trace::Event>(record.event))];
+            }
+        }
+    }
+    for (const auto &[name, count]: per_event) {
+        std::printf("  %-20s %10llu\n", name.c_str(), static_cast<unsigned long long>(count));
+    }
+
+    const auto json = trace::to_chrome_json(snapshot);
+    std::FILE *file = std::fopen(output.c_str(), "wb");
+    if (!file || std::fwrite(json.data(), 1, json.size(), file) != json.size()) {
+        std::fprintf(stderr, "trace_dump: cannot write %s\n", output.c_str());
+        if (file) {
+            std::fclose(file);
+        }
+        return 1;
+    }
+    std::fclose(file);
+    std::printf("wrote %s\n", output.c_str());
+    return 0;
+}